@@ -49,6 +49,7 @@
 #include "clutter-color.h"
 #include "clutter-main.h"
 #include "clutter-text.h"
+#include "clutter-text-buffer-private.h"
 
 static void cally_text_finalize   (GObject *obj);
 
@@ -123,6 +124,14 @@ static gint                  cally_text_get_offset_at_point      (AtkText *text,
 static void                  _cally_text_get_selection_bounds    (ClutterText *clutter_text,
                                                                   gint        *start_offset,
                                                                   gint        *end_offset);
+static gint                  _cally_text_get_length              (ClutterText *clutter_text);
+static gchar*                _cally_text_get_range               (ClutterText *clutter_text,
+                                                                  gint         start_offset,
+                                                                  gint         end_offset);
+static gint                  _cally_text_offset_to_index         (ClutterText *clutter_text,
+                                                                  gint         offset);
+static gint                  _cally_text_index_to_offset         (ClutterText *clutter_text,
+                                                                  gint         index);
 static void                  _cally_text_insert_text_cb          (ClutterText *clutter_text,
                                                                   gchar       *new_text,
                                                                   gint         new_text_length,
@@ -1075,28 +1084,12 @@ cally_text_get_text (AtkText *text,
                      gint end_offset)
 {
   ClutterActor *actor = NULL;
-  PangoLayout *layout = NULL;
-  const gchar *string = NULL;
-  gint character_count = 0;
 
   actor = CALLY_GET_CLUTTER_ACTOR (text);
   if (actor == NULL) /* Object is defunct */
     return NULL;
 
-  /* we use the pango layout instead of clutter_text_get_chars because
-     it take into account password-char */
-
-  layout = clutter_text_get_layout (CLUTTER_TEXT (actor));
-  string = pango_layout_get_text (layout);
-  character_count = pango_layout_get_character_count (layout);
-
-  if (end_offset == -1 || end_offset > character_count)
-    end_offset = character_count;
-
-  if (string[0] == 0)
-    return g_strdup("");
-  else
-    return g_utf8_substring (string, start_offset, end_offset);
+  return _cally_text_get_range (CLUTTER_TEXT (actor), start_offset, end_offset);
 }
 
 static gunichar
@@ -1104,31 +1097,19 @@ cally_text_get_character_at_offset (AtkText *text,
                                     gint     offset)
 {
   ClutterActor *actor      = NULL;
-  const gchar  *string     = NULL;
-  gchar        *index      = NULL;
+  gchar        *string     = NULL;
   gunichar      unichar;
-  PangoLayout  *layout = NULL;
 
   actor = CALLY_GET_CLUTTER_ACTOR (text);
   if (actor == NULL) /* State is defunct */
     return '\0';
 
-  /* we use the pango layout instead of clutter_text_get_chars because
-     it take into account password-char */
-
-  layout = clutter_text_get_layout (CLUTTER_TEXT (actor));
-  string = pango_layout_get_text (layout);
-
-  if (offset >= g_utf8_strlen (string, -1))
-    {
-      unichar = '\0';
-    }
-  else
-    {
-      index = g_utf8_offset_to_pointer (string, offset);
+  if (offset < 0 || offset >= _cally_text_get_length (CLUTTER_TEXT (actor)))
+    return '\0';
 
-      unichar = g_utf8_get_char (index);
-    }
+  string = _cally_text_get_range (CLUTTER_TEXT (actor), offset, offset + 1);
+  unichar = g_utf8_get_char (string);
+  g_free (string);
 
   return unichar;
 }
@@ -1227,7 +1208,7 @@ cally_text_get_character_count (AtkText *text)
     return 0;
 
   clutter_text = CLUTTER_TEXT (actor);
-  return g_utf8_strlen (clutter_text_get_text (clutter_text), -1);
+  return _cally_text_get_length (clutter_text);
 }
 
 static gint
@@ -1274,7 +1255,7 @@ cally_text_get_selection (AtkText *text,
   _cally_text_get_selection_bounds (CLUTTER_TEXT (actor), start_offset, end_offset);
 
   if (*start_offset != *end_offset)
-    return clutter_text_get_selection (CLUTTER_TEXT (actor));
+    return _cally_text_get_range (CLUTTER_TEXT (actor), *start_offset, *end_offset);
   else
      return NULL;
 }
@@ -1439,7 +1420,6 @@ static void cally_text_get_character_extents (AtkText *text,
   gint x_layout, y_layout;
   PangoLayout *layout;
   PangoRectangle extents;
-  const gchar *text_value;
   ClutterVertex verts[4];
 
   actor = CALLY_GET_CLUTTER_ACTOR (text);
@@ -1448,8 +1428,7 @@ static void cally_text_get_character_extents (AtkText *text,
 
   clutter_text = CLUTTER_TEXT (actor);
 
-  text_value = clutter_text_get_text (clutter_text);
-  index = g_utf8_offset_to_pointer (text_value, offset) - text_value;
+  index = _cally_text_offset_to_index (clutter_text, offset);
 
   layout = clutter_text_get_layout (clutter_text);
   pango_layout_index_to_pos (layout, index, &extents);
@@ -1501,7 +1480,6 @@ cally_text_get_offset_at_point (AtkText *text,
 {
   ClutterActor    *actor        = NULL;
   ClutterText     *clutter_text = NULL;
-  const gchar *text_value;
   gint index;
 
   actor = CALLY_GET_CLUTTER_ACTOR (text);
@@ -1511,11 +1489,10 @@ cally_text_get_offset_at_point (AtkText *text,
   clutter_text = CLUTTER_TEXT (actor);
 
   index = _cally_misc_get_index_at_point (clutter_text, x, y, coords);
-  text_value = clutter_text_get_text (clutter_text);
   if (index == -1)
-    return g_utf8_strlen (text_value, -1);
+    return _cally_text_get_length (clutter_text);
   else
-    return g_utf8_pointer_to_offset (text_value, text_value + index);
+    return _cally_text_index_to_offset (clutter_text, index);
 }
 
 
@@ -1548,6 +1525,86 @@ _cally_text_get_selection_bounds   (ClutterText *clutter_text,
     }
 }
 
+/* The text exposed through AtkText is the contents of the ClutterTextBuffer,
+   with every character replaced by the password character, if any. These
+   methods read it straight from the buffer, by offset, so that a query does
+   not need to copy, or lay out, the whole text: this matters for long texts,
+   as the screen readers query it after every change */
+static gint
+_cally_text_get_length (ClutterText *clutter_text)
+{
+  return clutter_text_buffer_get_length (clutter_text_get_buffer (clutter_text));
+}
+
+static gchar*
+_cally_text_get_range (ClutterText *clutter_text,
+                       gint         start_offset,
+                       gint         end_offset)
+{
+  gunichar password_char;
+  gint n_chars;
+
+  n_chars = _cally_text_get_length (clutter_text);
+
+  if (end_offset < 0 || end_offset > n_chars)
+    end_offset = n_chars;
+
+  start_offset = CLAMP (start_offset, 0, end_offset);
+
+  password_char = clutter_text_get_password_char (clutter_text);
+  if (password_char != 0)
+    {
+      GString *str = g_string_sized_new (end_offset - start_offset);
+      gint i;
+
+      for (i = start_offset; i < end_offset; i++)
+        g_string_append_unichar (str, password_char);
+
+      return g_string_free (str, FALSE);
+    }
+
+  return _clutter_text_buffer_get_range (clutter_text_get_buffer (clutter_text),
+                                         start_offset,
+                                         end_offset);
+}
+
+/* converts between character offsets and byte indices of the PangoLayout
+   of the ClutterText, which contains the password characters */
+static gint
+_cally_text_offset_to_index (ClutterText *clutter_text,
+                             gint         offset)
+{
+  gunichar password_char;
+
+  password_char = clutter_text_get_password_char (clutter_text);
+  if (password_char != 0)
+    {
+      gint n_chars = _cally_text_get_length (clutter_text);
+
+      if (offset < 0 || offset > n_chars)
+        offset = n_chars;
+
+      return offset * g_unichar_to_utf8 (password_char, NULL);
+    }
+
+  return _clutter_text_buffer_offset_to_bytes (clutter_text_get_buffer (clutter_text),
+                                               offset);
+}
+
+static gint
+_cally_text_index_to_offset (ClutterText *clutter_text,
+                             gint         index)
+{
+  gunichar password_char;
+
+  password_char = clutter_text_get_password_char (clutter_text);
+  if (password_char != 0)
+    return index / g_unichar_to_utf8 (password_char, NULL);
+
+  return _clutter_text_buffer_bytes_to_offset (clutter_text_get_buffer (clutter_text),
+                                               index);
+}
+
 static void
 _cally_text_delete_text_cb (ClutterText *clutter_text,
                             gint         start_pos,
@@ -1564,6 +1621,12 @@ _cally_text_delete_text_cb (ClutterText *clutter_text,
 
   cally_text = CALLY_TEXT (data);
 
+  if (end_pos < 0)
+    end_pos = _cally_text_get_length (clutter_text);
+
+  /* the pending insertion happened before this deletion */
+  _notify_insert (cally_text);
+
   if (!cally_text->priv->signal_name_delete)
     {
       cally_text->priv->signal_name_delete = "text_changed::delete";
@@ -1582,16 +1645,34 @@ _cally_text_insert_text_cb (ClutterText *clutter_text,
                             gpointer     data)
 {
   CallyText *cally_text = NULL;
+  gint insert_position;
+  gint insert_length;
 
   g_return_if_fail (CALLY_IS_TEXT (data));
 
   cally_text = CALLY_TEXT (data);
 
-  if (!cally_text->priv->signal_name_insert)
+  /* the buffer has not been changed yet, so -1 means its current end */
+  insert_position = *position;
+  if (insert_position < 0)
+    insert_position = _cally_text_get_length (clutter_text);
+
+  insert_length = g_utf8_strlen (new_text, new_text_length);
+
+  /* merge the insertions made before the pending signal is emitted,
+     like when typing, as long as they are contiguous */
+  if (cally_text->priv->signal_name_insert &&
+      cally_text->priv->position_insert + cally_text->priv->length_insert == insert_position)
+    {
+      cally_text->priv->length_insert += insert_length;
+    }
+  else
     {
+      _notify_insert (cally_text);
+
       cally_text->priv->signal_name_insert = "text_changed::insert";
-      cally_text->priv->position_insert = *position;
-      cally_text->priv->length_insert = g_utf8_strlen (new_text, new_text_length);
+      cally_text->priv->position_insert = insert_position;
+      cally_text->priv->length_insert = insert_length;
     }
 
   /*
@@ -2057,9 +2138,8 @@ _cally_misc_layout_get_run_attributes (AtkAttributeSet *attrib_set,
   gboolean is_next = TRUE;
   glong len;
   PangoLayout *layout = clutter_text_get_layout (clutter_text);
-  gchar *text = (gchar*) clutter_text_get_text (clutter_text);
 
-  len = g_utf8_strlen (text, -1);
+  len = _cally_text_get_length (clutter_text);
   /* Grab the attributes of the PangoLayout, if any */
   if ((attr = pango_layout_get_attributes (layout)) == NULL)
     {
@@ -2077,20 +2157,20 @@ _cally_misc_layout_get_run_attributes (AtkAttributeSet *attrib_set,
       else if (offset < 0)
         offset = 0;
 
-      index = g_utf8_offset_to_pointer (text, offset) - text;
+      index = _cally_text_offset_to_index (clutter_text, offset);
       pango_attr_iterator_range (iter, &start_index, &end_index);
       while (is_next)
         {
             if (index >= start_index && index < end_index)
               {
-                *start_offset = g_utf8_pointer_to_offset (text,
-                                                          text + start_index);
+                *start_offset = _cally_text_index_to_offset (clutter_text,
+                                                             start_index);
                 if (end_index == G_MAXINT)
-                    /* Last iterator */
-                    end_index = len;
-
-                *end_offset = g_utf8_pointer_to_offset (text,
-                                                        text + end_index);
+                  /* Last iterator */
+                  *end_offset = len;
+                else
+                  *end_offset = _cally_text_index_to_offset (clutter_text,
+                                                             end_index);
                 break;
               }
             is_next = pango_attr_iterator_next (iter);
@@ -321,6 +321,9 @@ CoglFramebuffer *               _clutter_actor_get_active_framebuffer
 
 ClutterPaintNode *              clutter_actor_create_texture_paint_node                 (ClutterActor *self,
                                                                                          CoglTexture  *texture);
+ClutterPaintNode *              _clutter_actor_create_texture_paint_node_for_area       (ClutterActor                *self,
+                                                                                         CoglTexture                 *texture,
+                                                                                         const cairo_rectangle_int_t *area);
 
 G_END_DECLS
 
@@ -633,6 +633,7 @@
 #include "clutter-fixed-layout.h"
 #include "clutter-flatten-effect.h"
 #include "clutter-interval.h"
+#include "clutter-layout-profiler.h"
 #include "clutter-main.h"
 #include "clutter-marshal.h"
 #include "clutter-paint-nodes.h"
@@ -4397,6 +4398,38 @@ _clutter_actor_get_transform_info (ClutterActor *self)
   return info;
 }
 
+/*< private >
+ * clutter_actor_queue_redraw_for_transform:
+ * @self: a #ClutterActor
+ *
+ * Queues a redraw after a change that only affects where @self is
+ * painted, and not what it paints.
+ *
+ * Like clutter_actor_set_opacity_internal() does for the flatten
+ * effect, the redraw is queued from the first effect of the actor, so
+ * that offscreen effects can paint their cached image at the new
+ * position instead of redrawing the actor and its children.
+ */
+static void
+clutter_actor_queue_redraw_for_transform (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  ClutterEffect *effect = NULL;
+
+  if (priv->effects != NULL)
+    {
+      const GList *effects = _clutter_meta_group_peek_metas (priv->effects);
+
+      if (effects != NULL)
+        effect = effects->data;
+    }
+
+  _clutter_actor_queue_redraw_full (self,
+                                    0, /* flags */
+                                    NULL, /* clip */
+                                    effect);
+}
+
 static inline void
 clutter_actor_set_pivot_point_internal (ClutterActor       *self,
                                         const ClutterPoint *pivot)
@@ -4410,7 +4443,7 @@ clutter_actor_set_pivot_point_internal (ClutterActor       *self,
 
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_PIVOT_POINT]);
 
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
 }
 
 static inline void
@@ -4426,7 +4459,7 @@ clutter_actor_set_pivot_point_z_internal (ClutterActor *self,
 
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_PIVOT_POINT_Z]);
 
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
 }
 
 /*< private >
@@ -4457,7 +4490,7 @@ clutter_actor_set_translation_internal (ClutterActor *self,
     g_assert_not_reached ();
 
   self->priv->transform_valid = FALSE;
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
   g_object_notify_by_pspec (obj, pspec);
 }
 
@@ -4590,7 +4623,7 @@ clutter_actor_set_rotation_angle_internal (ClutterActor *self,
 
   self->priv->transform_valid = FALSE;
 
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
 
   g_object_notify_by_pspec (G_OBJECT (self), pspec);
 }
@@ -4748,7 +4781,7 @@ clutter_actor_set_rotation_center_internal (ClutterActor        *self,
 
   g_object_thaw_notify (obj);
 
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
 }
 
 static void
@@ -4771,7 +4804,7 @@ clutter_actor_set_scale_factor_internal (ClutterActor *self,
     g_assert_not_reached ();
 
   self->priv->transform_valid = FALSE;
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
   g_object_notify_by_pspec (obj, pspec);
 }
 
@@ -4853,7 +4886,7 @@ clutter_actor_set_scale_center (ClutterActor      *self,
 
   self->priv->transform_valid = FALSE;
 
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
 
   g_object_thaw_notify (obj);
 }
@@ -4879,7 +4912,7 @@ clutter_actor_set_scale_gravity (ClutterActor   *self,
   g_object_notify_by_pspec (obj, obj_props[PROP_SCALE_CENTER_Y]);
   g_object_notify_by_pspec (obj, obj_props[PROP_SCALE_GRAVITY]);
 
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
 }
 
 /* XXX:2.0 - remove */
@@ -4928,7 +4961,7 @@ clutter_actor_set_anchor_coord (ClutterActor      *self,
 
   self->priv->transform_valid = FALSE;
 
-  clutter_actor_queue_redraw (self);
+  clutter_actor_queue_redraw_for_transform (self);
 
   g_object_thaw_notify (obj);
 }
@@ -9001,7 +9034,16 @@ _clutter_actor_queue_only_relayout (ClutterActor *self)
 
   _clutter_actor_queue_relayout_on_clones (self);
 
+  /* the parents of @self will be notified by the class handler of
+   * the signal, so we only record @self as the origin of the relayout
+   */
+  if (G_UNLIKELY (_clutter_layout_profiler_enabled))
+    _clutter_layout_profiler_begin_queue_relayout (self);
+
   g_signal_emit (self, actor_signals[QUEUE_RELAYOUT], 0);
+
+  if (G_UNLIKELY (_clutter_layout_profiler_enabled))
+    _clutter_layout_profiler_end_queue_relayout (self);
 }
 
 /**
@@ -9531,6 +9573,8 @@ clutter_actor_get_preferred_width (ClutterActor *self,
 
       CLUTTER_NOTE (LAYOUT, "Width request for %.2f px", for_height);
 
+      CLUTTER_LAYOUT_PROFILER_PUSH (self, CLUTTER_LAYOUT_PHASE_WIDTH);
+
       klass = CLUTTER_ACTOR_GET_CLASS (self);
       klass->get_preferred_width (self, for_height,
                                   &minimum_width,
@@ -9543,6 +9587,8 @@ clutter_actor_get_preferred_width (ClutterActor *self,
                                                            &minimum_width,
                                                            &natural_width);
 
+      CLUTTER_LAYOUT_PROFILER_POP (self);
+
       /* adjust for the margin */
       minimum_width += (info->margin.left + info->margin.right);
       natural_width += (info->margin.left + info->margin.right);
@@ -9674,6 +9720,8 @@ clutter_actor_get_preferred_height (ClutterActor *self,
             for_width = 0;
         }
 
+      CLUTTER_LAYOUT_PROFILER_PUSH (self, CLUTTER_LAYOUT_PHASE_HEIGHT);
+
       klass = CLUTTER_ACTOR_GET_CLASS (self);
       klass->get_preferred_height (self, for_width,
                                    &minimum_height,
@@ -9686,6 +9734,8 @@ clutter_actor_get_preferred_height (ClutterActor *self,
                                                            &minimum_height,
                                                            &natural_height);
 
+      CLUTTER_LAYOUT_PROFILER_POP (self);
+
       /* adjust for margin */
       minimum_height += (info->margin.top + info->margin.bottom);
       natural_height += (info->margin.top + info->margin.bottom);
@@ -9947,9 +9997,13 @@ clutter_actor_allocate_internal (ClutterActor           *self,
   CLUTTER_NOTE (LAYOUT, "Calling %s::allocate()",
                 _clutter_actor_get_debug_name (self));
 
+  CLUTTER_LAYOUT_PROFILER_PUSH (self, CLUTTER_LAYOUT_PHASE_ALLOCATE);
+
   klass = CLUTTER_ACTOR_GET_CLASS (self);
   klass->allocate (self, allocation, flags);
 
+  CLUTTER_LAYOUT_PROFILER_POP (self);
+
   CLUTTER_UNSET_PRIVATE_FLAGS (self, CLUTTER_IN_RELAYOUT);
 
   /* Caller should call clutter_actor_queue_redraw() if needed
@@ -11168,7 +11222,9 @@ clutter_actor_set_x_internal (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  /* moving the actor does not change its contents */
+  _clutter_actor_queue_only_relayout (self);
+  clutter_actor_queue_redraw_for_transform (self);
 }
 
 static inline void
@@ -11191,7 +11247,9 @@ clutter_actor_set_y_internal (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  /* moving the actor does not change its contents */
+  _clutter_actor_queue_only_relayout (self);
+  clutter_actor_queue_redraw_for_transform (self);
 }
 
 static void
@@ -11220,7 +11278,9 @@ clutter_actor_set_position_internal (ClutterActor       *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  /* moving the actor does not change its contents */
+  _clutter_actor_queue_only_relayout (self);
+  clutter_actor_queue_redraw_for_transform (self);
 }
 
 /**
@@ -11954,7 +12014,7 @@ clutter_actor_set_z_position_internal (ClutterActor *self,
 
       self->priv->transform_valid = FALSE;
 
-      clutter_actor_queue_redraw (self);
+      clutter_actor_queue_redraw_for_transform (self);
 
       g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_Z_POSITION]);
     }
@@ -21088,14 +21148,54 @@ clutter_actor_bind_model_with_properties (ClutterActor *self,
 ClutterPaintNode *
 clutter_actor_create_texture_paint_node (ClutterActor *self,
                                          CoglTexture  *texture)
+{
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (self), NULL);
+  g_return_val_if_fail (texture != NULL, NULL);
+
+  return _clutter_actor_create_texture_paint_node_for_area (self, texture, NULL);
+}
+
+/*< private >
+ * _clutter_actor_create_texture_paint_node_for_area:
+ * @self: a #ClutterActor
+ * @texture: a #CoglTexture
+ * @area: (allow-none): the area of @texture to paint, or %NULL to
+ *   paint all of it
+ *
+ * Like clutter_actor_create_texture_paint_node(), but only paints a
+ * part of @texture; this allows contents stored inside a texture shared
+ * with other contents to be drawn in the same batch.
+ *
+ * Returns: (transfer full): The newly created #ClutterPaintNode
+ */
+ClutterPaintNode *
+_clutter_actor_create_texture_paint_node_for_area (ClutterActor                *self,
+                                                   CoglTexture                 *texture,
+                                                   const cairo_rectangle_int_t *area)
 {
   ClutterActorPrivate *priv = clutter_actor_get_instance_private (self);
   ClutterPaintNode *node;
   ClutterActorBox box;
   ClutterColor color;
 
-  g_return_val_if_fail (CLUTTER_IS_ACTOR (self), NULL);
-  g_return_val_if_fail (texture != NULL, NULL);
+  /* repeating only a part of a texture requires a sub-texture */
+  if (area != NULL && priv->content_repeat != CLUTTER_REPEAT_NONE)
+    {
+      CoglContext *ctx;
+      CoglTexture *sub_texture;
+
+      ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+      sub_texture = cogl_sub_texture_new (ctx, texture,
+                                          area->x, area->y,
+                                          area->width, area->height);
+
+      node = _clutter_actor_create_texture_paint_node_for_area (self,
+                                                                sub_texture,
+                                                                NULL);
+      cogl_object_unref (sub_texture);
+
+      return node;
+    }
 
   clutter_actor_get_content_box (self, &box);
 
@@ -21110,7 +21210,18 @@ clutter_actor_create_texture_paint_node (ClutterActor *self,
   node = clutter_texture_node_new (texture, &color, priv->min_filter, priv->mag_filter);
   clutter_paint_node_set_name (node, "Texture");
 
-  if (priv->content_repeat == CLUTTER_REPEAT_NONE)
+  if (area != NULL)
+    {
+      float tex_width = cogl_texture_get_width (texture);
+      float tex_height = cogl_texture_get_height (texture);
+
+      clutter_paint_node_add_texture_rectangle (node, &box,
+                                                area->x / tex_width,
+                                                area->y / tex_height,
+                                                (area->x + area->width) / tex_width,
+                                                (area->y + area->height) / tex_height);
+    }
+  else if (priv->content_repeat == CLUTTER_REPEAT_NONE)
     clutter_paint_node_add_rectangle (node, &box);
   else
     {
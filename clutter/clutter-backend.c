@@ -47,11 +47,13 @@
 #include "clutter-backend-private.h"
 #include "clutter-debug.h"
 #include "clutter-event-private.h"
+#include "clutter-glyph-cache-private.h"
 #include "clutter-marshal.h"
 #include "clutter-private.h"
 #include "clutter-stage-manager-private.h"
 #include "clutter-stage-private.h"
 #include "clutter-stage-window.h"
+#include "clutter-texture-budget-private.h"
 #include "clutter-version.h"
 #include "clutter-device-manager-private.h"
 
@@ -1335,6 +1337,138 @@ clutter_backend_get_font_options (ClutterBackend *backend)
   return backend->font_options;
 }
 
+/**
+ * clutter_backend_warm_glyph_cache:
+ * @backend: a #ClutterBackend
+ * @font_name: (allow-none): a font description, in a format understood by
+ *   pango_font_description_from_string(), or %NULL for the default font
+ * @characters: a UTF-8 string with the characters to warm up
+ *
+ * Rasterises the glyphs of @characters in the given font ahead of time,
+ * so that the first frame showing them does not have to pay for it.
+ *
+ * The glyphs are rendered into the glyph cache shared by all the text
+ * drawn by Clutter, a few at a time, when the main loop is idle; this
+ * function can be called again for each size of the same font.
+ *
+ * Characters that have already been warmed up, or that have already
+ * been used, are ignored.
+ *
+ * Since: 1.28
+ */
+void
+clutter_backend_warm_glyph_cache (ClutterBackend *backend,
+                                  const gchar    *font_name,
+                                  const gchar    *characters)
+{
+  g_return_if_fail (CLUTTER_IS_BACKEND (backend));
+  g_return_if_fail (characters != NULL);
+  g_return_if_fail (g_utf8_validate (characters, -1, NULL));
+
+  _clutter_glyph_cache_warm (font_name, characters);
+}
+
+/**
+ * clutter_backend_set_glyph_cache_file:
+ * @backend: a #ClutterBackend
+ * @filename: (type filename) (allow-none): the path of the glyph cache
+ *   file, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Sets the file used to keep the glyph cache across runs.
+ *
+ * The glyphs listed in @filename, if it exists, are warmed up as if
+ * they had been passed to clutter_backend_warm_glyph_cache(); from then
+ * on, the glyphs used by #ClutterText are recorded, and periodically
+ * written back to @filename.
+ *
+ * Setting another file, or %NULL, writes the pending changes to the
+ * previous one, so applications should call this function with a %NULL
+ * @filename before exiting.
+ *
+ * Return value: %TRUE if the file was loaded, or did not exist
+ *
+ * Since: 1.28
+ */
+gboolean
+clutter_backend_set_glyph_cache_file (ClutterBackend  *backend,
+                                      const gchar     *filename,
+                                      GError         **error)
+{
+  g_return_val_if_fail (CLUTTER_IS_BACKEND (backend), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  return _clutter_glyph_cache_set_file (filename, error);
+}
+
+/**
+ * clutter_backend_set_texture_budget:
+ * @backend: a #ClutterBackend
+ * @budget: the maximum amount of texture memory, in bytes, or 0
+ *
+ * Sets the amount of texture memory that the contents, effects and
+ * textures of all the stages should try to stay within.
+ *
+ * Once the budget is exceeded, the textures that were painted least
+ * recently are released; they are re-created the next time they are
+ * painted: #ClutterImage keeps a copy of its data in system memory, and
+ * #ClutterCanvas draws its contents again.
+ *
+ * The textures of a #ClutterContent are only released while none of
+ * the actors using it is mapped, so the budget can be exceeded if the
+ * contents on the stages do not fit in it.
+ *
+ * A @budget of 0, the default, disables the eviction of textures.
+ *
+ * Since: 1.28
+ */
+void
+clutter_backend_set_texture_budget (ClutterBackend *backend,
+                                    gsize           budget)
+{
+  g_return_if_fail (CLUTTER_IS_BACKEND (backend));
+
+  _clutter_texture_budget_set_limit (budget);
+}
+
+/**
+ * clutter_backend_get_texture_budget:
+ * @backend: a #ClutterBackend
+ *
+ * Retrieves the texture budget set using
+ * clutter_backend_set_texture_budget().
+ *
+ * Return value: the texture budget, in bytes, or 0
+ *
+ * Since: 1.28
+ */
+gsize
+clutter_backend_get_texture_budget (ClutterBackend *backend)
+{
+  g_return_val_if_fail (CLUTTER_IS_BACKEND (backend), 0);
+
+  return _clutter_texture_budget_get_limit ();
+}
+
+/**
+ * clutter_backend_get_texture_memory:
+ * @backend: a #ClutterBackend
+ *
+ * Retrieves an estimate of the texture memory currently used by the
+ * contents, effects and textures of all the stages.
+ *
+ * Return value: the amount of texture memory, in bytes
+ *
+ * Since: 1.28
+ */
+gsize
+clutter_backend_get_texture_memory (ClutterBackend *backend)
+{
+  g_return_val_if_fail (CLUTTER_IS_BACKEND (backend), 0);
+
+  return _clutter_texture_budget_get_usage ();
+}
+
 /**
  * clutter_backend_set_font_name:
  * @backend: a #ClutterBackend
@@ -73,6 +73,23 @@ void                            clutter_backend_set_font_options        (Clutter
 CLUTTER_AVAILABLE_IN_ALL
 const cairo_font_options_t *    clutter_backend_get_font_options        (ClutterBackend             *backend);
 
+CLUTTER_AVAILABLE_IN_1_28
+void                            clutter_backend_warm_glyph_cache        (ClutterBackend             *backend,
+                                                                         const gchar                *font_name,
+                                                                         const gchar                *characters);
+CLUTTER_AVAILABLE_IN_1_28
+gboolean                        clutter_backend_set_glyph_cache_file    (ClutterBackend             *backend,
+                                                                         const gchar                *filename,
+                                                                         GError                    **error);
+
+CLUTTER_AVAILABLE_IN_1_28
+void                            clutter_backend_set_texture_budget      (ClutterBackend             *backend,
+                                                                         gsize                       budget);
+CLUTTER_AVAILABLE_IN_1_28
+gsize                           clutter_backend_get_texture_budget      (ClutterBackend             *backend);
+CLUTTER_AVAILABLE_IN_1_28
+gsize                           clutter_backend_get_texture_memory      (ClutterBackend             *backend);
+
 #if defined (COGL_ENABLE_EXPERIMENTAL_API) && defined (CLUTTER_ENABLE_EXPERIMENTAL_API)
 CLUTTER_AVAILABLE_IN_1_8
 CoglContext *                   clutter_backend_get_cogl_context        (ClutterBackend             *backend);
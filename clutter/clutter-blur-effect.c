@@ -30,6 +30,12 @@
  * #ClutterBlurEffect is a sub-class of #ClutterEffect that allows blurring a
  * actor and its contents.
  *
+ * By default the actor is blurred with a small, fixed kernel. Larger
+ * blurs can be obtained by setting the #ClutterBlurEffect:radius property;
+ * these are computed at progressively reduced resolutions, with separate
+ * horizontal and vertical gaussian passes at the smallest one, so that
+ * their cost does not grow with the radius.
+ *
  * #ClutterBlurEffect is available since Clutter 1.4
  */
 
@@ -43,19 +49,27 @@
 
 #define CLUTTER_ENABLE_EXPERIMENTAL_API
 
+#include <math.h>
+
 #include "clutter-blur-effect.h"
 
 #include "cogl/cogl.h"
 
+#include "clutter-actor-private.h"
 #include "clutter-debug.h"
-#include "clutter-offscreen-effect.h"
+#include "clutter-offscreen-effect-private.h"
 #include "clutter-private.h"
+#include "clutter-stage-private.h"
 
 #define BLUR_PADDING    2
 
-/* FIXME - lame shader; we should really have a decoupled
- * horizontal/vertical two pass shader for the gaussian blur
- */
+/* the number of taps on each side of the center in a gaussian pass */
+#define GAUSSIAN_TAPS   4
+
+/* the number of times the image can be halved before blurring it */
+#define MAX_LEVELS      5
+
+/* the single pass, 3x3 box blur used for small radii */
 static const gchar *box_blur_glsl_declarations =
 "uniform vec2 pixel_step;\n";
 #define SAMPLE(offx, offy) \
@@ -72,8 +86,73 @@ static const gchar *box_blur_glsl_shader =
   SAMPLE ( 0.0, +1.0)
   SAMPLE (+1.0, +1.0)
 "  cogl_texel /= 9.0;\n";
+
+/* halves the size of the image; with linear filtering each sample
+ * averages the four texels around it
+ */
+static const gchar *downsample_glsl_declarations =
+"uniform vec2 pixel_step;\n";
+static const gchar *downsample_glsl_shader =
+"  cogl_texel = texture2D (cogl_sampler, cogl_tex_coord.st) * 4.0;\n"
+  SAMPLE (-1.0, -1.0)
+  SAMPLE (+1.0, -1.0)
+  SAMPLE (-1.0, +1.0)
+  SAMPLE (+1.0, +1.0)
+"  cogl_texel /= 8.0;\n";
+
+/* doubles the size of the image, using a tent filter; pixel_step
+ * is half of a texel of the source
+ */
+static const gchar *upsample_glsl_declarations =
+"uniform vec2 pixel_step;\n";
+static const gchar *upsample_glsl_shader =
+"  cogl_texel = vec4 (0.0);\n"
+  SAMPLE (-2.0,  0.0)
+  SAMPLE (+2.0,  0.0)
+  SAMPLE ( 0.0, -2.0)
+  SAMPLE ( 0.0, +2.0)
+  SAMPLE (-1.0, -1.0)
+  SAMPLE (-1.0, -1.0)
+  SAMPLE (+1.0, -1.0)
+  SAMPLE (+1.0, -1.0)
+  SAMPLE (-1.0, +1.0)
+  SAMPLE (-1.0, +1.0)
+  SAMPLE (+1.0, +1.0)
+  SAMPLE (+1.0, +1.0)
+"  cogl_texel /= 12.0;\n";
+#undef SAMPLE
+
+/* one direction of a separable gaussian kernel; pixel_step is a
+ * texel along the direction of the pass
+ */
+static const gchar *gaussian_glsl_declarations =
+"uniform vec2 pixel_step;\n"
+"uniform float weights[" G_STRINGIFY (GAUSSIAN_TAPS) " + 1];\n";
+#define SAMPLE(n) \
+  "cogl_texel += (texture2D (cogl_sampler, cogl_tex_coord.st + pixel_step * " \
+  G_STRINGIFY (n) ".0) + texture2D (cogl_sampler, cogl_tex_coord.st - " \
+  "pixel_step * " G_STRINGIFY (n) ".0)) * weights[" G_STRINGIFY (n) "];\n"
+static const gchar *gaussian_glsl_shader =
+"  cogl_texel = texture2D (cogl_sampler, cogl_tex_coord.st) * weights[0];\n"
+  SAMPLE (1)
+  SAMPLE (2)
+  SAMPLE (3)
+  SAMPLE (4)
+;
 #undef SAMPLE
 
+/* an intermediate image, borrowed from the offscreen pool */
+typedef struct _BlurLevel
+{
+  ClutterOffscreenTarget *target;
+
+  /* the part of the target texture holding the image */
+  CoglHandle texture;
+
+  int width;
+  int height;
+} BlurLevel;
+
 struct _ClutterBlurEffect
 {
   ClutterOffscreenEffect parent_instance;
@@ -87,6 +166,33 @@ struct _ClutterBlurEffect
   gint tex_height;
 
   CoglPipeline *pipeline;
+
+  gfloat radius;
+
+  /* the pipelines of the multi-pass blur, used when radius > 1 */
+  CoglPipeline *downsample_pipeline;
+  CoglPipeline *gaussian_pipeline;
+  CoglPipeline *upsample_pipeline;
+
+  gint downsample_step_uniform;
+  gint gaussian_step_uniform;
+  gint gaussian_weights_uniform;
+  gint upsample_step_uniform;
+
+  /* the blurred image, at a reduced size; like the offscreen buffer,
+   * its target is given back to the pool after each paint, and can
+   * be reused as long as nobody else borrowed it since; the address
+   * of the result is the owner of the target in the pool
+   */
+  BlurLevel result;
+  guint64 result_serial;
+  ClutterOffscreenPool *result_pool;
+
+  /* paints the result when it was not scaled down */
+  CoglPipeline *copy_pipeline;
+
+  /* whether the offscreen buffer was redrawn since the last blur */
+  guint blur_dirty : 1;
 };
 
 struct _ClutterBlurEffectClass
@@ -94,12 +200,363 @@ struct _ClutterBlurEffectClass
   ClutterOffscreenEffectClass parent_class;
 
   CoglPipeline *base_pipeline;
+
+  CoglPipeline *base_downsample_pipeline;
+  CoglPipeline *base_gaussian_pipeline;
+  CoglPipeline *base_upsample_pipeline;
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_RADIUS,
+
+  PROP_LAST
 };
 
+static GParamSpec *obj_props[PROP_LAST];
+
 G_DEFINE_TYPE (ClutterBlurEffect,
                clutter_blur_effect,
                CLUTTER_TYPE_OFFSCREEN_EFFECT);
 
+static gboolean
+clutter_blur_effect_is_multi_pass (ClutterBlurEffect *self)
+{
+  return self->radius > 1.0f;
+}
+
+static gint
+clutter_blur_effect_get_padding (ClutterBlurEffect *self)
+{
+  if (!clutter_blur_effect_is_multi_pass (self))
+    return BLUR_PADDING;
+
+  return (gint) ceilf (self->radius) + BLUR_PADDING;
+}
+
+static void
+texture_get_texel_size (CoglHandle  texture,
+                        gfloat     *width,
+                        gfloat     *height)
+{
+  if (cogl_is_sub_texture (texture))
+    texture = cogl_sub_texture_get_parent (texture);
+
+  *width = 1.0f / cogl_texture_get_width (texture);
+  *height = 1.0f / cogl_texture_get_height (texture);
+}
+
+static void
+blur_level_clear (BlurLevel *level)
+{
+  if (level->texture != NULL)
+    cogl_handle_unref (level->texture);
+
+  level->target = NULL;
+  level->texture = NULL;
+  level->width = level->height = 0;
+}
+
+static gboolean
+blur_level_acquire (BlurLevel                    *level,
+                    ClutterOffscreenPool         *pool,
+                    int                           width,
+                    int                           height,
+                    gpointer                      owner,
+                    ClutterOffscreenTargetNotify  notify)
+{
+  CoglContext *ctx;
+
+  blur_level_clear (level);
+
+  level->target = _clutter_offscreen_pool_acquire (pool, width, height,
+                                                   owner, notify);
+  if (level->target == NULL)
+    return FALSE;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  level->texture = cogl_sub_texture_new (ctx, level->target->texture,
+                                         0, 0,
+                                         width, height);
+  level->width = width;
+  level->height = height;
+
+  return TRUE;
+}
+
+/* draws @source over the whole of @dest using @pipeline */
+static void
+blur_level_draw (BlurLevel    *dest,
+                 CoglPipeline *pipeline,
+                 CoglHandle    source)
+{
+  CoglFramebuffer *fb = COGL_FRAMEBUFFER (dest->target->offscreen);
+
+  cogl_pipeline_set_layer_texture (pipeline, 0, source);
+
+  cogl_framebuffer_set_viewport (fb, 0, 0, dest->width, dest->height);
+  cogl_framebuffer_identity_matrix (fb);
+  cogl_framebuffer_orthographic (fb,
+                                 0, 0,
+                                 dest->width, dest->height,
+                                 -1.f, 1.f);
+
+  /* the samples falling outside of the image must be transparent */
+  cogl_framebuffer_clear4f (fb, COGL_BUFFER_BIT_COLOR, 0.f, 0.f, 0.f, 0.f);
+
+  cogl_framebuffer_draw_textured_rectangle (fb, pipeline,
+                                            0, 0,
+                                            dest->width, dest->height,
+                                            0.f, 0.f,
+                                            1.f, 1.f);
+
+  /* the passes read from and write to the same textures, so each
+   * one has to land before the next one clears its destination
+   */
+  cogl_framebuffer_flush (fb);
+}
+
+static void
+blur_set_step (CoglPipeline *pipeline,
+               gint          uniform,
+               gfloat        step_x,
+               gfloat        step_y)
+{
+  gfloat pixel_step[2] = { step_x, step_y };
+
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   uniform,
+                                   2, /* n_components */
+                                   1, /* count */
+                                   pixel_step);
+}
+
+static void
+blur_set_gaussian_weights (ClutterBlurEffect *self,
+                           gfloat             sigma)
+{
+  gfloat weights[GAUSSIAN_TAPS + 1];
+  gfloat sum;
+  gint i;
+
+  sigma = MAX (sigma, 0.1f);
+
+  weights[0] = 1.0f;
+  sum = weights[0];
+
+  for (i = 1; i <= GAUSSIAN_TAPS; i++)
+    {
+      weights[i] = expf (-(i * i) / (2.0f * sigma * sigma));
+      sum += 2.0f * weights[i];
+    }
+
+  for (i = 0; i <= GAUSSIAN_TAPS; i++)
+    weights[i] /= sum;
+
+  cogl_pipeline_set_uniform_float (self->gaussian_pipeline,
+                                   self->gaussian_weights_uniform,
+                                   1, /* n_components */
+                                   GAUSSIAN_TAPS + 1, /* count */
+                                   weights);
+}
+
+/* called by the pool when the target of the result is lent to another
+ * borrower, or freed
+ */
+static void
+clutter_blur_effect_result_lost (gpointer owner)
+{
+  ClutterBlurEffect *self =
+    G_STRUCT_MEMBER_P (owner, -G_STRUCT_OFFSET (ClutterBlurEffect, result));
+
+  blur_level_clear (&self->result);
+  self->result_pool = NULL;
+
+  /* the pipelines painting the result keep a reference on it */
+  if (self->copy_pipeline != NULL)
+    cogl_pipeline_set_layer_texture (self->copy_pipeline, 0, NULL);
+
+  if (self->upsample_pipeline != NULL)
+    cogl_pipeline_set_layer_texture (self->upsample_pipeline, 0, NULL);
+}
+
+static void
+clutter_blur_effect_disown_result (ClutterBlurEffect *self)
+{
+  if (self->result_pool != NULL)
+    _clutter_offscreen_pool_disown (self->result_pool, &self->result);
+
+  blur_level_clear (&self->result);
+  self->result_pool = NULL;
+}
+
+/* Blurs the contents of the offscreen buffer into self->result.
+ *
+ * The image is halved until the standard deviation of the blur, a
+ * third of the radius, fits the gaussian kernel; it is then blurred
+ * horizontally and vertically, and scaled back up to half of its
+ * original size one level at a time, the last level being drawn
+ * directly on the stage.
+ */
+static gboolean
+clutter_blur_effect_update_result (ClutterBlurEffect *self,
+                                   CoglHandle         source)
+{
+  BlurLevel levels[MAX_LEVELS + 1] = { { NULL, }, };
+  BlurLevel scratch = { NULL, };
+  ClutterOffscreenPool *pool;
+  ClutterActor *stage;
+  gfloat sigma, step_x, step_y;
+  gboolean retval = FALSE;
+  gint n_levels, i;
+
+  stage = _clutter_actor_get_stage_internal (self->actor);
+  if (stage == NULL)
+    return FALSE;
+
+  pool = _clutter_stage_get_offscreen_pool (CLUTTER_STAGE (stage));
+
+  /* the actor might have moved to another stage */
+  if (self->result_pool != pool)
+    clutter_blur_effect_disown_result (self);
+
+  /* the first level is the offscreen buffer itself */
+  levels[0].texture = cogl_handle_ref (source);
+  levels[0].width = cogl_texture_get_width (source);
+  levels[0].height = cogl_texture_get_height (source);
+
+  sigma = self->radius / 3.0f;
+
+  n_levels = 0;
+  while (n_levels < MAX_LEVELS &&
+         sigma > GAUSSIAN_TAPS / 3.0f &&
+         levels[n_levels].width > 1 &&
+         levels[n_levels].height > 1)
+    {
+      BlurLevel *src = &levels[n_levels];
+      BlurLevel *dest = &levels[n_levels + 1];
+
+      /* the second level holds the result, and we keep its contents */
+      if (!blur_level_acquire (dest, pool,
+                               (src->width + 1) / 2,
+                               (src->height + 1) / 2,
+                               n_levels == 0 ? &self->result : NULL,
+                               n_levels == 0 ? clutter_blur_effect_result_lost
+                                             : NULL))
+        goto out;
+
+      texture_get_texel_size (src->texture, &step_x, &step_y);
+      blur_set_step (self->downsample_pipeline,
+                     self->downsample_step_uniform,
+                     step_x, step_y);
+      blur_level_draw (dest, self->downsample_pipeline, src->texture);
+
+      sigma /= 2.0f;
+      n_levels += 1;
+    }
+
+  /* horizontal pass into the scratch buffer, and vertical pass back
+   * into the smallest level, or into the result if we did not scale
+   * the image down
+   */
+  if (!blur_level_acquire (&scratch, pool,
+                           levels[n_levels].width,
+                           levels[n_levels].height,
+                           NULL, NULL))
+    goto out;
+
+  blur_set_gaussian_weights (self, sigma);
+
+  texture_get_texel_size (levels[n_levels].texture, &step_x, &step_y);
+  blur_set_step (self->gaussian_pipeline,
+                 self->gaussian_step_uniform,
+                 step_x, 0.f);
+  blur_level_draw (&scratch, self->gaussian_pipeline,
+                   levels[n_levels].texture);
+
+  if (n_levels == 0)
+    {
+      if (!blur_level_acquire (&levels[0], pool,
+                               levels[0].width,
+                               levels[0].height,
+                               &self->result,
+                               clutter_blur_effect_result_lost))
+        goto out;
+    }
+
+  texture_get_texel_size (scratch.texture, &step_x, &step_y);
+  blur_set_step (self->gaussian_pipeline,
+                 self->gaussian_step_uniform,
+                 0.f, step_y);
+  blur_level_draw (&levels[n_levels], self->gaussian_pipeline,
+                   scratch.texture);
+
+  /* scale back up, reusing the levels we went through; the first
+   * level is the offscreen buffer, so we stop at the second one
+   */
+  for (i = n_levels; i > 1; i--)
+    {
+      texture_get_texel_size (levels[i].texture, &step_x, &step_y);
+      blur_set_step (self->upsample_pipeline,
+                     self->upsample_step_uniform,
+                     step_x / 2.0f, step_y / 2.0f);
+      blur_level_draw (&levels[i - 1], self->upsample_pipeline,
+                       levels[i].texture);
+    }
+
+  i = MIN (n_levels, 1);
+
+  blur_level_clear (&self->result);
+  self->result = levels[i];
+  self->result.texture = cogl_handle_ref (levels[i].texture);
+  self->result_serial = self->result.target->serial;
+  self->result_pool = pool;
+
+  retval = TRUE;
+
+out:
+  /* do not keep the intermediate levels alive once they are trimmed */
+  cogl_pipeline_set_layer_texture (self->downsample_pipeline, 0, NULL);
+  cogl_pipeline_set_layer_texture (self->gaussian_pipeline, 0, NULL);
+  cogl_pipeline_set_layer_texture (self->upsample_pipeline, 0, NULL);
+
+  for (i = 0; i <= MAX_LEVELS; i++)
+    {
+      if (levels[i].target != NULL)
+        _clutter_offscreen_pool_release (pool, levels[i].target);
+
+      blur_level_clear (&levels[i]);
+    }
+
+  if (scratch.target != NULL)
+    _clutter_offscreen_pool_release (pool, scratch.target);
+
+  blur_level_clear (&scratch);
+
+  return retval;
+}
+
+static gboolean
+clutter_blur_effect_has_result (ClutterBlurEffect *self)
+{
+  ClutterActor *stage;
+
+  if (self->blur_dirty || self->result.target == NULL)
+    return FALSE;
+
+  stage = _clutter_actor_get_stage_internal (self->actor);
+  if (stage == NULL ||
+      _clutter_stage_get_offscreen_pool (CLUTTER_STAGE (stage)) != self->result_pool)
+    return FALSE;
+
+  return _clutter_offscreen_pool_is_current (self->result_pool,
+                                             self->result.target,
+                                             self->result_serial);
+}
+
 static gboolean
 clutter_blur_effect_pre_paint (ClutterEffect *effect)
 {
@@ -136,12 +593,16 @@ clutter_blur_effect_pre_paint (ClutterEffect *effect)
       self->tex_width = cogl_texture_get_width (texture);
       self->tex_height = cogl_texture_get_height (texture);
 
+      /* the actor is going to be redrawn */
+      self->blur_dirty = TRUE;
+
       if (self->pixel_step_uniform > -1)
         {
           gfloat pixel_step[2];
 
-          pixel_step[0] = 1.0f / self->tex_width;
-          pixel_step[1] = 1.0f / self->tex_height;
+          _clutter_offscreen_effect_get_texel_size (offscreen_effect,
+                                                    &pixel_step[0],
+                                                    &pixel_step[1]);
 
           cogl_pipeline_set_uniform_float (self->pipeline,
                                            self->pixel_step_uniform,
@@ -158,6 +619,78 @@ clutter_blur_effect_pre_paint (ClutterEffect *effect)
     return FALSE;
 }
 
+static void
+clutter_blur_effect_paint_multi_pass (ClutterBlurEffect *self,
+                                      guint8             paint_opacity)
+{
+  ClutterOffscreenEffect *offscreen_effect = CLUTTER_OFFSCREEN_EFFECT (self);
+  CoglFramebuffer *fb = cogl_get_draw_framebuffer ();
+  gfloat step_x, step_y;
+
+  CoglPipeline *pipeline;
+
+  if (!clutter_blur_effect_has_result (self))
+    {
+      CoglHandle texture;
+      gboolean res;
+
+      /* when painting from the cached image, the offscreen buffer
+       * was given back to the pool at the end of the last paint, and
+       * the passes below must not borrow it while reading from it
+       */
+      if (!_clutter_offscreen_effect_reclaim_target (offscreen_effect))
+        return;
+
+      texture = clutter_offscreen_effect_get_texture (offscreen_effect);
+      res = texture != NULL &&
+            clutter_blur_effect_update_result (self, texture);
+
+      _clutter_offscreen_effect_release_target (offscreen_effect);
+
+      if (!res)
+        return;
+
+      self->blur_dirty = FALSE;
+    }
+  else
+    {
+      /* keep the pool from trimming the result while it is on screen */
+      _clutter_offscreen_pool_touch (self->result_pool, self->result.target);
+    }
+
+  if (self->result.width == self->tex_width &&
+      self->result.height == self->tex_height)
+    {
+      /* the image was not scaled down, so it is painted as it is */
+      pipeline = self->copy_pipeline;
+    }
+  else
+    {
+      pipeline = self->upsample_pipeline;
+
+      texture_get_texel_size (self->result.texture, &step_x, &step_y);
+      blur_set_step (pipeline,
+                     self->upsample_step_uniform,
+                     step_x / 2.0f, step_y / 2.0f);
+    }
+
+  cogl_pipeline_set_layer_texture (pipeline, 0, self->result.texture);
+  cogl_pipeline_set_color4ub (pipeline,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity);
+
+  cogl_framebuffer_draw_rectangle (fb, pipeline,
+                                   0, 0,
+                                   self->tex_width, self->tex_height);
+
+  /* the intermediate pipelines are shared by all the passes; put
+   * back a neutral color for the next blur
+   */
+  cogl_pipeline_set_color4ub (pipeline, 255, 255, 255, 255);
+}
+
 static void
 clutter_blur_effect_paint_target (ClutterOffscreenEffect *effect)
 {
@@ -166,6 +699,12 @@ clutter_blur_effect_paint_target (ClutterOffscreenEffect *effect)
 
   paint_opacity = clutter_actor_get_paint_opacity (self->actor);
 
+  if (clutter_blur_effect_is_multi_pass (self))
+    {
+      clutter_blur_effect_paint_multi_pass (self, paint_opacity);
+      return;
+    }
+
   cogl_pipeline_set_color4ub (self->pipeline,
                               paint_opacity,
                               paint_opacity,
@@ -182,17 +721,21 @@ static gboolean
 clutter_blur_effect_get_paint_volume (ClutterEffect      *effect,
                                       ClutterPaintVolume *volume)
 {
+  ClutterBlurEffect *self = CLUTTER_BLUR_EFFECT (effect);
   gfloat cur_width, cur_height;
   ClutterVertex origin;
+  gint padding;
+
+  padding = clutter_blur_effect_get_padding (self);
 
   clutter_paint_volume_get_origin (volume, &origin);
   cur_width = clutter_paint_volume_get_width (volume);
   cur_height = clutter_paint_volume_get_height (volume);
 
-  origin.x -= BLUR_PADDING;
-  origin.y -= BLUR_PADDING;
-  cur_width += 2 * BLUR_PADDING;
-  cur_height += 2 * BLUR_PADDING;
+  origin.x -= padding;
+  origin.y -= padding;
+  cur_width += 2 * padding;
+  cur_height += 2 * padding;
   clutter_paint_volume_set_origin (volume, &origin);
   clutter_paint_volume_set_width (volume, cur_width);
   clutter_paint_volume_set_height (volume, cur_height);
@@ -211,9 +754,56 @@ clutter_blur_effect_dispose (GObject *gobject)
       self->pipeline = NULL;
     }
 
+  g_clear_pointer (&self->downsample_pipeline, cogl_object_unref);
+  g_clear_pointer (&self->gaussian_pipeline, cogl_object_unref);
+  g_clear_pointer (&self->upsample_pipeline, cogl_object_unref);
+  g_clear_pointer (&self->copy_pipeline, cogl_object_unref);
+
+  clutter_blur_effect_disown_result (self);
+
   G_OBJECT_CLASS (clutter_blur_effect_parent_class)->dispose (gobject);
 }
 
+static void
+clutter_blur_effect_set_property (GObject      *gobject,
+                                  guint         prop_id,
+                                  const GValue *value,
+                                  GParamSpec   *pspec)
+{
+  ClutterBlurEffect *effect = CLUTTER_BLUR_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_RADIUS:
+      clutter_blur_effect_set_radius (effect, g_value_get_float (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+clutter_blur_effect_get_property (GObject    *gobject,
+                                  guint       prop_id,
+                                  GValue     *value,
+                                  GParamSpec *pspec)
+{
+  ClutterBlurEffect *effect = CLUTTER_BLUR_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_RADIUS:
+      g_value_set_float (value, effect->radius);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
 static void
 clutter_blur_effect_class_init (ClutterBlurEffectClass *klass)
 {
@@ -221,6 +811,8 @@ clutter_blur_effect_class_init (ClutterBlurEffectClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   ClutterOffscreenEffectClass *offscreen_class;
 
+  gobject_class->set_property = clutter_blur_effect_set_property;
+  gobject_class->get_property = clutter_blur_effect_get_property;
   gobject_class->dispose = clutter_blur_effect_dispose;
 
   effect_class->pre_paint = clutter_blur_effect_pre_paint;
@@ -228,6 +820,71 @@ clutter_blur_effect_class_init (ClutterBlurEffectClass *klass)
 
   offscreen_class = CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
   offscreen_class->paint_target = clutter_blur_effect_paint_target;
+
+  /**
+   * ClutterBlurEffect:radius:
+   *
+   * The radius of the blur, in pixels.
+   *
+   * A radius of 1 or less uses a single pass with a fixed 3x3 kernel,
+   * as in previous versions of Clutter; bigger radii use a gaussian
+   * blur, computed at a reduced resolution.
+   *
+   * Since: 1.28
+   */
+  obj_props[PROP_RADIUS] =
+    g_param_spec_float ("radius",
+                        P_("Radius"),
+                        P_("The radius of the blur, in pixels"),
+                        0.0f, 256.0f,
+                        1.0f,
+                        CLUTTER_PARAM_READWRITE);
+
+  g_object_class_install_properties (gobject_class, PROP_LAST, obj_props);
+}
+
+static CoglPipeline *
+create_blur_pipeline (const gchar *declarations,
+                      const gchar *shader)
+{
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglPipeline *pipeline;
+  CoglSnippet *snippet;
+
+  pipeline = cogl_pipeline_new (ctx);
+
+  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                              declarations,
+                              NULL);
+  cogl_snippet_set_replace (snippet, shader);
+  cogl_pipeline_add_layer_snippet (pipeline, 0, snippet);
+  cogl_object_unref (snippet);
+
+  cogl_pipeline_set_layer_null_texture (pipeline,
+                                        0, /* layer number */
+                                        COGL_TEXTURE_TYPE_2D);
+
+  return pipeline;
+}
+
+static CoglPipeline *
+create_pass_pipeline (const gchar *declarations,
+                      const gchar *shader)
+{
+  CoglPipeline *pipeline = create_blur_pipeline (declarations, shader);
+
+  /* the passes rely on bilinear filtering to average neighbouring
+   * texels, and the part of the textures outside of the images is
+   * cleared, so reading past the edges is fine
+   */
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+  cogl_pipeline_set_layer_wrap_mode (pipeline, 0,
+                                     COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+
+  return pipeline;
 }
 
 static void
@@ -237,28 +894,60 @@ clutter_blur_effect_init (ClutterBlurEffect *self)
 
   if (G_UNLIKELY (klass->base_pipeline == NULL))
     {
-      CoglSnippet *snippet;
-      CoglContext *ctx =
-        clutter_backend_get_cogl_context (clutter_get_default_backend ());
-
-      klass->base_pipeline = cogl_pipeline_new (ctx);
-
-      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
-                                  box_blur_glsl_declarations,
-                                  NULL);
-      cogl_snippet_set_replace (snippet, box_blur_glsl_shader);
-      cogl_pipeline_add_layer_snippet (klass->base_pipeline, 0, snippet);
-      cogl_object_unref (snippet);
-
-      cogl_pipeline_set_layer_null_texture (klass->base_pipeline,
-                                            0, /* layer number */
-                                            COGL_TEXTURE_TYPE_2D);
+      klass->base_pipeline =
+        create_blur_pipeline (box_blur_glsl_declarations,
+                              box_blur_glsl_shader);
+
+      klass->base_downsample_pipeline =
+        create_pass_pipeline (downsample_glsl_declarations,
+                              downsample_glsl_shader);
+      klass->base_gaussian_pipeline =
+        create_pass_pipeline (gaussian_glsl_declarations,
+                              gaussian_glsl_shader);
+      klass->base_upsample_pipeline =
+        create_pass_pipeline (upsample_glsl_declarations,
+                              upsample_glsl_shader);
     }
 
+  self->radius = 1.0f;
+
+  _clutter_offscreen_effect_set_use_pool (CLUTTER_OFFSCREEN_EFFECT (self), TRUE);
+
   self->pipeline = cogl_pipeline_copy (klass->base_pipeline);
 
   self->pixel_step_uniform =
     cogl_pipeline_get_uniform_location (self->pipeline, "pixel_step");
+
+  self->downsample_pipeline =
+    cogl_pipeline_copy (klass->base_downsample_pipeline);
+  self->gaussian_pipeline =
+    cogl_pipeline_copy (klass->base_gaussian_pipeline);
+  self->upsample_pipeline =
+    cogl_pipeline_copy (klass->base_upsample_pipeline);
+
+  self->downsample_step_uniform =
+    cogl_pipeline_get_uniform_location (self->downsample_pipeline,
+                                        "pixel_step");
+  self->gaussian_step_uniform =
+    cogl_pipeline_get_uniform_location (self->gaussian_pipeline,
+                                        "pixel_step");
+  self->gaussian_weights_uniform =
+    cogl_pipeline_get_uniform_location (self->gaussian_pipeline,
+                                        "weights");
+  self->upsample_step_uniform =
+    cogl_pipeline_get_uniform_location (self->upsample_pipeline,
+                                        "pixel_step");
+
+  self->copy_pipeline =
+    cogl_pipeline_new (clutter_backend_get_cogl_context (clutter_get_default_backend ()));
+  cogl_pipeline_set_layer_null_texture (self->copy_pipeline,
+                                        0, /* layer number */
+                                        COGL_TEXTURE_TYPE_2D);
+  cogl_pipeline_set_layer_filters (self->copy_pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+
+  self->blur_dirty = TRUE;
 }
 
 /**
@@ -276,3 +965,61 @@ clutter_blur_effect_new (void)
 {
   return g_object_new (CLUTTER_TYPE_BLUR_EFFECT, NULL);
 }
+
+/**
+ * clutter_blur_effect_set_radius:
+ * @effect: a #ClutterBlurEffect
+ * @radius: the radius of the blur, in pixels
+ *
+ * Sets the radius of the blur applied by @effect.
+ *
+ * Since: 1.28
+ */
+void
+clutter_blur_effect_set_radius (ClutterBlurEffect *effect,
+                                gfloat             radius)
+{
+  ClutterActor *actor;
+  gint old_padding;
+
+  g_return_if_fail (CLUTTER_IS_BLUR_EFFECT (effect));
+  g_return_if_fail (radius >= 0.0f);
+
+  if (effect->radius == radius)
+    return;
+
+  old_padding = clutter_blur_effect_get_padding (effect);
+
+  effect->radius = radius;
+  effect->blur_dirty = TRUE;
+
+  /* a bigger blur needs a bigger offscreen buffer, so the actor
+   * has to be drawn again; otherwise, blurring the cached image
+   * again is enough
+   */
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
+  if (actor != NULL && old_padding != clutter_blur_effect_get_padding (effect))
+    clutter_actor_queue_redraw (actor);
+  else
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
+
+  g_object_notify_by_pspec (G_OBJECT (effect), obj_props[PROP_RADIUS]);
+}
+
+/**
+ * clutter_blur_effect_get_radius:
+ * @effect: a #ClutterBlurEffect
+ *
+ * Retrieves the radius of the blur applied by @effect.
+ *
+ * Return value: the radius, in pixels
+ *
+ * Since: 1.28
+ */
+gfloat
+clutter_blur_effect_get_radius (ClutterBlurEffect *effect)
+{
+  g_return_val_if_fail (CLUTTER_IS_BLUR_EFFECT (effect), 0.0f);
+
+  return effect->radius;
+}
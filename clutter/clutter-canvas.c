@@ -36,6 +36,16 @@
  * that can be used to draw. #ClutterCanvas will emit the #ClutterCanvas::draw
  * signal when invalidated using clutter_content_invalidate().
  *
+ * If only a part of the contents changed, clutter_canvas_invalidate_rect()
+ * can be used instead; the #ClutterCanvas::draw signal will be emitted
+ * with a #cairo_t clipped to the invalidated area, on top of the previous
+ * contents, and only that area will be uploaded to the GPU.
+ *
+ * Complex drawings can be moved out of the frame by setting the
+ * #ClutterCanvas:async-draw property; the #ClutterCanvas::draw signal
+ * is then emitted in a worker thread, and the previous contents are
+ * painted until the new ones are ready.
+ *
  * See [canvas.c](https://git.gnome.org/browse/clutter/tree/examples/canvas.c?h=clutter-1.18)
  * for an example of how to use #ClutterCanvas.
  *
@@ -64,6 +74,25 @@
 #include "clutter-paint-nodes.h"
 #include "clutter-private.h"
 #include "clutter-settings.h"
+#include "clutter-texture-budget-private.h"
+
+typedef struct _AsyncDraw        AsyncDraw;
+
+struct _AsyncDraw
+{
+  /* a reference, so that the canvas outlives the worker thread */
+  ClutterCanvas *canvas;
+
+  /* the worker thread has exclusive access to the surface until the
+   * request has been completed
+   */
+  cairo_surface_t *surface;
+  int width;
+  int height;
+
+  /* set when the results should be discarded */
+  guint cancelled : 1;
+};
 
 struct _ClutterCanvasPrivate
 {
@@ -75,10 +104,29 @@ struct _ClutterCanvasPrivate
   CoglTexture *texture;
   gboolean dirty;
 
+  /* the areas of the buffer, in pixels, that have been redrawn
+   * since the texture was last updated
+   */
+  cairo_region_t *dirty_region;
+
   CoglBitmap *buffer;
 
+  /* when drawing asynchronously, the surface drawn by the last
+   * completed request, and a surface to reuse for the next one
+   */
+  cairo_surface_t *front_surface;
+  cairo_surface_t *back_surface;
+  AsyncDraw *async_draw_data;
+
   int scale_factor;
   guint scale_factor_set : 1;
+
+  ClutterTextureBudgetEntry *budget_entry;
+
+  guint async_draw : 1;
+  guint draw_pending : 1;
+  guint front_dirty : 1;
+  guint evicted : 1;
 };
 
 enum
@@ -89,6 +137,7 @@ enum
   PROP_HEIGHT,
   PROP_SCALE_FACTOR,
   PROP_SCALE_FACTOR_SET,
+  PROP_ASYNC_DRAW,
 
   LAST_PROP
 };
@@ -104,6 +153,8 @@ enum
 
 static guint canvas_signals[LAST_SIGNAL] = { 0, };
 
+static GThreadPool *async_draw_thread_pool = NULL;
+
 static void clutter_content_iface_init (ClutterContentIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (ClutterCanvas, clutter_canvas, G_TYPE_OBJECT,
@@ -145,6 +196,15 @@ clutter_canvas_finalize (GObject *gobject)
     }
 
   g_clear_pointer (&priv->texture, cogl_object_unref);
+  g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+
+  _clutter_texture_budget_remove (priv->budget_entry);
+
+  /* pending asynchronous draws hold a reference on the canvas */
+  g_assert (priv->async_draw_data == NULL);
+
+  g_clear_pointer (&priv->front_surface, cairo_surface_destroy);
+  g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
 
   G_OBJECT_CLASS (clutter_canvas_parent_class)->finalize (gobject);
 }
@@ -190,6 +250,11 @@ clutter_canvas_set_property (GObject      *gobject,
                                        g_value_get_int (value));
       break;
 
+    case PROP_ASYNC_DRAW:
+      clutter_canvas_set_async_draw (CLUTTER_CANVAS (gobject),
+                                     g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -225,6 +290,10 @@ clutter_canvas_get_property (GObject    *gobject,
       g_value_set_boolean (value, priv->scale_factor_set);
       break;
 
+    case PROP_ASYNC_DRAW:
+      g_value_set_boolean (value, priv->async_draw);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -309,6 +378,27 @@ clutter_canvas_class_init (ClutterCanvasClass *klass)
                       -1,
                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * ClutterCanvas:async-draw:
+   *
+   * Whether the #ClutterCanvas::draw signal should be emitted in a
+   * worker thread.
+   *
+   * When drawing asynchronously, the canvas keeps painting its previous
+   * contents until the worker thread is done, and the new contents are
+   * uploaded at the next frame. Handlers of the #ClutterCanvas::draw
+   * signal must not use the Clutter API, and must protect any state they
+   * share with the main thread.
+   *
+   * Since: 1.28
+   */
+  obj_props[PROP_ASYNC_DRAW] =
+    g_param_spec_boolean ("async-draw",
+                          P_("Asynchronous Drawing"),
+                          P_("Whether the canvas is drawn in a worker thread"),
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   /**
    * ClutterCanvas::draw:
    * @canvas: the #ClutterCanvas that emitted the signal
@@ -323,6 +413,9 @@ clutter_canvas_class_init (ClutterCanvasClass *klass)
    * handler invocation will be automatically protected by cairo_save()
    * and cairo_restore() pairs.
    *
+   * If #ClutterCanvas:async-draw is set, this signal is emitted in a
+   * worker thread.
+   *
    * Return value: %TRUE if the signal emission should stop, and
    *   %FALSE otherwise
    *
@@ -347,6 +440,8 @@ clutter_canvas_class_init (ClutterCanvasClass *klass)
   g_object_class_install_properties (gobject_class, LAST_PROP, obj_props);
 }
 
+static void clutter_canvas_evict (gpointer data);
+
 static void
 clutter_canvas_init (ClutterCanvas *self)
 {
@@ -355,6 +450,143 @@ clutter_canvas_init (ClutterCanvas *self)
   self->priv->width = -1;
   self->priv->height = -1;
   self->priv->scale_factor = -1;
+
+  self->priv->budget_entry =
+    _clutter_texture_budget_add_for_content (CLUTTER_CONTENT (self),
+                                             clutter_canvas_evict);
+}
+
+static void
+clutter_canvas_update_budget (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  gsize size;
+
+  size = _clutter_texture_budget_get_texture_size (priv->texture);
+
+  /* the buffer is usually a pixel buffer object in GPU memory */
+  if (priv->buffer != NULL)
+    size += (gsize) cogl_bitmap_get_rowstride (priv->buffer)
+          * (gsize) cogl_bitmap_get_height (priv->buffer);
+
+  _clutter_texture_budget_set_size (priv->budget_entry, size);
+}
+
+/* releases the GPU resources; they are re-created the next time the
+ * canvas is painted, drawing it again if needed
+ */
+static void
+clutter_canvas_evict (gpointer data)
+{
+  ClutterCanvas *self = data;
+  ClutterCanvasPrivate *priv = self->priv;
+
+  CLUTTER_NOTE (MISC, "ClutterCanvas: %p: evicting texture", self);
+
+  g_clear_pointer (&priv->texture, cogl_object_unref);
+
+  if (priv->async_draw)
+    {
+      /* the front surface lives in system memory */
+      if (priv->front_surface != NULL)
+        priv->front_dirty = TRUE;
+    }
+  else if (priv->buffer != NULL)
+    {
+      g_clear_pointer (&priv->buffer, cogl_object_unref);
+      g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+      priv->dirty = FALSE;
+      priv->evicted = TRUE;
+    }
+
+  clutter_canvas_update_budget (self);
+}
+
+static void
+clutter_canvas_update_texture (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  CoglBuffer *buffer;
+  unsigned char *data;
+  int bitmap_width, bitmap_height, bitmap_stride;
+  int i, n_rects;
+
+  buffer = COGL_BUFFER (cogl_bitmap_get_buffer (priv->buffer));
+  data = cogl_buffer_map (buffer, COGL_BUFFER_ACCESS_READ, 0);
+
+  /* if we cannot read the buffer back, upload all of it */
+  if (data == NULL)
+    {
+      g_clear_pointer (&priv->texture, cogl_object_unref);
+      return;
+    }
+
+  bitmap_width = cogl_bitmap_get_width (priv->buffer);
+  bitmap_height = cogl_bitmap_get_height (priv->buffer);
+  bitmap_stride = cogl_bitmap_get_rowstride (priv->buffer);
+
+  n_rects = cairo_region_num_rectangles (priv->dirty_region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (priv->dirty_region, i, &rect);
+
+      CLUTTER_NOTE (MISC, "Uploading canvas area %d, %d (%d x %d)",
+                    rect.x, rect.y,
+                    rect.width, rect.height);
+
+      if (!cogl_texture_set_region (priv->texture,
+                                    rect.x, rect.y,
+                                    rect.x, rect.y,
+                                    rect.width, rect.height,
+                                    bitmap_width, bitmap_height,
+                                    CLUTTER_CAIRO_FORMAT_ARGB32,
+                                    bitmap_stride,
+                                    data))
+        {
+          g_clear_pointer (&priv->texture, cogl_object_unref);
+          break;
+        }
+    }
+
+  cogl_buffer_unmap (buffer);
+}
+
+static void
+clutter_canvas_upload_front_surface (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  int width, height, stride;
+  unsigned char *data;
+
+  width = cairo_image_surface_get_width (priv->front_surface);
+  height = cairo_image_surface_get_height (priv->front_surface);
+  stride = cairo_image_surface_get_stride (priv->front_surface);
+  data = cairo_image_surface_get_data (priv->front_surface);
+
+  if (priv->texture != NULL &&
+      (cogl_texture_get_width (priv->texture) != width ||
+       cogl_texture_get_height (priv->texture) != height ||
+       !cogl_texture_set_region (priv->texture,
+                                 0, 0,
+                                 0, 0,
+                                 width, height,
+                                 width, height,
+                                 CLUTTER_CAIRO_FORMAT_ARGB32,
+                                 stride,
+                                 data)))
+    g_clear_pointer (&priv->texture, cogl_object_unref);
+
+  if (priv->texture == NULL)
+    priv->texture = cogl_texture_new_from_data (width, height,
+                                                COGL_TEXTURE_NO_SLICING,
+                                                CLUTTER_CAIRO_FORMAT_ARGB32,
+                                                COGL_PIXEL_FORMAT_ANY,
+                                                stride,
+                                                data);
+
+  priv->front_dirty = FALSE;
 }
 
 static void
@@ -366,26 +598,100 @@ clutter_canvas_paint_content (ClutterContent   *content,
   ClutterCanvasPrivate *priv = self->priv;
   ClutterPaintNode *node;
 
-  if (priv->buffer == NULL)
-    return;
+  if (priv->async_draw)
+    {
+      /* until the first draw is done, we keep the previous texture */
+      if (priv->front_dirty)
+        clutter_canvas_upload_front_surface (self);
+    }
+  else
+    {
+      /* draw the contents released by the texture budget again */
+      if (priv->buffer == NULL && priv->evicted &&
+          priv->width > 0 && priv->height > 0)
+        clutter_canvas_emit_draw (self);
 
-  if (priv->dirty)
-    g_clear_pointer (&priv->texture, cogl_object_unref);
+      priv->evicted = FALSE;
 
-  if (priv->texture == NULL)
-    priv->texture = cogl_texture_new_from_bitmap (priv->buffer,
-                                                  COGL_TEXTURE_NO_SLICING,
-                                                  CLUTTER_CAIRO_FORMAT_ARGB32);
+      if (priv->buffer == NULL)
+        return;
+
+      if (priv->dirty)
+        g_clear_pointer (&priv->texture, cogl_object_unref);
+      else if (priv->dirty_region != NULL && priv->texture != NULL)
+        clutter_canvas_update_texture (self);
+
+      g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+
+      if (priv->texture == NULL)
+        priv->texture = cogl_texture_new_from_bitmap (priv->buffer,
+                                                      COGL_TEXTURE_NO_SLICING,
+                                                      CLUTTER_CAIRO_FORMAT_ARGB32);
+
+      priv->dirty = FALSE;
+    }
+
+  clutter_canvas_update_budget (self);
 
   if (priv->texture == NULL)
     return;
 
+  _clutter_texture_budget_mark_used (priv->budget_entry);
+
   node = clutter_actor_create_texture_paint_node (actor, priv->texture);
   clutter_paint_node_set_name (node, "Canvas Content");
   clutter_paint_node_add_child (root, node);
   clutter_paint_node_unref (node);
+}
+
+static int
+clutter_canvas_get_window_scale (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  int window_scale = 1;
+
+  if (priv->scale_factor_set)
+    window_scale = priv->scale_factor;
+  else
+    g_object_get (clutter_settings_get_default (),
+                  "window-scaling-factor", &window_scale,
+                  NULL);
+
+  return window_scale;
+}
+
+static void
+clutter_canvas_draw_surface (ClutterCanvas               *self,
+                             cairo_surface_t             *surface,
+                             const cairo_rectangle_int_t *clip)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  gboolean res;
+  cairo_t *cr;
+
+  self->priv->cr = cr = cairo_create (surface);
+
+  if (clip != NULL)
+    {
+      cairo_rectangle (cr, clip->x, clip->y, clip->width, clip->height);
+      cairo_clip (cr);
+    }
+
+  g_signal_emit (self, canvas_signals[DRAW], 0,
+                 cr, priv->width, priv->height,
+                 &res);
+
+#ifdef CLUTTER_ENABLE_DEBUG
+  if (_clutter_diagnostic_enabled () && cairo_status (cr))
+    {
+      g_warning ("Drawing failed for <ClutterCanvas>[%p]: %s",
+                 self,
+                 cairo_status_to_string (cairo_status (cr)));
+    }
+#endif
 
-  priv->dirty = FALSE;
+  self->priv->cr = NULL;
+  cairo_destroy (cr);
 }
 
 static void
@@ -397,20 +703,13 @@ clutter_canvas_emit_draw (ClutterCanvas *self)
   gboolean mapped_buffer;
   unsigned char *data;
   CoglBuffer *buffer;
-  int window_scale = 1;
-  gboolean res;
-  cairo_t *cr;
+  int window_scale;
 
   g_assert (priv->width > 0 && priv->height > 0);
 
   priv->dirty = TRUE;
 
-  if (priv->scale_factor_set)
-    window_scale = priv->scale_factor;
-  else
-    g_object_get (clutter_settings_get_default (),
-                  "window-scaling-factor", &window_scale,
-                  NULL);
+  window_scale = clutter_canvas_get_window_scale (self);
 
   real_width = priv->width * window_scale;
   real_height = priv->height * window_scale;
@@ -463,36 +762,188 @@ clutter_canvas_emit_draw (ClutterCanvas *self)
 
   cairo_surface_set_device_scale (surface, window_scale, window_scale);
 
-  self->priv->cr = cr = cairo_create (surface);
+  clutter_canvas_draw_surface (self, surface, NULL);
 
-  g_signal_emit (self, canvas_signals[DRAW], 0,
-                 cr, priv->width, priv->height,
+  if (mapped_buffer)
+    cogl_buffer_unmap (buffer);
+  else
+    {
+      int size = cairo_image_surface_get_stride (surface) * priv->height;
+      cogl_buffer_set_data (buffer,
+                            0,
+                            cairo_image_surface_get_data (surface),
+                            size);
+    }
+
+  cairo_surface_destroy (surface);
+}
+
+static void
+async_draw_free (AsyncDraw *async)
+{
+  if (async->surface != NULL)
+    cairo_surface_destroy (async->surface);
+
+  g_object_unref (async->canvas);
+
+  g_slice_free (AsyncDraw, async);
+}
+
+static void clutter_canvas_queue_async_draw (ClutterCanvas *self);
+
+static gboolean
+clutter_canvas_async_draw_done (gpointer data)
+{
+  AsyncDraw *async = data;
+  ClutterCanvas *self = async->canvas;
+  ClutterCanvasPrivate *priv = self->priv;
+
+  if (async->cancelled)
+    {
+      CLUTTER_NOTE (MISC, "ClutterCanvas: async draw cancelled");
+      goto out;
+    }
+
+  priv->async_draw_data = NULL;
+
+  /* swap the surfaces; the one we were painting is reused by the
+   * next draw
+   */
+  g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
+  priv->back_surface = priv->front_surface;
+  priv->front_surface = async->surface;
+  async->surface = NULL;
+
+  priv->front_dirty = TRUE;
+
+  _clutter_content_queue_redraw (CLUTTER_CONTENT (self));
+
+  /* the canvas was invalidated while we were drawing */
+  if (priv->draw_pending)
+    {
+      priv->draw_pending = FALSE;
+      clutter_canvas_queue_async_draw (self);
+    }
+
+out:
+  async_draw_free (async);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+clutter_canvas_async_draw_thread (gpointer data,
+                                  gpointer user_data)
+{
+  AsyncDraw *async = data;
+  gboolean res;
+  cairo_t *cr;
+
+  cr = cairo_create (async->surface);
+
+  /* the surface contains an older frame */
+  cairo_save (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_restore (cr);
+
+  g_signal_emit (async->canvas, canvas_signals[DRAW], 0,
+                 cr, async->width, async->height,
                  &res);
 
 #ifdef CLUTTER_ENABLE_DEBUG
   if (_clutter_diagnostic_enabled () && cairo_status (cr))
     {
       g_warning ("Drawing failed for <ClutterCanvas>[%p]: %s",
-                 self,
+                 async->canvas,
                  cairo_status_to_string (cairo_status (cr)));
     }
 #endif
 
-  self->priv->cr = NULL;
   cairo_destroy (cr);
+  cairo_surface_flush (async->surface);
 
-  if (mapped_buffer)
-    cogl_buffer_unmap (buffer);
-  else
+  clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                 clutter_canvas_async_draw_done,
+                                 async,
+                                 NULL);
+}
+
+static void
+clutter_canvas_queue_async_draw (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  int real_width, real_height;
+  int window_scale;
+  AsyncDraw *async;
+
+  /* coalesce the invalidations happening while drawing */
+  if (priv->async_draw_data != NULL)
     {
-      int size = cairo_image_surface_get_stride (surface) * priv->height;
-      cogl_buffer_set_data (buffer,
-                            0,
-                            cairo_image_surface_get_data (surface),
-                            size);
+      priv->draw_pending = TRUE;
+      return;
     }
 
-  cairo_surface_destroy (surface);
+  window_scale = clutter_canvas_get_window_scale (self);
+
+  real_width = priv->width * window_scale;
+  real_height = priv->height * window_scale;
+
+  if (priv->back_surface != NULL &&
+      (cairo_image_surface_get_width (priv->back_surface) != real_width ||
+       cairo_image_surface_get_height (priv->back_surface) != real_height))
+    g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
+
+  if (priv->back_surface == NULL)
+    priv->back_surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                     real_width,
+                                                     real_height);
+
+  cairo_surface_set_device_scale (priv->back_surface,
+                                  window_scale,
+                                  window_scale);
+
+  async = g_slice_new0 (AsyncDraw);
+  async->canvas = g_object_ref (self);
+  async->surface = priv->back_surface;
+  async->width = priv->width;
+  async->height = priv->height;
+
+  priv->back_surface = NULL;
+  priv->async_draw_data = async;
+
+  if (G_UNLIKELY (async_draw_thread_pool == NULL))
+    {
+      /* This apparently can't fail if exclusive == FALSE */
+      async_draw_thread_pool =
+        g_thread_pool_new (clutter_canvas_async_draw_thread, NULL,
+                           1,
+                           FALSE,
+                           NULL);
+    }
+
+  CLUTTER_NOTE (MISC, "ClutterCanvas: %p: queueing async draw (%d x %d)",
+                self,
+                real_width, real_height);
+
+  g_thread_pool_push (async_draw_thread_pool, async, NULL);
+}
+
+static void
+clutter_canvas_cancel_async_draw (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+
+  priv->draw_pending = FALSE;
+
+  if (priv->async_draw_data == NULL)
+    return;
+
+  /* the worker thread cannot be interrupted, so we just detach the
+   * request; the results will be discarded once it's done
+   */
+  priv->async_draw_data->cancelled = TRUE;
+  priv->async_draw_data = NULL;
 }
 
 static void
@@ -501,16 +952,27 @@ clutter_canvas_invalidate (ClutterContent *content)
   ClutterCanvas *self = CLUTTER_CANVAS (content);
   ClutterCanvasPrivate *priv = self->priv;
 
+  if (priv->async_draw)
+    {
+      if (priv->width > 0 && priv->height > 0)
+        clutter_canvas_queue_async_draw (self);
+
+      return;
+    }
+
   if (priv->buffer != NULL)
     {
       cogl_object_unref (priv->buffer);
       priv->buffer = NULL;
     }
 
-  if (priv->width <= 0 || priv->height <= 0)
-    return;
+  g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+  priv->evicted = FALSE;
 
-  clutter_canvas_emit_draw (self);
+  if (priv->width > 0 && priv->height > 0)
+    clutter_canvas_emit_draw (self);
+
+  clutter_canvas_update_budget (self);
 }
 
 static gboolean
@@ -714,3 +1176,172 @@ clutter_canvas_get_scale_factor (ClutterCanvas *canvas)
 
   return canvas->priv->scale_factor;
 }
+
+/**
+ * clutter_canvas_invalidate_rect:
+ * @canvas: a #ClutterCanvas
+ * @rect: the area to redraw, in the coordinates of the canvas
+ *
+ * Invalidates an area of the @canvas.
+ *
+ * Unlike clutter_content_invalidate(), the previous contents of the
+ * @canvas are preserved, and the #ClutterCanvas::draw signal is emitted
+ * with a #cairo_t clipped to @rect; handlers can use cairo_clip_extents()
+ * to avoid drawing outside of it. Only the invalidated areas are uploaded
+ * to the GPU the next time the @canvas is painted.
+ *
+ * If the @canvas has not been drawn yet, or its size changed, or it
+ * is drawn asynchronously, the whole @canvas is invalidated instead.
+ *
+ * Since: 1.28
+ */
+void
+clutter_canvas_invalidate_rect (ClutterCanvas               *canvas,
+                                const cairo_rectangle_int_t *rect)
+{
+  ClutterCanvasPrivate *priv;
+  cairo_rectangle_int_t area, real_area;
+  int real_width, real_height;
+  cairo_surface_t *surface;
+  unsigned char *data;
+  CoglBuffer *buffer;
+  int window_scale;
+
+  g_return_if_fail (CLUTTER_IS_CANVAS (canvas));
+  g_return_if_fail (rect != NULL);
+
+  priv = canvas->priv;
+
+  if (priv->width <= 0 || priv->height <= 0)
+    return;
+
+  window_scale = clutter_canvas_get_window_scale (canvas);
+
+  real_width = priv->width * window_scale;
+  real_height = priv->height * window_scale;
+
+  /* we need the previous contents to draw on top of them */
+  if (priv->async_draw ||
+      priv->buffer == NULL ||
+      cogl_bitmap_get_width (priv->buffer) != real_width ||
+      cogl_bitmap_get_height (priv->buffer) != real_height)
+    {
+      clutter_content_invalidate (CLUTTER_CONTENT (canvas));
+      return;
+    }
+
+  area.x = MAX (rect->x, 0);
+  area.y = MAX (rect->y, 0);
+  area.width = MIN (rect->x + rect->width, priv->width) - area.x;
+  area.height = MIN (rect->y + rect->height, priv->height) - area.y;
+
+  if (area.width <= 0 || area.height <= 0)
+    return;
+
+  buffer = COGL_BUFFER (cogl_bitmap_get_buffer (priv->buffer));
+  data = cogl_buffer_map (buffer, COGL_BUFFER_ACCESS_READ_WRITE, 0);
+  if (data == NULL)
+    {
+      clutter_content_invalidate (CLUTTER_CONTENT (canvas));
+      return;
+    }
+
+  surface = cairo_image_surface_create_for_data (data,
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 real_width,
+                                                 real_height,
+                                                 cogl_bitmap_get_rowstride (priv->buffer));
+  cairo_surface_set_device_scale (surface, window_scale, window_scale);
+
+  clutter_canvas_draw_surface (canvas, surface, &area);
+
+  cogl_buffer_unmap (buffer);
+  cairo_surface_destroy (surface);
+
+  /* if the whole texture has to be uploaded anyway, there is no
+   * point in tracking the damage
+   */
+  if (!priv->dirty && priv->texture != NULL)
+    {
+      real_area.x = area.x * window_scale;
+      real_area.y = area.y * window_scale;
+      real_area.width = area.width * window_scale;
+      real_area.height = area.height * window_scale;
+
+      if (priv->dirty_region == NULL)
+        priv->dirty_region = cairo_region_create_rectangle (&real_area);
+      else
+        cairo_region_union_rectangle (priv->dirty_region, &real_area);
+    }
+
+  _clutter_content_queue_redraw (CLUTTER_CONTENT (canvas));
+}
+
+/**
+ * clutter_canvas_set_async_draw:
+ * @canvas: a #ClutterCanvas
+ * @async_draw: whether to draw in a worker thread
+ *
+ * Sets whether the #ClutterCanvas::draw signal of @canvas should be
+ * emitted in a worker thread, instead of when the @canvas is invalidated.
+ *
+ * See #ClutterCanvas:async-draw for the constraints this puts on the
+ * signal handlers.
+ *
+ * Changing this setting invalidates the @canvas.
+ *
+ * Since: 1.28
+ */
+void
+clutter_canvas_set_async_draw (ClutterCanvas *canvas,
+                               gboolean       async_draw)
+{
+  ClutterCanvasPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_CANVAS (canvas));
+
+  priv = canvas->priv;
+
+  async_draw = !!async_draw;
+  if (priv->async_draw == async_draw)
+    return;
+
+  priv->async_draw = async_draw;
+
+  if (async_draw)
+    {
+      g_clear_pointer (&priv->buffer, cogl_object_unref);
+      g_clear_pointer (&priv->dirty_region, cairo_region_destroy);
+      priv->dirty = FALSE;
+    }
+  else
+    {
+      clutter_canvas_cancel_async_draw (canvas);
+
+      g_clear_pointer (&priv->front_surface, cairo_surface_destroy);
+      g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
+      priv->front_dirty = FALSE;
+    }
+
+  clutter_content_invalidate (CLUTTER_CONTENT (canvas));
+
+  g_object_notify_by_pspec (G_OBJECT (canvas), obj_props[PROP_ASYNC_DRAW]);
+}
+
+/**
+ * clutter_canvas_get_async_draw:
+ * @canvas: a #ClutterCanvas
+ *
+ * Retrieves the value set using clutter_canvas_set_async_draw().
+ *
+ * Return value: %TRUE if the @canvas is drawn in a worker thread
+ *
+ * Since: 1.28
+ */
+gboolean
+clutter_canvas_get_async_draw (ClutterCanvas *canvas)
+{
+  g_return_val_if_fail (CLUTTER_IS_CANVAS (canvas), FALSE);
+
+  return canvas->priv->async_draw;
+}
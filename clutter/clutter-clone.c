@@ -34,6 +34,14 @@
  * the presence of support for FBOs in the underlying GL or GLES
  * implementation.
  *
+ * By default, every #ClutterClone paints the whole source actor again.
+ * If #ClutterClone:cached is set, the source is instead rendered into a
+ * texture whenever it changes, and the clone paints that texture; the
+ * texture is shared by all the cached clones of the same source, so
+ * many clones of a complex actor cost little more than one. The
+ * snapshot is flat, so parts of the source transformed out of its
+ * plane are projected on it.
+ *
  * #ClutterClone is available since Clutter 1.0
  */
 
@@ -43,17 +51,50 @@
 
 #define CLUTTER_ENABLE_EXPERIMENTAL_API
 #include "clutter-actor-private.h"
+#include "clutter-backend.h"
 #include "clutter-clone.h"
 #include "clutter-debug.h"
 #include "clutter-main.h"
 #include "clutter-paint-volume-private.h"
 #include "clutter-private.h"
 
+#include <math.h>
+
 #include "cogl/cogl.h"
 
+typedef struct _CloneSnapshot   CloneSnapshot;
+
+/* the rendering of a source actor, shared by its cached clones */
+struct _CloneSnapshot
+{
+  ClutterActor *source;
+
+  int ref_count;
+
+  CoglHandle texture;
+  CoglHandle offscreen;
+
+  /* the area of the source inside the texture, in the coordinates
+   * of the source
+   */
+  float x;
+  float y;
+  int width;
+  int height;
+
+  gulong queue_redraw_id;
+
+  guint dirty : 1;
+};
+
 struct _ClutterClonePrivate
 {
   ClutterActor *clone_source;
+
+  CloneSnapshot *snapshot;
+  CoglPipeline *pipeline;
+
+  guint cached : 1;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (ClutterClone, clutter_clone, CLUTTER_TYPE_ACTOR)
@@ -63,12 +104,15 @@ enum
   PROP_0,
 
   PROP_SOURCE,
+  PROP_CACHED,
 
   PROP_LAST
 };
 
 static GParamSpec *obj_props[PROP_LAST];
 
+static GQuark quark_clone_snapshot = 0;
+
 static void clutter_clone_set_source_internal (ClutterClone *clone,
 					       ClutterActor *source);
 static void
@@ -152,19 +196,13 @@ clutter_clone_apply_transform (ClutterActor *self, CoglMatrix *matrix)
   cogl_matrix_scale (matrix, x_scale, y_scale, x_scale);
 }
 
+/* paints the source actor in place of the clone */
 static void
-clutter_clone_paint (ClutterActor *actor)
+clutter_clone_paint_source (ClutterActor *source,
+                            guint8        opacity)
 {
-  ClutterClone *self = CLUTTER_CLONE (actor);
-  ClutterClonePrivate *priv = self->priv;
   gboolean was_unmapped = FALSE;
 
-  if (priv->clone_source == NULL)
-    return;
-
-  CLUTTER_NOTE (PAINT, "painting clone actor '%s'",
-                _clutter_actor_get_debug_name (actor));
-
   /* The final bits of magic:
    * - We need to override the paint opacity of the actor with our own
    *   opacity.
@@ -173,33 +211,256 @@ clutter_clone_paint (ClutterActor *actor)
    * - We need to stop clutter_actor_paint applying the model view matrix of
    *   the clone source actor.
    */
-  _clutter_actor_set_in_clone_paint (priv->clone_source, TRUE);
-  clutter_actor_set_opacity_override (priv->clone_source,
-                                       clutter_actor_get_paint_opacity (actor));
-  _clutter_actor_set_enable_model_view_transform (priv->clone_source, FALSE);
+  _clutter_actor_set_in_clone_paint (source, TRUE);
+  clutter_actor_set_opacity_override (source, opacity);
+  _clutter_actor_set_enable_model_view_transform (source, FALSE);
 
-  if (!clutter_actor_is_mapped (priv->clone_source))
+  if (!clutter_actor_is_mapped (source))
     {
-      _clutter_actor_set_enable_paint_unmapped (priv->clone_source, TRUE);
+      _clutter_actor_set_enable_paint_unmapped (source, TRUE);
       was_unmapped = TRUE;
     }
 
   /* If the source isn't ultimately parented to a toplevel, it can't be
    * realized or painted.
    */
-  if (clutter_actor_is_realized (priv->clone_source))
+  if (clutter_actor_is_realized (source))
     {
       _clutter_actor_push_clone_paint ();
-      clutter_actor_paint (priv->clone_source);
+      clutter_actor_paint (source);
       _clutter_actor_pop_clone_paint ();
     }
 
   if (was_unmapped)
-    _clutter_actor_set_enable_paint_unmapped (priv->clone_source, FALSE);
+    _clutter_actor_set_enable_paint_unmapped (source, FALSE);
+
+  _clutter_actor_set_enable_model_view_transform (source, TRUE);
+  clutter_actor_set_opacity_override (source, -1);
+  _clutter_actor_set_in_clone_paint (source, FALSE);
+}
 
-  _clutter_actor_set_enable_model_view_transform (priv->clone_source, TRUE);
-  clutter_actor_set_opacity_override (priv->clone_source, -1);
-  _clutter_actor_set_in_clone_paint (priv->clone_source, FALSE);
+static void
+clone_snapshot_queue_redraw (ClutterActor  *source,
+                             ClutterActor  *origin,
+                             CloneSnapshot *snapshot)
+{
+  /* the source, or one of its children, changed */
+  snapshot->dirty = TRUE;
+}
+
+static CloneSnapshot *
+clone_snapshot_ref (ClutterActor *source)
+{
+  CloneSnapshot *snapshot;
+
+  snapshot = g_object_get_qdata (G_OBJECT (source), quark_clone_snapshot);
+  if (snapshot != NULL)
+    {
+      snapshot->ref_count += 1;
+      return snapshot;
+    }
+
+  snapshot = g_slice_new0 (CloneSnapshot);
+  snapshot->source = source;
+  snapshot->ref_count = 1;
+  snapshot->dirty = TRUE;
+  snapshot->queue_redraw_id =
+    g_signal_connect (source, "queue-redraw",
+                      G_CALLBACK (clone_snapshot_queue_redraw),
+                      snapshot);
+
+  g_object_set_qdata (G_OBJECT (source), quark_clone_snapshot, snapshot);
+
+  return snapshot;
+}
+
+static void
+clone_snapshot_unref (CloneSnapshot *snapshot)
+{
+  snapshot->ref_count -= 1;
+  if (snapshot->ref_count > 0)
+    return;
+
+  /* destroying the source disconnects all its handlers */
+  if (g_signal_handler_is_connected (snapshot->source, snapshot->queue_redraw_id))
+    g_signal_handler_disconnect (snapshot->source, snapshot->queue_redraw_id);
+
+  g_object_set_qdata (G_OBJECT (snapshot->source), quark_clone_snapshot, NULL);
+
+  if (snapshot->offscreen != NULL)
+    cogl_handle_unref (snapshot->offscreen);
+
+  if (snapshot->texture != NULL)
+    cogl_handle_unref (snapshot->texture);
+
+  g_slice_free (CloneSnapshot, snapshot);
+}
+
+/* renders the source again, if it changed since the last time */
+static gboolean
+clone_snapshot_update (CloneSnapshot *snapshot)
+{
+  ClutterActor *source = snapshot->source;
+  const ClutterPaintVolume *volume;
+  ClutterVertex origin;
+  CoglMatrix modelview;
+  CoglColor transparent;
+  float x, y;
+  int width, height;
+
+  volume = clutter_actor_get_paint_volume (source);
+  if (volume == NULL)
+    return FALSE;
+
+  clutter_paint_volume_get_origin (volume, &origin);
+  x = floorf (origin.x);
+  y = floorf (origin.y);
+  width = ceilf (origin.x + clutter_paint_volume_get_width (volume)) - x;
+  height = ceilf (origin.y + clutter_paint_volume_get_height (volume)) - y;
+
+  if (width <= 0 || height <= 0)
+    return FALSE;
+
+  if (!snapshot->dirty &&
+      snapshot->offscreen != NULL &&
+      snapshot->x == x &&
+      snapshot->y == y &&
+      snapshot->width == width &&
+      snapshot->height == height)
+    return TRUE;
+
+  if (snapshot->offscreen == NULL ||
+      snapshot->width != width ||
+      snapshot->height != height)
+    {
+      if (snapshot->offscreen != NULL)
+        {
+          cogl_handle_unref (snapshot->offscreen);
+          snapshot->offscreen = NULL;
+        }
+
+      if (snapshot->texture != NULL)
+        cogl_handle_unref (snapshot->texture);
+
+      snapshot->texture =
+        cogl_texture_new_with_size (width, height,
+                                    COGL_TEXTURE_NO_SLICING,
+                                    COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (snapshot->texture == NULL)
+        return FALSE;
+
+      snapshot->offscreen = cogl_offscreen_new_to_texture (snapshot->texture);
+      if (snapshot->offscreen == NULL)
+        {
+          g_warning ("%s: Unable to create an Offscreen buffer", G_STRLOC);
+          return FALSE;
+        }
+
+      /* actors moved along the z axis inside the source must not be
+       * clipped away
+       */
+      cogl_framebuffer_orthographic (COGL_FRAMEBUFFER (snapshot->offscreen),
+                                     0, 0,
+                                     width, height,
+                                     -10000.f, 10000.f);
+    }
+
+  CLUTTER_NOTE (PAINT, "rendering the snapshot of clone source '%s'",
+                _clutter_actor_get_debug_name (source));
+
+  snapshot->x = x;
+  snapshot->y = y;
+  snapshot->width = width;
+  snapshot->height = height;
+
+  cogl_push_framebuffer (snapshot->offscreen);
+
+  cogl_matrix_init_identity (&modelview);
+  cogl_matrix_translate (&modelview, -x, -y, 0.f);
+  cogl_set_modelview_matrix (&modelview);
+
+  cogl_color_init_from_4ub (&transparent, 0, 0, 0, 0);
+  cogl_clear (&transparent,
+              COGL_BUFFER_BIT_COLOR |
+              COGL_BUFFER_BIT_DEPTH);
+
+  /* the clones apply their own opacity when painting the snapshot */
+  clutter_clone_paint_source (source, 0xff);
+
+  cogl_pop_framebuffer ();
+
+  /* queueing redraws while painting does not change the snapshot */
+  snapshot->dirty = FALSE;
+
+  return TRUE;
+}
+
+static void
+clutter_clone_update_snapshot (ClutterClone *self)
+{
+  ClutterClonePrivate *priv = self->priv;
+  gboolean needs_snapshot;
+
+  needs_snapshot = priv->cached && priv->clone_source != NULL;
+
+  if (priv->snapshot != NULL &&
+      (!needs_snapshot || priv->snapshot->source != priv->clone_source))
+    {
+      clone_snapshot_unref (priv->snapshot);
+      priv->snapshot = NULL;
+    }
+
+  if (needs_snapshot && priv->snapshot == NULL)
+    priv->snapshot = clone_snapshot_ref (priv->clone_source);
+}
+
+static void
+clutter_clone_paint (ClutterActor *actor)
+{
+  ClutterClone *self = CLUTTER_CLONE (actor);
+  ClutterClonePrivate *priv = self->priv;
+  CloneSnapshot *snapshot = priv->snapshot;
+  guint8 paint_opacity;
+
+  if (priv->clone_source == NULL)
+    return;
+
+  CLUTTER_NOTE (PAINT, "painting clone actor '%s'",
+                _clutter_actor_get_debug_name (actor));
+
+  paint_opacity = clutter_actor_get_paint_opacity (actor);
+
+  if (snapshot == NULL ||
+      !clutter_actor_is_realized (priv->clone_source) ||
+      !clone_snapshot_update (snapshot))
+    {
+      clutter_clone_paint_source (priv->clone_source, paint_opacity);
+      return;
+    }
+
+  /* every clone has its own pipeline, so that drawing clones with
+   * different opacities does not flush the journal
+   */
+  if (priv->pipeline == NULL)
+    {
+      CoglContext *ctx =
+        clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+      priv->pipeline = cogl_pipeline_new (ctx);
+    }
+
+  cogl_pipeline_set_layer_texture (priv->pipeline, 0, snapshot->texture);
+  cogl_pipeline_set_color4ub (priv->pipeline,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity);
+
+  cogl_set_source (priv->pipeline);
+  cogl_rectangle (snapshot->x,
+                  snapshot->y,
+                  snapshot->x + snapshot->width,
+                  snapshot->y + snapshot->height);
 }
 
 static gboolean
@@ -284,6 +545,10 @@ clutter_clone_set_property (GObject      *gobject,
       clutter_clone_set_source (self, g_value_get_object (value));
       break;
 
+    case PROP_CACHED:
+      clutter_clone_set_cached (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -304,6 +569,10 @@ clutter_clone_get_property (GObject    *gobject,
       g_value_set_object (value, priv->clone_source);
       break;
 
+    case PROP_CACHED:
+      g_value_set_boolean (value, priv->cached);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -313,8 +582,16 @@ clutter_clone_get_property (GObject    *gobject,
 static void
 clutter_clone_dispose (GObject *gobject)
 {
+  ClutterClonePrivate *priv = CLUTTER_CLONE (gobject)->priv;
+
   clutter_clone_set_source_internal (CLUTTER_CLONE (gobject), NULL);
 
+  if (priv->pipeline != NULL)
+    {
+      cogl_object_unref (priv->pipeline);
+      priv->pipeline = NULL;
+    }
+
   G_OBJECT_CLASS (clutter_clone_parent_class)->dispose (gobject);
 }
 
@@ -351,7 +628,27 @@ clutter_clone_class_init (ClutterCloneClass *klass)
                          G_PARAM_CONSTRUCT |
                          CLUTTER_PARAM_READWRITE);
 
+  /**
+   * ClutterClone:cached:
+   *
+   * Whether the clone paints a snapshot of the source, instead of
+   * painting the source itself.
+   *
+   * The snapshot is rendered again only when the source changes, and
+   * it is shared with the other cached clones of the same source.
+   *
+   * Since: 1.28
+   */
+  obj_props[PROP_CACHED] =
+    g_param_spec_boolean ("cached",
+                          P_("Cached"),
+                          P_("Whether the clone paints a snapshot of the source"),
+                          FALSE,
+                          CLUTTER_PARAM_READWRITE);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, obj_props);
+
+  quark_clone_snapshot = g_quark_from_static_string ("-clutter-clone-snapshot");
 }
 
 static void
@@ -385,6 +682,15 @@ clutter_clone_set_source_internal (ClutterClone *self,
   if (priv->clone_source == source)
     return;
 
+  /* the snapshot has to be released while we still hold a reference
+   * on its source
+   */
+  if (priv->snapshot != NULL)
+    {
+      clone_snapshot_unref (priv->snapshot);
+      priv->snapshot = NULL;
+    }
+
   if (priv->clone_source != NULL)
     {
       _clutter_actor_detach_clone (priv->clone_source, CLUTTER_ACTOR (self));
@@ -398,6 +704,8 @@ clutter_clone_set_source_internal (ClutterClone *self,
       _clutter_actor_attach_clone (priv->clone_source, CLUTTER_ACTOR (self));
     }
 
+  clutter_clone_update_snapshot (self);
+
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_SOURCE]);
 
   clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
@@ -440,3 +748,58 @@ clutter_clone_get_source (ClutterClone *self)
 
   return self->priv->clone_source;
 }
+
+/**
+ * clutter_clone_set_cached:
+ * @self: a #ClutterClone
+ * @cached: whether @self should paint a snapshot of its source
+ *
+ * Sets whether @self paints a snapshot of its source actor, rendered
+ * only when the source changes, instead of painting the source actor
+ * itself.
+ *
+ * Cached clones are cheaper to paint when there are many clones of a
+ * complex source, at the cost of the memory used by the snapshot.
+ *
+ * Since: 1.28
+ */
+void
+clutter_clone_set_cached (ClutterClone *self,
+                          gboolean      cached)
+{
+  ClutterClonePrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_CLONE (self));
+
+  priv = self->priv;
+
+  cached = !!cached;
+  if (priv->cached == cached)
+    return;
+
+  priv->cached = cached;
+
+  clutter_clone_update_snapshot (self);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_CACHED]);
+}
+
+/**
+ * clutter_clone_get_cached:
+ * @self: a #ClutterClone
+ *
+ * Retrieves the value set using clutter_clone_set_cached().
+ *
+ * Return value: %TRUE if @self paints a snapshot of its source
+ *
+ * Since: 1.28
+ */
+gboolean
+clutter_clone_get_cached (ClutterClone *self)
+{
+  g_return_val_if_fail (CLUTTER_IS_CLONE (self), FALSE);
+
+  return self->priv->cached;
+}
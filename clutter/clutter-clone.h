@@ -89,6 +89,12 @@ void            clutter_clone_set_source        (ClutterClone *self,
 CLUTTER_AVAILABLE_IN_1_0
 ClutterActor *  clutter_clone_get_source        (ClutterClone *self);
 
+CLUTTER_AVAILABLE_IN_1_28
+void            clutter_clone_set_cached        (ClutterClone *self,
+                                                 gboolean      cached);
+CLUTTER_AVAILABLE_IN_1_28
+gboolean        clutter_clone_get_cached        (ClutterClone *self);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_CLONE_H__ */
@@ -38,6 +38,10 @@ void            _clutter_content_paint_content          (ClutterContent   *conte
                                                          ClutterActor     *actor,
                                                          ClutterPaintNode *node);
 
+void            _clutter_content_queue_redraw           (ClutterContent   *content);
+
+gboolean        _clutter_content_has_mapped_actors      (ClutterContent   *content);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_CONTENT_PRIVATE_H__ */
@@ -49,6 +49,17 @@
  * Each passed vertex is an in-out parameter that initially contains the
  * position of the vertex and should be modified according to a specific
  * deformation algorithm.
+ *
+ * Since the #ClutterDeformEffectClass.deform_vertex() virtual function runs
+ * on the CPU, every change in the parameters of the deformation requires
+ * computing and uploading all the vertices of the grid again. Sub-classes
+ * can instead describe the deformation as a snippet of GLSL using
+ * clutter_deform_effect_set_vertex_shader(), and its parameters as uniforms
+ * using clutter_deform_effect_set_uniform_float(); in that case the grid
+ * is only uploaded when the size of the actor or the number of tiles
+ * change, and the deformation is computed by the GPU. Sub-classes should
+ * still implement #ClutterDeformEffectClass.deform_vertex(), as it is used
+ * on platforms without support for GLSL.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -62,6 +73,7 @@
 
 #include "clutter-debug.h"
 #include "clutter-enum-types.h"
+#include "clutter-feature.h"
 #include "clutter-offscreen-effect-private.h"
 #include "clutter-private.h"
 
@@ -84,9 +96,22 @@ struct _ClutterDeformEffectPrivate
 
   gulong allocation_id;
 
+  /* the deformation, when computed on the GPU */
+  CoglSnippet *vertex_snippet;
+  GHashTable *uniforms;
+
+  /* the opacity the grid was last uploaded with */
+  guint8 grid_opacity;
+
   guint is_dirty : 1;
 };
 
+typedef struct {
+  gint n_components;
+  gint count;
+  gfloat *value;
+} DeformUniform;
+
 enum
 {
   PROP_0,
@@ -167,6 +192,68 @@ clutter_deform_effect_set_actor (ClutterActorMeta *meta,
   CLUTTER_ACTOR_META_CLASS (clutter_deform_effect_parent_class)->set_actor (meta, actor);
 }
 
+static void
+clutter_deform_effect_update_texture_matrix (ClutterOffscreenEffect *effect,
+                                             CoglPipeline           *pipeline)
+{
+  ClutterRect rect;
+  CoglMatrix matrix;
+  gfloat texel_width, texel_height;
+
+  if (!clutter_offscreen_effect_get_target_rect (effect, &rect))
+    return;
+
+  /* the target texture can be a region of a bigger texture, and unlike
+   * rectangles, primitives do not remap their texture coordinates
+   */
+  _clutter_offscreen_effect_get_texel_size (effect,
+                                            &texel_width,
+                                            &texel_height);
+
+  cogl_matrix_init_identity (&matrix);
+  cogl_matrix_scale (&matrix,
+                     clutter_rect_get_width (&rect) * texel_width,
+                     clutter_rect_get_height (&rect) * texel_height,
+                     1.0f);
+  cogl_pipeline_set_layer_matrix (pipeline, 0, &matrix);
+}
+
+static void
+clutter_deform_effect_apply_shader (ClutterDeformEffect *self,
+                                    CoglPipeline        *pipeline,
+                                    gfloat               width,
+                                    gfloat               height)
+{
+  ClutterDeformEffectPrivate *priv = self->priv;
+  GHashTableIter iter;
+  gpointer key, value;
+  gfloat size[2];
+  int location;
+
+  cogl_pipeline_add_snippet (pipeline, priv->vertex_snippet);
+
+  size[0] = width;
+  size[1] = height;
+  location = cogl_pipeline_get_uniform_location (pipeline,
+                                                 "clutter_deform_size");
+  cogl_pipeline_set_uniform_float (pipeline, location, 2, 1, size);
+
+  if (priv->uniforms == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, priv->uniforms);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      DeformUniform *uniform = value;
+
+      location = cogl_pipeline_get_uniform_location (pipeline, key);
+      cogl_pipeline_set_uniform_float (pipeline, location,
+                                       uniform->n_components,
+                                       uniform->count,
+                                       uniform->value);
+    }
+}
+
 static void
 clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
 {
@@ -176,31 +263,35 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
   CoglPipeline *pipeline;
   CoglDepthState depth_state;
   CoglFramebuffer *fb = cogl_get_draw_framebuffer ();
+  ClutterActor *actor;
+  ClutterRect rect;
+  gfloat width, height;
+  guint8 opacity;
+
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
+  opacity = clutter_actor_get_paint_opacity (actor);
+
+  /* if we don't have a target size, fall back to the actor's
+   * allocation, though wrong it might be
+   */
+  if (clutter_offscreen_effect_get_target_rect (effect, &rect))
+    {
+      width = clutter_rect_get_width (&rect);
+      height = clutter_rect_get_height (&rect);
+    }
+  else
+    clutter_actor_get_size (actor, &width, &height);
+
+  /* the opacity is stored in the colour of each vertex */
+  if (opacity != priv->grid_opacity)
+    priv->is_dirty = TRUE;
 
   if (priv->is_dirty)
     {
-      ClutterRect rect;
       gboolean mapped_buffer;
       CoglVertexP3T2C4 *verts;
-      ClutterActor *actor;
-      gfloat width, height;
-      guint opacity;
       gint i, j;
 
-      actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
-      opacity = clutter_actor_get_paint_opacity (actor);
-
-      /* if we don't have a target size, fall back to the actor's
-       * allocation, though wrong it might be
-       */
-      if (clutter_offscreen_effect_get_target_rect (effect, &rect))
-        {
-          width = clutter_rect_get_width (&rect);
-          height = clutter_rect_get_height (&rect);
-        }
-      else
-        clutter_actor_get_size (actor, &width, &height);
-
       /* XXX ideally, the sub-classes should tell us what they
        * changed in the texture vertices; we then would be able to
        * avoid resubmitting the same data, if it did not change. for
@@ -246,9 +337,11 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
 
               cogl_color_init_from_4ub (&vertex.color, 255, 255, 255, opacity);
 
-              clutter_deform_effect_deform_vertex (self,
-                                                   width, height,
-                                                   &vertex);
+              /* with a vertex shader, we upload the undeformed grid */
+              if (priv->vertex_snippet == NULL)
+                clutter_deform_effect_deform_vertex (self,
+                                                     width, height,
+                                                     &vertex);
 
               vertex_out = verts + i * (priv->x_tiles + 1) + j;
 
@@ -275,12 +368,16 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
           g_free (verts);
         }
 
+      priv->grid_opacity = opacity;
       priv->is_dirty = FALSE;
     }
 
   material = clutter_offscreen_effect_get_target (effect);
   pipeline = COGL_PIPELINE (material);
 
+  if (material != NULL)
+    clutter_deform_effect_update_texture_matrix (effect, pipeline);
+
   /* enable depth testing */
   cogl_depth_state_init (&depth_state);
   cogl_depth_state_set_test_enabled (&depth_state, TRUE);
@@ -293,7 +390,24 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
 
   /* draw the front */
   if (material != NULL)
-    cogl_framebuffer_draw_primitive (fb, pipeline, priv->primitive);
+    {
+      if (priv->vertex_snippet != NULL)
+        {
+          CoglPipeline *front_pipeline;
+
+          /* the target pipeline is owned by ClutterOffscreenEffect */
+          front_pipeline = cogl_pipeline_copy (pipeline);
+          clutter_deform_effect_apply_shader (self, front_pipeline,
+                                              width, height);
+
+          cogl_framebuffer_draw_primitive (fb, front_pipeline,
+                                           priv->primitive);
+
+          cogl_object_unref (front_pipeline);
+        }
+      else
+        cogl_framebuffer_draw_primitive (fb, pipeline, priv->primitive);
+    }
 
   /* draw the back */
   if (priv->back_pipeline != NULL)
@@ -307,6 +421,10 @@ clutter_deform_effect_paint_target (ClutterOffscreenEffect *effect)
       cogl_pipeline_set_cull_face_mode (back_pipeline,
                                         COGL_PIPELINE_CULL_FACE_MODE_FRONT);
 
+      if (priv->vertex_snippet != NULL)
+        clutter_deform_effect_apply_shader (self, back_pipeline,
+                                            width, height);
+
       cogl_framebuffer_draw_primitive (fb, back_pipeline, priv->primitive);
 
       cogl_object_unref (back_pipeline);
@@ -436,9 +554,12 @@ clutter_deform_effect_init_arrays (ClutterDeformEffect *self)
                                NULL);
 
   /* The application is expected to continuously modify the vertices
-     so we should give a hint to Cogl about that */
+     so we should give a hint to Cogl about that, unless they are
+     deformed by a vertex shader */
   cogl_buffer_set_update_hint (COGL_BUFFER (priv->buffer),
-                               COGL_BUFFER_UPDATE_HINT_DYNAMIC);
+                               priv->vertex_snippet != NULL
+                                 ? COGL_BUFFER_UPDATE_HINT_STATIC
+                                 : COGL_BUFFER_UPDATE_HINT_DYNAMIC);
 
   attributes[0] = cogl_attribute_new (priv->buffer,
                                       "cogl_position_in",
@@ -508,6 +629,12 @@ clutter_deform_effect_finalize (GObject *gobject)
   clutter_deform_effect_free_arrays (self);
   clutter_deform_effect_free_back_pipeline (self);
 
+  if (self->priv->vertex_snippet != NULL)
+    cogl_object_unref (self->priv->vertex_snippet);
+
+  if (self->priv->uniforms != NULL)
+    g_hash_table_unref (self->priv->uniforms);
+
   G_OBJECT_CLASS (clutter_deform_effect_parent_class)->finalize (gobject);
 }
 
@@ -645,6 +772,9 @@ clutter_deform_effect_init (ClutterDeformEffect *self)
   self->priv = clutter_deform_effect_get_instance_private (self);
   self->priv->x_tiles = self->priv->y_tiles = DEFAULT_N_TILES;
   self->priv->back_pipeline = NULL;
+  self->priv->grid_opacity = 0xff;
+
+  _clutter_offscreen_effect_set_use_pool (CLUTTER_OFFSCREEN_EFFECT (self), TRUE);
 
   clutter_deform_effect_init_arrays (self);
 }
@@ -786,6 +916,16 @@ clutter_deform_effect_get_n_tiles (ClutterDeformEffect *effect,
     *y_tiles = effect->priv->y_tiles;
 }
 
+static void
+clutter_deform_effect_queue_repaint (ClutterDeformEffect *effect)
+{
+  ClutterActor *actor;
+
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
+  if (actor != NULL)
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
+}
+
 /**
  * clutter_deform_effect_invalidate:
  * @effect: a #ClutterDeformEffect
@@ -798,8 +938,6 @@ clutter_deform_effect_get_n_tiles (ClutterDeformEffect *effect,
 void
 clutter_deform_effect_invalidate (ClutterDeformEffect *effect)
 {
-  ClutterActor *actor;
-
   g_return_if_fail (CLUTTER_IS_DEFORM_EFFECT (effect));
 
   if (effect->priv->is_dirty)
@@ -807,7 +945,157 @@ clutter_deform_effect_invalidate (ClutterDeformEffect *effect)
 
   effect->priv->is_dirty = TRUE;
 
-  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
-  if (actor != NULL)
-    clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
+  clutter_deform_effect_queue_repaint (effect);
+}
+
+static void
+deform_uniform_free (gpointer data)
+{
+  DeformUniform *uniform = data;
+
+  g_free (uniform->value);
+  g_slice_free (DeformUniform, uniform);
+}
+
+/**
+ * clutter_deform_effect_set_vertex_shader:
+ * @effect: a #ClutterDeformEffect
+ * @declarations: (allow-none): GLSL declarations, like uniforms or
+ *   functions, used by @source
+ * @source: (allow-none): a snippet of GLSL computing the deformation
+ *   of a vertex, or %NULL
+ *
+ * Sets a snippet of GLSL that computes the deformation of each vertex
+ * of the grid on the GPU, in place of the #ClutterDeformEffectClass.deform_vertex()
+ * virtual function.
+ *
+ * The snippet is run for every vertex, and can modify two variables:
+ * `position`, a `vec4` containing the undeformed position of the vertex
+ * in the coordinates of the actor, and `color`, a `vec4` containing the
+ * color of the vertex. The size of the deformed area is available in
+ * the `clutter_deform_size` uniform, a `vec2`. The parameters of the
+ * deformation should be declared in @declarations as uniforms, and set
+ * using clutter_deform_effect_set_uniform_float(); changing them does
+ * not require uploading the grid again.
+ *
+ * Passing %NULL for @source goes back to computing the deformation
+ * on the CPU.
+ *
+ * Return value: %TRUE if the deformation is going to be computed by
+ *   the vertex shader, and %FALSE if GLSL is not supported, in which
+ *   case #ClutterDeformEffectClass.deform_vertex() is still used
+ *
+ * Since: 1.28
+ */
+gboolean
+clutter_deform_effect_set_vertex_shader (ClutterDeformEffect *effect,
+                                         const gchar         *declarations,
+                                         const gchar         *source)
+{
+  ClutterDeformEffectPrivate *priv;
+  gchar *full_declarations, *full_source;
+
+  g_return_val_if_fail (CLUTTER_IS_DEFORM_EFFECT (effect), FALSE);
+
+  priv = effect->priv;
+
+  if (priv->vertex_snippet != NULL)
+    {
+      cogl_object_unref (priv->vertex_snippet);
+      priv->vertex_snippet = NULL;
+    }
+
+  if (source != NULL && clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
+    {
+      full_declarations =
+        g_strconcat ("uniform vec2 clutter_deform_size;\n",
+                     declarations != NULL ? declarations : "",
+                     NULL);
+
+      /* Cogl has already computed the outputs of the vertex when a
+       * post snippet runs, so we replace the position and the color
+       * with the deformed ones
+       */
+      full_source =
+        g_strconcat ("{\n"
+                     "  vec4 position = cogl_position_in;\n"
+                     "  vec4 color = cogl_color_in;\n",
+                     source,
+                     "\n"
+                     "  cogl_position_out = cogl_modelview_projection_matrix * position;\n"
+                     "  cogl_color_out = color;\n"
+                     "}\n",
+                     NULL);
+
+      priv->vertex_snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_VERTEX,
+                                               full_declarations,
+                                               full_source);
+
+      g_free (full_declarations);
+      g_free (full_source);
+    }
+
+  if (priv->buffer != NULL)
+    cogl_buffer_set_update_hint (COGL_BUFFER (priv->buffer),
+                                 priv->vertex_snippet != NULL
+                                   ? COGL_BUFFER_UPDATE_HINT_STATIC
+                                   : COGL_BUFFER_UPDATE_HINT_DYNAMIC);
+
+  /* the vertices have to be uploaded again, deformed or not, and the
+   * pipeline changed even if they were already dirty
+   */
+  priv->is_dirty = TRUE;
+  clutter_deform_effect_queue_repaint (effect);
+
+  return priv->vertex_snippet != NULL;
+}
+
+/**
+ * clutter_deform_effect_set_uniform_float:
+ * @effect: a #ClutterDeformEffect
+ * @name: the name of the uniform
+ * @n_components: the number of components of the uniform, between 1 and 4
+ * @count: the number of values, if the uniform is an array
+ * @value: (array): the @n_components times @count values of the uniform
+ *
+ * Sets the value of a uniform declared by the snippet passed to
+ * clutter_deform_effect_set_vertex_shader(), and queues a repaint
+ * of the effect.
+ *
+ * Unlike clutter_deform_effect_invalidate(), this function does not
+ * cause the vertices of the grid to be uploaded again.
+ *
+ * Since: 1.28
+ */
+void
+clutter_deform_effect_set_uniform_float (ClutterDeformEffect *effect,
+                                         const gchar         *name,
+                                         gint                 n_components,
+                                         gint                 count,
+                                         const gfloat        *value)
+{
+  ClutterDeformEffectPrivate *priv;
+  DeformUniform *uniform;
+
+  g_return_if_fail (CLUTTER_IS_DEFORM_EFFECT (effect));
+  g_return_if_fail (name != NULL);
+  g_return_if_fail (n_components >= 1 && n_components <= 4);
+  g_return_if_fail (count >= 1);
+  g_return_if_fail (value != NULL);
+
+  priv = effect->priv;
+
+  if (priv->uniforms == NULL)
+    priv->uniforms = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free,
+                                            deform_uniform_free);
+
+  uniform = g_slice_new (DeformUniform);
+  uniform->n_components = n_components;
+  uniform->count = count;
+  uniform->value = g_memdup (value, sizeof (gfloat) * n_components * count);
+
+  g_hash_table_replace (priv->uniforms, g_strdup (name), uniform);
+
+  clutter_deform_effect_queue_repaint (effect);
 }
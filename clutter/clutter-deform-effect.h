@@ -112,6 +112,17 @@ void            clutter_deform_effect_get_n_tiles       (ClutterDeformEffect *ef
 CLUTTER_AVAILABLE_IN_1_4
 void            clutter_deform_effect_invalidate        (ClutterDeformEffect *effect);
 
+CLUTTER_AVAILABLE_IN_1_28
+gboolean        clutter_deform_effect_set_vertex_shader (ClutterDeformEffect *effect,
+                                                         const gchar         *declarations,
+                                                         const gchar         *source);
+CLUTTER_AVAILABLE_IN_1_28
+void            clutter_deform_effect_set_uniform_float (ClutterDeformEffect *effect,
+                                                         const gchar         *name,
+                                                         gint                 n_components,
+                                                         gint                 count,
+                                                         const gfloat        *value);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_DEFORM_EFFECT_H__ */
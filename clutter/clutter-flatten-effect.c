@@ -32,6 +32,7 @@
 #endif
 
 #include "clutter-flatten-effect.h"
+#include "clutter-offscreen-effect-private.h"
 #include "clutter-private.h"
 #include "clutter-actor-private.h"
 
@@ -47,6 +48,7 @@ _clutter_flatten_effect_class_init (ClutterFlattenEffectClass *klass)
 static void
 _clutter_flatten_effect_init (ClutterFlattenEffect *self)
 {
+  _clutter_offscreen_effect_set_use_pool (CLUTTER_OFFSCREEN_EFFECT (self), TRUE);
 }
 
 ClutterEffect *
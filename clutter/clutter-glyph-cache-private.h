@@ -0,0 +1,52 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_GLYPH_CACHE_PRIVATE_H__
+#define __CLUTTER_GLYPH_CACHE_PRIVATE_H__
+
+#include <pango/pango.h>
+
+G_BEGIN_DECLS
+
+extern gboolean _clutter_glyph_cache_recording;
+
+/* records the glyphs used by a layout while a glyph cache file is set;
+ * free when it is not
+ */
+#define CLUTTER_GLYPH_CACHE_RECORD(layout)              G_STMT_START {  \
+  if (G_UNLIKELY (_clutter_glyph_cache_recording))                      \
+    _clutter_glyph_cache_record ((layout));                             \
+                                                        } G_STMT_END
+
+G_GNUC_INTERNAL
+void            _clutter_glyph_cache_warm       (const gchar    *font_name,
+                                                 const gchar    *characters);
+
+G_GNUC_INTERNAL
+gboolean        _clutter_glyph_cache_set_file   (const gchar    *filename,
+                                                 GError        **error);
+
+G_GNUC_INTERNAL
+void            _clutter_glyph_cache_record     (PangoLayout    *layout);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_GLYPH_CACHE_PRIVATE_H__ */
@@ -0,0 +1,512 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * The glyph cache warm-up: rasterises glyphs ahead of time.
+ *
+ * CoglPango only rasterises a glyph and uploads it to its atlas the first
+ * time a layout using it is rendered, which makes the first frame showing
+ * some new text, or a new font size, noticeably slower than the others.
+ *
+ * Applications can declare the fonts and characters they are going to
+ * use, and the glyphs are then rendered into the glyph cache of the
+ * CoglPango font map from an idle handler, a few at a time, so that they
+ * are already available by the time they are needed.
+ *
+ * The atlas textures themselves cannot be stored, but the set of glyphs
+ * used by the application can be: when a glyph cache file is set, the
+ * characters of every layout created by ClutterText are recorded for
+ * each font, and periodically written to the file; the next time the
+ * file is set, all the glyphs it lists are warmed up again.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "clutter-glyph-cache-private.h"
+
+#include "clutter-debug.h"
+#include "clutter-main.h"
+#include "clutter-private.h"
+#include "clutter-settings.h"
+
+/* the number of characters rendered by each run of the idle handler */
+#define WARM_CHUNK_SIZE         64
+
+/* the delay, in milliseconds, before writing newly recorded glyphs */
+#define SAVE_TIMEOUT            5000
+
+#define GLYPHS_GROUP            "Glyphs"
+
+typedef struct _WarmJob
+{
+  gchar *font_name;
+  GString *characters;
+} WarmJob;
+
+gboolean _clutter_glyph_cache_recording = FALSE;
+
+/* the record function is called while creating layouts, which can
+ * happen in the worker threads of ClutterText
+ */
+static GMutex glyph_cache_lock;
+
+/* font name → set of characters already warmed up or recorded */
+static GHashTable *known_glyphs = NULL;
+
+static GQueue warm_queue = G_QUEUE_INIT;
+static guint warm_id = 0;
+
+static gchar *cache_file = NULL;
+static guint save_id = 0;
+
+static void
+warm_job_free (WarmJob *job)
+{
+  g_free (job->font_name);
+  g_string_free (job->characters, TRUE);
+  g_slice_free (WarmJob, job);
+}
+
+static gchar *
+normalize_font_name (const gchar *font_name)
+{
+  PangoFontDescription *desc;
+  gchar *default_name = NULL;
+  gchar *retval;
+
+  if (font_name == NULL)
+    {
+      g_object_get (clutter_settings_get_default (),
+                    "font-name", &default_name,
+                    NULL);
+      font_name = default_name;
+    }
+
+  desc = pango_font_description_from_string (font_name);
+  retval = pango_font_description_to_string (desc);
+
+  pango_font_description_free (desc);
+  g_free (default_name);
+
+  return retval;
+}
+
+/* adds the characters of @text missing from the set of @font_name to
+ * @new_chars, if not %NULL; returns whether any was found. Must be
+ * called with the lock held
+ */
+static gboolean
+add_known_glyphs (const gchar *font_name,
+                  const gchar *text,
+                  gssize       text_len,
+                  GString     *new_chars)
+{
+  GHashTable *glyphs;
+  const gchar *p, *end;
+  gboolean retval = FALSE;
+
+  if (known_glyphs == NULL)
+    known_glyphs = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free,
+                                          (GDestroyNotify) g_hash_table_unref);
+
+  glyphs = g_hash_table_lookup (known_glyphs, font_name);
+  if (glyphs == NULL)
+    {
+      glyphs = g_hash_table_new (NULL, NULL);
+      g_hash_table_insert (known_glyphs, g_strdup (font_name), glyphs);
+    }
+
+  if (text_len < 0)
+    text_len = strlen (text);
+
+  for (p = text, end = text + text_len; p < end; p = g_utf8_next_char (p))
+    {
+      gunichar wc = g_utf8_get_char (p);
+
+      /* nothing to rasterise */
+      if (g_unichar_iscntrl (wc) || g_unichar_isspace (wc))
+        continue;
+
+      if (g_hash_table_contains (glyphs, GUINT_TO_POINTER (wc)))
+        continue;
+
+      g_hash_table_add (glyphs, GUINT_TO_POINTER (wc));
+      retval = TRUE;
+
+      if (new_chars != NULL)
+        g_string_append_unichar (new_chars, wc);
+    }
+
+  return retval;
+}
+
+static gint
+compare_glyphs (gconstpointer a,
+                gconstpointer b)
+{
+  gunichar wc_a = GPOINTER_TO_UINT (*(gpointer *) a);
+  gunichar wc_b = GPOINTER_TO_UINT (*(gpointer *) b);
+
+  return wc_a < wc_b ? -1 : wc_a > wc_b ? 1 : 0;
+}
+
+/* writes the known glyphs to the cache file; must be called with the
+ * lock held
+ */
+static void
+glyph_cache_save (void)
+{
+  GKeyFile *key_file;
+  GHashTableIter iter;
+  gpointer key, value;
+  GError *error = NULL;
+  gchar *dirname;
+  gchar *data;
+  gsize len;
+
+  if (cache_file == NULL || known_glyphs == NULL)
+    return;
+
+  key_file = g_key_file_new ();
+
+  g_hash_table_iter_init (&iter, known_glyphs);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      GString *characters;
+      gpointer *glyphs;
+      guint n_glyphs, i;
+
+      /* keep the file stable across runs */
+      glyphs = g_hash_table_get_keys_as_array (value, &n_glyphs);
+      qsort (glyphs, n_glyphs, sizeof (gpointer), compare_glyphs);
+
+      characters = g_string_new (NULL);
+      for (i = 0; i < n_glyphs; i++)
+        g_string_append_unichar (characters, GPOINTER_TO_UINT (glyphs[i]));
+
+      g_key_file_set_string (key_file, GLYPHS_GROUP, key, characters->str);
+
+      g_string_free (characters, TRUE);
+      g_free (glyphs);
+    }
+
+  data = g_key_file_to_data (key_file, &len, NULL);
+
+  dirname = g_path_get_dirname (cache_file);
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  if (!g_file_set_contents (cache_file, data, len, &error))
+    {
+      g_warning ("Unable to save the glyph cache to '%s': %s",
+                 cache_file,
+                 error->message);
+      g_error_free (error);
+    }
+  else
+    CLUTTER_NOTE (MISC, "Saved %u fonts to the glyph cache '%s'",
+                  g_hash_table_size (known_glyphs),
+                  cache_file);
+
+  g_free (data);
+  g_key_file_free (key_file);
+}
+
+static gboolean
+glyph_cache_save_timeout (gpointer data G_GNUC_UNUSED)
+{
+  g_mutex_lock (&glyph_cache_lock);
+
+  glyph_cache_save ();
+  save_id = 0;
+
+  g_mutex_unlock (&glyph_cache_lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* must be called with the lock held */
+static void
+glyph_cache_queue_save (void)
+{
+  if (cache_file == NULL || save_id != 0)
+    return;
+
+  save_id = clutter_threads_add_timeout_full (G_PRIORITY_LOW,
+                                              SAVE_TIMEOUT,
+                                              glyph_cache_save_timeout,
+                                              NULL, NULL);
+}
+
+static PangoContext *
+create_warm_context (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  PangoContext *context;
+  gdouble resolution;
+
+  /* this has to match the contexts created by ClutterActor, otherwise
+   * the fonts, and their glyphs, would not be shared
+   */
+  context = cogl_pango_font_map_create_context (COGL_PANGO_FONT_MAP (clutter_get_font_map ()));
+
+  resolution = clutter_backend_get_resolution (backend);
+  if (resolution < 0)
+    resolution = 96.0; /* fall back */
+
+  pango_cairo_context_set_font_options (context, clutter_backend_get_font_options (backend));
+  pango_cairo_context_set_resolution (context, resolution);
+  pango_context_set_language (context, pango_language_get_default ());
+
+  return context;
+}
+
+static gboolean
+glyph_cache_warm_idle (gpointer data G_GNUC_UNUSED)
+{
+  PangoFontDescription *desc;
+  PangoContext *context;
+  PangoLayout *layout;
+  WarmJob *job;
+  gchar *font_name;
+  gchar *chunk;
+  gsize n_bytes;
+
+  g_mutex_lock (&glyph_cache_lock);
+
+  job = g_queue_peek_head (&warm_queue);
+  if (job == NULL)
+    {
+      warm_id = 0;
+      g_mutex_unlock (&glyph_cache_lock);
+      return G_SOURCE_REMOVE;
+    }
+
+  n_bytes = g_utf8_offset_to_pointer (job->characters->str,
+                                      MIN (WARM_CHUNK_SIZE,
+                                           g_utf8_strlen (job->characters->str,
+                                                          job->characters->len)))
+          - job->characters->str;
+
+  chunk = g_strndup (job->characters->str, n_bytes);
+  font_name = g_strdup (job->font_name);
+
+  g_string_erase (job->characters, 0, n_bytes);
+  if (job->characters->len == 0)
+    warm_job_free (g_queue_pop_head (&warm_queue));
+
+  g_mutex_unlock (&glyph_cache_lock);
+
+  CLUTTER_NOTE (MISC, "Warming up the glyph cache for '%s' (%d characters)",
+                font_name,
+                (int) g_utf8_strlen (chunk, -1));
+
+  desc = pango_font_description_from_string (font_name);
+  context = create_warm_context ();
+
+  layout = pango_layout_new (context);
+  pango_layout_set_font_description (layout, desc);
+  pango_layout_set_text (layout, chunk, n_bytes);
+
+  cogl_pango_ensure_glyph_cache_for_layout (layout);
+
+  g_object_unref (layout);
+  g_object_unref (context);
+  pango_font_description_free (desc);
+  g_free (font_name);
+  g_free (chunk);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* must be called with the lock held */
+static void
+glyph_cache_warm_unlocked (const gchar *font_name,
+                           const gchar *characters,
+                           gssize       len)
+{
+  GString *new_chars = g_string_new (NULL);
+  gchar *name = normalize_font_name (font_name);
+  WarmJob *job = NULL;
+  GList *l;
+
+  if (!add_known_glyphs (name, characters, len, new_chars))
+    goto out;
+
+  for (l = warm_queue.head; l != NULL; l = l->next)
+    {
+      WarmJob *queued = l->data;
+
+      if (strcmp (queued->font_name, name) == 0)
+        {
+          job = queued;
+          break;
+        }
+    }
+
+  if (job == NULL)
+    {
+      job = g_slice_new (WarmJob);
+      job->font_name = name;
+      job->characters = new_chars;
+
+      g_queue_push_tail (&warm_queue, job);
+
+      name = NULL;
+      new_chars = NULL;
+    }
+  else
+    g_string_append_len (job->characters, new_chars->str, new_chars->len);
+
+  if (warm_id == 0)
+    warm_id = clutter_threads_add_idle_full (G_PRIORITY_LOW,
+                                             glyph_cache_warm_idle,
+                                             NULL, NULL);
+
+  glyph_cache_queue_save ();
+
+out:
+  if (new_chars != NULL)
+    g_string_free (new_chars, TRUE);
+
+  g_free (name);
+}
+
+void
+_clutter_glyph_cache_warm (const gchar *font_name,
+                           const gchar *characters)
+{
+  g_mutex_lock (&glyph_cache_lock);
+  glyph_cache_warm_unlocked (font_name, characters, -1);
+  g_mutex_unlock (&glyph_cache_lock);
+}
+
+gboolean
+_clutter_glyph_cache_set_file (const gchar  *filename,
+                               GError      **error)
+{
+  GKeyFile *key_file = NULL;
+  GError *internal_error = NULL;
+  gboolean retval = TRUE;
+
+  g_mutex_lock (&glyph_cache_lock);
+
+  /* flush whatever was recorded for the previous file */
+  if (save_id != 0)
+    {
+      g_source_remove (save_id);
+      save_id = 0;
+
+      glyph_cache_save ();
+    }
+
+  g_clear_pointer (&cache_file, g_free);
+  _clutter_glyph_cache_recording = FALSE;
+
+  /* the glyphs recorded for the previous file are not in the new one */
+  g_clear_pointer (&known_glyphs, g_hash_table_unref);
+
+  if (filename == NULL)
+    goto out;
+
+  key_file = g_key_file_new ();
+
+  if (!g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE,
+                                  &internal_error))
+    {
+      /* a missing file is simply an empty cache */
+      if (!g_error_matches (internal_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        {
+          g_propagate_error (error, internal_error);
+          retval = FALSE;
+          goto out;
+        }
+
+      g_error_free (internal_error);
+    }
+  else
+    {
+      gchar **fonts = g_key_file_get_keys (key_file, GLYPHS_GROUP, NULL, NULL);
+      gint i;
+
+      for (i = 0; fonts != NULL && fonts[i] != NULL; i++)
+        {
+          gchar *characters;
+
+          characters = g_key_file_get_string (key_file, GLYPHS_GROUP,
+                                              fonts[i],
+                                              NULL);
+          if (characters != NULL && g_utf8_validate (characters, -1, NULL))
+            glyph_cache_warm_unlocked (fonts[i], characters, -1);
+
+          g_free (characters);
+        }
+
+      g_strfreev (fonts);
+    }
+
+  cache_file = g_strdup (filename);
+  _clutter_glyph_cache_recording = TRUE;
+
+out:
+  g_mutex_unlock (&glyph_cache_lock);
+
+  if (key_file != NULL)
+    g_key_file_free (key_file);
+
+  return retval;
+}
+
+void
+_clutter_glyph_cache_record (PangoLayout *layout)
+{
+  const PangoFontDescription *desc;
+  const gchar *text;
+  gchar *font_name;
+
+  text = pango_layout_get_text (layout);
+  if (text == NULL || *text == '\0')
+    return;
+
+  desc = pango_layout_get_font_description (layout);
+  if (desc == NULL)
+    desc = pango_context_get_font_description (pango_layout_get_context (layout));
+
+  font_name = pango_font_description_to_string (desc);
+
+  g_mutex_lock (&glyph_cache_lock);
+
+  /* the glyphs have just been used, so there's no need to warm them up */
+  if (add_known_glyphs (font_name, text, -1, NULL))
+    glyph_cache_queue_save ();
+
+  g_mutex_unlock (&glyph_cache_lock);
+
+  g_free (font_name);
+}
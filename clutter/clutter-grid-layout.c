@@ -71,6 +71,7 @@ typedef struct _ClutterGridChild        ClutterGridChild;
 typedef struct _ClutterLayoutMetaClass  ClutterGridChildClass;
 
 typedef struct _ClutterGridAttach       ClutterGridAttach;
+typedef struct _ClutterGridCell         ClutterGridCell;
 typedef struct _ClutterGridLine         ClutterGridLine;
 typedef struct _ClutterGridLines        ClutterGridLines;
 typedef struct _ClutterGridLineData     ClutterGridLineData;
@@ -83,11 +84,24 @@ struct _ClutterGridAttach
   gint span;
 };
 
+/* A ClutterGridCell is the key of the cell index, mapping a single
+ * column/row pair to the child covering it
+ */
+struct _ClutterGridCell
+{
+  gint left;
+  gint top;
+};
+
 struct _ClutterGridChild
 {
   ClutterLayoutMeta parent_instance;
 
   ClutterGridAttach attach[2];
+
+  /* the area the child currently occupies inside the cell index */
+  ClutterGridAttach indexed[2];
+  guint is_indexed : 1;
 };
 
 #define CHILD_LEFT(child)    ((child)->attach[CLUTTER_ORIENTATION_HORIZONTAL].pos)
@@ -104,12 +118,36 @@ struct _ClutterGridLineData
   guint homogeneous : 1;
 };
 
+struct _ClutterGridLines
+{
+  ClutterGridLine *lines;
+  gint min, max;
+};
+
 struct _ClutterGridLayoutPrivate
 {
   ClutterContainer *container;
   ClutterOrientation orientation;
 
   ClutterGridLineData linedata[2];
+
+  /* cell → child index; rebuilt lazily when cells_valid is unset */
+  GHashTable *cells;
+
+  /* the lines of both orientations, shared by all the requests until
+   * the container queues a relayout
+   */
+  ClutterGridLines lines[2];
+
+  /* the result of the non-contextual request phase for each
+   * orientation, reused between width and height negotiation
+   */
+  ClutterGridLine *requests[2];
+
+  guint cells_valid : 1;
+  guint cells_overlap : 1;
+  guint lines_valid : 1;
+  guint request_valid : 2;
 };
 
 #define ROWS(priv)    (&(priv)->linedata[CLUTTER_ORIENTATION_HORIZONTAL])
@@ -130,12 +168,6 @@ struct _ClutterGridLine
   guint empty       : 1;
 };
 
-struct _ClutterGridLines
-{
-  ClutterGridLine *lines;
-  gint min, max;
-};
-
 struct _ClutterGridRequest
 {
   ClutterGridLayout *grid;
@@ -184,6 +216,199 @@ G_DEFINE_TYPE_WITH_PRIVATE (ClutterGridLayout,
    (CLUTTER_LAYOUT_MANAGER((grid)),\
     CLUTTER_GRID_LAYOUT((grid))->priv->container,(child))))
 
+static guint
+grid_cell_hash (gconstpointer v)
+{
+  const ClutterGridCell *cell = v;
+
+  return ((guint) cell->left * 31) ^ (guint) cell->top;
+}
+
+static gboolean
+grid_cell_equal (gconstpointer v1,
+                 gconstpointer v2)
+{
+  const ClutterGridCell *a = v1;
+  const ClutterGridCell *b = v2;
+
+  return a->left == b->left && a->top == b->top;
+}
+
+static void
+grid_cell_free (gpointer data)
+{
+  g_slice_free (ClutterGridCell, data);
+}
+
+/* Drops the cached lines and requests; called whenever the
+ * container queues a relayout, since any child may have changed
+ * its preferred size, visibility or expansion flags.
+ */
+static void
+grid_invalidate_request (ClutterGridLayout *self)
+{
+  ClutterGridLayoutPrivate *priv = self->priv;
+
+  priv->lines_valid = FALSE;
+  priv->request_valid = 0;
+}
+
+static void
+grid_invalidate_cells (ClutterGridLayout *self)
+{
+  ClutterGridLayoutPrivate *priv = self->priv;
+
+  priv->cells_valid = FALSE;
+
+  if (priv->cells != NULL)
+    g_hash_table_remove_all (priv->cells);
+}
+
+static void
+grid_unindex_child (ClutterGridLayout *self,
+                    ClutterActor      *actor,
+                    ClutterGridChild  *grid_child)
+{
+  ClutterGridLayoutPrivate *priv = self->priv;
+  ClutterGridAttach *h, *v;
+  ClutterGridCell cell;
+
+  if (!grid_child->is_indexed)
+    return;
+
+  grid_child->is_indexed = FALSE;
+
+  if (!priv->cells_valid)
+    return;
+
+  /* another child may be hiding below this one; we cannot tell which
+   * without walking all the children, so let the next lookup do it
+   */
+  if (priv->cells_overlap)
+    {
+      grid_invalidate_cells (self);
+      return;
+    }
+
+  h = &grid_child->indexed[CLUTTER_ORIENTATION_HORIZONTAL];
+  v = &grid_child->indexed[CLUTTER_ORIENTATION_VERTICAL];
+
+  for (cell.top = v->pos; cell.top < v->pos + v->span; cell.top++)
+    {
+      for (cell.left = h->pos; cell.left < h->pos + h->span; cell.left++)
+        {
+          if (g_hash_table_lookup (priv->cells, &cell) == actor)
+            g_hash_table_remove (priv->cells, &cell);
+        }
+    }
+}
+
+/* Adds the cells covered by @grid_child to the index. Children that
+ * have not been placed yet are skipped; if a cell is already taken
+ * the index is only consistent when built in children order, so it
+ * is marked invalid unless @in_order is set.
+ */
+static void
+grid_index_child (ClutterGridLayout *self,
+                  ClutterActor      *actor,
+                  ClutterGridChild  *grid_child,
+                  gboolean           in_order)
+{
+  ClutterGridLayoutPrivate *priv = self->priv;
+  ClutterGridAttach *h, *v;
+  ClutterGridCell cell;
+
+  grid_unindex_child (self, actor, grid_child);
+
+  if (!priv->cells_valid)
+    return;
+
+  h = &grid_child->attach[CLUTTER_ORIENTATION_HORIZONTAL];
+  v = &grid_child->attach[CLUTTER_ORIENTATION_VERTICAL];
+
+  if (h->pos == -1 || v->pos == -1)
+    return;
+
+  grid_child->indexed[CLUTTER_ORIENTATION_HORIZONTAL] = *h;
+  grid_child->indexed[CLUTTER_ORIENTATION_VERTICAL] = *v;
+  grid_child->is_indexed = TRUE;
+
+  for (cell.top = v->pos; cell.top < v->pos + v->span; cell.top++)
+    {
+      for (cell.left = h->pos; cell.left < h->pos + h->span; cell.left++)
+        {
+          ClutterGridCell *key;
+
+          if (g_hash_table_contains (priv->cells, &cell))
+            {
+              if (!in_order)
+                {
+                  grid_invalidate_cells (self);
+                  return;
+                }
+
+              priv->cells_overlap = TRUE;
+              continue;
+            }
+
+          key = g_slice_new (ClutterGridCell);
+          *key = cell;
+
+          g_hash_table_insert (priv->cells, key, actor);
+        }
+    }
+}
+
+static void
+grid_ensure_cells (ClutterGridLayout *self)
+{
+  ClutterGridLayoutPrivate *priv = self->priv;
+  ClutterActorIter iter;
+  ClutterActor *child;
+
+  if (priv->cells_valid)
+    return;
+
+  if (priv->cells == NULL)
+    priv->cells = g_hash_table_new_full (grid_cell_hash, grid_cell_equal,
+                                         grid_cell_free,
+                                         NULL);
+  else
+    g_hash_table_remove_all (priv->cells);
+
+  priv->cells_valid = TRUE;
+  priv->cells_overlap = FALSE;
+
+  if (priv->container == NULL)
+    return;
+
+  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
+  while (clutter_actor_iter_next (&iter, &child))
+    {
+      ClutterGridChild *grid_child = GET_GRID_CHILD (self, child);
+
+      grid_child->is_indexed = FALSE;
+      grid_index_child (self, child, grid_child, TRUE);
+    }
+}
+
+/* Updates the index after the attach of @grid_child changed */
+static void
+grid_child_moved (ClutterGridLayout *self,
+                  ClutterGridChild  *grid_child)
+{
+  ClutterGridLayoutPrivate *priv = self->priv;
+  ClutterActor *actor;
+
+  actor = clutter_child_meta_get_actor (CLUTTER_CHILD_META (grid_child));
+
+  if (priv->container == NULL ||
+      clutter_actor_get_parent (actor) != CLUTTER_ACTOR (priv->container))
+    return;
+
+  grid_index_child (self, actor, grid_child, FALSE);
+}
+
 static void
 grid_attach (ClutterGridLayout *self,
              ClutterActor      *actor,
@@ -200,6 +425,8 @@ grid_attach (ClutterGridLayout *self,
   CHILD_TOP (grid_child) = top;
   CHILD_WIDTH (grid_child) = width;
   CHILD_HEIGHT (grid_child) = height;
+
+  grid_child_moved (self, grid_child);
 }
 
 /* Find the position 'touching' existing
@@ -419,6 +646,13 @@ clutter_grid_request_count_lines (ClutterGridRequest *request)
       max[1] = MAX (max[1], attach[1].pos + attach[1].span);
     }
 
+  /* no children, no lines */
+  if (min[0] > max[0] || min[1] > max[1])
+    {
+      min[0] = min[1] = 0;
+      max[0] = max[1] = 0;
+    }
+
   request->lines[0].min = min[0];
   request->lines[0].max = max[0];
   request->lines[1].min = min[1];
@@ -890,6 +1124,78 @@ clutter_grid_request_run (ClutterGridRequest *request,
   clutter_grid_request_homogeneous (request, orientation);
 }
 
+/* Places the children that were added without an attach point,
+ * counts the lines and points the request at the lines arrays
+ * stored inside the layout. The attach points and the number of
+ * lines are only recomputed after the container queued a relayout.
+ */
+static void
+clutter_grid_request_prepare (ClutterGridRequest *request)
+{
+  ClutterGridLayoutPrivate *priv = request->grid->priv;
+  gint i, n_lines;
+
+  if (!priv->lines_valid)
+    {
+      clutter_grid_request_update_attach (request);
+      clutter_grid_request_count_lines (request);
+
+      for (i = 0; i < 2; i++)
+        {
+          n_lines = request->lines[i].max - request->lines[i].min;
+
+          priv->lines[i].lines = g_renew (ClutterGridLine,
+                                          priv->lines[i].lines,
+                                          n_lines);
+          priv->lines[i].min = request->lines[i].min;
+          priv->lines[i].max = request->lines[i].max;
+
+          priv->requests[i] = g_renew (ClutterGridLine,
+                                       priv->requests[i],
+                                       n_lines);
+        }
+
+      priv->request_valid = 0;
+      priv->lines_valid = TRUE;
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      request->lines[i] = priv->lines[i];
+
+      n_lines = request->lines[i].max - request->lines[i].min;
+      memset (request->lines[i].lines, 0, n_lines * sizeof (ClutterGridLine));
+    }
+}
+
+/* Like clutter_grid_request_run() without a context; the result
+ * only depends on the preferred sizes of the children, so it is
+ * kept around until the next relayout and shared between the
+ * width request, the height request and the allocation.
+ */
+static void
+clutter_grid_request_run_cached (ClutterGridRequest *request,
+                                 ClutterOrientation  orientation)
+{
+  ClutterGridLayoutPrivate *priv = request->grid->priv;
+  ClutterGridLines *lines;
+  gsize size;
+
+  lines = &request->lines[orientation];
+  size = (lines->max - lines->min) * sizeof (ClutterGridLine);
+
+  if (priv->request_valid & (1 << orientation))
+    {
+      memcpy (lines->lines, priv->requests[orientation], size);
+      return;
+    }
+
+  clutter_grid_request_run (request, orientation, FALSE);
+
+  memcpy (priv->requests[orientation], lines->lines, size);
+  priv->request_valid |= (1 << orientation);
+}
+
 typedef struct _RequestedSize
 {
   gpointer data;
@@ -1154,21 +1460,25 @@ clutter_grid_child_set_property (GObject      *gobject,
     {
     case PROP_CHILD_LEFT_ATTACH:
       CHILD_LEFT (grid_child) = g_value_get_int (value);
+      grid_child_moved (CLUTTER_GRID_LAYOUT (manager), grid_child);
       clutter_layout_manager_layout_changed (manager);
       break;
 
     case PROP_CHILD_TOP_ATTACH:
       CHILD_TOP (grid_child) = g_value_get_int (value);
+      grid_child_moved (CLUTTER_GRID_LAYOUT (manager), grid_child);
       clutter_layout_manager_layout_changed (manager);
       break;
 
     case PROP_CHILD_WIDTH:
       CHILD_WIDTH (grid_child) = g_value_get_int (value);
+      grid_child_moved (CLUTTER_GRID_LAYOUT (manager), grid_child);
       clutter_layout_manager_layout_changed (manager);
       break;
 
     case PROP_CHILD_HEIGHT:
       CHILD_HEIGHT (grid_child) = g_value_get_int (value);
+      grid_child_moved (CLUTTER_GRID_LAYOUT (manager), grid_child);
       clutter_layout_manager_layout_changed (manager);
       break;
 
@@ -1261,19 +1571,69 @@ clutter_grid_child_init (ClutterGridChild *self)
   CHILD_HEIGHT (self) = 1;
 }
 
+static void
+on_container_queue_relayout (ClutterActor      *container,
+                             ClutterGridLayout *self)
+{
+  grid_invalidate_request (self);
+}
+
+static void
+on_container_actor_added (ClutterContainer  *container,
+                          ClutterActor      *actor,
+                          ClutterGridLayout *self)
+{
+  grid_index_child (self, actor, GET_GRID_CHILD (self, actor), FALSE);
+}
+
+static void
+on_container_actor_removed (ClutterContainer  *container,
+                            ClutterActor      *actor,
+                            ClutterGridLayout *self)
+{
+  grid_unindex_child (self, actor, GET_GRID_CHILD (self, actor));
+}
+
 static void
 clutter_grid_layout_set_container (ClutterLayoutManager *self,
                                    ClutterContainer     *container)
 {
-  ClutterGridLayoutPrivate *priv = CLUTTER_GRID_LAYOUT (self)->priv;
+  ClutterGridLayout *grid = CLUTTER_GRID_LAYOUT (self);
+  ClutterGridLayoutPrivate *priv = grid->priv;
   ClutterLayoutManagerClass *parent_class;
 
+  if (priv->container != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (priv->container,
+                                            G_CALLBACK (on_container_queue_relayout),
+                                            self);
+      g_signal_handlers_disconnect_by_func (priv->container,
+                                            G_CALLBACK (on_container_actor_added),
+                                            self);
+      g_signal_handlers_disconnect_by_func (priv->container,
+                                            G_CALLBACK (on_container_actor_removed),
+                                            self);
+    }
+
   priv->container = container;
 
+  grid_invalidate_request (grid);
+  grid_invalidate_cells (grid);
+
   if (priv->container != NULL)
     {
       ClutterRequestMode request_mode;
 
+      g_signal_connect (priv->container, "queue-relayout",
+                        G_CALLBACK (on_container_queue_relayout),
+                        self);
+      g_signal_connect (priv->container, "actor-added",
+                        G_CALLBACK (on_container_actor_added),
+                        self);
+      g_signal_connect (priv->container, "actor-removed",
+                        G_CALLBACK (on_container_actor_removed),
+                        self);
+
       /* we need to change the :request-mode of the container
        * to match the orientation
        */
@@ -1296,22 +1656,15 @@ clutter_grid_layout_get_size_for_size (ClutterGridLayout  *self,
                                        float              *natural)
 {
   ClutterGridRequest request;
-  ClutterGridLines *lines;
   float min_size, nat_size;
 
-  request.grid = self;
-  clutter_grid_request_update_attach (&request);
-  clutter_grid_request_count_lines (&request);
-
-  lines = &request.lines[0];
-  lines->lines = g_newa (ClutterGridLine, lines->max - lines->min);
-  memset (lines->lines, 0, (lines->max - lines->min) * sizeof (ClutterGridLine));
+  if (self->priv->container == NULL)
+    return;
 
-  lines = &request.lines[1];
-  lines->lines = g_newa (ClutterGridLine, lines->max - lines->min);
-  memset (lines->lines, 0, (lines->max - lines->min) * sizeof (ClutterGridLine));
+  request.grid = self;
+  clutter_grid_request_prepare (&request);
 
-  clutter_grid_request_run (&request, 1 - orientation, FALSE);
+  clutter_grid_request_run_cached (&request, 1 - orientation);
   clutter_grid_request_sum (&request, 1 - orientation, &min_size, &nat_size);
   clutter_grid_request_allocate (&request, 1 - orientation, MAX (size, nat_size));
 
@@ -1399,27 +1752,18 @@ clutter_grid_layout_allocate (ClutterLayoutManager   *layout,
   ClutterGridLayout *self = CLUTTER_GRID_LAYOUT (layout);
   ClutterOrientation orientation;
   ClutterGridRequest request;
-  ClutterGridLines *lines;
   ClutterActorIter iter;
   ClutterActor *child;
 
   request.grid = self;
-
-  clutter_grid_request_update_attach (&request);
-  clutter_grid_request_count_lines (&request);
-  lines = &request.lines[0];
-  lines->lines = g_newa (ClutterGridLine, lines->max - lines->min);
-  memset (lines->lines, 0, (lines->max - lines->min) * sizeof (ClutterGridLine));
-  lines = &request.lines[1];
-  lines->lines = g_newa (ClutterGridLine, lines->max - lines->min);
-  memset (lines->lines, 0, (lines->max - lines->min) * sizeof (ClutterGridLine));
+  clutter_grid_request_prepare (&request);
 
   if (clutter_actor_get_request_mode (CLUTTER_ACTOR (container)) == CLUTTER_REQUEST_WIDTH_FOR_HEIGHT)
     orientation = CLUTTER_ORIENTATION_HORIZONTAL;
   else
     orientation = CLUTTER_ORIENTATION_VERTICAL;
 
-  clutter_grid_request_run (&request, 1 - orientation, FALSE);
+  clutter_grid_request_run_cached (&request, 1 - orientation);
   clutter_grid_request_allocate (&request, 1 - orientation, GET_SIZE (allocation, 1 - orientation));
   clutter_grid_request_run (&request, orientation, TRUE);
 
@@ -1539,6 +1883,22 @@ clutter_grid_layout_get_property (GObject    *gobject,
     }
 }
 
+static void
+clutter_grid_layout_finalize (GObject *gobject)
+{
+  ClutterGridLayoutPrivate *priv = CLUTTER_GRID_LAYOUT (gobject)->priv;
+
+  if (priv->cells != NULL)
+    g_hash_table_unref (priv->cells);
+
+  g_free (priv->lines[0].lines);
+  g_free (priv->lines[1].lines);
+  g_free (priv->requests[0]);
+  g_free (priv->requests[1]);
+
+  G_OBJECT_CLASS (clutter_grid_layout_parent_class)->finalize (gobject);
+}
+
 static void
 clutter_grid_layout_class_init (ClutterGridLayoutClass *klass)
 {
@@ -1549,6 +1909,7 @@ clutter_grid_layout_class_init (ClutterGridLayoutClass *klass)
 
   object_class->set_property = clutter_grid_layout_set_property;
   object_class->get_property = clutter_grid_layout_get_property;
+  object_class->finalize = clutter_grid_layout_finalize;
 
   layout_class->set_container = clutter_grid_layout_set_container;
   layout_class->get_preferred_width = clutter_grid_layout_get_preferred_width;
@@ -1786,6 +2147,10 @@ clutter_grid_layout_set_orientation (ClutterGridLayout *layout,
  * Gets the child of @layout whose area covers the grid
  * cell whose upper left corner is at @left, @top.
  *
+ * Children that have not been placed in the grid yet, for instance
+ * because they were added using clutter_actor_add_child() and the
+ * layout has not been allocated since, are not taken into account.
+ *
  * Returns: (transfer none): the child at the given position, or %NULL
  *
  * Since: 1.12
@@ -1796,9 +2161,7 @@ clutter_grid_layout_get_child_at (ClutterGridLayout *layout,
                                   gint               top)
 {
   ClutterGridLayoutPrivate *priv;
-  ClutterGridChild *grid_child;
-  ClutterActorIter iter;
-  ClutterActor *child;
+  ClutterGridCell cell;
 
   g_return_val_if_fail (CLUTTER_IS_GRID_LAYOUT (layout), NULL);
 
@@ -1807,19 +2170,12 @@ clutter_grid_layout_get_child_at (ClutterGridLayout *layout,
   if (!priv->container)
     return NULL;
 
-  clutter_actor_iter_init (&iter, CLUTTER_ACTOR (priv->container));
-  while (clutter_actor_iter_next (&iter, &child))
-    {
-      grid_child = GET_GRID_CHILD (layout, child);
+  grid_ensure_cells (layout);
 
-      if (CHILD_LEFT (grid_child) <= left &&
-          CHILD_LEFT (grid_child) + CHILD_WIDTH (grid_child) > left &&
-          CHILD_TOP (grid_child) <= top &&
-          CHILD_TOP (grid_child) + CHILD_HEIGHT (grid_child) > top)
-        return child;
-    }
+  cell.left = left;
+  cell.top = top;
 
-  return NULL;
+  return g_hash_table_lookup (priv->cells, &cell);
 }
 
 /**
@@ -1873,6 +2229,7 @@ clutter_grid_layout_insert_row (ClutterGridLayout *layout,
                                     child_props[PROP_CHILD_HEIGHT]);
         }
     }
+  grid_invalidate_cells (layout);
   clutter_layout_manager_layout_changed (CLUTTER_LAYOUT_MANAGER (layout));
 }
 
@@ -1927,6 +2284,7 @@ clutter_grid_layout_insert_column (ClutterGridLayout *layout,
                                     child_props[PROP_CHILD_WIDTH]);
         }
     }
+  grid_invalidate_cells (layout);
   clutter_layout_manager_layout_changed (CLUTTER_LAYOUT_MANAGER (layout));
 }
 
@@ -0,0 +1,56 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_IMAGE_ATLAS_PRIVATE_H__
+#define __CLUTTER_IMAGE_ATLAS_PRIVATE_H__
+
+#include <cairo.h>
+#include <cogl/cogl.h>
+
+G_BEGIN_DECLS
+
+/* the largest images that are stored in the atlas */
+#define CLUTTER_IMAGE_ATLAS_MAX_SIZE    128
+
+typedef struct _ClutterImageAtlasRegion ClutterImageAtlasRegion;
+
+G_GNUC_INTERNAL
+ClutterImageAtlasRegion *       _clutter_image_atlas_allocate           (int                             width,
+                                                                         int                             height);
+G_GNUC_INTERNAL
+void                            _clutter_image_atlas_free               (ClutterImageAtlasRegion        *region);
+
+G_GNUC_INTERNAL
+gboolean                        _clutter_image_atlas_set_data           (ClutterImageAtlasRegion        *region,
+                                                                         const guint8                   *data,
+                                                                         CoglPixelFormat                 pixel_format,
+                                                                         guint                           row_stride);
+G_GNUC_INTERNAL
+gboolean                        _clutter_image_atlas_set_bitmap         (ClutterImageAtlasRegion        *region,
+                                                                         CoglBitmap                     *bitmap);
+
+G_GNUC_INTERNAL
+CoglTexture *                   _clutter_image_atlas_get_texture        (ClutterImageAtlasRegion        *region,
+                                                                         cairo_rectangle_int_t          *rect);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_IMAGE_ATLAS_PRIVATE_H__ */
@@ -0,0 +1,595 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * ClutterImageAtlas: packs small images into shared textures.
+ *
+ * Images smaller than CLUTTER_IMAGE_ATLAS_MAX_SIZE in both directions
+ * are stored in pages of PAGE_SIZE by PAGE_SIZE pixels, so that actors
+ * painting them use the same texture, and their rectangles end up in
+ * the same batch of the Cogl journal.
+ *
+ * Each page is packed using a skyline: the top edge of the allocated
+ * area, as a list of horizontal segments. New images are placed on the
+ * lowest segment they fit on. Each image is surrounded by a copy of its
+ * edge pixels, so that bilinear filtering does not bleed in pixels of
+ * its neighbours.
+ *
+ * A skyline cannot reuse the space of the images that are released, so
+ * when no page has room for a new image the emptiest page is compacted:
+ * its images are packed again, tallest first, and copied to a new page
+ * texture by the GPU. Empty pages are released, except the last one.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "clutter-image-atlas-private.h"
+
+#include "clutter-backend.h"
+#include "clutter-debug.h"
+#include "clutter-private.h"
+#include "clutter-texture-budget-private.h"
+
+#define PAGE_SIZE       1024
+
+/* the copy of the edges around each image */
+#define BORDER          1
+
+typedef struct _AtlasPage       AtlasPage;
+typedef struct _Segment         Segment;
+
+struct _Segment
+{
+  int x;
+  int y;
+  int width;
+};
+
+struct _AtlasPage
+{
+  CoglTexture *texture;
+
+  /* Segment, ordered by x, covering the width of the page */
+  GArray *skyline;
+
+  /* ClutterImageAtlasRegion */
+  GList *regions;
+
+  /* the area of the regions, borders included */
+  int used_area;
+
+  /* whether compacting the page again would be pointless */
+  guint compacted : 1;
+
+  ClutterTextureBudgetEntry *budget_entry;
+};
+
+struct _ClutterImageAtlasRegion
+{
+  AtlasPage *page;
+
+  /* the area of the image, borders excluded */
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+static GList *atlas_pages = NULL;
+
+static void
+skyline_reset (GArray *skyline)
+{
+  Segment segment = { 0, 0, PAGE_SIZE };
+
+  g_array_set_size (skyline, 0);
+  g_array_append_val (skyline, segment);
+}
+
+/* returns the y coordinate of a rectangle placed at the start of the
+ * segment at @index, or -1 if it does not fit there
+ */
+static int
+skyline_fit (GArray *skyline,
+             guint   index,
+             int     width,
+             int     height)
+{
+  const Segment *segment = &g_array_index (skyline, Segment, index);
+  int remaining = width;
+  int y = 0;
+
+  if (segment->x + width > PAGE_SIZE)
+    return -1;
+
+  while (remaining > 0)
+    {
+      segment = &g_array_index (skyline, Segment, index);
+
+      y = MAX (y, segment->y);
+      if (y + height > PAGE_SIZE)
+        return -1;
+
+      remaining -= segment->width;
+      index += 1;
+    }
+
+  return y;
+}
+
+static gboolean
+skyline_allocate (GArray *skyline,
+                  int     width,
+                  int     height,
+                  int    *x_out,
+                  int    *y_out)
+{
+  int best_y = G_MAXINT, best_width = G_MAXINT;
+  int best_index = -1;
+  Segment segment;
+  guint i;
+
+  /* bottom-left placement: the lowest position, then the narrowest
+   * segment, to keep the wide ones for wide images
+   */
+  for (i = 0; i < skyline->len; i++)
+    {
+      const Segment *s = &g_array_index (skyline, Segment, i);
+      int y = skyline_fit (skyline, i, width, height);
+
+      if (y < 0)
+        continue;
+
+      if (y < best_y || (y == best_y && s->width < best_width))
+        {
+          best_y = y;
+          best_width = s->width;
+          best_index = i;
+        }
+    }
+
+  if (best_index < 0)
+    return FALSE;
+
+  segment.x = g_array_index (skyline, Segment, best_index).x;
+  segment.y = best_y + height;
+  segment.width = width;
+  g_array_insert_val (skyline, best_index, segment);
+
+  /* shrink or remove the segments now below the new one */
+  for (i = best_index + 1; i < skyline->len; )
+    {
+      Segment *prev = &g_array_index (skyline, Segment, i - 1);
+      Segment *s = &g_array_index (skyline, Segment, i);
+      int overlap = prev->x + prev->width - s->x;
+
+      if (overlap <= 0)
+        break;
+
+      s->x += overlap;
+      s->width -= overlap;
+
+      if (s->width > 0)
+        break;
+
+      g_array_remove_index (skyline, i);
+    }
+
+  /* merge the segments at the same height */
+  for (i = 0; i + 1 < skyline->len; )
+    {
+      Segment *s = &g_array_index (skyline, Segment, i);
+      Segment *next = &g_array_index (skyline, Segment, i + 1);
+
+      if (s->y == next->y)
+        {
+          s->width += next->width;
+          g_array_remove_index (skyline, i + 1);
+        }
+      else
+        i++;
+    }
+
+  *x_out = segment.x;
+  *y_out = best_y;
+
+  return TRUE;
+}
+
+static CoglTexture *
+atlas_page_create_texture (void)
+{
+  return cogl_texture_new_with_size (PAGE_SIZE, PAGE_SIZE,
+                                     COGL_TEXTURE_NO_ATLAS |
+                                     COGL_TEXTURE_NO_SLICING,
+                                     COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+}
+
+static AtlasPage *
+atlas_page_new (void)
+{
+  AtlasPage *page;
+  CoglTexture *texture;
+
+  texture = atlas_page_create_texture ();
+  if (texture == NULL)
+    return NULL;
+
+  page = g_slice_new0 (AtlasPage);
+  page->texture = texture;
+  page->skyline = g_array_new (FALSE, FALSE, sizeof (Segment));
+  skyline_reset (page->skyline);
+
+  /* the pages cannot be re-created, so they are only accounted */
+  page->budget_entry = _clutter_texture_budget_add (NULL, NULL);
+  _clutter_texture_budget_set_size (page->budget_entry,
+                                    _clutter_texture_budget_get_texture_size (texture));
+
+  CLUTTER_NOTE (MISC, "Created image atlas page %p", page);
+
+  atlas_pages = g_list_append (atlas_pages, page);
+
+  return page;
+}
+
+static void
+atlas_page_free (AtlasPage *page)
+{
+  CLUTTER_NOTE (MISC, "Releasing image atlas page %p", page);
+
+  atlas_pages = g_list_remove (atlas_pages, page);
+
+  _clutter_texture_budget_remove (page->budget_entry);
+
+  cogl_object_unref (page->texture);
+  g_array_unref (page->skyline);
+
+  g_slice_free (AtlasPage, page);
+}
+
+static gboolean
+atlas_page_allocate (AtlasPage               *page,
+                     ClutterImageAtlasRegion *region)
+{
+  int x, y;
+
+  if (!skyline_allocate (page->skyline,
+                         region->width + 2 * BORDER,
+                         region->height + 2 * BORDER,
+                         &x, &y))
+    return FALSE;
+
+  region->page = page;
+  region->x = x + BORDER;
+  region->y = y + BORDER;
+
+  page->regions = g_list_prepend (page->regions, region);
+  page->used_area += (region->width + 2 * BORDER) * (region->height + 2 * BORDER);
+
+  return TRUE;
+}
+
+static gint
+compare_region_height (gconstpointer a,
+                       gconstpointer b)
+{
+  const ClutterImageAtlasRegion *region_a = a;
+  const ClutterImageAtlasRegion *region_b = b;
+
+  return region_b->height - region_a->height;
+}
+
+/* packs the regions of @page again, and moves their contents to a new
+ * texture using the GPU
+ */
+static gboolean
+atlas_page_compact (AtlasPage *page)
+{
+  CoglContext *ctx;
+  CoglTexture *texture;
+  CoglFramebuffer *fb;
+  CoglHandle offscreen;
+  CoglPipeline *pipeline;
+  GArray *skyline;
+  GList *regions, *l;
+  int *positions;
+  int i;
+
+  page->compacted = TRUE;
+
+  regions = g_list_sort (g_list_copy (page->regions), compare_region_height);
+  positions = g_new (int, 2 * g_list_length (regions));
+
+  /* first find out whether everything fits */
+  skyline = g_array_new (FALSE, FALSE, sizeof (Segment));
+  skyline_reset (skyline);
+
+  for (l = regions, i = 0; l != NULL; l = l->next, i += 2)
+    {
+      ClutterImageAtlasRegion *region = l->data;
+
+      if (!skyline_allocate (skyline,
+                             region->width + 2 * BORDER,
+                             region->height + 2 * BORDER,
+                             &positions[i], &positions[i + 1]))
+        goto fail;
+    }
+
+  texture = atlas_page_create_texture ();
+  if (texture == NULL)
+    goto fail;
+
+  offscreen = cogl_offscreen_new_to_texture (texture);
+  if (offscreen == NULL)
+    {
+      cogl_object_unref (texture);
+      goto fail;
+    }
+
+  CLUTTER_NOTE (MISC, "Compacting image atlas page %p (%d regions)",
+                page,
+                g_list_length (regions));
+
+  fb = COGL_FRAMEBUFFER (offscreen);
+  cogl_framebuffer_orthographic (fb, 0, 0, PAGE_SIZE, PAGE_SIZE, -1.f, 1.f);
+  cogl_framebuffer_clear4f (fb, COGL_BUFFER_BIT_COLOR, 0.f, 0.f, 0.f, 0.f);
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  /* an exact copy of the texels */
+  pipeline = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_layer_texture (pipeline, 0, page->texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+  cogl_pipeline_set_blend (pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+
+  for (l = regions, i = 0; l != NULL; l = l->next, i += 2)
+    {
+      ClutterImageAtlasRegion *region = l->data;
+      float src_x = region->x - BORDER;
+      float src_y = region->y - BORDER;
+      float width = region->width + 2 * BORDER;
+      float height = region->height + 2 * BORDER;
+
+      cogl_framebuffer_draw_textured_rectangle (fb, pipeline,
+                                                positions[i],
+                                                positions[i + 1],
+                                                positions[i] + width,
+                                                positions[i + 1] + height,
+                                                src_x / PAGE_SIZE,
+                                                src_y / PAGE_SIZE,
+                                                (src_x + width) / PAGE_SIZE,
+                                                (src_y + height) / PAGE_SIZE);
+
+      region->x = positions[i] + BORDER;
+      region->y = positions[i + 1] + BORDER;
+    }
+
+  cogl_framebuffer_flush (fb);
+
+  cogl_object_unref (pipeline);
+  cogl_object_unref (offscreen);
+
+  /* the paint nodes still using the previous texture hold a reference */
+  cogl_object_unref (page->texture);
+  page->texture = texture;
+
+  g_array_unref (page->skyline);
+  page->skyline = skyline;
+
+  g_list_free (regions);
+  g_free (positions);
+
+  return TRUE;
+
+fail:
+  g_array_unref (skyline);
+  g_list_free (regions);
+  g_free (positions);
+
+  return FALSE;
+}
+
+/*< private >
+ * _clutter_image_atlas_allocate:
+ * @width: the width of the image
+ * @height: the height of the image
+ *
+ * Reserves room for an image of @width by @height pixels in the atlas.
+ *
+ * Return value: the new region, or %NULL if the image should use its
+ *   own texture
+ */
+ClutterImageAtlasRegion *
+_clutter_image_atlas_allocate (int width,
+                               int height)
+{
+  ClutterImageAtlasRegion *region;
+  AtlasPage *emptiest = NULL;
+  AtlasPage *page;
+  GList *l;
+
+  if (width <= 0 || height <= 0 ||
+      width > CLUTTER_IMAGE_ATLAS_MAX_SIZE ||
+      height > CLUTTER_IMAGE_ATLAS_MAX_SIZE)
+    return NULL;
+
+  region = g_slice_new0 (ClutterImageAtlasRegion);
+  region->width = width;
+  region->height = height;
+
+  for (l = atlas_pages; l != NULL; l = l->next)
+    {
+      page = l->data;
+
+      if (atlas_page_allocate (page, region))
+        return region;
+
+      if (!page->compacted &&
+          (emptiest == NULL || page->used_area < emptiest->used_area))
+        emptiest = page;
+    }
+
+  /* compacting is only worth it if it frees a good share of the page */
+  if (emptiest != NULL &&
+      emptiest->used_area < PAGE_SIZE * PAGE_SIZE / 2 &&
+      atlas_page_compact (emptiest) &&
+      atlas_page_allocate (emptiest, region))
+    return region;
+
+  page = atlas_page_new ();
+  if (page != NULL && atlas_page_allocate (page, region))
+    return region;
+
+  g_slice_free (ClutterImageAtlasRegion, region);
+
+  return NULL;
+}
+
+void
+_clutter_image_atlas_free (ClutterImageAtlasRegion *region)
+{
+  AtlasPage *page;
+
+  if (region == NULL)
+    return;
+
+  page = region->page;
+  page->regions = g_list_remove (page->regions, region);
+  page->used_area -= (region->width + 2 * BORDER) * (region->height + 2 * BORDER);
+  page->compacted = FALSE;
+
+  if (page->regions == NULL)
+    {
+      /* keep one page around for the next images */
+      if (atlas_pages->next != NULL)
+        atlas_page_free (page);
+      else
+        skyline_reset (page->skyline);
+    }
+
+  g_slice_free (ClutterImageAtlasRegion, region);
+}
+
+/* copies the image, then its edges around it; the source of each copy
+ * is either @data or @bitmap
+ */
+static gboolean
+atlas_region_upload (ClutterImageAtlasRegion *region,
+                     const guint8            *data,
+                     CoglPixelFormat          pixel_format,
+                     guint                    row_stride,
+                     CoglBitmap              *bitmap)
+{
+  CoglTexture *texture = region->page->texture;
+  int i;
+
+  for (i = 0; i < 9; i++)
+    {
+      /* 0 is the border before the image, 1 the image, 2 the border
+       * after it
+       */
+      int column = i % 3;
+      int row = i / 3;
+      int src_x = column == 2 ? region->width - 1 : 0;
+      int src_y = row == 2 ? region->height - 1 : 0;
+      int dst_x = region->x + (column == 0 ? -BORDER : column == 1 ? 0 : region->width);
+      int dst_y = region->y + (row == 0 ? -BORDER : row == 1 ? 0 : region->height);
+      int width = column == 1 ? region->width : BORDER;
+      int height = row == 1 ? region->height : BORDER;
+      gboolean res;
+
+      if (bitmap != NULL)
+        res = cogl_texture_set_region_from_bitmap (texture,
+                                                   src_x, src_y,
+                                                   dst_x, dst_y,
+                                                   width, height,
+                                                   bitmap);
+      else
+        res = cogl_texture_set_region (texture,
+                                       src_x, src_y,
+                                       dst_x, dst_y,
+                                       width, height,
+                                       region->width, region->height,
+                                       pixel_format,
+                                       row_stride,
+                                       data);
+
+      if (!res)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*< private >
+ * _clutter_image_atlas_set_data:
+ * @region: a region of the atlas
+ * @data: the image data, with the size of @region
+ * @pixel_format: the format of @data
+ * @row_stride: the length of a row of @data
+ *
+ * Uploads image data into @region.
+ *
+ * Return value: %TRUE if the data was uploaded
+ */
+gboolean
+_clutter_image_atlas_set_data (ClutterImageAtlasRegion *region,
+                               const guint8            *data,
+                               CoglPixelFormat          pixel_format,
+                               guint                    row_stride)
+{
+  return atlas_region_upload (region, data, pixel_format, row_stride, NULL);
+}
+
+gboolean
+_clutter_image_atlas_set_bitmap (ClutterImageAtlasRegion *region,
+                                 CoglBitmap              *bitmap)
+{
+  return atlas_region_upload (region, NULL, COGL_PIXEL_FORMAT_ANY, 0, bitmap);
+}
+
+/*< private >
+ * _clutter_image_atlas_get_texture:
+ * @region: a region of the atlas
+ * @rect: (out): return location for the area of the image inside
+ *   the texture
+ *
+ * Retrieves the texture containing @region. Both the texture and
+ * the position of the image inside it can change when the atlas is
+ * compacted, so they should not be kept across frames.
+ *
+ * Return value: (transfer none): the texture of the atlas page
+ */
+CoglTexture *
+_clutter_image_atlas_get_texture (ClutterImageAtlasRegion *region,
+                                  cairo_rectangle_int_t   *rect)
+{
+  rect->x = region->x;
+  rect->y = region->y;
+  rect->width = region->width;
+  rect->height = region->height;
+
+  return region->page->texture;
+}
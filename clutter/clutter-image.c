@@ -30,6 +30,12 @@
  * #ClutterImage is a #ClutterContent implementation that displays
  * image data inside a #ClutterActor.
  *
+ * When new image data with the same size is set, #ClutterImage updates
+ * the contents of its texture instead of allocating a new one. Content
+ * updated every frame, like video, can avoid copies by using a #CoglBitmap
+ * backed by a pixel buffer with clutter_image_set_bitmap(), or move the
+ * upload out of the caller with clutter_image_set_bytes_async().
+ *
  * See [image.c](https://git.gnome.org/browse/clutter/tree/examples/image-content.c?h=clutter-1.18)
  * for an example of how to use #ClutterImage.
  *
@@ -45,19 +51,58 @@
 #include "clutter-image.h"
 
 #include "clutter-actor-private.h"
+#include "clutter-backend.h"
 #include "clutter-color.h"
 #include "clutter-content-private.h"
 #include "clutter-debug.h"
+#include "clutter-image-atlas-private.h"
 #include "clutter-paint-node.h"
 #include "clutter-paint-nodes.h"
 #include "clutter-private.h"
+#include "clutter-texture-budget-private.h"
+
+typedef struct _PendingUpload    PendingUpload;
+
+struct _PendingUpload
+{
+  GTask *task;
+
+  GBytes *data;
+  CoglPixelFormat pixel_format;
+  guint width;
+  guint height;
+  guint row_stride;
+
+  guint repaint_id;
+  guint idle_id;
+};
 
 struct _ClutterImagePrivate
 {
   CoglTexture *texture;
+
+  /* small images are stored inside a shared texture instead */
+  ClutterImageAtlasRegion *atlas_region;
+
+  /* set once the image is painted with mipmaps, which cannot be
+   * computed for a region of the atlas
+   */
+  guint needs_mipmaps : 1;
+
+  PendingUpload *pending_upload;
+
+  ClutterTextureBudgetEntry *budget_entry;
+
+  /* a copy of the texture, after it was evicted */
+  GBytes *evicted_data;
+  CoglPixelFormat evicted_format;
+  guint evicted_width;
+  guint evicted_height;
+  guint evicted_stride;
 };
 
 static void clutter_content_iface_init (ClutterContentIface *iface);
+static void clutter_image_leave_atlas  (ClutterImage        *image);
 
 G_DEFINE_TYPE_WITH_CODE (ClutterImage, clutter_image, G_TYPE_OBJECT,
                          G_ADD_PRIVATE (ClutterImage)
@@ -75,6 +120,13 @@ clutter_image_finalize (GObject *gobject)
 {
   ClutterImagePrivate *priv = CLUTTER_IMAGE (gobject)->priv;
 
+  /* pending uploads hold a reference on the image */
+  g_assert (priv->pending_upload == NULL);
+
+  _clutter_texture_budget_remove (priv->budget_entry);
+  g_clear_pointer (&priv->evicted_data, g_bytes_unref);
+  g_clear_pointer (&priv->atlas_region, _clutter_image_atlas_free);
+
   if (priv->texture != NULL)
     {
       cogl_object_unref (priv->texture);
@@ -90,10 +142,114 @@ clutter_image_class_init (ClutterImageClass *klass)
   G_OBJECT_CLASS (klass)->finalize = clutter_image_finalize;
 }
 
+static void clutter_image_evict (gpointer data);
+
 static void
 clutter_image_init (ClutterImage *self)
 {
   self->priv = clutter_image_get_instance_private (self);
+
+  self->priv->budget_entry =
+    _clutter_texture_budget_add_for_content (CLUTTER_CONTENT (self),
+                                             clutter_image_evict);
+}
+
+static void
+clutter_image_update_budget (ClutterImage *image)
+{
+  ClutterImagePrivate *priv = image->priv;
+
+  /* the pages of the atlas are accounted on their own */
+  _clutter_texture_budget_set_size (priv->budget_entry,
+                                    _clutter_texture_budget_get_texture_size (priv->texture));
+}
+
+/* moves the texture to system memory, to be uploaded again the next
+ * time it is needed
+ */
+static void
+clutter_image_evict (gpointer data)
+{
+  ClutterImage *image = data;
+  ClutterImagePrivate *priv = image->priv;
+  CoglPixelFormat format;
+  guint width, height, stride;
+  guint8 *pixels;
+  int size;
+
+  if (priv->texture == NULL)
+    return;
+
+  width = cogl_texture_get_width (priv->texture);
+  height = cogl_texture_get_height (priv->texture);
+
+  if ((cogl_texture_get_format (priv->texture) & COGL_A_BIT) != 0)
+    {
+      format = COGL_PIXEL_FORMAT_RGBA_8888_PRE;
+      stride = width * 4;
+    }
+  else
+    {
+      format = COGL_PIXEL_FORMAT_RGB_888;
+      stride = width * 3;
+    }
+
+  pixels = g_malloc (stride * height);
+  size = cogl_texture_get_data (priv->texture, format, stride, pixels);
+  if (size == 0)
+    {
+      g_free (pixels);
+      return;
+    }
+
+  CLUTTER_NOTE (MISC, "ClutterImage: %p: evicting texture of %u x %u",
+                image,
+                width, height);
+
+  g_clear_pointer (&priv->evicted_data, g_bytes_unref);
+  priv->evicted_data = g_bytes_new_take (pixels, stride * height);
+  priv->evicted_format = format;
+  priv->evicted_width = width;
+  priv->evicted_height = height;
+  priv->evicted_stride = stride;
+
+  g_clear_pointer (&priv->texture, cogl_object_unref);
+
+  clutter_image_update_budget (image);
+}
+
+static gboolean clutter_image_upload_data (ClutterImage     *image,
+                                           const guint8     *data,
+                                           CoglPixelFormat   pixel_format,
+                                           guint             width,
+                                           guint             height,
+                                           guint             row_stride,
+                                           GError          **error);
+
+/* uploads the data of an evicted texture again */
+static void
+clutter_image_restore_texture (ClutterImage *image)
+{
+  ClutterImagePrivate *priv = image->priv;
+  GBytes *evicted_data;
+
+  if (priv->evicted_data == NULL)
+    return;
+
+  evicted_data = priv->evicted_data;
+  priv->evicted_data = NULL;
+
+  clutter_image_upload_data (image,
+                             g_bytes_get_data (evicted_data, NULL),
+                             priv->evicted_format,
+                             priv->evicted_width,
+                             priv->evicted_height,
+                             priv->evicted_stride,
+                             NULL);
+
+  g_bytes_unref (evicted_data);
+
+  clutter_image_update_budget (image);
 }
 
 static void
@@ -101,12 +257,41 @@ clutter_image_paint_content (ClutterContent   *content,
                              ClutterActor     *actor,
                              ClutterPaintNode *root)
 {
-  ClutterImagePrivate *priv = CLUTTER_IMAGE (content)->priv;
+  ClutterImage *self = CLUTTER_IMAGE (content);
+  ClutterImagePrivate *priv = self->priv;
   ClutterPaintNode *node;
+  ClutterScalingFilter min_filter, mag_filter;
+
+  clutter_image_restore_texture (self);
+
+  /* the mipmaps of the atlas would mix the image with its neighbours */
+  clutter_actor_get_content_scaling_filters (actor, &min_filter, &mag_filter);
+  if (min_filter == CLUTTER_SCALING_FILTER_TRILINEAR)
+    {
+      priv->needs_mipmaps = TRUE;
+      clutter_image_leave_atlas (self);
+    }
+
+  if (priv->atlas_region != NULL)
+    {
+      cairo_rectangle_int_t area;
+      CoglTexture *texture;
+
+      texture = _clutter_image_atlas_get_texture (priv->atlas_region, &area);
+      node = _clutter_actor_create_texture_paint_node_for_area (actor,
+                                                                texture,
+                                                                &area);
+      clutter_paint_node_set_name (node, "Image Content");
+      clutter_paint_node_add_child (root, node);
+      clutter_paint_node_unref (node);
+      return;
+    }
 
   if (priv->texture == NULL)
     return;
 
+  _clutter_texture_budget_mark_used (priv->budget_entry);
+
   node = clutter_actor_create_texture_paint_node (actor, priv->texture);
   clutter_paint_node_set_name (node, "Image Content");
   clutter_paint_node_add_child (root, node);
@@ -120,6 +305,44 @@ clutter_image_get_preferred_size (ClutterContent *content,
 {
   ClutterImagePrivate *priv = CLUTTER_IMAGE (content)->priv;
 
+  /* the size of the data that is going to be uploaded */
+  if (priv->pending_upload != NULL)
+    {
+      if (width != NULL)
+        *width = priv->pending_upload->width;
+
+      if (height != NULL)
+        *height = priv->pending_upload->height;
+
+      return TRUE;
+    }
+
+  if (priv->atlas_region != NULL)
+    {
+      cairo_rectangle_int_t area;
+
+      _clutter_image_atlas_get_texture (priv->atlas_region, &area);
+
+      if (width != NULL)
+        *width = area.width;
+
+      if (height != NULL)
+        *height = area.height;
+
+      return TRUE;
+    }
+
+  if (priv->evicted_data != NULL)
+    {
+      if (width != NULL)
+        *width = priv->evicted_width;
+
+      if (height != NULL)
+        *height = priv->evicted_height;
+
+      return TRUE;
+    }
+
   if (priv->texture == NULL)
     return FALSE;
 
@@ -132,11 +355,297 @@ clutter_image_get_preferred_size (ClutterContent *content,
   return TRUE;
 }
 
+static void
+clutter_image_invalidate (ClutterContent *content)
+{
+  /* the texture was replaced or updated */
+  clutter_image_update_budget (CLUTTER_IMAGE (content));
+}
+
 static void
 clutter_content_iface_init (ClutterContentIface *iface)
 {
   iface->get_preferred_size = clutter_image_get_preferred_size;
   iface->paint_content = clutter_image_paint_content;
+  iface->invalidate = clutter_image_invalidate;
+}
+
+static CoglTextureFlags
+clutter_image_get_texture_flags (guint width,
+                                 guint height)
+{
+  CoglTextureFlags flags = COGL_TEXTURE_NONE;
+
+  if (width >= 512 && height >= 512)
+    flags |= COGL_TEXTURE_NO_ATLAS;
+
+  return flags;
+}
+
+/* whether the storage of the current texture can be reused for
+ * image data of the given geometry
+ */
+static gboolean
+clutter_image_can_reuse_texture (ClutterImage    *image,
+                                 CoglPixelFormat  pixel_format,
+                                 guint            width,
+                                 guint            height)
+{
+  CoglTexture *texture = image->priv->texture;
+
+  if (texture == NULL)
+    return FALSE;
+
+  if (cogl_texture_get_width (texture) != width ||
+      cogl_texture_get_height (texture) != height)
+    return FALSE;
+
+  /* the internal format was chosen for the first data; we cannot
+   * add an alpha channel to it
+   */
+  if ((cogl_texture_get_format (texture) & COGL_A_BIT) !=
+      (pixel_format & COGL_A_BIT))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* stores small images inside the atlas, so that actors painting
+ * them can be drawn in the same batch; either @data or @bitmap is
+ * used as the source of the image
+ */
+static gboolean
+clutter_image_upload_to_atlas (ClutterImage    *image,
+                               const guint8    *data,
+                               CoglPixelFormat  pixel_format,
+                               guint            width,
+                               guint            height,
+                               guint            row_stride,
+                               CoglBitmap      *bitmap)
+{
+  ClutterImagePrivate *priv = image->priv;
+  gboolean res;
+
+  if (priv->needs_mipmaps ||
+      width > CLUTTER_IMAGE_ATLAS_MAX_SIZE ||
+      height > CLUTTER_IMAGE_ATLAS_MAX_SIZE)
+    return FALSE;
+
+  /* the region is reused if the size did not change */
+  if (priv->atlas_region != NULL)
+    {
+      cairo_rectangle_int_t area;
+
+      _clutter_image_atlas_get_texture (priv->atlas_region, &area);
+      if ((guint) area.width != width || (guint) area.height != height)
+        g_clear_pointer (&priv->atlas_region, _clutter_image_atlas_free);
+    }
+
+  if (priv->atlas_region == NULL)
+    priv->atlas_region = _clutter_image_atlas_allocate (width, height);
+
+  if (priv->atlas_region == NULL)
+    return FALSE;
+
+  if (bitmap != NULL)
+    res = _clutter_image_atlas_set_bitmap (priv->atlas_region, bitmap);
+  else
+    res = _clutter_image_atlas_set_data (priv->atlas_region,
+                                         data,
+                                         pixel_format,
+                                         row_stride);
+
+  if (!res)
+    {
+      g_clear_pointer (&priv->atlas_region, _clutter_image_atlas_free);
+      return FALSE;
+    }
+
+  g_clear_pointer (&priv->texture, cogl_object_unref);
+
+  return TRUE;
+}
+
+/* moves the image out of the atlas, into its own texture, so that it
+ * can be modified or handed out
+ */
+static void
+clutter_image_leave_atlas (ClutterImage *image)
+{
+  ClutterImagePrivate *priv = image->priv;
+  cairo_rectangle_int_t area;
+  CoglTexture *texture, *sub_texture;
+  CoglContext *ctx;
+  guint8 *pixels;
+  int size;
+
+  if (priv->atlas_region == NULL)
+    return;
+
+  texture = _clutter_image_atlas_get_texture (priv->atlas_region, &area);
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  sub_texture = cogl_sub_texture_new (ctx, texture,
+                                      area.x, area.y,
+                                      area.width, area.height);
+
+  pixels = g_malloc (area.width * area.height * 4);
+  size = cogl_texture_get_data (sub_texture,
+                                COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                area.width * 4,
+                                pixels);
+
+  if (size != 0)
+    priv->texture = cogl_texture_new_from_data (area.width, area.height,
+                                                COGL_TEXTURE_NONE,
+                                                COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                                COGL_PIXEL_FORMAT_ANY,
+                                                area.width * 4,
+                                                pixels);
+
+  CLUTTER_NOTE (MISC, "ClutterImage: %p: moved out of the atlas", image);
+
+  g_free (pixels);
+  cogl_object_unref (sub_texture);
+
+  g_clear_pointer (&priv->atlas_region, _clutter_image_atlas_free);
+
+  clutter_image_update_budget (image);
+}
+
+static gboolean
+clutter_image_upload_data (ClutterImage     *image,
+                           const guint8     *data,
+                           CoglPixelFormat   pixel_format,
+                           guint             width,
+                           guint             height,
+                           guint             row_stride,
+                           GError          **error)
+{
+  ClutterImagePrivate *priv = image->priv;
+
+  /* the new data replaces the evicted one */
+  g_clear_pointer (&priv->evicted_data, g_bytes_unref);
+
+  /* the texture might have been handed out by get_texture(), so we
+   * keep using it instead of moving the image back into the atlas
+   */
+  if (clutter_image_can_reuse_texture (image, pixel_format, width, height) &&
+      cogl_texture_set_region (priv->texture,
+                               0, 0,
+                               0, 0,
+                               width, height,
+                               width, height,
+                               pixel_format,
+                               row_stride,
+                               data))
+    return TRUE;
+
+  if (clutter_image_upload_to_atlas (image, data, pixel_format,
+                                     width, height,
+                                     row_stride,
+                                     NULL))
+    return TRUE;
+
+  g_clear_pointer (&priv->atlas_region, _clutter_image_atlas_free);
+  g_clear_pointer (&priv->texture, cogl_object_unref);
+
+  priv->texture = cogl_texture_new_from_data (width, height,
+                                              clutter_image_get_texture_flags (width, height),
+                                              pixel_format,
+                                              COGL_PIXEL_FORMAT_ANY,
+                                              row_stride,
+                                              data);
+  if (priv->texture == NULL)
+    {
+      g_set_error_literal (error, CLUTTER_IMAGE_ERROR,
+                           CLUTTER_IMAGE_ERROR_INVALID_DATA,
+                           _("Unable to load image data"));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+pending_upload_free (PendingUpload *pending)
+{
+  if (pending->repaint_id != 0)
+    clutter_threads_remove_repaint_func (pending->repaint_id);
+
+  if (pending->idle_id != 0)
+    g_source_remove (pending->idle_id);
+
+  g_bytes_unref (pending->data);
+  g_object_unref (pending->task);
+
+  g_slice_free (PendingUpload, pending);
+}
+
+/* drops the pending upload, if any, because newer data was set */
+static void
+clutter_image_cancel_pending_upload (ClutterImage *image)
+{
+  PendingUpload *pending = image->priv->pending_upload;
+
+  if (pending == NULL)
+    return;
+
+  image->priv->pending_upload = NULL;
+
+  g_task_return_new_error (pending->task,
+                           G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                           "The image data was replaced before being uploaded");
+
+  pending_upload_free (pending);
+}
+
+static gboolean
+clutter_image_flush_pending_upload (gpointer data)
+{
+  ClutterImage *image = data;
+  ClutterImagePrivate *priv = image->priv;
+  PendingUpload *pending = priv->pending_upload;
+  GError *error = NULL;
+
+  if (pending == NULL)
+    return G_SOURCE_REMOVE;
+
+  priv->pending_upload = NULL;
+
+  /* the source that is running is removed by returning FALSE */
+  if (pending->repaint_id != 0)
+    {
+      clutter_threads_remove_repaint_func (pending->repaint_id);
+      pending->repaint_id = 0;
+    }
+
+  if (pending->idle_id != 0)
+    {
+      g_source_remove (pending->idle_id);
+      pending->idle_id = 0;
+    }
+
+  if (g_task_return_error_if_cancelled (pending->task))
+    goto out;
+
+  if (clutter_image_upload_data (image,
+                                 g_bytes_get_data (pending->data, NULL),
+                                 pending->pixel_format,
+                                 pending->width,
+                                 pending->height,
+                                 pending->row_stride,
+                                 &error))
+    g_task_return_boolean (pending->task, TRUE);
+  else
+    g_task_return_error (pending->task, error);
+
+  clutter_content_invalidate (CLUTTER_CONTENT (image));
+
+out:
+  pending_upload_free (pending);
+
+  return G_SOURCE_REMOVE;
 }
 
 /**
@@ -172,7 +681,9 @@ clutter_image_new (void)
  * In case of error, the @error value will be set, and this function will
  * return %FALSE.
  *
- * The image data is copied in texture memory.
+ * The image data is copied in texture memory. If the @image already
+ * contains data of the same size, the existing texture is updated
+ * instead of being replaced.
  *
  * The image data is expected to be a linear array of RGBA or RGB pixel data;
  * how to retrieve that data is left to platform specific image loaders. For
@@ -210,34 +721,16 @@ clutter_image_set_data (ClutterImage     *image,
                         guint             row_stride,
                         GError          **error)
 {
-  ClutterImagePrivate *priv;
-  CoglTextureFlags flags;
-
   g_return_val_if_fail (CLUTTER_IS_IMAGE (image), FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
 
-  priv = image->priv;
-
-  if (priv->texture != NULL)
-    cogl_object_unref (priv->texture);
-
-  flags = COGL_TEXTURE_NONE;
-  if (width >= 512 && height >= 512)
-    flags |= COGL_TEXTURE_NO_ATLAS;
+  clutter_image_cancel_pending_upload (image);
 
-  priv->texture = cogl_texture_new_from_data (width, height,
-                                              flags,
-                                              pixel_format,
-                                              COGL_PIXEL_FORMAT_ANY,
-                                              row_stride,
-                                              data);
-  if (priv->texture == NULL)
-    {
-      g_set_error_literal (error, CLUTTER_IMAGE_ERROR,
-                           CLUTTER_IMAGE_ERROR_INVALID_DATA,
-                           _("Unable to load image data"));
-      return FALSE;
-    }
+  if (!clutter_image_upload_data (image, data, pixel_format,
+                                  width, height,
+                                  row_stride,
+                                  error))
+    return FALSE;
 
   clutter_content_invalidate (CLUTTER_CONTENT (image));
 
@@ -278,34 +771,18 @@ clutter_image_set_bytes (ClutterImage     *image,
                          guint             row_stride,
                          GError          **error)
 {
-  ClutterImagePrivate *priv;
-  CoglTextureFlags flags;
-
   g_return_val_if_fail (CLUTTER_IS_IMAGE (image), FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
 
-  priv = image->priv;
-
-  if (priv->texture != NULL)
-    cogl_object_unref (priv->texture);
-
-  flags = COGL_TEXTURE_NONE;
-  if (width >= 512 && height >= 512)
-    flags |= COGL_TEXTURE_NO_ATLAS;
+  clutter_image_cancel_pending_upload (image);
 
-  priv->texture = cogl_texture_new_from_data (width, height,
-                                              flags,
-                                              pixel_format,
-                                              COGL_PIXEL_FORMAT_ANY,
-                                              row_stride,
-                                              g_bytes_get_data (data, NULL));
-  if (priv->texture == NULL)
-    {
-      g_set_error_literal (error, CLUTTER_IMAGE_ERROR,
-                           CLUTTER_IMAGE_ERROR_INVALID_DATA,
-                           _("Unable to load image data"));
-      return FALSE;
-    }
+  if (!clutter_image_upload_data (image,
+                                  g_bytes_get_data (data, NULL),
+                                  pixel_format,
+                                  width, height,
+                                  row_stride,
+                                  error))
+    return FALSE;
 
   clutter_content_invalidate (CLUTTER_CONTENT (image));
 
@@ -357,6 +834,13 @@ clutter_image_set_area (ClutterImage                 *image,
 
   priv = image->priv;
 
+  /* the area is relative to the data that was set before */
+  if (priv->pending_upload != NULL)
+    clutter_image_flush_pending_upload (image);
+
+  clutter_image_restore_texture (image);
+  clutter_image_leave_atlas (image);
+
   if (priv->texture == NULL)
     {
       CoglTextureFlags flags = COGL_TEXTURE_NONE;
@@ -415,6 +899,10 @@ clutter_image_set_area (ClutterImage                 *image,
  * to manually invalidate the @image with clutter_content_invalidate()
  * in order to update the actors using @image as their content.
  *
+ * Small images are stored inside a texture shared with other images;
+ * calling this function moves the image data of @image to a texture
+ * of its own.
+ *
  * Return value: (transfer none): a pointer to the Cogl texture, or %NULL
  *
  * Since: 1.10
@@ -425,5 +913,189 @@ clutter_image_get_texture (ClutterImage *image)
 {
   g_return_val_if_fail (CLUTTER_IS_IMAGE (image), NULL);
 
+  clutter_image_restore_texture (image);
+  clutter_image_leave_atlas (image);
+
   return image->priv->texture;
 }
+
+/**
+ * clutter_image_set_bitmap:
+ * @image: a #ClutterImage
+ * @bitmap: a #CoglBitmap
+ * @error: return location for a #GError, or %NULL
+ *
+ * Sets the image data stored inside a #CoglBitmap to be displayed
+ * by @image.
+ *
+ * If @bitmap is backed by a #CoglPixelBuffer, for instance because it
+ * was created using cogl_bitmap_new_from_buffer(), the data is
+ * transferred to the texture by the GPU, without being copied by the
+ * CPU; the application can write its data directly into the mapped
+ * pixel buffer.
+ *
+ * If the image data was successfully loaded, the @image will be invalidated.
+ *
+ * In case of error, the @error value will be set, and this function will
+ * return %FALSE.
+ *
+ * Return value: %TRUE if the image data was successfully loaded,
+ *   and %FALSE otherwise.
+ *
+ * Since: 1.28
+ * Stability: unstable
+ */
+gboolean
+clutter_image_set_bitmap (ClutterImage  *image,
+                          CoglBitmap    *bitmap,
+                          GError       **error)
+{
+  ClutterImagePrivate *priv;
+  CoglPixelFormat pixel_format;
+  guint width, height;
+
+  g_return_val_if_fail (CLUTTER_IS_IMAGE (image), FALSE);
+  g_return_val_if_fail (cogl_is_bitmap (bitmap), FALSE);
+
+  priv = image->priv;
+
+  clutter_image_cancel_pending_upload (image);
+  g_clear_pointer (&priv->evicted_data, g_bytes_unref);
+
+  pixel_format = cogl_bitmap_get_format (bitmap);
+  width = cogl_bitmap_get_width (bitmap);
+  height = cogl_bitmap_get_height (bitmap);
+
+  if (clutter_image_can_reuse_texture (image, pixel_format, width, height) &&
+      cogl_texture_set_region_from_bitmap (priv->texture,
+                                           0, 0,
+                                           0, 0,
+                                           width, height,
+                                           bitmap))
+    goto out;
+
+  if (clutter_image_upload_to_atlas (image, NULL, pixel_format,
+                                     width, height,
+                                     0,
+                                     bitmap))
+    goto out;
+
+  g_clear_pointer (&priv->atlas_region, _clutter_image_atlas_free);
+  g_clear_pointer (&priv->texture, cogl_object_unref);
+
+  priv->texture =
+    cogl_texture_new_from_bitmap (bitmap,
+                                  clutter_image_get_texture_flags (width, height),
+                                  COGL_PIXEL_FORMAT_ANY);
+
+  if (priv->texture == NULL)
+    {
+      g_set_error_literal (error, CLUTTER_IMAGE_ERROR,
+                           CLUTTER_IMAGE_ERROR_INVALID_DATA,
+                           _("Unable to load image data"));
+      return FALSE;
+    }
+
+out:
+  clutter_content_invalidate (CLUTTER_CONTENT (image));
+
+  return TRUE;
+}
+
+/**
+ * clutter_image_set_bytes_async:
+ * @image: a #ClutterImage
+ * @data: the image data, as a #GBytes
+ * @pixel_format: the Cogl pixel format of the image data
+ * @width: the width of the image data
+ * @height: the height of the image data
+ * @row_stride: the length of each row inside @data
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): a callback to call when the data has
+ *   been uploaded
+ * @user_data: (closure): data to pass to @callback
+ *
+ * Asynchronously sets the image data stored inside a #GBytes to be
+ * displayed by @image.
+ *
+ * Unlike clutter_image_set_bytes(), this function does not copy
+ * @data: a reference is acquired on it until the data has been
+ * uploaded, right before the next frame is painted, and @callback
+ * is called; at that point the memory backing @data can be reused.
+ *
+ * If new image data is set on @image before the upload happens,
+ * the upload of @data is skipped, and clutter_image_set_bytes_finish()
+ * returns a %G_IO_ERROR_CANCELLED error.
+ *
+ * Since: 1.28
+ */
+void
+clutter_image_set_bytes_async (ClutterImage        *image,
+                               GBytes              *data,
+                               CoglPixelFormat      pixel_format,
+                               guint                width,
+                               guint                height,
+                               guint                row_stride,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  PendingUpload *pending;
+
+  g_return_if_fail (CLUTTER_IS_IMAGE (image));
+  g_return_if_fail (data != NULL);
+
+  clutter_image_cancel_pending_upload (image);
+
+  pending = g_slice_new0 (PendingUpload);
+  pending->task = g_task_new (image, cancellable, callback, user_data);
+  g_task_set_source_tag (pending->task, clutter_image_set_bytes_async);
+  pending->data = g_bytes_ref (data);
+  pending->pixel_format = pixel_format;
+  pending->width = width;
+  pending->height = height;
+  pending->row_stride = row_stride;
+
+  /* we upload before painting the next frame; if the image is not
+   * on a stage there is no frame, so we also upload once idle
+   */
+  pending->repaint_id =
+    clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_PRE_PAINT,
+                                           clutter_image_flush_pending_upload,
+                                           g_object_ref (image),
+                                           g_object_unref);
+  pending->idle_id =
+    clutter_threads_add_idle_full (G_PRIORITY_DEFAULT_IDLE,
+                                   clutter_image_flush_pending_upload,
+                                   g_object_ref (image),
+                                   g_object_unref);
+
+  image->priv->pending_upload = pending;
+
+  /* the preferred size might have changed */
+  clutter_content_invalidate (CLUTTER_CONTENT (image));
+}
+
+/**
+ * clutter_image_set_bytes_finish:
+ * @image: a #ClutterImage
+ * @result: the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes an operation started with clutter_image_set_bytes_async().
+ *
+ * Return value: %TRUE if the image data was successfully loaded,
+ *   and %FALSE otherwise.
+ *
+ * Since: 1.28
+ */
+gboolean
+clutter_image_set_bytes_finish (ClutterImage  *image,
+                                GAsyncResult  *result,
+                                GError       **error)
+{
+  g_return_val_if_fail (CLUTTER_IS_IMAGE (image), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, image), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
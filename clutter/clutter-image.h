@@ -29,6 +29,7 @@
 #error "Only <clutter/clutter.h> can be included directly."
 #endif
 
+#include <gio/gio.h>
 #include <cogl/cogl.h>
 #include <clutter/clutter-types.h>
 
@@ -130,10 +131,28 @@ gboolean                clutter_image_set_bytes         (ClutterImage
                                                          guint                         height,
                                                          guint                         row_stride,
                                                          GError                      **error);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_image_set_bytes_async   (ClutterImage                 *image,
+                                                         GBytes                       *data,
+                                                         CoglPixelFormat               pixel_format,
+                                                         guint                         width,
+                                                         guint                         height,
+                                                         guint                         row_stride,
+                                                         GCancellable                 *cancellable,
+                                                         GAsyncReadyCallback           callback,
+                                                         gpointer                      user_data);
+CLUTTER_AVAILABLE_IN_1_28
+gboolean                clutter_image_set_bytes_finish  (ClutterImage                 *image,
+                                                         GAsyncResult                 *result,
+                                                         GError                      **error);
 
 #if defined(COGL_ENABLE_EXPERIMENTAL_API) && defined(CLUTTER_ENABLE_EXPERIMENTAL_API)
 CLUTTER_AVAILABLE_IN_1_10
 CoglTexture *           clutter_image_get_texture       (ClutterImage                 *image);
+CLUTTER_AVAILABLE_IN_1_28
+gboolean                clutter_image_set_bitmap        (ClutterImage                 *image,
+                                                         CoglBitmap                   *bitmap,
+                                                         GError                      **error);
 #endif
 
 G_END_DECLS
@@ -145,6 +145,7 @@
 #include "clutter-layout-meta.h"
 #include "clutter-marshal.h"
 #include "clutter-private.h"
+#include "clutter-text-private.h"
 #include "clutter-timeline.h"
 
 #define LAYOUT_MANAGER_WARN_NOT_IMPLEMENTED(m,method)   G_STMT_START {  \
@@ -167,6 +168,7 @@ G_DEFINE_ABSTRACT_TYPE (ClutterLayoutManager,
 
 static GQuark quark_layout_meta  = 0;
 static GQuark quark_layout_alpha = 0;
+static GQuark quark_layout_independent = 0;
 
 static guint manager_signals[LAST_SIGNAL] = { 0, };
 
@@ -399,6 +401,9 @@ clutter_layout_manager_class_init (ClutterLayoutManagerClass *klass)
   quark_layout_alpha =
     g_quark_from_static_string ("clutter-layout-manager-alpha");
 
+  quark_layout_independent =
+    g_quark_from_static_string ("clutter-layout-manager-independent-children");
+
   klass->get_preferred_width = layout_manager_real_get_preferred_width;
   klass->get_preferred_height = layout_manager_real_get_preferred_height;
   klass->allocate = layout_manager_real_allocate;
@@ -485,6 +490,9 @@ clutter_layout_manager_get_preferred_width (ClutterLayoutManager *manager,
   g_return_if_fail (CLUTTER_IS_LAYOUT_MANAGER (manager));
   g_return_if_fail (CLUTTER_IS_CONTAINER (container));
 
+  if (g_object_get_qdata (G_OBJECT (manager), quark_layout_independent))
+    _clutter_text_measure_subtrees (CLUTTER_ACTOR (container));
+
   klass = CLUTTER_LAYOUT_MANAGER_GET_CLASS (manager);
   klass->get_preferred_width (manager, container, for_height,
                               min_width_p,
@@ -520,6 +528,9 @@ clutter_layout_manager_get_preferred_height (ClutterLayoutManager *manager,
   g_return_if_fail (CLUTTER_IS_LAYOUT_MANAGER (manager));
   g_return_if_fail (CLUTTER_IS_CONTAINER (container));
 
+  if (g_object_get_qdata (G_OBJECT (manager), quark_layout_independent))
+    _clutter_text_measure_subtrees (CLUTTER_ACTOR (container));
+
   klass = CLUTTER_LAYOUT_MANAGER_GET_CLASS (manager);
   klass->get_preferred_height (manager, container, for_width,
                                min_height_p,
@@ -556,6 +567,60 @@ clutter_layout_manager_allocate (ClutterLayoutManager   *manager,
   klass->allocate (manager, container, allocation, flags);
 }
 
+/**
+ * clutter_layout_manager_set_independent_children:
+ * @manager: a #ClutterLayoutManager
+ * @independent: whether the children of the container are independent
+ *
+ * Sets whether the size of each child of the #ClutterContainer using
+ * @manager can be measured without knowing the size of its siblings.
+ *
+ * If @independent is %TRUE, Clutter is allowed to measure the sub-trees
+ * of the children concurrently before asking @manager for the preferred
+ * size of the container; currently, this means shaping the text of the
+ * #ClutterText actors inside each sub-tree using a pool of threads.
+ *
+ * Layout managers that lay out their children in a way that does not
+ * depend on the size of their siblings, like a #ClutterFixedLayout,
+ * or that contain many labels, like a list, will benefit the most.
+ *
+ * Since: 1.28
+ */
+void
+clutter_layout_manager_set_independent_children (ClutterLayoutManager *manager,
+                                                 gboolean              independent)
+{
+  g_return_if_fail (CLUTTER_IS_LAYOUT_MANAGER (manager));
+
+  independent = !!independent;
+
+  if (clutter_layout_manager_get_independent_children (manager) == independent)
+    return;
+
+  g_object_set_qdata (G_OBJECT (manager), quark_layout_independent,
+                      GUINT_TO_POINTER (independent));
+}
+
+/**
+ * clutter_layout_manager_get_independent_children:
+ * @manager: a #ClutterLayoutManager
+ *
+ * Retrieves the value set using clutter_layout_manager_set_independent_children().
+ *
+ * Return value: %TRUE if the children of the container can be
+ *   measured independently
+ *
+ * Since: 1.28
+ */
+gboolean
+clutter_layout_manager_get_independent_children (ClutterLayoutManager *manager)
+{
+  g_return_val_if_fail (CLUTTER_IS_LAYOUT_MANAGER (manager), FALSE);
+
+  return GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (manager),
+                                               quark_layout_independent));
+}
+
 /**
  * clutter_layout_manager_layout_changed:
  * @manager: a #ClutterLayoutManager
@@ -213,6 +213,12 @@ void               clutter_layout_manager_child_get_property    (ClutterLayoutMa
                                                                  const gchar            *property_name,
                                                                  GValue                 *value);
 
+CLUTTER_AVAILABLE_IN_1_28
+void               clutter_layout_manager_set_independent_children (ClutterLayoutManager *manager,
+                                                                    gboolean              independent);
+CLUTTER_AVAILABLE_IN_1_28
+gboolean           clutter_layout_manager_get_independent_children (ClutterLayoutManager *manager);
+
 CLUTTER_DEPRECATED_IN_1_12
 ClutterAlpha *     clutter_layout_manager_begin_animation       (ClutterLayoutManager   *manager,
                                                                  guint                   duration,
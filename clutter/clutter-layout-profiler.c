@@ -0,0 +1,481 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * ClutterLayoutProfiler: records where the time of each relayout is spent.
+ *
+ * When the CLUTTER_LAYOUT_PROFILE environment variable is set to a file
+ * name, every size request and allocation that misses the caches of
+ * ClutterActor is timed, and at the end of each relayout of a stage a
+ * block of data is appended to that file. Each block contains:
+ *
+ *   - a summary of the actors that queued the relayout, with the path
+ *     from the stage to each of them and the number of requests;
+ *   - the number of calls, and the inclusive and exclusive time, in
+ *     microseconds, spent by each actor, sorted by inclusive time;
+ *   - the exclusive time of each call stack, in the "folded stacks"
+ *     format understood by flamegraph.pl and compatible tools.
+ *
+ * The summary lines start with a '#', so the whole file can be fed
+ * directly to the flame graph tools, which will ignore them.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "clutter-layout-profiler.h"
+
+#include "clutter-actor-private.h"
+#include "clutter-debug.h"
+#include "clutter-layout-manager.h"
+#include "clutter-private.h"
+
+typedef struct _ProfileFrame    ProfileFrame;
+typedef struct _ActorStats      ActorStats;
+
+struct _ProfileFrame
+{
+  ClutterActor *actor;
+  ActorStats *stats;
+
+  /* the length of the call stack path before this frame */
+  gsize path_len;
+
+  gint64 start_time;
+  gint64 children_time;
+};
+
+struct _ActorStats
+{
+  /* weak pointer; unset once the actor is finalized */
+  ClutterActor *actor;
+
+  gchar *label;
+
+  guint n_calls;
+
+  /* the number of frames of the same actor on the call stack; we
+   * only account the inclusive time of the outermost one
+   */
+  guint depth;
+
+  gint64 inclusive_time;
+  gint64 exclusive_time;
+};
+
+gboolean _clutter_layout_profiler_enabled = FALSE;
+
+static gchar *profile_filename = NULL;
+static FILE *profile_file = NULL;
+
+static GArray *frames = NULL;
+static GString *frame_path = NULL;
+
+/* call stack path → gint64 exclusive time */
+static GHashTable *samples = NULL;
+
+/* ClutterActor → ActorStats */
+static GHashTable *actor_stats = NULL;
+
+/* ActorStats of the actors finalized since the last flush; they cannot
+ * stay in actor_stats, as another actor might get the same address
+ */
+static GList *finalized_actor_stats = NULL;
+
+/* path from the stage → number of relayout requests */
+static GHashTable *origins = NULL;
+
+static guint queue_relayout_depth = 0;
+static guint n_relayouts = 0;
+static gint64 total_time = 0;
+
+static const gchar *phase_names[] = {
+  "get_preferred_width",
+  "get_preferred_height",
+  "allocate",
+};
+
+static void
+actor_stats_weak_notify (gpointer  data,
+                         GObject  *where_the_object_was)
+{
+  ActorStats *stats = data;
+
+  g_hash_table_steal (actor_stats, where_the_object_was);
+  stats->actor = NULL;
+
+  finalized_actor_stats = g_list_prepend (finalized_actor_stats, stats);
+}
+
+static void
+actor_stats_free (gpointer data)
+{
+  ActorStats *stats = data;
+
+  if (stats->actor != NULL)
+    g_object_weak_unref (G_OBJECT (stats->actor),
+                         actor_stats_weak_notify,
+                         stats);
+
+  g_free (stats->label);
+  g_slice_free (ActorStats, stats);
+}
+
+static void
+append_actor_label (GString      *buffer,
+                    ClutterActor *actor)
+{
+  ClutterLayoutManager *manager = clutter_actor_get_layout_manager (actor);
+  const gchar *name = clutter_actor_get_name (actor);
+  gsize i, start = buffer->len;
+
+  g_string_append (buffer, G_OBJECT_TYPE_NAME (actor));
+
+  if (name != NULL)
+    g_string_append_printf (buffer, " '%s'", name);
+
+  if (manager != NULL)
+    g_string_append_printf (buffer, " [%s]", G_OBJECT_TYPE_NAME (manager));
+
+  /* semicolons separate frames and newlines separate stacks in
+   * the folded format, so we cannot have them inside a label
+   */
+  for (i = start; i < buffer->len; i++)
+    {
+      if (buffer->str[i] == ';' || buffer->str[i] == '\n')
+        buffer->str[i] = ',';
+    }
+}
+
+static ActorStats *
+get_actor_stats (ClutterActor *actor)
+{
+  ActorStats *stats;
+
+  stats = g_hash_table_lookup (actor_stats, actor);
+  if (stats == NULL)
+    {
+      GString *label = g_string_new (NULL);
+
+      append_actor_label (label, actor);
+
+      stats = g_slice_new0 (ActorStats);
+      stats->actor = actor;
+      stats->label = g_string_free (label, FALSE);
+
+      g_hash_table_insert (actor_stats, actor, stats);
+      g_object_weak_ref (G_OBJECT (actor), actor_stats_weak_notify, stats);
+    }
+
+  return stats;
+}
+
+/*< private >
+ * _clutter_layout_profiler_init:
+ * @filename: the file the profile data should be appended to
+ *
+ * Enables the layout profiler.
+ */
+void
+_clutter_layout_profiler_init (const gchar *filename)
+{
+  if (_clutter_layout_profiler_enabled)
+    return;
+
+  profile_filename = g_strdup (filename);
+
+  frames = g_array_new (FALSE, FALSE, sizeof (ProfileFrame));
+  frame_path = g_string_new (NULL);
+
+  samples = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  actor_stats = g_hash_table_new_full (NULL, NULL, NULL, actor_stats_free);
+  origins = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  _clutter_layout_profiler_enabled = TRUE;
+}
+
+/*< private >
+ * _clutter_layout_profiler_push:
+ * @actor: a #ClutterActor
+ * @phase: the phase of the layout cycle
+ *
+ * Starts timing the @phase of the layout cycle of @actor. Each call
+ * must be paired with a call to _clutter_layout_profiler_pop().
+ */
+void
+_clutter_layout_profiler_push (ClutterActor       *actor,
+                               ClutterLayoutPhase  phase)
+{
+  ProfileFrame frame;
+
+  frame.actor = actor;
+  frame.stats = get_actor_stats (actor);
+  frame.path_len = frame_path->len;
+  frame.children_time = 0;
+
+  if (frame_path->len > 0)
+    g_string_append_c (frame_path, ';');
+
+  g_string_append (frame_path, frame.stats->label);
+  g_string_append_c (frame_path, ':');
+  g_string_append (frame_path, phase_names[phase]);
+
+  frame.stats->n_calls += 1;
+  frame.stats->depth += 1;
+
+  /* sample the time last, so that we do not account for our own overhead */
+  frame.start_time = g_get_monotonic_time ();
+
+  g_array_append_val (frames, frame);
+}
+
+/*< private >
+ * _clutter_layout_profiler_pop:
+ * @actor: a #ClutterActor
+ *
+ * Stops timing the layout phase of @actor started by the last
+ * call to _clutter_layout_profiler_push().
+ */
+void
+_clutter_layout_profiler_pop (ClutterActor *actor)
+{
+  gint64 elapsed, self_time, *sample;
+  ProfileFrame *frame;
+
+  elapsed = g_get_monotonic_time ();
+
+  g_assert (frames->len > 0);
+
+  frame = &g_array_index (frames, ProfileFrame, frames->len - 1);
+  g_assert (frame->actor == actor);
+
+  elapsed -= frame->start_time;
+  self_time = elapsed - frame->children_time;
+
+  sample = g_hash_table_lookup (samples, frame_path->str);
+  if (sample == NULL)
+    {
+      sample = g_new0 (gint64, 1);
+      g_hash_table_insert (samples, g_strdup (frame_path->str), sample);
+    }
+
+  *sample += self_time;
+
+  frame->stats->exclusive_time += self_time;
+  frame->stats->depth -= 1;
+  if (frame->stats->depth == 0)
+    frame->stats->inclusive_time += elapsed;
+
+  g_string_truncate (frame_path, frame->path_len);
+  g_array_set_size (frames, frames->len - 1);
+
+  if (frames->len > 0)
+    {
+      frame = &g_array_index (frames, ProfileFrame, frames->len - 1);
+      frame->children_time += elapsed;
+    }
+  else
+    total_time += elapsed;
+}
+
+/*< private >
+ * _clutter_layout_profiler_begin_queue_relayout:
+ * @actor: a #ClutterActor
+ *
+ * Records @actor as the origin of a relayout, unless the relayout
+ * request is being propagated from one of its children.
+ */
+void
+_clutter_layout_profiler_begin_queue_relayout (ClutterActor *actor)
+{
+  if (queue_relayout_depth++ == 0)
+    {
+      GString *origin = g_string_new (NULL);
+      ClutterActor *iter;
+      GSList *ancestors = NULL, *l;
+      guint count;
+
+      for (iter = actor; iter != NULL; iter = clutter_actor_get_parent (iter))
+        ancestors = g_slist_prepend (ancestors, iter);
+
+      for (l = ancestors; l != NULL; l = l->next)
+        {
+          if (origin->len > 0)
+            g_string_append_c (origin, '/');
+
+          append_actor_label (origin, l->data);
+        }
+
+      g_slist_free (ancestors);
+
+      count = GPOINTER_TO_UINT (g_hash_table_lookup (origins, origin->str));
+      g_hash_table_replace (origins,
+                            g_string_free (origin, FALSE),
+                            GUINT_TO_POINTER (count + 1));
+    }
+}
+
+/*< private >
+ * _clutter_layout_profiler_end_queue_relayout:
+ * @actor: a #ClutterActor
+ *
+ * Ends the relayout request started by
+ * _clutter_layout_profiler_begin_queue_relayout().
+ */
+void
+_clutter_layout_profiler_end_queue_relayout (ClutterActor *actor)
+{
+  g_assert (queue_relayout_depth > 0);
+
+  queue_relayout_depth -= 1;
+}
+
+static gint
+sort_origins (gconstpointer a,
+              gconstpointer b)
+{
+  guint count_a = GPOINTER_TO_UINT (g_hash_table_lookup (origins, a));
+  guint count_b = GPOINTER_TO_UINT (g_hash_table_lookup (origins, b));
+
+  if (count_a == count_b)
+    return g_strcmp0 (a, b);
+
+  return count_a > count_b ? -1 : 1;
+}
+
+static gint
+sort_actor_stats (gconstpointer a,
+                  gconstpointer b)
+{
+  const ActorStats *stats_a = a;
+  const ActorStats *stats_b = b;
+
+  if (stats_a->inclusive_time == stats_b->inclusive_time)
+    return 0;
+
+  return stats_a->inclusive_time > stats_b->inclusive_time ? -1 : 1;
+}
+
+/*< private >
+ * _clutter_layout_profiler_flush:
+ * @stage: the #ClutterStage that has just been relaid out
+ *
+ * Appends the data collected since the last flush to the profile file.
+ */
+void
+_clutter_layout_profiler_flush (ClutterActor *stage)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GList *list, *l;
+  guint n_requests;
+
+  /* we might be inside a nested relayout */
+  if (frames->len > 0)
+    return;
+
+  if (g_hash_table_size (samples) == 0 &&
+      g_hash_table_size (origins) == 0)
+    return;
+
+  if (profile_file == NULL)
+    {
+      profile_file = g_fopen (profile_filename, "a");
+      if (profile_file == NULL)
+        {
+          g_warning ("Unable to open the layout profile file '%s': %s",
+                     profile_filename,
+                     g_strerror (errno));
+
+          _clutter_layout_profiler_enabled = FALSE;
+          return;
+        }
+    }
+
+  n_relayouts += 1;
+
+  n_requests = 0;
+  g_hash_table_iter_init (&iter, origins);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    n_requests += GPOINTER_TO_UINT (value);
+
+  fprintf (profile_file,
+           "# relayout %u of %s: %u requests, %" G_GINT64_FORMAT " us\n",
+           n_relayouts,
+           _clutter_actor_get_debug_name (stage),
+           n_requests,
+           total_time);
+
+  list = g_list_sort (g_hash_table_get_keys (origins), sort_origins);
+  for (l = list; l != NULL; l = l->next)
+    {
+      fprintf (profile_file, "# origin: %s (%u)\n",
+               (const gchar *) l->data,
+               GPOINTER_TO_UINT (g_hash_table_lookup (origins, l->data)));
+    }
+  g_list_free (list);
+
+  list = g_list_concat (g_hash_table_get_values (actor_stats),
+                        g_list_copy (finalized_actor_stats));
+  list = g_list_sort (list, sort_actor_stats);
+  for (l = list; l != NULL; l = l->next)
+    {
+      const ActorStats *stats = l->data;
+
+      fprintf (profile_file,
+               "# actor: %s calls=%u inclusive=%" G_GINT64_FORMAT
+               " exclusive=%" G_GINT64_FORMAT "\n",
+               stats->label,
+               stats->n_calls,
+               stats->inclusive_time,
+               stats->exclusive_time);
+    }
+  g_list_free (list);
+
+  g_hash_table_iter_init (&iter, samples);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      fprintf (profile_file, "%s %" G_GINT64_FORMAT "\n",
+               (const gchar *) key,
+               *((gint64 *) value));
+    }
+
+  fflush (profile_file);
+
+  CLUTTER_NOTE (LAYOUT, "Relayout %u: %u requests, %" G_GINT64_FORMAT " us",
+                n_relayouts,
+                n_requests,
+                total_time);
+
+  g_hash_table_remove_all (samples);
+  g_hash_table_remove_all (actor_stats);
+  g_hash_table_remove_all (origins);
+  g_list_free_full (finalized_actor_stats, actor_stats_free);
+  finalized_actor_stats = NULL;
+  total_time = 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_LAYOUT_PROFILER_H__
+#define __CLUTTER_LAYOUT_PROFILER_H__
+
+#include <clutter/clutter-types.h>
+
+G_BEGIN_DECLS
+
+/*< private >
+ * ClutterLayoutPhase:
+ * @CLUTTER_LAYOUT_PHASE_WIDTH: a width request
+ * @CLUTTER_LAYOUT_PHASE_HEIGHT: a height request
+ * @CLUTTER_LAYOUT_PHASE_ALLOCATE: an allocation
+ *
+ * The phases of the layout cycle recorded by the layout profiler.
+ */
+typedef enum {
+  CLUTTER_LAYOUT_PHASE_WIDTH,
+  CLUTTER_LAYOUT_PHASE_HEIGHT,
+  CLUTTER_LAYOUT_PHASE_ALLOCATE
+} ClutterLayoutPhase;
+
+extern gboolean _clutter_layout_profiler_enabled;
+
+/* the profiler is enabled through the CLUTTER_LAYOUT_PROFILE environment
+ * variable; these macros make the instrumentation points free when it is
+ * not in use
+ */
+#define CLUTTER_LAYOUT_PROFILER_PUSH(actor,phase)       G_STMT_START {  \
+  if (G_UNLIKELY (_clutter_layout_profiler_enabled))                    \
+    _clutter_layout_profiler_push ((actor), (phase));                   \
+                                                        } G_STMT_END
+
+#define CLUTTER_LAYOUT_PROFILER_POP(actor)              G_STMT_START {  \
+  if (G_UNLIKELY (_clutter_layout_profiler_enabled))                    \
+    _clutter_layout_profiler_pop ((actor));                             \
+                                                        } G_STMT_END
+
+G_GNUC_INTERNAL
+void    _clutter_layout_profiler_init                   (const gchar        *filename);
+
+G_GNUC_INTERNAL
+void    _clutter_layout_profiler_push                   (ClutterActor       *actor,
+                                                         ClutterLayoutPhase  phase);
+G_GNUC_INTERNAL
+void    _clutter_layout_profiler_pop                    (ClutterActor       *actor);
+
+G_GNUC_INTERNAL
+void    _clutter_layout_profiler_begin_queue_relayout   (ClutterActor       *actor);
+G_GNUC_INTERNAL
+void    _clutter_layout_profiler_end_queue_relayout     (ClutterActor       *actor);
+
+G_GNUC_INTERNAL
+void    _clutter_layout_profiler_flush                  (ClutterActor       *stage);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_LAYOUT_PROFILER_H__ */
@@ -62,6 +62,7 @@
 #include "clutter-device-manager-private.h"
 #include "clutter-event-private.h"
 #include "clutter-feature.h"
+#include "clutter-layout-profiler.h"
 #include "clutter-main.h"
 #include "clutter-master-clock.h"
 #include "clutter-private.h"
@@ -1542,6 +1543,10 @@ pre_parse_hook (GOptionContext  *context,
   if (g_strcmp0 (env_string, "none") == 0)
     clutter_sync_to_vblank = FALSE;
 
+  env_string = g_getenv ("CLUTTER_LAYOUT_PROFILE");
+  if (env_string != NULL && *env_string != '\0')
+    _clutter_layout_profiler_init (env_string);
+
   return _clutter_backend_pre_parse (backend, error);
 }
 
@@ -5,6 +5,14 @@
 
 G_BEGIN_DECLS
 
+void     _clutter_offscreen_effect_set_use_pool         (ClutterOffscreenEffect *effect,
+                                                         gboolean                use_pool);
+gboolean _clutter_offscreen_effect_reclaim_target       (ClutterOffscreenEffect *effect);
+void     _clutter_offscreen_effect_release_target       (ClutterOffscreenEffect *effect);
+void     _clutter_offscreen_effect_get_texel_size       (ClutterOffscreenEffect *effect,
+                                                         gfloat                 *width,
+                                                         gfloat                 *height);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_OFFSCREEN_EFFECT_PRIVATE_H__ */
@@ -40,6 +40,12 @@
  * offscreen framebuffer, the redirection and the final paint of the texture on
  * the desired stage.
  *
+ * The contents of the offscreen framebuffer are kept between frames, and
+ * painted again without redrawing the actor as long as it did not change.
+ * This includes the case of an actor only moved in the plane of the
+ * screen, unless one of its children has a depth or is rotated around
+ * the x or y axes, as those parts would move by different amounts.
+ *
  * #ClutterOffscreenEffect is available since Clutter 1.4
  *
  * ## Implementing a ClutterOffscreenEffect
@@ -74,6 +80,7 @@
 
 #include "clutter-actor-private.h"
 #include "clutter-debug.h"
+#include "clutter-offscreen-effect-private.h"
 #include "clutter-private.h"
 #include "clutter-stage-private.h"
 
@@ -107,12 +114,76 @@ struct _ClutterOffscreenEffectPrivate
      and it won't cause a redraw to be queued on the parent's
      children. */
   CoglMatrix last_matrix_drawn;
+
+  /* The render target borrowed from the offscreen pool of the stage,
+     and its serial at the time; the target is given back after each
+     paint, and its contents are still ours as long as the serial
+     did not change. The pool tells us when it lends the target to
+     another effect. This is NULL if a sub-class creates its own
+     texture */
+  ClutterOffscreenPool *pool;
+  ClutterOffscreenTarget *pool_target;
+  guint64 pool_serial;
+
+  /* Whether the render target can be borrowed from the offscreen
+     pool; only the effects implemented by Clutter opt in, as the
+     pooled texture is a region of a bigger texture, and its contents
+     can be overwritten by other effects after each paint */
+  guint use_pool : 1;
+
+  /* Whether the pool target was borrowed again, outside of a paint,
+     by _clutter_offscreen_effect_reclaim_target() */
+  guint target_reclaimed : 1;
 };
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (ClutterOffscreenEffect,
                                      clutter_offscreen_effect,
                                      CLUTTER_TYPE_EFFECT)
 
+/* called by the pool when our target is lent to another effect, or
+ * freed; the texture and the framebuffer of the target are only freed
+ * once we drop our references on them
+ */
+static void
+clutter_offscreen_effect_target_lost (gpointer data)
+{
+  ClutterOffscreenEffectPrivate *priv =
+    CLUTTER_OFFSCREEN_EFFECT (data)->priv;
+
+  priv->pool = NULL;
+  priv->pool_target = NULL;
+
+  if (priv->offscreen != NULL)
+    {
+      cogl_handle_unref (priv->offscreen);
+      priv->offscreen = NULL;
+    }
+
+  if (priv->texture != NULL)
+    {
+      cogl_handle_unref (priv->texture);
+      priv->texture = NULL;
+    }
+
+  if (priv->target != NULL)
+    cogl_pipeline_set_layer_texture (priv->target, 0, NULL);
+
+  priv->fbo_width = 0;
+  priv->fbo_height = 0;
+}
+
+static void
+clutter_offscreen_effect_disown_target (ClutterOffscreenEffect *self)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+
+  if (priv->pool != NULL)
+    _clutter_offscreen_pool_disown (priv->pool, self);
+
+  priv->pool = NULL;
+  priv->pool_target = NULL;
+}
+
 static void
 clutter_offscreen_effect_set_actor (ClutterActorMeta *meta,
                                     ClutterActor     *actor)
@@ -131,6 +202,8 @@ clutter_offscreen_effect_set_actor (ClutterActorMeta *meta,
       priv->offscreen = NULL;
     }
 
+  clutter_offscreen_effect_disown_target (self);
+
   /* we keep a back pointer here, to avoid going through the ActorMeta */
   priv->actor = clutter_actor_meta_get_actor (meta);
 }
@@ -145,6 +218,102 @@ clutter_offscreen_effect_real_create_texture (ClutterOffscreenEffect *effect,
                                      COGL_PIXEL_FORMAT_RGBA_8888_PRE);
 }
 
+static void
+ensure_target (ClutterOffscreenEffect *self)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  CoglContext *ctx;
+
+  if (priv->target != NULL)
+    return;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  priv->target = cogl_pipeline_new (ctx);
+
+  /* We're always going to render the texture at a 1:1 texel:pixel
+     ratio so we can use 'nearest' filtering to decrease the
+     effects of rounding errors in the geometry calculation */
+  cogl_pipeline_set_layer_filters (priv->target,
+                                   0, /* layer_index */
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+}
+
+static gboolean
+clutter_offscreen_effect_uses_pool (ClutterOffscreenEffect *self)
+{
+  if (!self->priv->use_pool)
+    return FALSE;
+
+  /* sub-classes creating their own textures get their own framebuffer */
+  return CLUTTER_OFFSCREEN_EFFECT_GET_CLASS (self)->create_texture ==
+         clutter_offscreen_effect_real_create_texture;
+}
+
+static gboolean
+update_pooled_fbo (ClutterOffscreenEffect *self,
+                   int                     fbo_width,
+                   int                     fbo_height)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  ClutterOffscreenPool *pool;
+  ClutterOffscreenTarget *target;
+
+  fbo_width = MAX (fbo_width, 1);
+  fbo_height = MAX (fbo_height, 1);
+
+  /* the actor might have moved to another stage */
+  pool = _clutter_stage_get_offscreen_pool (CLUTTER_STAGE (priv->stage));
+  if (priv->pool != pool)
+    clutter_offscreen_effect_disown_target (self);
+
+  target = _clutter_offscreen_pool_acquire (pool, fbo_width, fbo_height,
+                                            self,
+                                            clutter_offscreen_effect_target_lost);
+  if (target == NULL)
+    return FALSE;
+
+  priv->pool = pool;
+  priv->pool_target = target;
+  priv->pool_serial = target->serial;
+
+  /* we paint the top-left corner of the pooled texture, so we only
+   * need a new sub-texture if the size or the pooled texture changed
+   */
+  if (priv->texture == NULL ||
+      priv->fbo_width != fbo_width ||
+      priv->fbo_height != fbo_height ||
+      cogl_sub_texture_get_parent (priv->texture) != target->texture)
+    {
+      CoglContext *ctx =
+        clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+      if (priv->texture != NULL)
+        cogl_handle_unref (priv->texture);
+
+      priv->texture = cogl_sub_texture_new (ctx, target->texture,
+                                            0, 0,
+                                            fbo_width,
+                                            fbo_height);
+
+      cogl_pipeline_set_layer_texture (priv->target, 0, priv->texture);
+
+      priv->fbo_width = fbo_width;
+      priv->fbo_height = fbo_height;
+    }
+
+  if (priv->offscreen != target->offscreen)
+    {
+      if (priv->offscreen != NULL)
+        cogl_handle_unref (priv->offscreen);
+
+      priv->offscreen = cogl_handle_ref (target->offscreen);
+    }
+
+  return TRUE;
+}
+
 static gboolean
 update_fbo (ClutterEffect *effect, int fbo_width, int fbo_height)
 {
@@ -161,27 +330,16 @@ update_fbo (ClutterEffect *effect, int fbo_width, int fbo_height)
       return FALSE;
     }
 
+  ensure_target (self);
+
+  if (clutter_offscreen_effect_uses_pool (self))
+    return update_pooled_fbo (self, fbo_width, fbo_height);
+
   if (priv->fbo_width == fbo_width &&
       priv->fbo_height == fbo_height &&
       priv->offscreen != NULL)
     return TRUE;
 
-  if (priv->target == NULL)
-    {
-      CoglContext *ctx =
-        clutter_backend_get_cogl_context (clutter_get_default_backend ());
-
-      priv->target = cogl_pipeline_new (ctx);
-
-      /* We're always going to render the texture at a 1:1 texel:pixel
-         ratio so we can use 'nearest' filtering to decrease the
-         effects of rounding errors in the geometry calculation */
-      cogl_pipeline_set_layer_filters (priv->target,
-                                       0, /* layer_index */
-                                       COGL_PIPELINE_FILTER_NEAREST,
-                                       COGL_PIPELINE_FILTER_NEAREST);
-    }
-
   if (priv->texture != NULL)
     {
       cogl_handle_unref (priv->texture);
@@ -419,6 +577,133 @@ clutter_offscreen_effect_post_paint (ClutterEffect *effect)
   cogl_pop_framebuffer ();
 
   clutter_offscreen_effect_paint_texture (self);
+
+  /* the target can be lent to other effects until we paint again;
+   * clutter_offscreen_effect_has_cached_image() will tell if we can
+   * still use its contents
+   */
+  if (priv->pool_target != NULL)
+    _clutter_offscreen_pool_release (priv->pool, priv->pool_target);
+}
+
+static gboolean
+clutter_offscreen_effect_has_cached_image (ClutterOffscreenEffect *self)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  ClutterActor *stage;
+
+  if (priv->offscreen == NULL)
+    return FALSE;
+
+  if (priv->pool_target == NULL)
+    return TRUE;
+
+  stage = _clutter_actor_get_stage_internal (priv->actor);
+  if (stage == NULL || stage != priv->stage)
+    return FALSE;
+
+  return _clutter_offscreen_pool_is_current (priv->pool,
+                                             priv->pool_target,
+                                             priv->pool_serial);
+}
+
+/* whether the descendants of @actor all lie in its plane; under a
+ * perspective projection, the parts of a subtree at another depth move
+ * by a different amount when the subtree is translated
+ */
+static gboolean
+clutter_offscreen_effect_is_flat (ClutterActor *actor)
+{
+  ClutterActor *child;
+  CoglMatrix transform;
+
+  for (child = clutter_actor_get_first_child (actor);
+       child != NULL;
+       child = clutter_actor_get_next_sibling (child))
+    {
+      clutter_actor_get_transform (child, &transform);
+
+      if (transform.zx != 0.f || transform.zy != 0.f ||
+          transform.zw != 0.f ||
+          transform.wx != 0.f || transform.wy != 0.f ||
+          transform.wz != 0.f || transform.ww != 1.f)
+        return FALSE;
+
+      if (!clutter_offscreen_effect_is_flat (child))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Checks whether the actor would be painted like the last time it
+ * was redirected, only moved in the plane of the screen, as happens
+ * when a parent is translated; if so, the offset of the cached image
+ * is updated so that it can be painted at the new position.
+ *
+ * The whole actor, children included, has to be parallel to the
+ * screen for all of it to move by the same amount in stage
+ * coordinates, so any change other than a translation along the x
+ * and y axes of the eye coordinates will cause a redraw, and so will
+ * a child with a depth or a rotation around the x or y axes.
+ */
+static gboolean
+clutter_offscreen_effect_update_offset (ClutterOffscreenEffect *self,
+                                        const CoglMatrix       *matrix)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  const CoglMatrix *old = &priv->last_matrix_drawn;
+  ClutterVertex origin = { 0.f, 0.f, 0.f };
+  ClutterVertex old_origin, new_origin;
+  CoglMatrix projection;
+  ClutterActorBox box;
+  gfloat viewport[4];
+  gfloat width, height;
+
+  if (matrix->xx != old->xx || matrix->yx != old->yx ||
+      matrix->zx != old->zx || matrix->wx != old->wx ||
+      matrix->xy != old->xy || matrix->yy != old->yy ||
+      matrix->zy != old->zy || matrix->wy != old->wy ||
+      matrix->xz != old->xz || matrix->yz != old->yz ||
+      matrix->zz != old->zz || matrix->wz != old->wz ||
+      matrix->zw != old->zw || matrix->ww != old->ww)
+    return FALSE;
+
+  if (matrix->zx != 0.f || matrix->zy != 0.f)
+    return FALSE;
+
+  if (!clutter_offscreen_effect_is_flat (priv->actor))
+    return FALSE;
+
+  /* the cached image must still hold the whole actor */
+  if (!clutter_actor_get_paint_box (priv->actor, &box))
+    return FALSE;
+
+  clutter_actor_box_get_size (&box, &width, &height);
+  if ((int) width != priv->fbo_width || (int) height != priv->fbo_height)
+    return FALSE;
+
+  _clutter_stage_get_projection_matrix (CLUTTER_STAGE (priv->stage),
+                                        &projection);
+  _clutter_stage_get_viewport (CLUTTER_STAGE (priv->stage),
+                               &viewport[0],
+                               &viewport[1],
+                               &viewport[2],
+                               &viewport[3]);
+
+  _clutter_util_fully_transform_vertices (old, &projection, viewport,
+                                          &origin, &old_origin,
+                                          1);
+  _clutter_util_fully_transform_vertices (matrix, &projection, viewport,
+                                          &origin, &new_origin,
+                                          1);
+
+  priv->x_offset += new_origin.x - old_origin.x;
+  priv->y_offset += new_origin.y - old_origin.y;
+
+  priv->last_matrix_drawn = *matrix;
+
+  return TRUE;
 }
 
 static void
@@ -431,12 +716,14 @@ clutter_offscreen_effect_paint (ClutterEffect           *effect,
 
   cogl_get_modelview_matrix (&matrix);
 
-  /* If we've already got a cached image for the same matrix and the
+  /* If we've already got a cached image for the same matrix, or for
+     a matrix that only translates the actor on the screen, and the
      actor hasn't been redrawn then we can just use the cached image
      in the fbo */
-  if (priv->offscreen == NULL ||
+  if (!clutter_offscreen_effect_has_cached_image (self) ||
       (flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY) ||
-      !cogl_matrix_equal (&matrix, &priv->last_matrix_drawn))
+      (!cogl_matrix_equal (&matrix, &priv->last_matrix_drawn) &&
+       !clutter_offscreen_effect_update_offset (self, &matrix)))
     {
       /* Chain up to the parent paint method which will call the pre and
          post paint functions to update the image */
@@ -444,7 +731,13 @@ clutter_offscreen_effect_paint (ClutterEffect           *effect,
         paint (effect, flags);
     }
   else
-    clutter_offscreen_effect_paint_texture (self);
+    {
+      /* keep the pool from trimming the target while it is on screen */
+      if (priv->pool_target != NULL)
+        _clutter_offscreen_pool_touch (priv->pool, priv->pool_target);
+
+      clutter_offscreen_effect_paint_texture (self);
+    }
 }
 
 static void
@@ -453,6 +746,8 @@ clutter_offscreen_effect_finalize (GObject *gobject)
   ClutterOffscreenEffect *self = CLUTTER_OFFSCREEN_EFFECT (gobject);
   ClutterOffscreenEffectPrivate *priv = self->priv;
 
+  clutter_offscreen_effect_disown_target (self);
+
   if (priv->offscreen)
     cogl_handle_unref (priv->offscreen);
 
@@ -669,3 +964,121 @@ clutter_offscreen_effect_get_target_rect (ClutterOffscreenEffect *effect,
 
   return TRUE;
 }
+
+/*< private >
+ * _clutter_offscreen_effect_set_use_pool:
+ * @effect: a #ClutterOffscreenEffect
+ * @use_pool: whether @effect can borrow its render target
+ *
+ * Sets whether @effect borrows its render target from the offscreen
+ * pool of the stage, unless its class overrides the
+ * #ClutterOffscreenEffectClass.create_texture() virtual function.
+ *
+ * A pooled texture is a region of a bigger texture, so shaders have to
+ * use _clutter_offscreen_effect_get_texel_size(); and since the target
+ * is lent to other effects after each paint, the texture returned by
+ * clutter_offscreen_effect_get_texture() is only valid until the end
+ * of the paint. This must be called before the effect is painted.
+ */
+void
+_clutter_offscreen_effect_set_use_pool (ClutterOffscreenEffect *effect,
+                                        gboolean                use_pool)
+{
+  effect->priv->use_pool = !!use_pool;
+}
+
+/*< private >
+ * _clutter_offscreen_effect_reclaim_target:
+ * @effect: a #ClutterOffscreenEffect
+ *
+ * Makes sure that the texture returned by
+ * clutter_offscreen_effect_get_texture() is not lent to another effect
+ * until _clutter_offscreen_effect_release_target() is called.
+ *
+ * Sub-classes using the pool have to call this before reading the
+ * texture when they are painted from the cached image, since the
+ * render target was given back to the pool at the end of the paint
+ * that filled it.
+ *
+ * Return value: %TRUE if the texture still contains the image of the
+ *   actor
+ */
+gboolean
+_clutter_offscreen_effect_reclaim_target (ClutterOffscreenEffect *effect)
+{
+  ClutterOffscreenEffectPrivate *priv = effect->priv;
+
+  if (priv->pool_target == NULL)
+    return priv->texture != NULL;
+
+  if (!_clutter_offscreen_pool_is_current (priv->pool,
+                                           priv->pool_target,
+                                           priv->pool_serial))
+    return FALSE;
+
+  /* between pre_paint() and post_paint() the target is ours already */
+  if (priv->pool_target->in_use)
+    return TRUE;
+
+  if (!_clutter_offscreen_pool_reclaim (priv->pool,
+                                        priv->pool_target,
+                                        priv->pool_serial))
+    return FALSE;
+
+  priv->target_reclaimed = TRUE;
+
+  return TRUE;
+}
+
+/*< private >
+ * _clutter_offscreen_effect_release_target:
+ * @effect: a #ClutterOffscreenEffect
+ *
+ * Gives back the render target borrowed again by
+ * _clutter_offscreen_effect_reclaim_target(), if any.
+ */
+void
+_clutter_offscreen_effect_release_target (ClutterOffscreenEffect *effect)
+{
+  ClutterOffscreenEffectPrivate *priv = effect->priv;
+
+  if (!priv->target_reclaimed)
+    return;
+
+  priv->target_reclaimed = FALSE;
+
+  _clutter_offscreen_pool_release (priv->pool, priv->pool_target);
+}
+
+/*< private >
+ * _clutter_offscreen_effect_get_texel_size:
+ * @effect: a #ClutterOffscreenEffect
+ * @width: (out): return location for the width of a texel
+ * @height: (out): return location for the height of a texel
+ *
+ * Retrieves the size of a texel of the texture returned by
+ * clutter_offscreen_effect_get_texture(), in normalized texture
+ * coordinates as seen by a shader.
+ *
+ * The texture can be a region of a bigger, pooled texture, so this
+ * is not necessarily the inverse of the size of the texture.
+ */
+void
+_clutter_offscreen_effect_get_texel_size (ClutterOffscreenEffect *effect,
+                                          gfloat                 *width,
+                                          gfloat                 *height)
+{
+  CoglHandle texture = effect->priv->texture;
+
+  if (texture == NULL)
+    {
+      *width = *height = 0.f;
+      return;
+    }
+
+  if (cogl_is_sub_texture (texture))
+    texture = cogl_sub_texture_get_parent (texture);
+
+  *width = 1.0f / cogl_texture_get_width (texture);
+  *height = 1.0f / cogl_texture_get_height (texture);
+}
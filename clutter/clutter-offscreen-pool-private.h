@@ -0,0 +1,102 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_OFFSCREEN_POOL_PRIVATE_H__
+#define __CLUTTER_OFFSCREEN_POOL_PRIVATE_H__
+
+#include <cogl/cogl.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ClutterOffscreenPool    ClutterOffscreenPool;
+typedef struct _ClutterOffscreenTarget  ClutterOffscreenTarget;
+
+/*
+ * ClutterOffscreenTargetNotify:
+ * @owner: the owner passed to _clutter_offscreen_pool_acquire()
+ *
+ * Tells the owner of the contents of a target that the target was lent
+ * to somebody else, or freed; the owner must drop its references on the
+ * texture and the framebuffer of the target, and forget about it.
+ */
+typedef void (* ClutterOffscreenTargetNotify) (gpointer owner);
+
+/*
+ * ClutterOffscreenTarget:
+ * @texture: the render target texture; its size is rounded up to the
+ *   next power of two of the requested size
+ * @offscreen: the framebuffer rendering to @texture
+ * @serial: changes every time the target is lent out, so that a
+ *   borrower can tell whether somebody else rendered into it since
+ * @owner: the borrower caching the contents of the target, if any
+ * @notify: called when @owner loses the target
+ *
+ * A render target owned by a #ClutterOffscreenPool.
+ */
+struct _ClutterOffscreenTarget
+{
+  CoglHandle texture;
+  CoglHandle offscreen;
+
+  int width;
+  int height;
+
+  guint64 serial;
+  gint64 last_used;
+
+  gpointer owner;
+  ClutterOffscreenTargetNotify notify;
+
+  guint in_use : 1;
+};
+
+G_GNUC_INTERNAL
+ClutterOffscreenPool *  _clutter_offscreen_pool_new             (void);
+G_GNUC_INTERNAL
+void                    _clutter_offscreen_pool_free            (ClutterOffscreenPool   *pool);
+
+G_GNUC_INTERNAL
+ClutterOffscreenTarget *_clutter_offscreen_pool_acquire         (ClutterOffscreenPool         *pool,
+                                                                 int                           width,
+                                                                 int                           height,
+                                                                 gpointer                      owner,
+                                                                 ClutterOffscreenTargetNotify  notify);
+G_GNUC_INTERNAL
+void                    _clutter_offscreen_pool_release         (ClutterOffscreenPool   *pool,
+                                                                 ClutterOffscreenTarget *target);
+G_GNUC_INTERNAL
+gboolean                _clutter_offscreen_pool_reclaim         (ClutterOffscreenPool   *pool,
+                                                                 ClutterOffscreenTarget *target,
+                                                                 guint64                 serial);
+G_GNUC_INTERNAL
+gboolean                _clutter_offscreen_pool_is_current      (ClutterOffscreenPool   *pool,
+                                                                 ClutterOffscreenTarget *target,
+                                                                 guint64                 serial);
+G_GNUC_INTERNAL
+void                    _clutter_offscreen_pool_touch           (ClutterOffscreenPool   *pool,
+                                                                 ClutterOffscreenTarget *target);
+G_GNUC_INTERNAL
+void                    _clutter_offscreen_pool_disown          (ClutterOffscreenPool   *pool,
+                                                                 gpointer                owner);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_OFFSCREEN_POOL_PRIVATE_H__ */
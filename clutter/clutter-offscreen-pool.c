@@ -0,0 +1,541 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * ClutterOffscreenPool: a pool of render targets shared by the
+ * offscreen effects of a stage.
+ *
+ * Offscreen effects only need their render target between the pre_paint
+ * and the post_paint of the actor they are applied to, so instead of
+ * each effect owning a texture and a framebuffer sized after its actor
+ * (and reallocating them every time that size changes), they borrow one
+ * from the pool of their stage and give it back once the actor has been
+ * painted.
+ *
+ * The targets are bucketed by size, rounded up to the next power of two
+ * in each direction, so that actors of slightly different, or slowly
+ * animating, sizes can share them. Targets that have not been used for
+ * a while are released from a low priority timeout.
+ *
+ * Effects caching the image of their actor own the target it is stored
+ * in; owned targets are only lent to other borrowers when there are too
+ * many idle targets, or when the texture budget is exceeded, and their
+ * owner is then notified so that it paints its actor again.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "clutter-offscreen-pool-private.h"
+
+#include "clutter-debug.h"
+#include "clutter-main.h"
+#include "clutter-private.h"
+#include "clutter-texture-budget-private.h"
+
+/* the smallest bucket size, to avoid a bucket for every tiny actor */
+#define MIN_TARGET_SIZE         64
+
+/* the number of unused targets kept around before trimming */
+#define MAX_FREE_TARGETS        8
+
+/* the time, in milliseconds, after which an unused target is freed */
+#define TRIM_TIMEOUT            2000
+
+struct _ClutterOffscreenPool
+{
+  /* ClutterOffscreenTarget, most recently used first */
+  GList *targets;
+
+  guint n_free;
+
+  guint trim_id;
+
+  /* accounts the size of all the targets */
+  ClutterTextureBudgetEntry *budget_entry;
+  gsize size;
+};
+
+/* shared by all pools, so that a serial is never reused */
+static guint64 next_serial = 1;
+
+static int
+bucket_size (int size)
+{
+  int bucket = MIN_TARGET_SIZE;
+
+  while (bucket < size)
+    bucket *= 2;
+
+  return bucket;
+}
+
+static void
+offscreen_target_free (ClutterOffscreenTarget *target)
+{
+  if (target->offscreen != NULL)
+    cogl_handle_unref (target->offscreen);
+
+  if (target->texture != NULL)
+    cogl_handle_unref (target->texture);
+
+  g_slice_free (ClutterOffscreenTarget, target);
+}
+
+static ClutterOffscreenTarget *
+offscreen_target_new (int width,
+                      int height)
+{
+  ClutterOffscreenTarget *target;
+
+  target = g_slice_new0 (ClutterOffscreenTarget);
+  target->width = width;
+  target->height = height;
+
+  target->texture = cogl_texture_new_with_size (width, height,
+                                                COGL_TEXTURE_NO_SLICING,
+                                                COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+  if (target->texture == NULL)
+    goto error;
+
+  target->offscreen = cogl_offscreen_new_to_texture (target->texture);
+  if (target->offscreen == NULL)
+    goto error;
+
+  return target;
+
+error:
+  g_warning ("%s: Unable to create an offscreen buffer of %dx%d pixels",
+             G_STRLOC,
+             width, height);
+
+  offscreen_target_free (target);
+
+  return NULL;
+}
+
+/* the owner drops its references on the target, so that freeing
+ * the target releases its memory
+ */
+static void
+offscreen_target_notify_owner (ClutterOffscreenTarget *target)
+{
+  ClutterOffscreenTargetNotify notify = target->notify;
+  gpointer owner = target->owner;
+
+  target->owner = NULL;
+  target->notify = NULL;
+
+  if (notify != NULL)
+    notify (owner);
+}
+
+static void
+clutter_offscreen_pool_remove (ClutterOffscreenPool *pool,
+                               GList                *link_)
+{
+  ClutterOffscreenTarget *target = link_->data;
+
+  offscreen_target_notify_owner (target);
+
+  CLUTTER_NOTE (MISC, "Freeing pooled offscreen target of %dx%d pixels",
+                target->width,
+                target->height);
+
+  if (!target->in_use)
+    pool->n_free -= 1;
+
+  pool->size -= (gsize) target->width * target->height * 4;
+  _clutter_texture_budget_set_size (pool->budget_entry, pool->size);
+
+  pool->targets = g_list_delete_link (pool->targets, link_);
+  offscreen_target_free (target);
+}
+
+static gboolean
+clutter_offscreen_pool_trim (gpointer data)
+{
+  ClutterOffscreenPool *pool = data;
+  gint64 now = g_get_monotonic_time ();
+  GList *l;
+
+  l = pool->targets;
+  while (l != NULL)
+    {
+      ClutterOffscreenTarget *target = l->data;
+      GList *next = l->next;
+
+      if (!target->in_use &&
+          now - target->last_used >= TRIM_TIMEOUT * 1000)
+        clutter_offscreen_pool_remove (pool, l);
+
+      l = next;
+    }
+
+  if (pool->n_free > 0)
+    return G_SOURCE_CONTINUE;
+
+  pool->trim_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* the targets in use are kept, as their borrowers are painting */
+static void
+clutter_offscreen_pool_evict (gpointer data)
+{
+  ClutterOffscreenPool *pool = data;
+  GList *l;
+
+  l = pool->targets;
+  while (l != NULL)
+    {
+      GList *next = l->next;
+
+      if (!((ClutterOffscreenTarget *) l->data)->in_use)
+        clutter_offscreen_pool_remove (pool, l);
+
+      l = next;
+    }
+}
+
+ClutterOffscreenPool *
+_clutter_offscreen_pool_new (void)
+{
+  ClutterOffscreenPool *pool;
+
+  pool = g_slice_new0 (ClutterOffscreenPool);
+  pool->budget_entry = _clutter_texture_budget_add (clutter_offscreen_pool_evict,
+                                                    pool);
+
+  return pool;
+}
+
+void
+_clutter_offscreen_pool_free (ClutterOffscreenPool *pool)
+{
+  if (pool == NULL)
+    return;
+
+  if (pool->trim_id != 0)
+    g_source_remove (pool->trim_id);
+
+  _clutter_texture_budget_remove (pool->budget_entry);
+
+  /* borrowers hold their own references on the texture and the
+   * framebuffer, so the targets can be freed even while in use
+   */
+  g_list_foreach (pool->targets, (GFunc) offscreen_target_notify_owner, NULL);
+  g_list_free_full (pool->targets, (GDestroyNotify) offscreen_target_free);
+
+  g_slice_free (ClutterOffscreenPool, pool);
+}
+
+/* whether a new target of @size bytes should not be allocated while
+ * one that is owned by another borrower could be taken instead
+ */
+static gboolean
+clutter_offscreen_pool_under_pressure (ClutterOffscreenPool *pool,
+                                       gsize                 size)
+{
+  gsize limit = _clutter_texture_budget_get_limit ();
+
+  if (pool->n_free >= MAX_FREE_TARGETS)
+    return TRUE;
+
+  return limit != 0 && _clutter_texture_budget_get_usage () + size > limit;
+}
+
+/*< private >
+ * _clutter_offscreen_pool_acquire:
+ * @pool: a #ClutterOffscreenPool
+ * @width: the minimum width of the target
+ * @height: the minimum height of the target
+ * @owner: (allow-none): the borrower caching the contents of the
+ *   target after giving it back, or %NULL
+ * @notify: (allow-none): the function called when @owner loses the
+ *   target
+ *
+ * Borrows a render target at least @width by @height pixels big from
+ * @pool; the target must be given back with _clutter_offscreen_pool_release()
+ * once it has been rendered into and painted.
+ *
+ * The target previously owned by @owner is preferred, followed by the
+ * targets nobody owns; the targets of other owners are only taken when
+ * no new target can be allocated. @owner loses any other target it owned.
+ *
+ * The contents of the target are undefined.
+ *
+ * Return value: (transfer none): a render target, or %NULL
+ */
+ClutterOffscreenTarget *
+_clutter_offscreen_pool_acquire (ClutterOffscreenPool         *pool,
+                                 int                           width,
+                                 int                           height,
+                                 gpointer                      owner,
+                                 ClutterOffscreenTargetNotify  notify)
+{
+  ClutterOffscreenTarget *target;
+  GList *l, *found = NULL, *stolen = NULL;
+
+  width = bucket_size (MAX (width, 1));
+  height = bucket_size (MAX (height, 1));
+
+  for (l = pool->targets; l != NULL; l = l->next)
+    {
+      target = l->data;
+
+      if (target->in_use ||
+          target->width != width ||
+          target->height != height)
+        continue;
+
+      if (owner != NULL && target->owner == owner)
+        {
+          found = l;
+          break;
+        }
+
+      if (target->owner == NULL)
+        {
+          if (found == NULL)
+            found = l;
+        }
+      else
+        stolen = l; /* the least recently used one */
+    }
+
+  if (found == NULL && stolen != NULL &&
+      clutter_offscreen_pool_under_pressure (pool, (gsize) width * height * 4))
+    found = stolen;
+
+  if (found != NULL)
+    {
+      target = found->data;
+
+      /* the painting of the previous borrower might still be queued
+       * in the journal of another framebuffer, and it has to happen
+       * before we draw on top of it
+       */
+      cogl_flush ();
+
+      if (target->owner != owner)
+        offscreen_target_notify_owner (target);
+
+      pool->targets = g_list_remove_link (pool->targets, found);
+      pool->targets = g_list_concat (found, pool->targets);
+      pool->n_free -= 1;
+
+      goto out;
+    }
+
+  target = offscreen_target_new (width, height);
+  if (target == NULL)
+    return NULL;
+
+  CLUTTER_NOTE (MISC, "Allocated pooled offscreen target of %dx%d pixels",
+                width, height);
+
+  pool->targets = g_list_prepend (pool->targets, target);
+
+  pool->size += (gsize) width * height * 4;
+  _clutter_texture_budget_set_size (pool->budget_entry, pool->size);
+
+out:
+  if (owner != NULL)
+    _clutter_offscreen_pool_disown (pool, owner);
+
+  target->in_use = TRUE;
+  target->serial = next_serial++;
+  target->owner = owner;
+  target->notify = notify;
+
+  _clutter_texture_budget_mark_used (pool->budget_entry);
+
+  return target;
+}
+
+/*< private >
+ * _clutter_offscreen_pool_release:
+ * @pool: a #ClutterOffscreenPool
+ * @target: a target borrowed from @pool
+ *
+ * Gives @target back to @pool, so that it can be lent to somebody
+ * else. The contents of the target are preserved until then, which
+ * can be checked using _clutter_offscreen_pool_is_current().
+ */
+void
+_clutter_offscreen_pool_release (ClutterOffscreenPool   *pool,
+                                 ClutterOffscreenTarget *target)
+{
+  GList *l;
+
+  l = g_list_find (pool->targets, target);
+  if (l == NULL || !target->in_use)
+    return;
+
+  target->in_use = FALSE;
+  target->last_used = g_get_monotonic_time ();
+  pool->n_free += 1;
+
+  /* keep the number of idle targets bounded; the least recently
+   * used ones are at the end of the list, and the ones caching the
+   * image of an actor go last
+   */
+  l = g_list_last (pool->targets);
+  while (l != NULL && pool->n_free > MAX_FREE_TARGETS)
+    {
+      ClutterOffscreenTarget *idle = l->data;
+      GList *prev = l->prev;
+
+      if (!idle->in_use && idle->owner == NULL)
+        clutter_offscreen_pool_remove (pool, l);
+
+      l = prev;
+    }
+
+  l = g_list_last (pool->targets);
+  while (l != NULL && pool->n_free > MAX_FREE_TARGETS)
+    {
+      GList *prev = l->prev;
+
+      if (!((ClutterOffscreenTarget *) l->data)->in_use)
+        clutter_offscreen_pool_remove (pool, l);
+
+      l = prev;
+    }
+
+  if (pool->trim_id == 0)
+    pool->trim_id = clutter_threads_add_timeout_full (G_PRIORITY_LOW,
+                                                      TRIM_TIMEOUT,
+                                                      clutter_offscreen_pool_trim,
+                                                      pool,
+                                                      NULL);
+}
+
+/*< private >
+ * _clutter_offscreen_pool_is_current:
+ * @pool: a #ClutterOffscreenPool
+ * @target: a target previously borrowed from @pool
+ * @serial: the serial of @target when it was borrowed
+ *
+ * Checks whether @target still belongs to @pool and has not been lent
+ * to anybody else since it was borrowed with @serial, that is whether
+ * it still contains what was rendered into it.
+ *
+ * @target is not dereferenced unless it is still part of @pool.
+ *
+ * Return value: %TRUE if the contents of @target are still valid
+ */
+gboolean
+_clutter_offscreen_pool_is_current (ClutterOffscreenPool   *pool,
+                                    ClutterOffscreenTarget *target,
+                                    guint64                 serial)
+{
+  if (target == NULL || g_list_find (pool->targets, target) == NULL)
+    return FALSE;
+
+  return target->serial == serial;
+}
+
+/*< private >
+ * _clutter_offscreen_pool_reclaim:
+ * @pool: a #ClutterOffscreenPool
+ * @target: a target previously borrowed from @pool
+ * @serial: the serial of @target when it was borrowed
+ *
+ * Borrows @target again, if nobody else borrowed it since it was given
+ * back; unlike _clutter_offscreen_pool_acquire(), the serial of @target
+ * is not changed, as its contents are preserved. The target must be
+ * given back with _clutter_offscreen_pool_release().
+ *
+ * Return value: %TRUE if @target was borrowed again
+ */
+gboolean
+_clutter_offscreen_pool_reclaim (ClutterOffscreenPool   *pool,
+                                 ClutterOffscreenTarget *target,
+                                 guint64                 serial)
+{
+  if (!_clutter_offscreen_pool_is_current (pool, target, serial) ||
+      target->in_use)
+    return FALSE;
+
+  target->in_use = TRUE;
+  pool->n_free -= 1;
+
+  _clutter_texture_budget_mark_used (pool->budget_entry);
+
+  return TRUE;
+}
+
+/*< private >
+ * _clutter_offscreen_pool_touch:
+ * @pool: a #ClutterOffscreenPool
+ * @target: a target owned by the caller
+ *
+ * Marks @target as used, without borrowing it, when its contents are
+ * painted again; this keeps the target from being trimmed while the
+ * image it caches is on screen.
+ */
+void
+_clutter_offscreen_pool_touch (ClutterOffscreenPool   *pool,
+                               ClutterOffscreenTarget *target)
+{
+  GList *l;
+
+  l = g_list_find (pool->targets, target);
+  if (l == NULL)
+    return;
+
+  target->last_used = g_get_monotonic_time ();
+
+  pool->targets = g_list_remove_link (pool->targets, l);
+  pool->targets = g_list_concat (l, pool->targets);
+
+  _clutter_texture_budget_mark_used (pool->budget_entry);
+}
+
+/*< private >
+ * _clutter_offscreen_pool_disown:
+ * @pool: a #ClutterOffscreenPool
+ * @owner: an owner passed to _clutter_offscreen_pool_acquire()
+ *
+ * Gives up the contents of the targets owned by @owner, which can then
+ * be lent to other borrowers; @owner is not notified.
+ */
+void
+_clutter_offscreen_pool_disown (ClutterOffscreenPool *pool,
+                                gpointer              owner)
+{
+  GList *l;
+
+  for (l = pool->targets; l != NULL; l = l->next)
+    {
+      ClutterOffscreenTarget *target = l->data;
+
+      if (target->owner == owner)
+        {
+          target->owner = NULL;
+          target->notify = NULL;
+        }
+    }
+}
@@ -32,6 +32,10 @@
  *
  * A simple page turning effect
  *
+ * Where GLSL is available, the page curl is computed by a vertex shader,
+ * so animating the effect does not require uploading its vertices
+ * every frame.
+ *
  * #ClutterPageTurnEffect is available since Clutter 1.4
  */
 
@@ -58,6 +62,8 @@ struct _ClutterPageTurnEffect
   gdouble angle;
 
   gfloat radius;
+
+  guint use_shader : 1;
 };
 
 struct _ClutterPageTurnEffectClass
@@ -82,6 +88,46 @@ G_DEFINE_TYPE (ClutterPageTurnEffect,
                clutter_page_turn_effect,
                CLUTTER_TYPE_DEFORM_EFFECT);
 
+/* the same deformation as clutter_page_turn_effect_deform_vertex() */
+static const gchar *page_turn_glsl_declarations =
+"uniform float page_turn_period;\n"
+"uniform float page_turn_angle;\n"
+"uniform float page_turn_radius;\n";
+
+static const gchar *page_turn_glsl_source =
+"  if (page_turn_period != 0.0)\n"
+"    {\n"
+"      float cx = (1.0 - page_turn_period) * clutter_deform_size.x;\n"
+"      float cy = (1.0 - page_turn_period) * clutter_deform_size.y;\n"
+"      float c = cos (page_turn_angle);\n"
+"      float s = sin (page_turn_angle);\n"
+"      float rx = (position.x - cx) * c + (position.y - cy) * s\n"
+"               - page_turn_radius;\n"
+"      float ry = (position.y - cy) * c - (position.x - cx) * s;\n"
+"      float turn_angle = 0.0;\n"
+"\n"
+"      if (rx > page_turn_radius * -2.0)\n"
+"        {\n"
+"          float shade;\n"
+"\n"
+"          turn_angle = (rx / page_turn_radius * 1.5707963) - 1.5707963;\n"
+"          shade = (sin (turn_angle) * 96.0 + 159.0) / 255.0;\n"
+"          color = vec4 (shade, shade, shade, 1.0);\n"
+"        }\n"
+"\n"
+"      if (rx > 0.0)\n"
+"        {\n"
+"          float small_radius = page_turn_radius\n"
+"                             - min (page_turn_radius,\n"
+"                                    (turn_angle * 10.0) / 3.1415927);\n"
+"\n"
+"          rx = (small_radius * cos (turn_angle)) + page_turn_radius;\n"
+"          position.x = (rx * c) - (ry * s) + cx;\n"
+"          position.y = (rx * s) + (ry * c) + cy;\n"
+"          position.z = (small_radius * sin (turn_angle)) + page_turn_radius;\n"
+"        }\n"
+"    }\n";
+
 static void
 clutter_page_turn_effect_deform_vertex (ClutterDeformEffect *effect,
                                         gfloat               width,
@@ -147,6 +193,31 @@ clutter_page_turn_effect_deform_vertex (ClutterDeformEffect *effect,
     }
 }
 
+static void
+clutter_page_turn_effect_update (ClutterPageTurnEffect *self)
+{
+  ClutterDeformEffect *deform = CLUTTER_DEFORM_EFFECT (self);
+  gfloat value;
+
+  if (!self->use_shader)
+    {
+      clutter_deform_effect_invalidate (deform);
+      return;
+    }
+
+  value = self->period;
+  clutter_deform_effect_set_uniform_float (deform, "page_turn_period",
+                                           1, 1, &value);
+
+  value = self->angle / (180.0f / G_PI);
+  clutter_deform_effect_set_uniform_float (deform, "page_turn_angle",
+                                           1, 1, &value);
+
+  value = self->radius;
+  clutter_deform_effect_set_uniform_float (deform, "page_turn_radius",
+                                           1, 1, &value);
+}
+
 static void
 clutter_page_turn_effect_set_property (GObject      *gobject,
                                        guint         prop_id,
@@ -271,6 +342,13 @@ clutter_page_turn_effect_init (ClutterPageTurnEffect *self)
   self->period = 0.0;
   self->angle = 0.0;
   self->radius = 24.0f;
+
+  self->use_shader =
+    clutter_deform_effect_set_vertex_shader (CLUTTER_DEFORM_EFFECT (self),
+                                             page_turn_glsl_declarations,
+                                             page_turn_glsl_source);
+
+  clutter_page_turn_effect_update (self);
 }
 
 /**
@@ -319,7 +397,7 @@ clutter_page_turn_effect_set_period (ClutterPageTurnEffect *effect,
 
   effect->period = period;
 
-  clutter_deform_effect_invalidate (CLUTTER_DEFORM_EFFECT (effect));
+  clutter_page_turn_effect_update (effect);
 
   g_object_notify_by_pspec (G_OBJECT (effect), obj_props[PROP_PERIOD]);
 }
@@ -360,7 +438,7 @@ clutter_page_turn_effect_set_angle (ClutterPageTurnEffect *effect,
 
   effect->angle = angle;
 
-  clutter_deform_effect_invalidate (CLUTTER_DEFORM_EFFECT (effect));
+  clutter_page_turn_effect_update (effect);
 
   g_object_notify_by_pspec (G_OBJECT (effect), obj_props[PROP_ANGLE]);
 }
@@ -400,7 +478,7 @@ clutter_page_turn_effect_set_radius (ClutterPageTurnEffect *effect,
 
   effect->radius = radius;
 
-  clutter_deform_effect_invalidate (CLUTTER_DEFORM_EFFECT (effect));
+  clutter_page_turn_effect_update (effect);
 
   g_object_notify_by_pspec (G_OBJECT (effect), obj_props[PROP_RADIUS]);
 }
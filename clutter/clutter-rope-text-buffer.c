@@ -0,0 +1,731 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:clutter-rope-text-buffer
+ * @title: ClutterRopeTextBuffer
+ * @short_description: Text buffer for large documents
+ *
+ * #ClutterRopeTextBuffer is a #ClutterTextBuffer that stores its
+ * contents in a rope: a balanced tree of small chunks of text, in
+ * which every node knows how many characters and bytes are stored
+ * beneath it.
+ *
+ * Inserting or deleting text, and converting between character
+ * positions and byte offsets, only touch the chunks along one path
+ * of the tree, instead of moving or scanning the whole contents like
+ * the default #ClutterTextBuffer does; the contiguous string returned
+ * by clutter_text_buffer_get_text() is assembled on demand.
+ *
+ * Unlike the default implementation, #ClutterRopeTextBuffer is not
+ * limited to %CLUTTER_TEXT_BUFFER_MAX_SIZE bytes, which makes it
+ * suitable for editing long documents; use clutter_text_new_with_buffer()
+ * or clutter_text_set_buffer() to use it with a #ClutterText.
+ *
+ * #ClutterRopeTextBuffer is available since Clutter 1.28
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "clutter-rope-text-buffer.h"
+
+#include "clutter-private.h"
+#include "clutter-text-buffer-private.h"
+
+#include <string.h>
+
+/* the maximum number of bytes stored in a single node */
+#define CHUNK_MAX_SIZE  1024
+#define CHUNK_MIN_SIZE  16
+
+#define ROPE_BYTES(n)   ((n) != NULL ? (n)->total_bytes : 0)
+#define ROPE_CHARS(n)   ((n) != NULL ? (n)->total_chars : 0)
+
+typedef struct _RopeNode        RopeNode;
+
+struct _RopeNode
+{
+  RopeNode *left;
+  RopeNode *right;
+
+  /* the nodes are kept balanced as a treap, using random priorities */
+  guint32 priority;
+
+  /* the chunk of text held by this node; not nul-terminated */
+  gchar *text;
+  gsize size;
+  gsize n_bytes;
+  guint n_chars;
+
+  /* the size of the subtree rooted at this node */
+  gsize total_bytes;
+  guint total_chars;
+};
+
+struct _ClutterRopeTextBufferPrivate
+{
+  RopeNode *root;
+
+  /* the flattened contents, built by get_text() and dropped
+   * whenever the contents change
+   */
+  gchar *text;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (ClutterRopeTextBuffer,
+                            clutter_rope_text_buffer,
+                            CLUTTER_TYPE_TEXT_BUFFER)
+
+/* Overwrite a memory that might contain sensitive information. */
+static void
+trash_area (gchar *area,
+            gsize  len)
+{
+  volatile gchar *varea = (volatile gchar *)area;
+  while (len-- > 0)
+    *varea++ = 0;
+}
+
+static inline gsize
+chunk_offset_to_bytes (const RopeNode *node,
+                       guint           offset)
+{
+  /* ASCII-only chunks do not need to be scanned */
+  if (node->n_bytes == node->n_chars)
+    return offset;
+
+  return g_utf8_offset_to_pointer (node->text, offset) - node->text;
+}
+
+static inline guint
+chunk_bytes_to_offset (const RopeNode *node,
+                       gsize           index_)
+{
+  if (node->n_bytes == node->n_chars)
+    return index_;
+
+  return g_utf8_pointer_to_offset (node->text, node->text + index_);
+}
+
+static RopeNode *
+rope_node_new (const gchar *chars,
+               gsize        n_bytes,
+               guint        n_chars)
+{
+  RopeNode *node = g_slice_new0 (RopeNode);
+
+  node->priority = g_random_int ();
+  node->size = MAX (n_bytes, CHUNK_MIN_SIZE);
+  node->text = g_malloc (node->size);
+  memcpy (node->text, chars, n_bytes);
+  node->n_bytes = node->total_bytes = n_bytes;
+  node->n_chars = node->total_chars = n_chars;
+
+  return node;
+}
+
+static void
+rope_free (RopeNode *node)
+{
+  if (node == NULL)
+    return;
+
+  rope_free (node->left);
+  rope_free (node->right);
+
+  /* Could be a password, so can't leave stuff in memory. */
+  trash_area (node->text, node->size);
+  g_free (node->text);
+
+  g_slice_free (RopeNode, node);
+}
+
+static inline void
+rope_node_update (RopeNode *node)
+{
+  node->total_bytes = ROPE_BYTES (node->left) + node->n_bytes + ROPE_BYTES (node->right);
+  node->total_chars = ROPE_CHARS (node->left) + node->n_chars + ROPE_CHARS (node->right);
+}
+
+static void
+rope_node_reserve (RopeNode *node,
+                   gsize     size)
+{
+  gchar *text;
+
+  if (size <= node->size)
+    return;
+
+  size = MIN (MAX (size, node->size * 2), CHUNK_MAX_SIZE);
+
+  /* no g_realloc(), to avoid leaving the old chunk around */
+  text = g_malloc (size);
+  memcpy (text, node->text, node->n_bytes);
+  trash_area (node->text, node->size);
+  g_free (node->text);
+
+  node->text = text;
+  node->size = size;
+}
+
+/* concatenates two ropes */
+static RopeNode *
+rope_merge (RopeNode *left,
+            RopeNode *right)
+{
+  if (left == NULL)
+    return right;
+
+  if (right == NULL)
+    return left;
+
+  if (left->priority > right->priority)
+    {
+      left->right = rope_merge (left->right, right);
+      rope_node_update (left);
+      return left;
+    }
+  else
+    {
+      right->left = rope_merge (left, right->left);
+      rope_node_update (right);
+      return right;
+    }
+}
+
+/* splits a rope so that @left_p holds the first @position characters;
+ * a chunk straddling @position is split in two
+ */
+static void
+rope_split (RopeNode  *node,
+            guint      position,
+            RopeNode **left_p,
+            RopeNode **right_p)
+{
+  guint left_chars;
+
+  if (node == NULL)
+    {
+      *left_p = *right_p = NULL;
+      return;
+    }
+
+  left_chars = ROPE_CHARS (node->left);
+
+  if (position <= left_chars)
+    {
+      rope_split (node->left, position, left_p, &node->left);
+      rope_node_update (node);
+      *right_p = node;
+    }
+  else if (position >= left_chars + node->n_chars)
+    {
+      rope_split (node->right, position - left_chars - node->n_chars,
+                  &node->right, right_p);
+      rope_node_update (node);
+      *left_p = node;
+    }
+  else
+    {
+      guint offset = position - left_chars;
+      gsize index_ = chunk_offset_to_bytes (node, offset);
+      RopeNode *tail;
+
+      tail = rope_node_new (node->text + index_,
+                            node->n_bytes - index_,
+                            node->n_chars - offset);
+
+      trash_area (node->text + index_, node->n_bytes - index_);
+      node->n_bytes = index_;
+      node->n_chars = offset;
+
+      *right_p = rope_merge (tail, node->right);
+
+      node->right = NULL;
+      rope_node_update (node);
+      *left_p = node;
+    }
+}
+
+/* builds a rope out of @n_bytes of @chars */
+static RopeNode *
+rope_new_from_text (const gchar *chars,
+                    gsize        n_bytes)
+{
+  RopeNode *rope = NULL;
+
+  while (n_bytes > 0)
+    {
+      gsize len = n_bytes;
+
+      if (len > CHUNK_MAX_SIZE)
+        len = g_utf8_find_prev_char (chars, chars + CHUNK_MAX_SIZE + 1) - chars;
+
+      rope = rope_merge (rope, rope_node_new (chars, len, g_utf8_strlen (chars, len)));
+
+      chars += len;
+      n_bytes -= len;
+    }
+
+  return rope;
+}
+
+/* finds the node holding the character at @position; when @position
+ * falls between two nodes the first one is returned, unless @prefer_next
+ * is set
+ */
+static RopeNode *
+rope_find (RopeNode *node,
+           guint     position,
+           gboolean  prefer_next,
+           guint    *offset_p)
+{
+  while (node != NULL)
+    {
+      guint left_chars = ROPE_CHARS (node->left);
+
+      if (position < left_chars ||
+          (position == left_chars && prefer_next == FALSE && node->left != NULL))
+        {
+          node = node->left;
+          continue;
+        }
+
+      position -= left_chars;
+
+      if (position < node->n_chars ||
+          (position == node->n_chars && (prefer_next == FALSE || node->right == NULL)))
+        break;
+
+      position -= node->n_chars;
+      node = node->right;
+    }
+
+  if (offset_p != NULL)
+    *offset_p = position;
+
+  return node;
+}
+
+/* walks the same path as rope_find(), adjusting the sizes of the
+ * subtrees on the way; it must be called before the chunk found
+ * by rope_find() is changed
+ */
+static void
+rope_adjust (RopeNode *node,
+             guint     position,
+             gboolean  prefer_next,
+             gssize    delta_bytes,
+             gint      delta_chars)
+{
+  while (node != NULL)
+    {
+      guint left_chars = ROPE_CHARS (node->left);
+
+      node->total_bytes += delta_bytes;
+      node->total_chars += delta_chars;
+
+      if (position < left_chars ||
+          (position == left_chars && prefer_next == FALSE && node->left != NULL))
+        {
+          node = node->left;
+          continue;
+        }
+
+      position -= left_chars;
+
+      if (position < node->n_chars ||
+          (position == node->n_chars && (prefer_next == FALSE || node->right == NULL)))
+        break;
+
+      position -= node->n_chars;
+      node = node->right;
+    }
+}
+
+static gsize
+rope_offset_to_bytes (RopeNode *node,
+                      guint     position)
+{
+  gsize index_ = 0;
+
+  while (node != NULL)
+    {
+      guint left_chars = ROPE_CHARS (node->left);
+
+      if (position < left_chars)
+        {
+          node = node->left;
+          continue;
+        }
+
+      index_ += ROPE_BYTES (node->left);
+      position -= left_chars;
+
+      if (position <= node->n_chars)
+        return index_ + chunk_offset_to_bytes (node, position);
+
+      index_ += node->n_bytes;
+      position -= node->n_chars;
+      node = node->right;
+    }
+
+  return index_;
+}
+
+static guint
+rope_bytes_to_offset (RopeNode *node,
+                      gsize     index_)
+{
+  guint position = 0;
+
+  while (node != NULL)
+    {
+      gsize left_bytes = ROPE_BYTES (node->left);
+
+      if (index_ < left_bytes)
+        {
+          node = node->left;
+          continue;
+        }
+
+      position += ROPE_CHARS (node->left);
+      index_ -= left_bytes;
+
+      if (index_ <= node->n_bytes)
+        return position + chunk_bytes_to_offset (node, index_);
+
+      position += node->n_chars;
+      index_ -= node->n_bytes;
+      node = node->right;
+    }
+
+  return position;
+}
+
+static gchar *
+rope_copy (RopeNode *node,
+           gchar    *dest)
+{
+  while (node != NULL)
+    {
+      dest = rope_copy (node->left, dest);
+
+      memcpy (dest, node->text, node->n_bytes);
+      dest += node->n_bytes;
+
+      node = node->right;
+    }
+
+  return dest;
+}
+
+/* copies the bytes between @start and @end of the subtree rooted at
+ * @node, whose first byte is at @base, skipping the chunks outside of
+ * the range
+ */
+static gchar *
+rope_copy_range (RopeNode *node,
+                 gsize     base,
+                 gsize     start,
+                 gsize     end,
+                 gchar    *dest)
+{
+  while (node != NULL && base < end)
+    {
+      gsize chunk_start = base + ROPE_BYTES (node->left);
+      gsize from, to;
+
+      if (start < chunk_start)
+        dest = rope_copy_range (node->left, base, start, end, dest);
+
+      from = MAX (start, chunk_start);
+      to = MIN (end, chunk_start + node->n_bytes);
+
+      if (from < to)
+        {
+          memcpy (dest, node->text + (from - chunk_start), to - from);
+          dest += to - from;
+        }
+
+      base = chunk_start + node->n_bytes;
+      node = node->right;
+    }
+
+  return dest;
+}
+
+static void
+clutter_rope_text_buffer_clear_text (ClutterRopeTextBuffer *self)
+{
+  ClutterRopeTextBufferPrivate *priv = self->priv;
+
+  if (priv->text == NULL)
+    return;
+
+  trash_area (priv->text, ROPE_BYTES (priv->root));
+  g_free (priv->text);
+  priv->text = NULL;
+}
+
+static const gchar *
+clutter_rope_text_buffer_get_text (ClutterTextBuffer *buffer,
+                                   gsize             *n_bytes)
+{
+  ClutterRopeTextBufferPrivate *priv = CLUTTER_ROPE_TEXT_BUFFER (buffer)->priv;
+  gsize total_bytes = ROPE_BYTES (priv->root);
+
+  if (n_bytes)
+    *n_bytes = total_bytes;
+
+  if (total_bytes == 0)
+    return "";
+
+  if (priv->text == NULL)
+    {
+      priv->text = g_malloc (total_bytes + 1);
+      *rope_copy (priv->root, priv->text) = '\0';
+    }
+
+  return priv->text;
+}
+
+static guint
+clutter_rope_text_buffer_get_length (ClutterTextBuffer *buffer)
+{
+  return ROPE_CHARS (CLUTTER_ROPE_TEXT_BUFFER (buffer)->priv->root);
+}
+
+static guint
+clutter_rope_text_buffer_insert_text (ClutterTextBuffer *buffer,
+                                      guint              position,
+                                      const gchar       *chars,
+                                      guint              n_chars)
+{
+  ClutterRopeTextBuffer *self = CLUTTER_ROPE_TEXT_BUFFER (buffer);
+  ClutterRopeTextBufferPrivate *priv = self->priv;
+  RopeNode *node, *left, *right;
+  gboolean prefer_next;
+  guint offset = 0;
+  gsize n_bytes;
+
+  if (n_chars == 0)
+    return 0;
+
+  n_bytes = g_utf8_offset_to_pointer (chars, n_chars) - chars;
+
+  clutter_rope_text_buffer_clear_text (self);
+
+  /* the common case of typing a few characters is done in place, as
+   * long as the chunk at @position has room for them; if the end of
+   * the chunk before @position is full, try the start of the next one
+   */
+  prefer_next = FALSE;
+  node = rope_find (priv->root, position, prefer_next, &offset);
+  if (node != NULL && node->n_bytes + n_bytes > CHUNK_MAX_SIZE &&
+      offset == node->n_chars)
+    {
+      prefer_next = TRUE;
+      node = rope_find (priv->root, position, prefer_next, &offset);
+    }
+
+  if (node != NULL && node->n_bytes + n_bytes <= CHUNK_MAX_SIZE)
+    {
+      gsize index_ = chunk_offset_to_bytes (node, offset);
+
+      rope_adjust (priv->root, position, prefer_next, n_bytes, n_chars);
+
+      rope_node_reserve (node, node->n_bytes + n_bytes);
+      memmove (node->text + index_ + n_bytes,
+               node->text + index_,
+               node->n_bytes - index_);
+      memcpy (node->text + index_, chars, n_bytes);
+
+      node->n_bytes += n_bytes;
+      node->n_chars += n_chars;
+    }
+  else
+    {
+      rope_split (priv->root, position, &left, &right);
+      priv->root = rope_merge (rope_merge (left, rope_new_from_text (chars, n_bytes)),
+                               right);
+    }
+
+  clutter_text_buffer_emit_inserted_text (buffer, position, chars, n_chars);
+
+  return n_chars;
+}
+
+static guint
+clutter_rope_text_buffer_delete_text (ClutterTextBuffer *buffer,
+                                      guint              position,
+                                      guint              n_chars)
+{
+  ClutterRopeTextBuffer *self = CLUTTER_ROPE_TEXT_BUFFER (buffer);
+  ClutterRopeTextBufferPrivate *priv = self->priv;
+  guint length = ROPE_CHARS (priv->root);
+  RopeNode *node, *left, *middle, *right;
+  guint offset = 0;
+
+  if (position > length)
+    position = length;
+  if (position + n_chars > length)
+    n_chars = length - position;
+
+  if (n_chars == 0)
+    return 0;
+
+  clutter_rope_text_buffer_clear_text (self);
+
+  /* deleting inside a single chunk, without emptying it, is done in place */
+  node = rope_find (priv->root, position, TRUE, &offset);
+  if (node != NULL &&
+      offset + n_chars <= node->n_chars &&
+      n_chars < node->n_chars)
+    {
+      gsize start = chunk_offset_to_bytes (node, offset);
+      gsize end = chunk_offset_to_bytes (node, offset + n_chars);
+
+      rope_adjust (priv->root, position, TRUE,
+                   -(gssize) (end - start),
+                   -(gint) n_chars);
+
+      memmove (node->text + start, node->text + end, node->n_bytes - end);
+      node->n_bytes -= (end - start);
+      node->n_chars -= n_chars;
+
+      /* Could be a password, make sure we don't leave anything
+       * sensitive after the end of the chunk.
+       */
+      trash_area (node->text + node->n_bytes, end - start);
+    }
+  else
+    {
+      rope_split (priv->root, position, &left, &right);
+      rope_split (right, n_chars, &middle, &right);
+      rope_free (middle);
+
+      priv->root = rope_merge (left, right);
+    }
+
+  clutter_text_buffer_emit_deleted_text (buffer, position, n_chars);
+
+  return n_chars;
+}
+
+static void
+clutter_rope_text_buffer_finalize (GObject *gobject)
+{
+  ClutterRopeTextBuffer *self = CLUTTER_ROPE_TEXT_BUFFER (gobject);
+
+  clutter_rope_text_buffer_clear_text (self);
+
+  rope_free (self->priv->root);
+  self->priv->root = NULL;
+
+  G_OBJECT_CLASS (clutter_rope_text_buffer_parent_class)->finalize (gobject);
+}
+
+static void
+clutter_rope_text_buffer_class_init (ClutterRopeTextBufferClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterTextBufferClass *buffer_class = CLUTTER_TEXT_BUFFER_CLASS (klass);
+
+  gobject_class->finalize = clutter_rope_text_buffer_finalize;
+
+  buffer_class->get_text = clutter_rope_text_buffer_get_text;
+  buffer_class->get_length = clutter_rope_text_buffer_get_length;
+  buffer_class->insert_text = clutter_rope_text_buffer_insert_text;
+  buffer_class->delete_text = clutter_rope_text_buffer_delete_text;
+}
+
+static void
+clutter_rope_text_buffer_init (ClutterRopeTextBuffer *self)
+{
+  self->priv = clutter_rope_text_buffer_get_instance_private (self);
+}
+
+gsize
+_clutter_rope_text_buffer_offset_to_bytes (ClutterRopeTextBuffer *buffer,
+                                           guint                  position)
+{
+  return rope_offset_to_bytes (buffer->priv->root, position);
+}
+
+guint
+_clutter_rope_text_buffer_bytes_to_offset (ClutterRopeTextBuffer *buffer,
+                                           gsize                  index_)
+{
+  return rope_bytes_to_offset (buffer->priv->root, index_);
+}
+
+gchar *
+_clutter_rope_text_buffer_get_range (ClutterRopeTextBuffer *buffer,
+                                     gsize                  start_index,
+                                     gsize                  end_index)
+{
+  gchar *retval = g_malloc (end_index - start_index + 1);
+
+  *rope_copy_range (buffer->priv->root, 0, start_index, end_index, retval) = '\0';
+
+  return retval;
+}
+
+/**
+ * clutter_rope_text_buffer_new:
+ *
+ * Creates a new, empty #ClutterRopeTextBuffer.
+ *
+ * Return value: (transfer full): the newly created #ClutterRopeTextBuffer
+ *
+ * Since: 1.28
+ */
+ClutterTextBuffer *
+clutter_rope_text_buffer_new (void)
+{
+  return g_object_new (CLUTTER_TYPE_ROPE_TEXT_BUFFER, NULL);
+}
+
+/**
+ * clutter_rope_text_buffer_new_with_text:
+ * @text: (allow-none): initial buffer text
+ * @text_len: initial buffer text length, or -1 for null-terminated.
+ *
+ * Creates a new #ClutterRopeTextBuffer holding @text.
+ *
+ * Return value: (transfer full): the newly created #ClutterRopeTextBuffer
+ *
+ * Since: 1.28
+ */
+ClutterTextBuffer *
+clutter_rope_text_buffer_new_with_text (const gchar *text,
+                                        gssize       text_len)
+{
+  ClutterTextBuffer *buffer;
+
+  buffer = clutter_rope_text_buffer_new ();
+  clutter_text_buffer_set_text (buffer, text, text_len);
+
+  return buffer;
+}
@@ -0,0 +1,85 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_ROPE_TEXT_BUFFER_H__
+#define __CLUTTER_ROPE_TEXT_BUFFER_H__
+
+#if !defined(__CLUTTER_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <clutter/clutter.h> can be included directly."
+#endif
+
+#include <clutter/clutter-text-buffer.h>
+
+G_BEGIN_DECLS
+
+#define CLUTTER_TYPE_ROPE_TEXT_BUFFER            (clutter_rope_text_buffer_get_type ())
+#define CLUTTER_ROPE_TEXT_BUFFER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), CLUTTER_TYPE_ROPE_TEXT_BUFFER, ClutterRopeTextBuffer))
+#define CLUTTER_ROPE_TEXT_BUFFER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), CLUTTER_TYPE_ROPE_TEXT_BUFFER, ClutterRopeTextBufferClass))
+#define CLUTTER_IS_ROPE_TEXT_BUFFER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CLUTTER_TYPE_ROPE_TEXT_BUFFER))
+#define CLUTTER_IS_ROPE_TEXT_BUFFER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CLUTTER_TYPE_ROPE_TEXT_BUFFER))
+#define CLUTTER_ROPE_TEXT_BUFFER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), CLUTTER_TYPE_ROPE_TEXT_BUFFER, ClutterRopeTextBufferClass))
+
+typedef struct _ClutterRopeTextBuffer            ClutterRopeTextBuffer;
+typedef struct _ClutterRopeTextBufferClass       ClutterRopeTextBufferClass;
+typedef struct _ClutterRopeTextBufferPrivate     ClutterRopeTextBufferPrivate;
+
+/**
+ * ClutterRopeTextBuffer:
+ *
+ * The #ClutterRopeTextBuffer structure contains private
+ * data and it should only be accessed using the provided API.
+ *
+ * Since: 1.28
+ */
+struct _ClutterRopeTextBuffer
+{
+  /*< private >*/
+  ClutterTextBuffer parent_instance;
+
+  ClutterRopeTextBufferPrivate *priv;
+};
+
+/**
+ * ClutterRopeTextBufferClass:
+ *
+ * The #ClutterRopeTextBufferClass structure contains
+ * only private data.
+ *
+ * Since: 1.28
+ */
+struct _ClutterRopeTextBufferClass
+{
+  /*< private >*/
+  ClutterTextBufferClass parent_class;
+};
+
+CLUTTER_AVAILABLE_IN_1_28
+GType               clutter_rope_text_buffer_get_type       (void) G_GNUC_CONST;
+
+CLUTTER_AVAILABLE_IN_1_28
+ClutterTextBuffer*  clutter_rope_text_buffer_new            (void);
+CLUTTER_AVAILABLE_IN_1_28
+ClutterTextBuffer*  clutter_rope_text_buffer_new_with_text  (const gchar *text,
+                                                             gssize       text_len);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_ROPE_TEXT_BUFFER_H__ */
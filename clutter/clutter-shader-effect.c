@@ -129,6 +129,19 @@
 #include "clutter-private.h"
 #include "clutter-shader-types.h"
 
+typedef struct _ShaderCacheEntry
+{
+  gchar *key;
+
+  CoglHandle shader;
+  CoglHandle program;
+
+  guint n_users;
+
+  /* the static source of a class, kept even when no effect uses it */
+  guint is_static : 1;
+} ShaderCacheEntry;
+
 typedef struct _ShaderUniform
 {
   gchar *name;
@@ -146,17 +159,19 @@ struct _ClutterShaderEffectPrivate
   CoglHandle program;
   CoglHandle shader;
 
+  /* the entry of the shader cache we got the program from */
+  ShaderCacheEntry *cache_entry;
+
   GHashTable *uniforms;
 };
 
 typedef struct _ClutterShaderEffectClassPrivate
 {
-  /* These are the per-class pre-compiled shader and program which is
-     used when the class implements get_static_shader_source without
-     calling set_shader_source. They will be shared by all instances
-     of this class */
-  CoglHandle program;
-  CoglHandle shader;
+  /* This is the entry of the per-class pre-compiled shader and program
+     which is used when the class implements get_static_shader_source
+     without calling set_shader_source. It will be shared by all
+     instances of this class */
+  ShaderCacheEntry *cache_entry;
 } ClutterShaderEffectClassPrivate;
 
 enum
@@ -170,6 +185,12 @@ enum
 
 static GParamSpec *obj_props[PROP_LAST];
 
+/* compiled programs shared by all the shader effects using the same
+ * source; the uniforms are stored in each effect, and set on the
+ * program before painting
+ */
+static GHashTable *shader_cache = NULL;
+
 G_DEFINE_TYPE_WITH_CODE (ClutterShaderEffect,
                          clutter_shader_effect,
                          CLUTTER_TYPE_OFFSCREEN_EFFECT,
@@ -177,6 +198,91 @@ G_DEFINE_TYPE_WITH_CODE (ClutterShaderEffect,
                          g_type_add_class_private (g_define_type_id,
                                                    sizeof (ClutterShaderEffectClassPrivate)))
 
+static ShaderCacheEntry *
+shader_cache_get (ClutterShaderType  shader_type,
+                  const gchar       *source)
+{
+  ShaderCacheEntry *entry;
+  gchar *key;
+
+  if (G_UNLIKELY (shader_cache == NULL))
+    shader_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* the shader type is part of the key, as the same source can be
+   * compiled both as a vertex and as a fragment shader
+   */
+  key = g_strconcat (shader_type == CLUTTER_VERTEX_SHADER ? "v:" : "f:",
+                     source,
+                     NULL);
+
+  entry = g_hash_table_lookup (shader_cache, key);
+  if (entry != NULL)
+    {
+      CLUTTER_NOTE (SHADER, "Reusing cached shader effect program");
+
+      g_free (key);
+      entry->n_users += 1;
+
+      return entry;
+    }
+
+  entry = g_slice_new0 (ShaderCacheEntry);
+  entry->key = key;
+  entry->n_users = 1;
+
+  if (shader_type == CLUTTER_VERTEX_SHADER)
+    entry->shader = cogl_create_shader (COGL_SHADER_TYPE_VERTEX);
+  else
+    entry->shader = cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
+
+  cogl_shader_source (entry->shader, source);
+
+  CLUTTER_NOTE (SHADER, "Compiling shader effect");
+
+  cogl_shader_compile (entry->shader);
+
+  /* a source that does not compile is cached as well, so that we
+   * do not try, and warn, again for each effect using it
+   */
+  if (cogl_shader_is_compiled (entry->shader))
+    {
+      entry->program = cogl_create_program ();
+
+      cogl_program_attach_shader (entry->program, entry->shader);
+
+      cogl_program_link (entry->program);
+    }
+  else
+    {
+      gchar *log_buf = cogl_shader_get_info_log (entry->shader);
+
+      g_warning (G_STRLOC ": Unable to compile the GLSL shader: %s", log_buf);
+      g_free (log_buf);
+    }
+
+  g_hash_table_insert (shader_cache, entry->key, entry);
+
+  return entry;
+}
+
+static void
+shader_cache_release (ShaderCacheEntry *entry)
+{
+  entry->n_users -= 1;
+  if (entry->n_users > 0 || entry->is_static)
+    return;
+
+  g_hash_table_remove (shader_cache, entry->key);
+
+  if (entry->program != COGL_INVALID_HANDLE)
+    cogl_handle_unref (entry->program);
+
+  cogl_handle_unref (entry->shader);
+
+  g_free (entry->key);
+  g_slice_free (ShaderCacheEntry, entry);
+}
+
 static inline void
 clutter_shader_effect_clear (ClutterShaderEffect *self,
                              gboolean             reset_uniforms)
@@ -197,6 +303,13 @@ clutter_shader_effect_clear (ClutterShaderEffect *self,
       priv->program = COGL_INVALID_HANDLE;
     }
 
+  if (priv->cache_entry != NULL)
+    {
+      shader_cache_release (priv->cache_entry);
+
+      priv->cache_entry = NULL;
+    }
+
   if (reset_uniforms && priv->uniforms != NULL)
     {
       g_hash_table_destroy (priv->uniforms);
@@ -322,26 +435,6 @@ clutter_shader_effect_set_actor (ClutterActorMeta *meta,
                 G_OBJECT_TYPE_NAME (meta));
 }
 
-static CoglHandle
-clutter_shader_effect_create_shader (ClutterShaderEffect *self)
-{
-  ClutterShaderEffectPrivate *priv = self->priv;
-
-  switch (priv->shader_type)
-    {
-    case CLUTTER_FRAGMENT_SHADER:
-      return cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
-      break;
-
-    case CLUTTER_VERTEX_SHADER:
-      return cogl_create_shader (COGL_SHADER_TYPE_VERTEX);
-      break;
-
-    default:
-      g_assert_not_reached ();
-    }
-}
-
 static void
 clutter_shader_effect_try_static_source (ClutterShaderEffect *self)
 {
@@ -358,44 +451,31 @@ clutter_shader_effect_try_static_source (ClutterShaderEffect *self)
                                   CLUTTER_TYPE_SHADER_EFFECT,
                                   ClutterShaderEffectClassPrivate);
 
-      if (class_priv->shader == COGL_INVALID_HANDLE)
+      if (class_priv->cache_entry == NULL)
         {
           gchar *source;
 
-          class_priv->shader = clutter_shader_effect_create_shader (self);
-
           source = shader_effect_class->get_static_shader_source (self);
 
-          cogl_shader_source (class_priv->shader, source);
+          /* the class keeps its entry for the lifetime of the process */
+          class_priv->cache_entry = shader_cache_get (priv->shader_type,
+                                                      source);
+          class_priv->cache_entry->is_static = TRUE;
 
           g_free (source);
-
-          CLUTTER_NOTE (SHADER, "Compiling shader effect");
-
-          cogl_shader_compile (class_priv->shader);
-
-          if (cogl_shader_is_compiled (class_priv->shader))
-            {
-              class_priv->program = cogl_create_program ();
-
-              cogl_program_attach_shader (class_priv->program,
-                                          class_priv->shader);
-
-              cogl_program_link (class_priv->program);
-            }
-          else
-            {
-              gchar *log_buf = cogl_shader_get_info_log (class_priv->shader);
-
-              g_warning (G_STRLOC ": Unable to compile the GLSL shader: %s", log_buf);
-              g_free (log_buf);
-            }
         }
+      else
+        class_priv->cache_entry->n_users += 1;
+
+      /* like a source set on the effect, the entry counts its users
+       * so that we know when the program is shared
+       */
+      priv->cache_entry = class_priv->cache_entry;
 
-      priv->shader = cogl_handle_ref (class_priv->shader);
+      priv->shader = cogl_handle_ref (priv->cache_entry->shader);
 
-      if (class_priv->program != COGL_INVALID_HANDLE)
-        priv->program = cogl_handle_ref (class_priv->program);
+      if (priv->cache_entry->program != COGL_INVALID_HANDLE)
+        priv->program = cogl_handle_ref (priv->cache_entry->program);
     }
 }
 
@@ -421,6 +501,13 @@ clutter_shader_effect_paint_target (ClutterOffscreenEffect *effect)
   CLUTTER_NOTE (SHADER, "Applying the shader effect of type '%s'",
                 G_OBJECT_TYPE_NAME (effect));
 
+  /* the program is shared with other effects, and the uniforms are
+   * only set on it when drawing; so anything queued with the values
+   * of another effect has to be drawn before we change them
+   */
+  if (priv->cache_entry != NULL && priv->cache_entry->n_users > 1)
+    cogl_flush ();
+
   clutter_shader_effect_update_uniforms (CLUTTER_SHADER_EFFECT (effect));
 
   /* associate the program to the offscreen target material */
@@ -881,6 +968,9 @@ clutter_shader_effect_set_uniform (ClutterShaderEffect *effect,
  * This function can only be called once; subsequent calls will
  * yield no result.
  *
+ * Effects using the same source share the same compiled program,
+ * while keeping their own values for the uniforms.
+ *
  * Return value: %TRUE if the source was set
  *
  * Since: 1.4
@@ -899,29 +989,15 @@ clutter_shader_effect_set_shader_source (ClutterShaderEffect *effect,
   if (priv->shader != COGL_INVALID_HANDLE)
     return TRUE;
 
-  priv->shader = clutter_shader_effect_create_shader (effect);
-
-  cogl_shader_source (priv->shader, source);
-
-  CLUTTER_NOTE (SHADER, "Compiling shader effect");
-
-  cogl_shader_compile (priv->shader);
-
-  if (cogl_shader_is_compiled (priv->shader))
-    {
-      priv->program = cogl_create_program ();
-
-      cogl_program_attach_shader (priv->program, priv->shader);
+  /* effects using the same source share the same program, instead
+   * of compiling and linking their own
+   */
+  priv->cache_entry = shader_cache_get (priv->shader_type, source);
 
-      cogl_program_link (priv->program);
-    }
-  else
-    {
-      gchar *log_buf = cogl_shader_get_info_log (priv->shader);
+  priv->shader = cogl_handle_ref (priv->cache_entry->shader);
 
-      g_warning (G_STRLOC ": Unable to compile the GLSL shader: %s", log_buf);
-      g_free (log_buf);
-    }
+  if (priv->cache_entry->program != COGL_INVALID_HANDLE)
+    priv->program = cogl_handle_ref (priv->cache_entry->program);
 
   return TRUE;
 }
@@ -0,0 +1,974 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:clutter-sprite-batch
+ * @Title: ClutterSpriteBatch
+ * @Short_Description: An actor drawing many small quads at once
+ *
+ * #ClutterSpriteBatch is a #ClutterActor that draws a large number of
+ * sprites, like particles, markers or map pins, without paying the cost of
+ * one #ClutterActor for each of them.
+ *
+ * Each sprite is a rectangle with a position and a size, in the
+ * coordinates of the batch, a color, and an area of the texture set
+ * with clutter_sprite_batch_set_texture(); sprites are drawn in the
+ * order of their index, so a sprite is painted on top of all the
+ * sprites with a lower index. Sprites are not actors: they are not
+ * allocated, and they do not receive events. The batch is picked using
+ * its allocation like any other actor, and
+ * clutter_sprite_batch_get_sprite_at_position() can be used to find
+ * the sprite under an event.
+ *
+ * The sprites are kept in a single vertex buffer, and only the ones
+ * that changed since the last frame are uploaded again; the whole batch
+ * is then drawn with a handful of primitives, all sharing the same
+ * pipeline.
+ *
+ * |[<!-- language="C" -->
+ *   ClutterActor *batch = clutter_sprite_batch_new ();
+ *   guint i;
+ *
+ *   clutter_sprite_batch_set_texture (CLUTTER_SPRITE_BATCH (batch), pins);
+ *
+ *   for (i = 0; i < n_places; i++)
+ *     clutter_sprite_batch_add_sprite (CLUTTER_SPRITE_BATCH (batch),
+ *                                      places[i].x, places[i].y,
+ *                                      16, 16,
+ *                                      NULL);
+ * ]|
+ *
+ * #ClutterSpriteBatch is available since Clutter 1.28.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "clutter-sprite-batch.h"
+
+#define CLUTTER_ENABLE_EXPERIMENTAL_API
+
+#include "clutter-actor-private.h"
+#include "clutter-backend.h"
+#include "clutter-color.h"
+#include "clutter-debug.h"
+#include "clutter-paint-node.h"
+#include "clutter-paint-nodes.h"
+#include "clutter-private.h"
+
+/* the rectangle indices provided by Cogl are 16 bit wide, so a single
+ * primitive can address at most 65536 vertices
+ */
+#define MAX_SPRITES_PER_PRIMITIVE       (65536 / 4)
+
+struct _ClutterSpriteBatchPrivate
+{
+  /* the sprites, one array for each attribute */
+  GArray *positions;            /* x, y */
+  GArray *sizes;                /* width, height */
+  GArray *colors;               /* ClutterColor */
+  GArray *tex_coords;           /* s1, t1, s2, t2 */
+
+  guint n_sprites;
+
+  CoglTexture *texture;
+  CoglPipeline *pipeline;
+
+  CoglAttributeBuffer *buffer;
+  guint buffer_size;            /* in sprites */
+
+  GPtrArray *primitives;
+  guint primitives_n_sprites;
+
+  /* the range of sprites that changed since the last upload */
+  guint dirty_start;
+  guint dirty_end;
+
+  ClutterActorBox bounds;
+  guint bounds_valid : 1;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (ClutterSpriteBatch, clutter_sprite_batch, CLUTTER_TYPE_ACTOR)
+
+#define SPRITE_POSITION(priv,i)         (&g_array_index ((priv)->positions, float, (i) * 2))
+#define SPRITE_SIZE(priv,i)             (&g_array_index ((priv)->sizes, float, (i) * 2))
+#define SPRITE_COLOR(priv,i)            (&g_array_index ((priv)->colors, ClutterColor, (i)))
+#define SPRITE_TEX_COORDS(priv,i)       (&g_array_index ((priv)->tex_coords, float, (i) * 4))
+
+static void
+clutter_sprite_batch_invalidate (ClutterSpriteBatch *batch,
+                                 guint               first,
+                                 guint               n_sprites,
+                                 gboolean            geometry_changed)
+{
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+
+  if (n_sprites == 0)
+    return;
+
+  if (priv->dirty_start == priv->dirty_end)
+    {
+      priv->dirty_start = first;
+      priv->dirty_end = first + n_sprites;
+    }
+  else
+    {
+      priv->dirty_start = MIN (priv->dirty_start, first);
+      priv->dirty_end = MAX (priv->dirty_end, first + n_sprites);
+    }
+
+  if (geometry_changed)
+    priv->bounds_valid = FALSE;
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (batch));
+}
+
+static void
+clutter_sprite_batch_ensure_bounds (ClutterSpriteBatch *batch)
+{
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+  guint i;
+
+  if (priv->bounds_valid)
+    return;
+
+  priv->bounds_valid = TRUE;
+
+  if (priv->n_sprites == 0)
+    {
+      clutter_actor_box_init (&priv->bounds, 0.f, 0.f, 0.f, 0.f);
+      return;
+    }
+
+  priv->bounds.x1 = priv->bounds.y1 = G_MAXFLOAT;
+  priv->bounds.x2 = priv->bounds.y2 = -G_MAXFLOAT;
+
+  for (i = 0; i < priv->n_sprites; i++)
+    {
+      const float *position = SPRITE_POSITION (priv, i);
+      const float *size = SPRITE_SIZE (priv, i);
+
+      priv->bounds.x1 = MIN (priv->bounds.x1, position[0]);
+      priv->bounds.y1 = MIN (priv->bounds.y1, position[1]);
+      priv->bounds.x2 = MAX (priv->bounds.x2, position[0] + size[0]);
+      priv->bounds.y2 = MAX (priv->bounds.y2, position[1] + size[1]);
+    }
+}
+
+static void
+clutter_sprite_batch_clear_primitives (ClutterSpriteBatch *batch)
+{
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+
+  g_ptr_array_set_size (priv->primitives, 0);
+  priv->primitives_n_sprites = 0;
+}
+
+static void
+clutter_sprite_batch_ensure_buffer (ClutterSpriteBatch *batch,
+                                    CoglContext        *ctx)
+{
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+  guint size;
+
+  if (priv->buffer != NULL && priv->buffer_size >= priv->n_sprites)
+    return;
+
+  /* grow geometrically, so that adding sprites one by one does not
+   * reallocate the buffer every frame
+   */
+  size = MAX (priv->buffer_size, 64);
+  while (size < priv->n_sprites)
+    size *= 2;
+
+  clutter_sprite_batch_clear_primitives (batch);
+
+  if (priv->buffer != NULL)
+    cogl_object_unref (priv->buffer);
+
+  priv->buffer = cogl_attribute_buffer_new (ctx,
+                                            sizeof (CoglVertexP2T2C4) * 4 * size,
+                                            NULL);
+  priv->buffer_size = size;
+
+  /* the sprites are expected to be animated */
+  cogl_buffer_set_update_hint (COGL_BUFFER (priv->buffer),
+                               COGL_BUFFER_UPDATE_HINT_DYNAMIC);
+
+  /* everything has to be uploaded into the new buffer */
+  priv->dirty_start = 0;
+  priv->dirty_end = priv->n_sprites;
+}
+
+static void
+clutter_sprite_batch_upload (ClutterSpriteBatch *batch)
+{
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+  CoglVertexP2T2C4 *verts, *v;
+  guint start, end, i;
+
+  start = priv->dirty_start;
+  end = MIN (priv->dirty_end, priv->n_sprites);
+
+  priv->dirty_start = priv->dirty_end = 0;
+
+  if (start >= end)
+    return;
+
+  CLUTTER_NOTE (PAINT, "Uploading sprites %u to %u of batch '%s'",
+                start, end,
+                _clutter_actor_get_debug_name (CLUTTER_ACTOR (batch)));
+
+  verts = g_new (CoglVertexP2T2C4, (end - start) * 4);
+
+  for (i = start, v = verts; i < end; i++, v += 4)
+    {
+      const float *position = SPRITE_POSITION (priv, i);
+      const float *size = SPRITE_SIZE (priv, i);
+      const ClutterColor *color = SPRITE_COLOR (priv, i);
+      const float *tex_coords = SPRITE_TEX_COORDS (priv, i);
+      float x1 = position[0], y1 = position[1];
+      float x2 = x1 + size[0], y2 = y1 + size[1];
+      guint8 r, g, b, a;
+      int j;
+
+      /* the pipeline blends premultiplied colors */
+      a = color->alpha;
+      r = color->red * a / 255;
+      g = color->green * a / 255;
+      b = color->blue * a / 255;
+
+      v[0].x = x1; v[0].y = y1; v[0].s = tex_coords[0]; v[0].t = tex_coords[1];
+      v[1].x = x1; v[1].y = y2; v[1].s = tex_coords[0]; v[1].t = tex_coords[3];
+      v[2].x = x2; v[2].y = y2; v[2].s = tex_coords[2]; v[2].t = tex_coords[3];
+      v[3].x = x2; v[3].y = y1; v[3].s = tex_coords[2]; v[3].t = tex_coords[1];
+
+      for (j = 0; j < 4; j++)
+        {
+          v[j].r = r;
+          v[j].g = g;
+          v[j].b = b;
+          v[j].a = a;
+        }
+    }
+
+  cogl_buffer_set_data (COGL_BUFFER (priv->buffer),
+                        sizeof (CoglVertexP2T2C4) * 4 * start,
+                        verts,
+                        sizeof (CoglVertexP2T2C4) * 4 * (end - start));
+
+  g_free (verts);
+}
+
+static void
+clutter_sprite_batch_ensure_primitives (ClutterSpriteBatch *batch,
+                                        CoglContext        *ctx)
+{
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+  guint first;
+
+  if (priv->primitives_n_sprites == priv->n_sprites)
+    return;
+
+  clutter_sprite_batch_clear_primitives (batch);
+
+  for (first = 0; first < priv->n_sprites; first += MAX_SPRITES_PER_PRIMITIVE)
+    {
+      guint n_sprites = MIN (priv->n_sprites - first, MAX_SPRITES_PER_PRIMITIVE);
+      gsize offset = sizeof (CoglVertexP2T2C4) * 4 * first;
+      CoglAttribute *attributes[3];
+      CoglPrimitive *primitive;
+      int i;
+
+      attributes[0] = cogl_attribute_new (priv->buffer,
+                                          "cogl_position_in",
+                                          sizeof (CoglVertexP2T2C4),
+                                          offset + G_STRUCT_OFFSET (CoglVertexP2T2C4, x),
+                                          2, /* n_components */
+                                          COGL_ATTRIBUTE_TYPE_FLOAT);
+      attributes[1] = cogl_attribute_new (priv->buffer,
+                                          "cogl_tex_coord0_in",
+                                          sizeof (CoglVertexP2T2C4),
+                                          offset + G_STRUCT_OFFSET (CoglVertexP2T2C4, s),
+                                          2, /* n_components */
+                                          COGL_ATTRIBUTE_TYPE_FLOAT);
+      attributes[2] = cogl_attribute_new (priv->buffer,
+                                          "cogl_color_in",
+                                          sizeof (CoglVertexP2T2C4),
+                                          offset + G_STRUCT_OFFSET (CoglVertexP2T2C4, r),
+                                          4, /* n_components */
+                                          COGL_ATTRIBUTE_TYPE_UNSIGNED_BYTE);
+
+      primitive = cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_TRIANGLES,
+                                                      n_sprites * 6,
+                                                      attributes,
+                                                      3 /* n_attributes */);
+      cogl_primitive_set_indices (primitive,
+                                  cogl_get_rectangle_indices (ctx, n_sprites),
+                                  n_sprites * 6);
+
+      g_ptr_array_add (priv->primitives, primitive);
+
+      for (i = 0; i < 3; i++)
+        cogl_object_unref (attributes[i]);
+    }
+
+  priv->primitives_n_sprites = priv->n_sprites;
+}
+
+static void
+clutter_sprite_batch_ensure_pipeline (ClutterSpriteBatch *batch,
+                                      CoglContext        *ctx)
+{
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+  int opacity_layer;
+
+  if (priv->pipeline != NULL)
+    return;
+
+  priv->pipeline = cogl_pipeline_new (ctx);
+
+  if (priv->texture != NULL)
+    {
+      cogl_pipeline_set_layer_texture (priv->pipeline, 0, priv->texture);
+      opacity_layer = 1;
+    }
+  else
+    opacity_layer = 0;
+
+  /* the color of the sprites comes from the vertices, so the paint
+   * opacity is applied by an additional layer
+   */
+  cogl_pipeline_set_layer_combine (priv->pipeline, opacity_layer,
+                                   "RGBA = MODULATE (PREVIOUS, CONSTANT)",
+                                   NULL);
+}
+
+static void
+clutter_sprite_batch_paint_node (ClutterActor     *actor,
+                                 ClutterPaintNode *root)
+{
+  ClutterSpriteBatch *batch = CLUTTER_SPRITE_BATCH (actor);
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+  ClutterPaintNode *node;
+  CoglContext *ctx;
+  CoglColor constant;
+  guint8 paint_opacity;
+  guint i;
+
+  if (priv->n_sprites == 0)
+    return;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  clutter_sprite_batch_ensure_buffer (batch, ctx);
+  clutter_sprite_batch_upload (batch);
+  clutter_sprite_batch_ensure_primitives (batch, ctx);
+  clutter_sprite_batch_ensure_pipeline (batch, ctx);
+
+  paint_opacity = clutter_actor_get_paint_opacity (actor);
+  cogl_color_init_from_4ub (&constant,
+                            paint_opacity,
+                            paint_opacity,
+                            paint_opacity,
+                            paint_opacity);
+  cogl_pipeline_set_layer_combine_constant (priv->pipeline,
+                                            priv->texture != NULL ? 1 : 0,
+                                            &constant);
+
+  node = clutter_pipeline_node_new (priv->pipeline);
+  clutter_paint_node_set_name (node, "SpriteBatch");
+
+  for (i = 0; i < priv->primitives->len; i++)
+    clutter_paint_node_add_primitive (node, g_ptr_array_index (priv->primitives, i));
+
+  clutter_paint_node_add_child (root, node);
+  clutter_paint_node_unref (node);
+}
+
+static gboolean
+clutter_sprite_batch_get_paint_volume (ClutterActor       *actor,
+                                       ClutterPaintVolume *volume)
+{
+  ClutterSpriteBatch *batch = CLUTTER_SPRITE_BATCH (actor);
+  ClutterSpriteBatchPrivate *priv = batch->priv;
+
+  if (!clutter_paint_volume_set_from_allocation (volume, actor))
+    return FALSE;
+
+  clutter_sprite_batch_ensure_bounds (batch);
+
+  /* sprites are not clipped to the allocation */
+  if (priv->n_sprites != 0)
+    clutter_paint_volume_union_box (volume, &priv->bounds);
+
+  return TRUE;
+}
+
+static gboolean
+clutter_sprite_batch_has_overlaps (ClutterActor *actor)
+{
+  return CLUTTER_SPRITE_BATCH (actor)->priv->n_sprites > 1;
+}
+
+static void
+clutter_sprite_batch_dispose (GObject *gobject)
+{
+  ClutterSpriteBatchPrivate *priv = CLUTTER_SPRITE_BATCH (gobject)->priv;
+
+  clutter_sprite_batch_clear_primitives (CLUTTER_SPRITE_BATCH (gobject));
+
+  if (priv->buffer != NULL)
+    {
+      cogl_object_unref (priv->buffer);
+      priv->buffer = NULL;
+      priv->buffer_size = 0;
+    }
+
+  if (priv->pipeline != NULL)
+    {
+      cogl_object_unref (priv->pipeline);
+      priv->pipeline = NULL;
+    }
+
+  if (priv->texture != NULL)
+    {
+      cogl_object_unref (priv->texture);
+      priv->texture = NULL;
+    }
+
+  G_OBJECT_CLASS (clutter_sprite_batch_parent_class)->dispose (gobject);
+}
+
+static void
+clutter_sprite_batch_finalize (GObject *gobject)
+{
+  ClutterSpriteBatchPrivate *priv = CLUTTER_SPRITE_BATCH (gobject)->priv;
+
+  g_array_unref (priv->positions);
+  g_array_unref (priv->sizes);
+  g_array_unref (priv->colors);
+  g_array_unref (priv->tex_coords);
+  g_ptr_array_unref (priv->primitives);
+
+  G_OBJECT_CLASS (clutter_sprite_batch_parent_class)->finalize (gobject);
+}
+
+static void
+clutter_sprite_batch_class_init (ClutterSpriteBatchClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+
+  gobject_class->dispose = clutter_sprite_batch_dispose;
+  gobject_class->finalize = clutter_sprite_batch_finalize;
+
+  actor_class->paint_node = clutter_sprite_batch_paint_node;
+  actor_class->get_paint_volume = clutter_sprite_batch_get_paint_volume;
+  actor_class->has_overlaps = clutter_sprite_batch_has_overlaps;
+}
+
+static void
+clutter_sprite_batch_init (ClutterSpriteBatch *self)
+{
+  ClutterSpriteBatchPrivate *priv;
+
+  self->priv = priv = clutter_sprite_batch_get_instance_private (self);
+
+  priv->positions = g_array_new (FALSE, FALSE, sizeof (float));
+  priv->sizes = g_array_new (FALSE, FALSE, sizeof (float));
+  priv->colors = g_array_new (FALSE, FALSE, sizeof (ClutterColor));
+  priv->tex_coords = g_array_new (FALSE, FALSE, sizeof (float));
+  priv->primitives = g_ptr_array_new_with_free_func (cogl_object_unref);
+}
+
+/**
+ * clutter_sprite_batch_new:
+ *
+ * Creates a new, empty #ClutterSpriteBatch.
+ *
+ * Return value: the newly created #ClutterSpriteBatch
+ *
+ * Since: 1.28
+ */
+ClutterActor *
+clutter_sprite_batch_new (void)
+{
+  return g_object_new (CLUTTER_TYPE_SPRITE_BATCH, NULL);
+}
+
+/**
+ * clutter_sprite_batch_set_texture:
+ * @batch: a #ClutterSpriteBatch
+ * @texture: (allow-none): a #CoglTexture, or %NULL
+ *
+ * Sets the texture the sprites of @batch are cut from; the area of
+ * @texture used by each sprite is set using
+ * clutter_sprite_batch_set_sprite_texture_area(), and its pixels are
+ * modulated by the color of the sprite.
+ *
+ * All the sprites share the same texture, so different images should
+ * be packed in a single atlas. Since sprites are drawn as primitives,
+ * @texture should not be sliced.
+ *
+ * If @texture is %NULL, sprites are filled with their color.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_set_texture (ClutterSpriteBatch *batch,
+                                  CoglTexture        *texture)
+{
+  ClutterSpriteBatchPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (texture == NULL || cogl_is_texture (texture));
+
+  priv = batch->priv;
+
+  if (priv->texture == texture)
+    return;
+
+  if (texture != NULL)
+    cogl_object_ref (texture);
+
+  if (priv->texture != NULL)
+    cogl_object_unref (priv->texture);
+
+  priv->texture = texture;
+
+  /* the number of layers changes, so build the pipeline again */
+  if (priv->pipeline != NULL)
+    {
+      cogl_object_unref (priv->pipeline);
+      priv->pipeline = NULL;
+    }
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (batch));
+}
+
+/**
+ * clutter_sprite_batch_get_texture:
+ * @batch: a #ClutterSpriteBatch
+ *
+ * Retrieves the texture set using clutter_sprite_batch_set_texture().
+ *
+ * Return value: (transfer none): the texture of the sprites, or %NULL
+ *
+ * Since: 1.28
+ */
+CoglTexture *
+clutter_sprite_batch_get_texture (ClutterSpriteBatch *batch)
+{
+  g_return_val_if_fail (CLUTTER_IS_SPRITE_BATCH (batch), NULL);
+
+  return batch->priv->texture;
+}
+
+/**
+ * clutter_sprite_batch_add_sprite:
+ * @batch: a #ClutterSpriteBatch
+ * @x: the X coordinate of the top left corner of the sprite
+ * @y: the Y coordinate of the top left corner of the sprite
+ * @width: the width of the sprite
+ * @height: the height of the sprite
+ * @color: (allow-none): the color of the sprite, or %NULL for white
+ *
+ * Adds a sprite on top of the other sprites of @batch. The sprite
+ * uses the whole texture of @batch.
+ *
+ * Return value: the index of the new sprite
+ *
+ * Since: 1.28
+ */
+guint
+clutter_sprite_batch_add_sprite (ClutterSpriteBatch *batch,
+                                 float               x,
+                                 float               y,
+                                 float               width,
+                                 float               height,
+                                 const ClutterColor *color)
+{
+  ClutterSpriteBatchPrivate *priv;
+  float position[2] = { x, y };
+  float size[2] = { width, height };
+  float tex_coords[4] = { 0.f, 0.f, 1.f, 1.f };
+  guint index_;
+
+  g_return_val_if_fail (CLUTTER_IS_SPRITE_BATCH (batch), 0);
+
+  priv = batch->priv;
+
+  if (color == NULL)
+    color = clutter_color_get_static (CLUTTER_COLOR_WHITE);
+
+  g_array_append_vals (priv->positions, position, 2);
+  g_array_append_vals (priv->sizes, size, 2);
+  g_array_append_vals (priv->colors, color, 1);
+  g_array_append_vals (priv->tex_coords, tex_coords, 4);
+
+  index_ = priv->n_sprites++;
+
+  clutter_sprite_batch_invalidate (batch, index_, 1, TRUE);
+
+  return index_;
+}
+
+/**
+ * clutter_sprite_batch_remove_sprite:
+ * @batch: a #ClutterSpriteBatch
+ * @index_: the index of the sprite to remove
+ *
+ * Removes the sprite at @index_ from @batch.
+ *
+ * To keep the removal cheap, the last sprite of @batch is moved at
+ * @index_; the indices of the other sprites are not changed.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_remove_sprite (ClutterSpriteBatch *batch,
+                                    guint               index_)
+{
+  ClutterSpriteBatchPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (index_ < batch->priv->n_sprites);
+
+  priv = batch->priv;
+
+  priv->n_sprites -= 1;
+
+  if (index_ != priv->n_sprites)
+    {
+      memcpy (SPRITE_POSITION (priv, index_),
+              SPRITE_POSITION (priv, priv->n_sprites),
+              sizeof (float) * 2);
+      memcpy (SPRITE_SIZE (priv, index_),
+              SPRITE_SIZE (priv, priv->n_sprites),
+              sizeof (float) * 2);
+      *SPRITE_COLOR (priv, index_) = *SPRITE_COLOR (priv, priv->n_sprites);
+      memcpy (SPRITE_TEX_COORDS (priv, index_),
+              SPRITE_TEX_COORDS (priv, priv->n_sprites),
+              sizeof (float) * 4);
+
+      clutter_sprite_batch_invalidate (batch, index_, 1, TRUE);
+    }
+  else
+    {
+      priv->bounds_valid = FALSE;
+      clutter_actor_queue_redraw (CLUTTER_ACTOR (batch));
+    }
+
+  g_array_set_size (priv->positions, priv->n_sprites * 2);
+  g_array_set_size (priv->sizes, priv->n_sprites * 2);
+  g_array_set_size (priv->colors, priv->n_sprites);
+  g_array_set_size (priv->tex_coords, priv->n_sprites * 4);
+}
+
+/**
+ * clutter_sprite_batch_remove_all:
+ * @batch: a #ClutterSpriteBatch
+ *
+ * Removes all the sprites of @batch.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_remove_all (ClutterSpriteBatch *batch)
+{
+  ClutterSpriteBatchPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+
+  priv = batch->priv;
+
+  if (priv->n_sprites == 0)
+    return;
+
+  priv->n_sprites = 0;
+  priv->dirty_start = priv->dirty_end = 0;
+  priv->bounds_valid = FALSE;
+
+  g_array_set_size (priv->positions, 0);
+  g_array_set_size (priv->sizes, 0);
+  g_array_set_size (priv->colors, 0);
+  g_array_set_size (priv->tex_coords, 0);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (batch));
+}
+
+/**
+ * clutter_sprite_batch_get_n_sprites:
+ * @batch: a #ClutterSpriteBatch
+ *
+ * Retrieves the number of sprites of @batch.
+ *
+ * Return value: the number of sprites
+ *
+ * Since: 1.28
+ */
+guint
+clutter_sprite_batch_get_n_sprites (ClutterSpriteBatch *batch)
+{
+  g_return_val_if_fail (CLUTTER_IS_SPRITE_BATCH (batch), 0);
+
+  return batch->priv->n_sprites;
+}
+
+/**
+ * clutter_sprite_batch_set_sprite_position:
+ * @batch: a #ClutterSpriteBatch
+ * @index_: the index of a sprite
+ * @x: the X coordinate of the top left corner of the sprite
+ * @y: the Y coordinate of the top left corner of the sprite
+ *
+ * Moves the sprite at @index_.
+ *
+ * To move many sprites at once, clutter_sprite_batch_set_positions()
+ * is more efficient.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_set_sprite_position (ClutterSpriteBatch *batch,
+                                          guint               index_,
+                                          float               x,
+                                          float               y)
+{
+  float *position;
+
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (index_ < batch->priv->n_sprites);
+
+  position = SPRITE_POSITION (batch->priv, index_);
+  position[0] = x;
+  position[1] = y;
+
+  clutter_sprite_batch_invalidate (batch, index_, 1, TRUE);
+}
+
+/**
+ * clutter_sprite_batch_get_sprite_position:
+ * @batch: a #ClutterSpriteBatch
+ * @index_: the index of a sprite
+ * @x: (out) (allow-none): return location for the X coordinate of the
+ *   top left corner of the sprite, or %NULL
+ * @y: (out) (allow-none): return location for the Y coordinate of the
+ *   top left corner of the sprite, or %NULL
+ *
+ * Retrieves the position of the sprite at @index_.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_get_sprite_position (ClutterSpriteBatch *batch,
+                                          guint               index_,
+                                          float              *x,
+                                          float              *y)
+{
+  const float *position;
+
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (index_ < batch->priv->n_sprites);
+
+  position = SPRITE_POSITION (batch->priv, index_);
+
+  if (x != NULL)
+    *x = position[0];
+
+  if (y != NULL)
+    *y = position[1];
+}
+
+/**
+ * clutter_sprite_batch_set_sprite_size:
+ * @batch: a #ClutterSpriteBatch
+ * @index_: the index of a sprite
+ * @width: the width of the sprite
+ * @height: the height of the sprite
+ *
+ * Resizes the sprite at @index_.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_set_sprite_size (ClutterSpriteBatch *batch,
+                                      guint               index_,
+                                      float               width,
+                                      float               height)
+{
+  float *size;
+
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (index_ < batch->priv->n_sprites);
+
+  size = SPRITE_SIZE (batch->priv, index_);
+  size[0] = width;
+  size[1] = height;
+
+  clutter_sprite_batch_invalidate (batch, index_, 1, TRUE);
+}
+
+/**
+ * clutter_sprite_batch_set_sprite_color:
+ * @batch: a #ClutterSpriteBatch
+ * @index_: the index of a sprite
+ * @color: the color of the sprite
+ *
+ * Sets the color of the sprite at @index_. If @batch has a texture,
+ * the texture is modulated by @color.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_set_sprite_color (ClutterSpriteBatch *batch,
+                                       guint               index_,
+                                       const ClutterColor *color)
+{
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (index_ < batch->priv->n_sprites);
+  g_return_if_fail (color != NULL);
+
+  *SPRITE_COLOR (batch->priv, index_) = *color;
+
+  clutter_sprite_batch_invalidate (batch, index_, 1, FALSE);
+}
+
+/**
+ * clutter_sprite_batch_set_sprite_texture_area:
+ * @batch: a #ClutterSpriteBatch
+ * @index_: the index of a sprite
+ * @s1: the horizontal texture coordinate of the top left corner
+ * @t1: the vertical texture coordinate of the top left corner
+ * @s2: the horizontal texture coordinate of the bottom right corner
+ * @t2: the vertical texture coordinate of the bottom right corner
+ *
+ * Sets the area of the texture of @batch drawn by the sprite at
+ * @index_, using normalized coordinates.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_set_sprite_texture_area (ClutterSpriteBatch *batch,
+                                              guint               index_,
+                                              float               s1,
+                                              float               t1,
+                                              float               s2,
+                                              float               t2)
+{
+  float *tex_coords;
+
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (index_ < batch->priv->n_sprites);
+
+  tex_coords = SPRITE_TEX_COORDS (batch->priv, index_);
+  tex_coords[0] = s1;
+  tex_coords[1] = t1;
+  tex_coords[2] = s2;
+  tex_coords[3] = t2;
+
+  clutter_sprite_batch_invalidate (batch, index_, 1, FALSE);
+}
+
+/**
+ * clutter_sprite_batch_set_positions:
+ * @batch: a #ClutterSpriteBatch
+ * @first: the index of the first sprite to move
+ * @n_sprites: the number of sprites to move
+ * @positions: (array): the new positions, as @n_sprites pairs of X and Y
+ *   coordinates of the top left corner of the sprites
+ *
+ * Moves the sprites from @first to @first + @n_sprites - 1 at once.
+ *
+ * Since: 1.28
+ */
+void
+clutter_sprite_batch_set_positions (ClutterSpriteBatch *batch,
+                                    guint               first,
+                                    guint               n_sprites,
+                                    const float        *positions)
+{
+  g_return_if_fail (CLUTTER_IS_SPRITE_BATCH (batch));
+  g_return_if_fail (first + n_sprites <= batch->priv->n_sprites);
+  g_return_if_fail (n_sprites == 0 || positions != NULL);
+
+  if (n_sprites == 0)
+    return;
+
+  memcpy (SPRITE_POSITION (batch->priv, first),
+          positions,
+          sizeof (float) * 2 * n_sprites);
+
+  clutter_sprite_batch_invalidate (batch, first, n_sprites, TRUE);
+}
+
+/**
+ * clutter_sprite_batch_get_sprite_at_position:
+ * @batch: a #ClutterSpriteBatch
+ * @x: the X coordinate, relative to @batch
+ * @y: the Y coordinate, relative to @batch
+ *
+ * Retrieves the topmost sprite of @batch containing the given point.
+ *
+ * This function can be used from an event handler, after transforming
+ * the stage coordinates of the event using
+ * clutter_actor_transform_stage_point().
+ *
+ * Return value: the index of the sprite, or -1 if no sprite contains
+ *   the point
+ *
+ * Since: 1.28
+ */
+gint
+clutter_sprite_batch_get_sprite_at_position (ClutterSpriteBatch *batch,
+                                             float               x,
+                                             float               y)
+{
+  ClutterSpriteBatchPrivate *priv;
+  guint i;
+
+  g_return_val_if_fail (CLUTTER_IS_SPRITE_BATCH (batch), -1);
+
+  priv = batch->priv;
+
+  clutter_sprite_batch_ensure_bounds (batch);
+
+  if (priv->n_sprites == 0 ||
+      !clutter_actor_box_contains (&priv->bounds, x, y))
+    return -1;
+
+  /* sprites with a higher index are painted on top */
+  for (i = priv->n_sprites; i > 0; i--)
+    {
+      const float *position = SPRITE_POSITION (priv, i - 1);
+      const float *size = SPRITE_SIZE (priv, i - 1);
+
+      if (x >= position[0] && x < position[0] + size[0] &&
+          y >= position[1] && y < position[1] + size[1])
+        return i - 1;
+    }
+
+  return -1;
+}
@@ -0,0 +1,144 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_SPRITE_BATCH_H__
+#define __CLUTTER_SPRITE_BATCH_H__
+
+#if !defined(__CLUTTER_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <clutter/clutter.h> can be included directly."
+#endif
+
+#include <cogl/cogl.h>
+#include <clutter/clutter-types.h>
+#include <clutter/clutter-actor.h>
+
+G_BEGIN_DECLS
+
+#define CLUTTER_TYPE_SPRITE_BATCH               (clutter_sprite_batch_get_type ())
+#define CLUTTER_SPRITE_BATCH(obj)               (G_TYPE_CHECK_INSTANCE_CAST ((obj), CLUTTER_TYPE_SPRITE_BATCH, ClutterSpriteBatch))
+#define CLUTTER_IS_SPRITE_BATCH(obj)            (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CLUTTER_TYPE_SPRITE_BATCH))
+#define CLUTTER_SPRITE_BATCH_CLASS(klass)       (G_TYPE_CHECK_CLASS_CAST ((klass), CLUTTER_TYPE_SPRITE_BATCH, ClutterSpriteBatchClass))
+#define CLUTTER_IS_SPRITE_BATCH_CLASS(klass)    (G_TYPE_CHECK_CLASS_TYPE ((klass), CLUTTER_TYPE_SPRITE_BATCH))
+#define CLUTTER_SPRITE_BATCH_GET_CLASS(obj)     (G_TYPE_INSTANCE_GET_CLASS ((obj), CLUTTER_TYPE_SPRITE_BATCH, ClutterSpriteBatchClass))
+
+typedef struct _ClutterSpriteBatch              ClutterSpriteBatch;
+typedef struct _ClutterSpriteBatchPrivate       ClutterSpriteBatchPrivate;
+typedef struct _ClutterSpriteBatchClass         ClutterSpriteBatchClass;
+
+/**
+ * ClutterSpriteBatch:
+ *
+ * The #ClutterSpriteBatch structure contains only
+ * private data, and should be accessed using the provided API.
+ *
+ * Since: 1.28
+ */
+struct _ClutterSpriteBatch
+{
+  /*< private >*/
+  ClutterActor parent_instance;
+
+  ClutterSpriteBatchPrivate *priv;
+};
+
+/**
+ * ClutterSpriteBatchClass:
+ *
+ * The #ClutterSpriteBatchClass structure contains only
+ * private data.
+ *
+ * Since: 1.28
+ */
+struct _ClutterSpriteBatchClass
+{
+  /*< private >*/
+  ClutterActorClass parent_class;
+
+  gpointer _padding[8];
+};
+
+CLUTTER_AVAILABLE_IN_1_28
+GType clutter_sprite_batch_get_type (void) G_GNUC_CONST;
+
+CLUTTER_AVAILABLE_IN_1_28
+ClutterActor *          clutter_sprite_batch_new                        (void);
+
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_set_texture                (ClutterSpriteBatch *batch,
+                                                                         CoglTexture        *texture);
+CLUTTER_AVAILABLE_IN_1_28
+CoglTexture *           clutter_sprite_batch_get_texture                (ClutterSpriteBatch *batch);
+
+CLUTTER_AVAILABLE_IN_1_28
+guint                   clutter_sprite_batch_add_sprite                 (ClutterSpriteBatch *batch,
+                                                                         float               x,
+                                                                         float               y,
+                                                                         float               width,
+                                                                         float               height,
+                                                                         const ClutterColor *color);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_remove_sprite              (ClutterSpriteBatch *batch,
+                                                                         guint               index_);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_remove_all                 (ClutterSpriteBatch *batch);
+CLUTTER_AVAILABLE_IN_1_28
+guint                   clutter_sprite_batch_get_n_sprites              (ClutterSpriteBatch *batch);
+
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_set_sprite_position        (ClutterSpriteBatch *batch,
+                                                                         guint               index_,
+                                                                         float               x,
+                                                                         float               y);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_get_sprite_position        (ClutterSpriteBatch *batch,
+                                                                         guint               index_,
+                                                                         float              *x,
+                                                                         float              *y);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_set_sprite_size            (ClutterSpriteBatch *batch,
+                                                                         guint               index_,
+                                                                         float               width,
+                                                                         float               height);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_set_sprite_color           (ClutterSpriteBatch *batch,
+                                                                         guint               index_,
+                                                                         const ClutterColor *color);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_set_sprite_texture_area    (ClutterSpriteBatch *batch,
+                                                                         guint               index_,
+                                                                         float               s1,
+                                                                         float               t1,
+                                                                         float               s2,
+                                                                         float               t2);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_sprite_batch_set_positions              (ClutterSpriteBatch *batch,
+                                                                         guint               first,
+                                                                         guint               n_sprites,
+                                                                         const float        *positions);
+
+CLUTTER_AVAILABLE_IN_1_28
+gint                    clutter_sprite_batch_get_sprite_at_position     (ClutterSpriteBatch *batch,
+                                                                         float               x,
+                                                                         float               y);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_SPRITE_BATCH_H__ */
@@ -26,6 +26,7 @@
 #include <clutter/clutter-stage.h>
 #include <clutter/clutter-input-device.h>
 #include <clutter/clutter-private.h>
+#include <clutter/clutter-offscreen-pool-private.h>
 
 #include <cogl/cogl.h>
 
@@ -90,6 +91,8 @@ void                          _clutter_stage_queue_redraw_entry_invalidate (Clut
 
 CoglFramebuffer *_clutter_stage_get_active_framebuffer (ClutterStage *stage);
 
+ClutterOffscreenPool *_clutter_stage_get_offscreen_pool (ClutterStage *stage);
+
 gint32          _clutter_stage_acquire_pick_id          (ClutterStage *stage,
                                                          ClutterActor *actor);
 void            _clutter_stage_release_pick_id          (ClutterStage *stage,
@@ -66,6 +66,7 @@
 #include "clutter-enum-types.h"
 #include "clutter-event-private.h"
 #include "clutter-id-pool.h"
+#include "clutter-layout-profiler.h"
 #include "clutter-main.h"
 #include "clutter-marshal.h"
 #include "clutter-master-clock.h"
@@ -73,6 +74,7 @@
 #include "clutter-private.h"
 #include "clutter-stage-manager-private.h"
 #include "clutter-stage-private.h"
+#include "clutter-texture-budget-private.h"
 #include "clutter-version.h" 	/* For flavour */
 #include "clutter-private.h"
 
@@ -139,6 +141,8 @@ struct _ClutterStagePrivate
 
   ClutterIDPool *pick_id_pool;
 
+  ClutterOffscreenPool *offscreen_pool;
+
 #ifdef CLUTTER_ENABLE_DEBUG
   gulong redraw_count;
 #endif /* CLUTTER_ENABLE_DEBUG */
@@ -638,6 +642,9 @@ _clutter_stage_do_paint (ClutterStage                *stage,
   if (priv->impl == NULL)
     return;
 
+  if (_clutter_context_get_pick_mode () == CLUTTER_PICK_NONE)
+    _clutter_texture_budget_new_frame ();
+
   _clutter_stage_window_get_geometry (priv->impl, &geom);
   window_scale = _clutter_stage_window_get_scale_factor (priv->impl);
 
@@ -1097,6 +1104,9 @@ _clutter_stage_maybe_relayout (ClutterActor *actor)
                               &box, CLUTTER_ALLOCATION_NONE);
 
       CLUTTER_UNSET_PRIVATE_FLAGS (stage, CLUTTER_IN_RELAYOUT);
+
+      if (G_UNLIKELY (_clutter_layout_profiler_enabled))
+        _clutter_layout_profiler_flush (actor);
     }
 }
 
@@ -1743,6 +1753,8 @@ clutter_stage_finalize (GObject *object)
 
   _clutter_id_pool_free (priv->pick_id_pool);
 
+  _clutter_offscreen_pool_free (priv->offscreen_pool);
+
   if (priv->fps_timer != NULL)
     g_timer_destroy (priv->fps_timer);
 
@@ -4210,6 +4222,26 @@ _clutter_stage_get_active_framebuffer (ClutterStage *stage)
   return stage->priv->active_framebuffer;
 }
 
+/*< private >
+ * _clutter_stage_get_offscreen_pool:
+ * @stage: a #ClutterStage
+ *
+ * Retrieves the pool of render targets shared by the offscreen
+ * effects of the actors inside @stage.
+ *
+ * Return value: (transfer none): the offscreen pool
+ */
+ClutterOffscreenPool *
+_clutter_stage_get_offscreen_pool (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  if (priv->offscreen_pool == NULL)
+    priv->offscreen_pool = _clutter_offscreen_pool_new ();
+
+  return priv->offscreen_pool;
+}
+
 gint32
 _clutter_stage_acquire_pick_id (ClutterStage *stage,
                                 ClutterActor *actor)
@@ -0,0 +1,48 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_TEXT_BUFFER_PRIVATE_H__
+#define __CLUTTER_TEXT_BUFFER_PRIVATE_H__
+
+#include <clutter/clutter-text-buffer.h>
+#include <clutter/clutter-rope-text-buffer.h>
+
+G_BEGIN_DECLS
+
+gsize           _clutter_text_buffer_offset_to_bytes            (ClutterTextBuffer     *buffer,
+                                                                 gint                   position);
+gint            _clutter_text_buffer_bytes_to_offset            (ClutterTextBuffer     *buffer,
+                                                                 gsize                  index_);
+gchar *         _clutter_text_buffer_get_range                  (ClutterTextBuffer     *buffer,
+                                                                 gint                   start_pos,
+                                                                 gint                   end_pos);
+
+gsize           _clutter_rope_text_buffer_offset_to_bytes       (ClutterRopeTextBuffer *buffer,
+                                                                 guint                  position);
+guint           _clutter_rope_text_buffer_bytes_to_offset       (ClutterRopeTextBuffer *buffer,
+                                                                 gsize                  index_);
+gchar *         _clutter_rope_text_buffer_get_range             (ClutterRopeTextBuffer *buffer,
+                                                                 gsize                  start_index,
+                                                                 gsize                  end_index);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_TEXT_BUFFER_PRIVATE_H__ */
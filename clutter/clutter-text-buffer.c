@@ -23,7 +23,7 @@
 #include "config.h"
 #endif
 
-#include "clutter-text-buffer.h"
+#include "clutter-text-buffer-private.h"
 #include "clutter-marshal.h"
 #include "clutter-private.h"
 
@@ -101,6 +101,21 @@ trash_area (gchar *area,
     *varea++ = 0;
 }
 
+/* Finds the byte offset of the character at @position in the contents;
+ * when they are all ASCII there's no need to scan them.
+ */
+static inline gsize
+clutter_text_buffer_normal_offset_to_bytes (ClutterTextBuffer *buffer,
+                                            guint              position)
+{
+  ClutterTextBufferPrivate *pv = buffer->priv;
+
+  if (pv->normal_text_bytes == pv->normal_text_chars)
+    return MIN (position, pv->normal_text_bytes);
+
+  return g_utf8_offset_to_pointer (pv->normal_text, position) - pv->normal_text;
+}
+
 static const gchar*
 clutter_text_buffer_normal_get_text (ClutterTextBuffer *buffer,
                                   gsize          *n_bytes)
@@ -170,7 +185,7 @@ clutter_text_buffer_normal_insert_text (ClutterTextBuffer *buffer,
     }
 
   /* Actual text insertion */
-  at = g_utf8_offset_to_pointer (pv->normal_text, position) - pv->normal_text;
+  at = clutter_text_buffer_normal_offset_to_bytes (buffer, position);
   g_memmove (pv->normal_text + at + n_bytes, pv->normal_text + at, pv->normal_text_bytes - at);
   memcpy (pv->normal_text + at, chars, n_bytes);
 
@@ -198,8 +213,8 @@ clutter_text_buffer_normal_delete_text (ClutterTextBuffer *buffer,
 
   if (n_chars > 0)
     {
-      start = g_utf8_offset_to_pointer (pv->normal_text, position) - pv->normal_text;
-      end = g_utf8_offset_to_pointer (pv->normal_text, position + n_chars) - pv->normal_text;
+      start = clutter_text_buffer_normal_offset_to_bytes (buffer, position);
+      end = clutter_text_buffer_normal_offset_to_bytes (buffer, position + n_chars);
 
       g_memmove (pv->normal_text + start, pv->normal_text + end, pv->normal_text_bytes + 1 - end);
       pv->normal_text_chars -= n_chars;
@@ -764,3 +779,112 @@ clutter_text_buffer_emit_deleted_text (ClutterTextBuffer *buffer,
   g_return_if_fail (CLUTTER_IS_TEXT_BUFFER (buffer));
   g_signal_emit (buffer, signals[DELETED_TEXT], 0, position, n_chars);
 }
+
+/*< private >
+ * _clutter_text_buffer_offset_to_bytes:
+ * @buffer: a #ClutterTextBuffer
+ * @position: a position in characters, or -1 for the end of the buffer
+ *
+ * Converts @position into a byte offset inside the string returned
+ * by clutter_text_buffer_get_text(), without scanning it whenever
+ * the implementation of @buffer allows it.
+ *
+ * Return value: the byte offset of @position, clamped to the
+ *   length of the buffer
+ */
+gsize
+_clutter_text_buffer_offset_to_bytes (ClutterTextBuffer *buffer,
+                                      gint               position)
+{
+  ClutterTextBufferClass *klass = CLUTTER_TEXT_BUFFER_GET_CLASS (buffer);
+  const gchar *text, *ptr;
+  gsize n_bytes;
+
+  if (position < 0)
+    return clutter_text_buffer_get_bytes (buffer);
+
+  if (CLUTTER_IS_ROPE_TEXT_BUFFER (buffer))
+    return _clutter_rope_text_buffer_offset_to_bytes (CLUTTER_ROPE_TEXT_BUFFER (buffer),
+                                                      position);
+
+  if (klass->get_text == clutter_text_buffer_normal_get_text)
+    {
+      if (position > buffer->priv->normal_text_chars)
+        position = buffer->priv->normal_text_chars;
+
+      return clutter_text_buffer_normal_offset_to_bytes (buffer, position);
+    }
+
+  text = clutter_text_buffer_get_text (buffer);
+  n_bytes = clutter_text_buffer_get_bytes (buffer);
+
+  for (ptr = text; ptr < text + n_bytes && position-- > 0; ptr = g_utf8_next_char (ptr))
+    ;
+
+  return ptr - text;
+}
+
+/*< private >
+ * _clutter_text_buffer_bytes_to_offset:
+ * @buffer: a #ClutterTextBuffer
+ * @index_: a byte offset inside the contents of @buffer
+ *
+ * Converts @index_ into a position in characters; this is the
+ * inverse of _clutter_text_buffer_offset_to_bytes().
+ *
+ * Return value: the position of the character at @index_
+ */
+gint
+_clutter_text_buffer_bytes_to_offset (ClutterTextBuffer *buffer,
+                                      gsize              index_)
+{
+  ClutterTextBufferClass *klass = CLUTTER_TEXT_BUFFER_GET_CLASS (buffer);
+  const gchar *text;
+
+  if (CLUTTER_IS_ROPE_TEXT_BUFFER (buffer))
+    return _clutter_rope_text_buffer_bytes_to_offset (CLUTTER_ROPE_TEXT_BUFFER (buffer),
+                                                      index_);
+
+  if (klass->get_text == clutter_text_buffer_normal_get_text &&
+      buffer->priv->normal_text_bytes == buffer->priv->normal_text_chars)
+    return MIN (index_, buffer->priv->normal_text_bytes);
+
+  text = clutter_text_buffer_get_text (buffer);
+
+  return g_utf8_pointer_to_offset (text, text + index_);
+}
+
+/*< private >
+ * _clutter_text_buffer_get_range:
+ * @buffer: a #ClutterTextBuffer
+ * @start_pos: the position of the first character
+ * @end_pos: the position after the last character, or -1 for the
+ *   end of the buffer
+ *
+ * Copies a range of the contents of @buffer; unlike taking a slice of
+ * clutter_text_buffer_get_text(), this does not require the buffer to
+ * build its whole contents.
+ *
+ * Return value: (transfer full): a newly allocated string
+ */
+gchar *
+_clutter_text_buffer_get_range (ClutterTextBuffer *buffer,
+                                gint               start_pos,
+                                gint               end_pos)
+{
+  gsize start_index, end_index;
+
+  start_index = _clutter_text_buffer_offset_to_bytes (buffer, start_pos);
+  end_index = _clutter_text_buffer_offset_to_bytes (buffer, end_pos);
+
+  if (end_index <= start_index)
+    return g_strdup ("");
+
+  if (CLUTTER_IS_ROPE_TEXT_BUFFER (buffer))
+    return _clutter_rope_text_buffer_get_range (CLUTTER_ROPE_TEXT_BUFFER (buffer),
+                                                start_index,
+                                                end_index);
+
+  return g_strndup (clutter_text_buffer_get_text (buffer) + start_index,
+                    end_index - start_index);
+}
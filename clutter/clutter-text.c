@@ -46,6 +46,7 @@
 #include <math.h>
 
 #include "clutter-text.h"
+#include "clutter-text-private.h"
 
 #include "clutter-actor-private.h"
 #include "clutter-animatable.h"
@@ -54,15 +55,17 @@
 #include "clutter-color.h"
 #include "clutter-debug.h"
 #include "clutter-enum-types.h"
+#include "clutter-glyph-cache-private.h"
 #include "clutter-keysyms.h"
 #include "clutter-main.h"
 #include "clutter-marshal.h"
 #include "clutter-private.h"    /* includes <cogl-pango/cogl-pango.h> */
 #include "clutter-property-transition.h"
-#include "clutter-text-buffer.h"
+#include "clutter-text-buffer-private.h"
 #include "clutter-units.h"
 #include "clutter-paint-volume-private.h"
 #include "clutter-scriptable.h"
+#include "clutter-stage-private.h"
 
 /* cursor width in pixels */
 #define DEFAULT_CURSOR_SIZE     2
@@ -82,6 +85,50 @@
  */
 #define N_CACHED_LAYOUTS        6
 
+/* The layouts of non-editable text without attributes are also stored
+ * inside a cache shared by all ClutterText instances, so that actors
+ * showing the same string with the same font only shape it once. We
+ * keep up to N_SHARED_LAYOUTS layouts, and we skip long strings, as
+ * they are unlikely to be repeated
+ */
+#define N_SHARED_LAYOUTS        256
+#define SHARED_LAYOUT_MAX_BYTES 1024
+
+/* When :async-layout is set, text larger than this is shaped in a
+ * worker thread
+ */
+#define ASYNC_LAYOUT_MIN_BYTES  (16 * 1024)
+
+/* Wrapped, multi-line text larger than this is laid out one paragraph
+ * at a time, so that editing it only shapes again the paragraphs that
+ * changed; we keep the layouts of each paragraph for two widths: the
+ * one used by the width request, and the allocated one
+ */
+#define PARAGRAPH_LAYOUT_MIN_BYTES      (4 * 1024)
+#define N_PARAGRAPH_WIDTHS              2
+
+typedef struct _AsyncLayout     AsyncLayout;
+
+typedef struct _Paragraph       Paragraph;
+
+struct _Paragraph
+{
+  /* the size of the paragraph, without its delimiter */
+  gsize n_bytes;
+  guint n_chars;
+
+  /* the size of the delimiter: 0 for the last paragraph, 1 for "\n"
+   * and 2 for "\r\n"
+   */
+  guint delimiter;
+
+  /* the layouts for each width in paragraph_widths, and their
+   * logical extents
+   */
+  PangoLayout *layouts[N_PARAGRAPH_WIDTHS];
+  PangoRectangle logical_rects[N_PARAGRAPH_WIDTHS];
+};
+
 typedef struct _LayoutCache     LayoutCache;
 
 struct _LayoutCache
@@ -114,6 +161,14 @@ struct _ClutterTextPrivate
   LayoutCache cached_layouts[N_CACHED_LAYOUTS];
   guint cache_age;
 
+  /* the paragraphs of wrapped, multi-line text; see
+   * clutter_text_use_paragraphs()
+   */
+  GArray *paragraphs;
+  guint paragraphs_chars;
+  gint paragraph_widths[N_PARAGRAPH_WIDTHS];
+  guint paragraph_ages[N_PARAGRAPH_WIDTHS];
+
   /* These are the attributes set by the attributes property */
   PangoAttrList *attrs;
   /* These are the attributes derived from the text when the
@@ -176,6 +231,9 @@ struct _ClutterTextPrivate
   /* Signal handler for when the :text-direction changes */
   guint direction_changed_id;
 
+  /* the pending asynchronous layout request, if any */
+  AsyncLayout *async_layout_data;
+
   /* bitfields */
   guint alignment               : 2;
   guint wrap                    : 1;
@@ -201,6 +259,7 @@ struct _ClutterTextPrivate
   guint show_password_hint      : 1;
   guint password_hint_visible   : 1;
   guint resolved_direction      : 4;
+  guint async_layout            : 1;
 };
 
 enum
@@ -236,6 +295,7 @@ enum
   PROP_SINGLE_LINE_MODE,
   PROP_SELECTED_TEXT_COLOR,
   PROP_SELECTED_TEXT_COLOR_SET,
+  PROP_ASYNC_LAYOUT,
 
   PROP_LAST
 };
@@ -257,6 +317,8 @@ enum
 static guint text_signals[LAST_SIGNAL] = { 0, };
 
 static void clutter_text_settings_changed_cb (ClutterText *text);
+static void clutter_text_cancel_async_layout (ClutterText *self);
+static void clutter_text_clear_paragraphs (ClutterText *self);
 static void buffer_connect_signals (ClutterText *self);
 static void buffer_disconnect_signals (ClutterText *self);
 static ClutterTextBuffer *get_buffer (ClutterText *self);
@@ -342,6 +404,33 @@ offset_to_bytes (const gchar *text,
 
 #define bytes_to_offset(t,p)    (g_utf8_pointer_to_offset ((t), (t) + (p)))
 
+/* Like offset_to_bytes(), for the contents of the buffer or for the
+ * display text; unless a password character is set the display text
+ * is a copy of the contents, and the buffer can find the offset for
+ * us without scanning the whole string
+ */
+static gint
+clutter_text_offset_to_bytes (ClutterText *self,
+                              const gchar *text,
+                              gint         pos)
+{
+  if (self->priv->password_char != 0)
+    return offset_to_bytes (text, pos);
+
+  return _clutter_text_buffer_offset_to_bytes (get_buffer (self), pos);
+}
+
+static gint
+clutter_text_bytes_to_offset (ClutterText *self,
+                              const gchar *text,
+                              gint         index_)
+{
+  if (self->priv->password_char != 0)
+    return bytes_to_offset (text, index_);
+
+  return _clutter_text_buffer_bytes_to_offset (get_buffer (self), index_);
+}
+
 static inline void
 clutter_text_clear_selection (ClutterText *self)
 {
@@ -486,18 +575,62 @@ clutter_text_ensure_effective_attributes (ClutterText *self)
     }
 }
 
-static PangoLayout *
-clutter_text_create_layout_no_cache (ClutterText       *text,
-				     gint               width,
-				     gint               height,
-				     PangoEllipsizeMode ellipsize)
+static PangoDirection
+clutter_text_resolve_direction (ClutterText *text,
+                                const gchar *contents,
+                                gsize        contents_len)
+{
+  ClutterTextPrivate *priv = text->priv;
+  PangoDirection pango_dir;
+
+  if (priv->password_char != 0)
+    pango_dir = PANGO_DIRECTION_NEUTRAL;
+  else
+    pango_dir = pango_find_base_dir (contents, contents_len);
+
+  if (pango_dir == PANGO_DIRECTION_NEUTRAL)
+    {
+      ClutterBackend *backend = clutter_get_default_backend ();
+      ClutterTextDirection text_dir;
+
+      if (clutter_actor_has_key_focus (CLUTTER_ACTOR (text)))
+        pango_dir = _clutter_backend_get_keymap_direction (backend);
+      else
+        {
+          text_dir = clutter_actor_get_text_direction (CLUTTER_ACTOR (text));
+
+          if (text_dir == CLUTTER_TEXT_DIRECTION_RTL)
+            pango_dir = PANGO_DIRECTION_RTL;
+          else
+            pango_dir = PANGO_DIRECTION_LTR;
+       }
+    }
+
+  return pango_dir;
+}
+
+/*
+ * clutter_text_setup_layout:
+ * @text: a #ClutterText
+ * @layout: a newly created #PangoLayout
+ * @width: the width of the layout
+ * @height: the height of the layout
+ * @ellipsize: the ellipsize mode of the layout
+ *
+ * Sets the contents and the parameters of @text on @layout; the
+ * base direction of the #PangoContext of @layout is changed as well.
+ */
+static void
+clutter_text_setup_layout (ClutterText        *text,
+                           PangoLayout        *layout,
+                           gint                width,
+                           gint                height,
+                           PangoEllipsizeMode  ellipsize)
 {
   ClutterTextPrivate *priv = text->priv;
-  PangoLayout *layout;
   gchar *contents;
   gsize contents_len;
 
-  layout = clutter_actor_create_pango_layout (CLUTTER_ACTOR (text), NULL);
   pango_layout_set_font_description (layout, priv->font_desc);
 
   contents = clutter_text_get_display_text (text);
@@ -512,7 +645,7 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
       if (priv->position == 0)
         cursor_index = 0;
       else
-        cursor_index = offset_to_bytes (contents, priv->position);
+        cursor_index = clutter_text_offset_to_bytes (text, contents, priv->position);
 
       g_string_insert (tmp, cursor_index, priv->preedit_str);
 
@@ -534,30 +667,9 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
     {
       PangoDirection pango_dir;
 
-      if (priv->password_char != 0)
-        pango_dir = PANGO_DIRECTION_NEUTRAL;
-      else
-        pango_dir = pango_find_base_dir (contents, contents_len);
-
-      if (pango_dir == PANGO_DIRECTION_NEUTRAL)
-        {
-          ClutterBackend *backend = clutter_get_default_backend ();
-          ClutterTextDirection text_dir;
-
-          if (clutter_actor_has_key_focus (CLUTTER_ACTOR (text)))
-            pango_dir = _clutter_backend_get_keymap_direction (backend);
-          else
-            {
-              text_dir = clutter_actor_get_text_direction (CLUTTER_ACTOR (text));
-
-              if (text_dir == CLUTTER_TEXT_DIRECTION_RTL)
-                pango_dir = PANGO_DIRECTION_RTL;
-              else
-                pango_dir = PANGO_DIRECTION_LTR;
-           }
-        }
+      pango_dir = clutter_text_resolve_direction (text, contents, contents_len);
 
-      pango_context_set_base_dir (clutter_actor_get_pango_context (CLUTTER_ACTOR (text)), pango_dir);
+      pango_context_set_base_dir (pango_layout_get_context (layout), pango_dir);
 
       priv->resolved_direction = pango_dir;
 
@@ -580,17 +692,329 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
   pango_layout_set_width (layout, width);
   pango_layout_set_height (layout, height);
 
+  CLUTTER_GLYPH_CACHE_RECORD (layout);
+
   g_free (contents);
+}
+
+static PangoLayout *
+clutter_text_create_layout_no_cache (ClutterText       *text,
+				     gint               width,
+				     gint               height,
+				     PangoEllipsizeMode ellipsize)
+{
+  PangoLayout *layout;
+
+  layout = clutter_actor_create_pango_layout (CLUTTER_ACTOR (text), NULL);
+  clutter_text_setup_layout (text, layout, width, height, ellipsize);
 
   return layout;
 }
 
+typedef struct _SharedLayoutKey         SharedLayoutKey;
+typedef struct _SharedLayout            SharedLayout;
+
+struct _SharedLayoutKey
+{
+  gchar *contents;
+  PangoFontDescription *font_desc;
+
+  gint width;
+  gint height;
+
+  guint base_dir         : 3;
+  guint ellipsize        : 3;
+  guint wrap_mode        : 3;
+  guint alignment        : 2;
+  guint justify          : 1;
+  guint single_line_mode : 1;
+
+  guint hash;
+};
+
+struct _SharedLayout
+{
+  SharedLayoutKey key;
+
+  PangoLayout *layout;
+
+  /* the link inside the LRU queue */
+  GList link;
+};
+
+/* SharedLayoutKey → SharedLayout */
+static GHashTable *shared_layouts = NULL;
+
+/* the most recently used layouts are at the head */
+static GQueue shared_layouts_lru = G_QUEUE_INIT;
+
+/* the shared layouts cannot use the PangoContext of the ClutterText
+ * that created them, as each actor changes the base direction of its
+ * own context; we keep a context for each direction instead
+ */
+static PangoContext *shared_contexts[2] = { NULL, NULL };
+
+static guint
+shared_layout_key_hash (gconstpointer data)
+{
+  const SharedLayoutKey *key = data;
+
+  return key->hash;
+}
+
+static gboolean
+shared_layout_key_equal (gconstpointer a,
+                         gconstpointer b)
+{
+  const SharedLayoutKey *key_a = a;
+  const SharedLayoutKey *key_b = b;
+
+  return key_a->hash == key_b->hash &&
+         key_a->width == key_b->width &&
+         key_a->height == key_b->height &&
+         key_a->base_dir == key_b->base_dir &&
+         key_a->ellipsize == key_b->ellipsize &&
+         key_a->wrap_mode == key_b->wrap_mode &&
+         key_a->alignment == key_b->alignment &&
+         key_a->justify == key_b->justify &&
+         key_a->single_line_mode == key_b->single_line_mode &&
+         strcmp (key_a->contents, key_b->contents) == 0 &&
+         pango_font_description_equal (key_a->font_desc, key_b->font_desc);
+}
+
 static void
-clutter_text_dirty_cache (ClutterText *text)
+shared_layout_free (gpointer data)
+{
+  SharedLayout *shared = data;
+
+  g_queue_unlink (&shared_layouts_lru, &shared->link);
+
+  g_free (shared->key.contents);
+  pango_font_description_free (shared->key.font_desc);
+  g_object_unref (shared->layout);
+
+  g_slice_free (SharedLayout, shared);
+}
+
+static void
+shared_layouts_clear (ClutterBackend *backend,
+                      gpointer        dummy G_GNUC_UNUSED)
+{
+  int i;
+
+  if (shared_layouts != NULL)
+    g_hash_table_remove_all (shared_layouts);
+
+  for (i = 0; i < G_N_ELEMENTS (shared_contexts); i++)
+    g_clear_object (&shared_contexts[i]);
+}
+
+/*
+ * clutter_text_get_shared_layout_key:
+ * @text: a #ClutterText
+ * @width: the width of the layout
+ * @height: the height of the layout
+ * @ellipsize: the ellipsize mode of the layout
+ * @key: (out caller-allocates): the key to initialize
+ *
+ * Initializes @key with the parameters of the layout that @text would
+ * create for the given size. The contents of @key should be freed with
+ * g_free().
+ *
+ * Return value: %TRUE if the layout of @text can be shared
+ */
+static gboolean
+clutter_text_get_shared_layout_key (ClutterText        *text,
+                                    gint                width,
+                                    gint                height,
+                                    PangoEllipsizeMode  ellipsize,
+                                    SharedLayoutKey    *key)
+{
+  ClutterTextPrivate *priv = text->priv;
+  gsize contents_len;
+
+  /* editable text has a cursor, a selection and a preedit string, so
+   * its layouts are not going to be shared; we also do not want to
+   * leak the length of passwords outside of the actor
+   */
+  if (priv->editable || priv->password_char != 0)
+    return FALSE;
+
+  clutter_text_ensure_effective_attributes (text);
+  if (priv->effective_attrs != NULL)
+    return FALSE;
+
+  if (clutter_text_buffer_get_bytes (get_buffer (text)) > SHARED_LAYOUT_MAX_BYTES)
+    return FALSE;
+
+  key->contents = clutter_text_get_display_text (text);
+  contents_len = strlen (key->contents);
+
+  key->font_desc = priv->font_desc;
+  key->width = width;
+  key->height = height;
+  key->base_dir = clutter_text_resolve_direction (text,
+                                                  key->contents,
+                                                  contents_len);
+  key->ellipsize = ellipsize;
+  key->wrap_mode = priv->wrap_mode;
+  key->alignment = priv->alignment;
+  key->justify = priv->justify;
+  key->single_line_mode = priv->single_line_mode;
+
+  key->hash = g_str_hash (key->contents)
+            ^ pango_font_description_hash (key->font_desc)
+            ^ (guint) (width * 31 + height);
+
+  /* keep the same side effect of clutter_text_create_layout_no_cache() */
+  priv->resolved_direction = key->base_dir;
+
+  return TRUE;
+}
+
+static PangoLayout *
+clutter_text_lookup_shared_layout (const SharedLayoutKey *key)
+{
+  SharedLayout *shared;
+
+  if (shared_layouts == NULL)
+    return NULL;
+
+  shared = g_hash_table_lookup (shared_layouts, key);
+  if (shared == NULL)
+    return NULL;
+
+  /* move the layout at the head of the LRU queue */
+  g_queue_unlink (&shared_layouts_lru, &shared->link);
+  g_queue_push_head_link (&shared_layouts_lru, &shared->link);
+
+  return shared->layout;
+}
+
+static PangoLayout *
+clutter_text_create_shared_layout (ClutterText     *text,
+                                   SharedLayoutKey *key)
+{
+  SharedLayout *shared;
+  PangoContext *context;
+  PangoLayout *layout;
+  int context_idx;
+
+  if (G_UNLIKELY (shared_layouts == NULL))
+    {
+      ClutterBackend *backend = clutter_get_default_backend ();
+
+      shared_layouts = g_hash_table_new_full (shared_layout_key_hash,
+                                              shared_layout_key_equal,
+                                              NULL,
+                                              shared_layout_free);
+
+      /* the contexts are configured using the backend settings */
+      g_signal_connect (backend, "settings-changed",
+                        G_CALLBACK (shared_layouts_clear), NULL);
+      g_signal_connect (backend, "font-changed",
+                        G_CALLBACK (shared_layouts_clear), NULL);
+      g_signal_connect (backend, "resolution-changed",
+                        G_CALLBACK (shared_layouts_clear), NULL);
+    }
+
+  context_idx = key->base_dir == PANGO_DIRECTION_RTL ? 1 : 0;
+  context = shared_contexts[context_idx];
+  if (context == NULL)
+    {
+      context = clutter_actor_create_pango_context (CLUTTER_ACTOR (text));
+      pango_context_set_base_dir (context, key->base_dir);
+
+      shared_contexts[context_idx] = context;
+    }
+
+  layout = pango_layout_new (context);
+  pango_layout_set_font_description (layout, key->font_desc);
+  pango_layout_set_text (layout, key->contents, -1);
+  pango_layout_set_alignment (layout, key->alignment);
+  pango_layout_set_single_paragraph_mode (layout, key->single_line_mode);
+  pango_layout_set_justify (layout, key->justify);
+  pango_layout_set_wrap (layout, key->wrap_mode);
+  pango_layout_set_ellipsize (layout, key->ellipsize);
+  pango_layout_set_width (layout, key->width);
+  pango_layout_set_height (layout, key->height);
+
+  CLUTTER_GLYPH_CACHE_RECORD (layout);
+
+  shared = g_slice_new0 (SharedLayout);
+  shared->key = *key;
+  shared->key.font_desc = pango_font_description_copy (key->font_desc);
+  shared->layout = g_object_ref (layout);
+  shared->link.data = shared;
+
+  /* the shared layout takes ownership of the contents */
+  key->contents = NULL;
+
+  g_hash_table_replace (shared_layouts, &shared->key, shared);
+  g_queue_push_head_link (&shared_layouts_lru, &shared->link);
+
+  while (shared_layouts_lru.length > N_SHARED_LAYOUTS)
+    {
+      SharedLayout *oldest = g_queue_peek_tail (&shared_layouts_lru);
+
+      g_hash_table_remove (shared_layouts, &oldest->key);
+    }
+
+  return layout;
+}
+
+/*
+ * clutter_text_get_shared_layout:
+ * @text: a #ClutterText
+ * @width: the width of the layout
+ * @height: the height of the layout
+ * @ellipsize: the ellipsize mode of the layout
+ *
+ * Retrieves a layout for @text from the cache shared by all the
+ * #ClutterText instances, creating it if needed. Shared layouts
+ * must not be modified.
+ *
+ * Return value: (transfer full): a #PangoLayout, or %NULL if the
+ *   layout of @text cannot be shared
+ */
+static PangoLayout *
+clutter_text_get_shared_layout (ClutterText        *text,
+                                gint                width,
+                                gint                height,
+                                PangoEllipsizeMode  ellipsize)
+{
+  SharedLayoutKey key;
+  PangoLayout *layout;
+
+  if (!clutter_text_get_shared_layout_key (text, width, height, ellipsize, &key))
+    return NULL;
+
+  layout = clutter_text_lookup_shared_layout (&key);
+  if (layout != NULL)
+    {
+      CLUTTER_NOTE (ACTOR, "ClutterText: %p: shared cache hit for '%s'",
+                    text,
+                    key.contents);
+
+      layout = g_object_ref (layout);
+    }
+  else
+    layout = clutter_text_create_shared_layout (text, &key);
+
+  g_free (key.contents);
+
+  return layout;
+}
+
+static void
+clutter_text_dirty_layouts (ClutterText *text)
 {
   ClutterTextPrivate *priv = text->priv;
   int i;
 
+  /* the pending layouts have been created with the old contents */
+  clutter_text_cancel_async_layout (text);
+
   /* Delete the cached layouts so they will be recreated the next time
      they are needed */
   for (i = 0; i < N_CACHED_LAYOUTS; i++)
@@ -603,6 +1027,13 @@ clutter_text_dirty_cache (ClutterText *text)
   clutter_text_dirty_paint_volume (text);
 }
 
+static void
+clutter_text_dirty_cache (ClutterText *text)
+{
+  clutter_text_clear_paragraphs (text);
+  clutter_text_dirty_layouts (text);
+}
+
 /*
  * clutter_text_set_font_description_internal:
  * @self: a #ClutterText
@@ -692,28 +1123,29 @@ clutter_text_direction_changed_cb (GObject    *gobject,
 }
 
 /*
- * clutter_text_create_layout:
+ * clutter_text_get_layout_params:
  * @text: a #ClutterText
  * @allocation_width: the allocation width
  * @allocation_height: the allocation height
+ * @width_p: (out): return location for the width of the layout
+ * @height_p: (out): return location for the height of the layout
+ * @ellipsize_p: (out): return location for the ellipsize mode
  *
- * Like clutter_text_create_layout_no_cache(), but will also ensure
- * the glyphs cache. If a previously cached layout generated using the
- * same width is available then that will be used instead of
- * generating a new one.
+ * Computes the parameters of the #PangoLayout that should be used
+ * for the given allocation size.
  */
-static PangoLayout *
-clutter_text_create_layout (ClutterText *text,
-                            gfloat       allocation_width,
-                            gfloat       allocation_height)
+static void
+clutter_text_get_layout_params (ClutterText        *text,
+                                gfloat              allocation_width,
+                                gfloat              allocation_height,
+                                gint               *width_p,
+                                gint               *height_p,
+                                PangoEllipsizeMode *ellipsize_p)
 {
   ClutterTextPrivate *priv = text->priv;
-  LayoutCache *oldest_cache = priv->cached_layouts;
-  gboolean found_free_cache = FALSE;
   gint width = -1;
   gint height = -1;
   PangoEllipsizeMode ellipsize = PANGO_ELLIPSIZE_NONE;
-  int i;
 
   /* First determine the width, height, and ellipsize mode that
    * we need for the layout. The ellipsize mode depends on
@@ -778,6 +1210,41 @@ clutter_text_create_layout (ClutterText *text,
       height = allocation_height * 1024 + 0.5f;
     }
 
+  *width_p = width;
+  *height_p = height;
+  *ellipsize_p = ellipsize;
+}
+
+/*
+ * clutter_text_lookup_layout:
+ * @text: a #ClutterText
+ * @allocation_width: the allocation width
+ * @allocation_height: the allocation height
+ * @width: the width of the layout
+ * @height: the height of the layout
+ * @ellipsize: the ellipsize mode of the layout
+ * @oldest_cache_p: (out): return location for the cache slot that
+ *   should be replaced if no layout was found
+ *
+ * Searches the layout cache for a layout that can be used for
+ * the given parameters.
+ *
+ * Return value: (transfer none): a cached #PangoLayout, or %NULL
+ */
+static PangoLayout *
+clutter_text_lookup_layout (ClutterText        *text,
+                            gfloat              allocation_width,
+                            gfloat              allocation_height,
+                            gint                width,
+                            gint                height,
+                            PangoEllipsizeMode  ellipsize,
+                            LayoutCache       **oldest_cache_p)
+{
+  ClutterTextPrivate *priv = text->priv;
+  LayoutCache *oldest_cache = priv->cached_layouts;
+  gboolean found_free_cache = FALSE;
+  int i;
+
   /* Search for a cached layout with the same width and keep
    * track of the oldest one
    */
@@ -852,31 +1319,1040 @@ clutter_text_create_layout (ClutterText *text,
         }
     }
 
-  CLUTTER_NOTE (ACTOR, "ClutterText: %p: cache miss for size %.2fx%.2f",
-		text,
-                allocation_width,
-                allocation_height);
+  if (oldest_cache_p != NULL)
+    *oldest_cache_p = oldest_cache;
 
-  /* If we make it here then we didn't have a cached version so we
-     need to recreate the layout */
-  if (oldest_cache->layout)
-    g_object_unref (oldest_cache->layout);
+  return NULL;
+}
+
+/*
+ * clutter_text_store_layout:
+ * @text: a #ClutterText
+ * @cache: the cache slot returned by clutter_text_lookup_layout()
+ * @layout: (transfer full): the #PangoLayout to store
+ *
+ * Replaces the contents of @cache with @layout, and ensures the
+ * glyphs cache for it.
+ */
+static PangoLayout *
+clutter_text_store_layout (ClutterText *text,
+                           LayoutCache *cache,
+                           PangoLayout *layout)
+{
+  ClutterTextPrivate *priv = text->priv;
 
-  oldest_cache->layout =
-    clutter_text_create_layout_no_cache (text, width, height, ellipsize);
+  if (cache->layout)
+    g_object_unref (cache->layout);
 
-  cogl_pango_ensure_glyph_cache_for_layout (oldest_cache->layout);
+  cache->layout = layout;
+
+  cogl_pango_ensure_glyph_cache_for_layout (cache->layout);
 
   /* Mark the 'time' this cache was created and advance the time */
-  oldest_cache->age = priv->cache_age++;
-  return oldest_cache->layout;
+  cache->age = priv->cache_age++;
+  return cache->layout;
 }
 
-/**
- * clutter_text_coords_to_position:
- * @self: a #ClutterText
- * @x: the X coordinate, relative to the actor
- * @y: the Y coordinate, relative to the actor
+/*
+ * clutter_text_create_layout:
+ * @text: a #ClutterText
+ * @allocation_width: the allocation width
+ * @allocation_height: the allocation height
+ *
+ * Like clutter_text_create_layout_no_cache(), but will also ensure
+ * the glyphs cache. If a previously cached layout generated using the
+ * same width is available then that will be used instead of
+ * generating a new one.
+ */
+static PangoLayout *
+clutter_text_create_layout (ClutterText *text,
+                            gfloat       allocation_width,
+                            gfloat       allocation_height)
+{
+  LayoutCache *oldest_cache;
+  PangoLayout *layout;
+  PangoEllipsizeMode ellipsize;
+  gint width, height;
+
+  clutter_text_get_layout_params (text, allocation_width, allocation_height,
+                                  &width, &height, &ellipsize);
+
+  layout = clutter_text_lookup_layout (text,
+                                       allocation_width,
+                                       allocation_height,
+                                       width, height, ellipsize,
+                                       &oldest_cache);
+  if (layout != NULL)
+    return layout;
+
+  CLUTTER_NOTE (ACTOR, "ClutterText: %p: cache miss for size %.2fx%.2f",
+		text,
+                allocation_width,
+                allocation_height);
+
+  /* If we make it here then we didn't have a cached version so we
+     need to recreate the layout, unless another actor already did */
+  layout = clutter_text_get_shared_layout (text, width, height, ellipsize);
+  if (layout == NULL)
+    layout = clutter_text_create_layout_no_cache (text, width, height, ellipsize);
+
+  return clutter_text_store_layout (text, oldest_cache, layout);
+}
+
+static void
+paragraph_clear (gpointer data)
+{
+  Paragraph *paragraph = data;
+  gint i;
+
+  for (i = 0; i < N_PARAGRAPH_WIDTHS; i++)
+    g_clear_object (&paragraph->layouts[i]);
+}
+
+static void
+clutter_text_clear_paragraphs (ClutterText *self)
+{
+  ClutterTextPrivate *priv = self->priv;
+
+  if (priv->paragraphs == NULL)
+    return;
+
+  g_array_unref (priv->paragraphs);
+  priv->paragraphs = NULL;
+  priv->paragraphs_chars = 0;
+}
+
+/*
+ * clutter_text_use_paragraphs:
+ * @self: a #ClutterText
+ *
+ * Checks whether @self should lay out its contents one paragraph at a
+ * time instead of using a single #PangoLayout.
+ *
+ * Laying out each paragraph on its own is only equivalent to a single
+ * layout for wrapped, multi-line text without attributes, ellipsization
+ * or pre-edit strings; the line alignment is also only consistent when
+ * every paragraph is laid out at the same width, which is the case when
+ * wrapping.
+ */
+static gboolean
+clutter_text_use_paragraphs (ClutterText *self)
+{
+  ClutterTextPrivate *priv = self->priv;
+
+  if (priv->single_line_mode || !priv->wrap)
+    return FALSE;
+
+  if (priv->use_markup || priv->attrs != NULL)
+    return FALSE;
+
+  if (priv->ellipsize != PANGO_ELLIPSIZE_NONE ||
+      priv->password_char != 0 ||
+      priv->preedit_set ||
+      priv->async_layout)
+    return FALSE;
+
+  if (priv->buffer == NULL ||
+      clutter_text_buffer_get_bytes (priv->buffer) < PARAGRAPH_LAYOUT_MIN_BYTES)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* splits @n_bytes of @text into paragraphs, and appends them to
+ * @paragraphs; unless @at_end is set, @text must end with a paragraph
+ * delimiter
+ */
+static void
+clutter_text_split_paragraphs (const gchar *text,
+                               gsize        n_bytes,
+                               gboolean     at_end,
+                               GArray      *paragraphs)
+{
+  const gchar *end = text + n_bytes;
+
+  while (TRUE)
+    {
+      Paragraph paragraph = { 0, };
+      const gchar *newline;
+
+      newline = memchr (text, '\n', end - text);
+      if (newline == NULL)
+        {
+          if (at_end)
+            {
+              paragraph.n_bytes = end - text;
+              paragraph.n_chars = g_utf8_strlen (text, paragraph.n_bytes);
+              g_array_append_val (paragraphs, paragraph);
+            }
+
+          break;
+        }
+
+      /* "\r\n" is a single delimiter for Pango */
+      if (newline > text && newline[-1] == '\r')
+        paragraph.delimiter = 2;
+      else
+        paragraph.delimiter = 1;
+
+      paragraph.n_bytes = newline + 1 - text - paragraph.delimiter;
+      paragraph.n_chars = g_utf8_strlen (text, paragraph.n_bytes);
+      g_array_append_val (paragraphs, paragraph);
+
+      text = newline + 1;
+    }
+}
+
+/*
+ * clutter_text_update_paragraphs:
+ * @self: a #ClutterText
+ * @position: the position of the change, in characters
+ * @n_removed: the number of characters removed at @position
+ * @n_inserted: the number of characters inserted at @position
+ *
+ * Splits again the paragraphs touched by a change in the buffer,
+ * discarding their layouts, and keeps the layouts of all the other
+ * paragraphs.
+ */
+static void
+clutter_text_update_paragraphs (ClutterText *self,
+                                guint        position,
+                                guint        n_removed,
+                                guint        n_inserted)
+{
+  ClutterTextPrivate *priv = self->priv;
+  ClutterTextBuffer *buffer = get_buffer (self);
+  const gchar *text, *region_end;
+  guint first, last, start, end;
+  guint length, region_chars;
+  gsize offset;
+  GArray *changed;
+
+  if (priv->paragraphs == NULL)
+    return;
+
+  if (!clutter_text_use_paragraphs (self))
+    {
+      clutter_text_clear_paragraphs (self);
+      return;
+    }
+
+  /* the paragraphs might have been split again after the contents
+   * of the buffer changed, but before we were notified of the change
+   */
+  length = clutter_text_buffer_get_length (buffer);
+  if (priv->paragraphs_chars + n_inserted - n_removed != length)
+    {
+      clutter_text_clear_paragraphs (self);
+      return;
+    }
+
+  /* find the paragraph containing @position, and the one containing
+   * the first character after the removed range, in the old contents
+   */
+  for (first = 0, start = 0, offset = 0;
+       first < priv->paragraphs->len - 1;
+       first++)
+    {
+      Paragraph *paragraph = &g_array_index (priv->paragraphs, Paragraph, first);
+
+      if (position < start + paragraph->n_chars + paragraph->delimiter)
+        break;
+
+      start += paragraph->n_chars + paragraph->delimiter;
+      offset += paragraph->n_bytes + paragraph->delimiter;
+    }
+
+  for (last = first, end = start; ; last++)
+    {
+      Paragraph *paragraph = &g_array_index (priv->paragraphs, Paragraph, last);
+
+      end += paragraph->n_chars + paragraph->delimiter;
+
+      if (position + n_removed < end || last == priv->paragraphs->len - 1)
+        break;
+    }
+
+  /* the touched paragraphs always end with a delimiter, unless they
+   * include the last one
+   */
+  region_chars = end - start - n_removed + n_inserted;
+
+  text = clutter_text_buffer_get_text (buffer);
+  region_end = g_utf8_offset_to_pointer (text + offset, region_chars);
+
+  changed = g_array_new (FALSE, FALSE, sizeof (Paragraph));
+  clutter_text_split_paragraphs (text + offset, region_end - (text + offset),
+                                 last == priv->paragraphs->len - 1,
+                                 changed);
+
+  g_array_remove_range (priv->paragraphs, first, last - first + 1);
+  g_array_insert_vals (priv->paragraphs, first, changed->data, changed->len);
+  g_array_unref (changed);
+
+  priv->paragraphs_chars = length;
+}
+
+/*
+ * clutter_text_ensure_paragraphs:
+ * @self: a #ClutterText
+ * @width: the width of the layouts, in Pango units, or -1
+ *
+ * Ensures that every paragraph of @self has a layout for the given
+ * @width, only creating the ones that are missing.
+ *
+ * Return value: the index of the layouts for @width inside the
+ *   #Paragraph structures
+ */
+static gint
+clutter_text_ensure_paragraphs (ClutterText *self,
+                                gint         width)
+{
+  ClutterTextPrivate *priv = self->priv;
+  ClutterTextBuffer *buffer = get_buffer (self);
+  PangoContext *context;
+  PangoDirection pango_dir;
+  const gchar *text;
+  gsize n_bytes, offset;
+  gint i, slot;
+
+  text = clutter_text_buffer_get_text (buffer);
+  n_bytes = clutter_text_buffer_get_bytes (buffer);
+
+  if (priv->paragraphs == NULL ||
+      priv->paragraphs_chars != clutter_text_buffer_get_length (buffer))
+    {
+      clutter_text_clear_paragraphs (self);
+
+      priv->paragraphs = g_array_new (FALSE, FALSE, sizeof (Paragraph));
+      g_array_set_clear_func (priv->paragraphs, paragraph_clear);
+
+      clutter_text_split_paragraphs (text, n_bytes, TRUE, priv->paragraphs);
+      priv->paragraphs_chars = clutter_text_buffer_get_length (buffer);
+    }
+
+  for (slot = 0; slot < N_PARAGRAPH_WIDTHS; slot++)
+    if (priv->paragraph_widths[slot] == width)
+      break;
+
+  /* replace the layouts for the least recently used width */
+  if (slot == N_PARAGRAPH_WIDTHS)
+    {
+      slot = 0;
+      for (i = 1; i < N_PARAGRAPH_WIDTHS; i++)
+        if (priv->paragraph_ages[i] < priv->paragraph_ages[slot])
+          slot = i;
+
+      for (i = 0; i < priv->paragraphs->len; i++)
+        g_clear_object (&g_array_index (priv->paragraphs, Paragraph, i).layouts[slot]);
+
+      priv->paragraph_widths[slot] = width;
+    }
+
+  priv->paragraph_ages[slot] = priv->cache_age++;
+
+  /* all the paragraphs share the base direction of the whole text,
+   * like they would inside a single layout
+   */
+  context = clutter_actor_get_pango_context (CLUTTER_ACTOR (self));
+  pango_dir = clutter_text_resolve_direction (self, text, n_bytes);
+  pango_context_set_base_dir (context, pango_dir);
+  priv->resolved_direction = pango_dir;
+
+  for (i = 0, offset = 0; i < priv->paragraphs->len; i++)
+    {
+      Paragraph *paragraph = &g_array_index (priv->paragraphs, Paragraph, i);
+
+      if (paragraph->layouts[slot] == NULL)
+        {
+          PangoLayout *layout = pango_layout_new (context);
+
+          pango_layout_set_font_description (layout, priv->font_desc);
+          pango_layout_set_text (layout, text + offset, paragraph->n_bytes);
+          pango_layout_set_alignment (layout, priv->alignment);
+          pango_layout_set_justify (layout, priv->justify);
+          pango_layout_set_wrap (layout, priv->wrap_mode);
+          pango_layout_set_width (layout, width);
+
+          CLUTTER_GLYPH_CACHE_RECORD (layout);
+
+          pango_layout_get_extents (layout, NULL, &paragraph->logical_rects[slot]);
+          paragraph->layouts[slot] = layout;
+        }
+
+      offset += paragraph->n_bytes + paragraph->delimiter;
+    }
+
+  return slot;
+}
+
+/* like clutter_text_create_layout(), but for the paragraphs of @self */
+static gint
+clutter_text_ensure_paragraphs_for_size (ClutterText *self,
+                                         gfloat       allocation_width,
+                                         gfloat       allocation_height)
+{
+  PangoEllipsizeMode ellipsize;
+  gint width, height;
+
+  clutter_text_get_layout_params (self, allocation_width, allocation_height,
+                                  &width, &height, &ellipsize);
+
+  return clutter_text_ensure_paragraphs (self, width);
+}
+
+/* like clutter_text_get_layout(), but for the paragraphs of @self */
+static gint
+clutter_text_get_paragraphs_slot (ClutterText *self)
+{
+  gfloat width, height;
+
+  clutter_actor_get_size (CLUTTER_ACTOR (self), &width, &height);
+
+  return clutter_text_ensure_paragraphs_for_size (self, width, height);
+}
+
+/*
+ * clutter_text_get_paragraphs_extents:
+ * @self: a #ClutterText
+ * @slot: the index of the layouts to use
+ * @ink_rect: (out) (allow-none): return location for the ink extents
+ * @logical_rect: (out) (allow-none): return location for the logical extents
+ *
+ * Computes the extents of the paragraphs of @self stacked vertically,
+ * like pango_layout_get_extents() does for a single layout.
+ */
+static void
+clutter_text_get_paragraphs_extents (ClutterText    *self,
+                                     gint            slot,
+                                     PangoRectangle *ink_rect,
+                                     PangoRectangle *logical_rect)
+{
+  ClutterTextPrivate *priv = self->priv;
+  gint logical_x1 = G_MAXINT, logical_x2 = G_MININT;
+  gint ink_x1 = G_MAXINT, ink_y1 = G_MAXINT;
+  gint ink_x2 = G_MININT, ink_y2 = G_MININT;
+  gint i, y;
+
+  for (i = 0, y = 0; i < priv->paragraphs->len; i++)
+    {
+      Paragraph *paragraph = &g_array_index (priv->paragraphs, Paragraph, i);
+      const PangoRectangle *rect = &paragraph->logical_rects[slot];
+
+      if (ink_rect != NULL)
+        {
+          PangoRectangle ink;
+
+          pango_layout_get_extents (paragraph->layouts[slot], &ink, NULL);
+
+          if (ink.width > 0 && ink.height > 0)
+            {
+              ink_x1 = MIN (ink_x1, ink.x);
+              ink_y1 = MIN (ink_y1, y + ink.y);
+              ink_x2 = MAX (ink_x2, ink.x + ink.width);
+              ink_y2 = MAX (ink_y2, y + ink.y + ink.height);
+            }
+        }
+
+      logical_x1 = MIN (logical_x1, rect->x);
+      logical_x2 = MAX (logical_x2, rect->x + rect->width);
+
+      y += rect->y + rect->height;
+    }
+
+  if (ink_rect != NULL)
+    {
+      if (ink_x1 < ink_x2 && ink_y1 < ink_y2)
+        {
+          ink_rect->x = ink_x1;
+          ink_rect->y = ink_y1;
+          ink_rect->width = ink_x2 - ink_x1;
+          ink_rect->height = ink_y2 - ink_y1;
+        }
+      else
+        ink_rect->x = ink_rect->y = ink_rect->width = ink_rect->height = 0;
+    }
+
+  if (logical_rect != NULL)
+    {
+      logical_rect->x = logical_x1;
+      logical_rect->y = 0;
+      logical_rect->width = logical_x2 - logical_x1;
+      logical_rect->height = y;
+    }
+}
+
+/*
+ * clutter_text_find_paragraph:
+ * @self: a #ClutterText
+ * @slot: the index of the layouts to use
+ * @position: a position in characters, or -1 for the end of the text
+ * @index_: (out): return location for the byte index of @position
+ *   inside the paragraph
+ * @offset_p: (out): return location for the byte offset of the paragraph
+ * @y_p: (out): return location for the Y coordinate of the paragraph,
+ *   in Pango units
+ *
+ * Finds the paragraph containing @position.
+ *
+ * Return value: (transfer none): the paragraph
+ */
+static Paragraph *
+clutter_text_find_paragraph (ClutterText *self,
+                             gint         slot,
+                             gint         position,
+                             gint        *index_,
+                             gsize       *offset_p,
+                             gint        *y_p)
+{
+  ClutterTextPrivate *priv = self->priv;
+  Paragraph *paragraph = NULL;
+  const gchar *text;
+  gsize offset;
+  guint i, start;
+  gint y;
+
+  if (position < 0)
+    position = priv->paragraphs_chars;
+
+  for (i = 0, start = 0, offset = 0, y = 0; i < priv->paragraphs->len; i++)
+    {
+      paragraph = &g_array_index (priv->paragraphs, Paragraph, i);
+
+      if (position <= start + paragraph->n_chars ||
+          i == priv->paragraphs->len - 1)
+        break;
+
+      /* a position inside a "\r\n" delimiter falls at the end of
+       * the paragraph
+       */
+      if (position < start + paragraph->n_chars + paragraph->delimiter)
+        {
+          position = start + paragraph->n_chars;
+          break;
+        }
+
+      start += paragraph->n_chars + paragraph->delimiter;
+      offset += paragraph->n_bytes + paragraph->delimiter;
+      y += paragraph->logical_rects[slot].y + paragraph->logical_rects[slot].height;
+    }
+
+  text = clutter_text_buffer_get_text (get_buffer (self)) + offset;
+  *index_ = g_utf8_offset_to_pointer (text, MIN (position - start, paragraph->n_chars)) - text;
+  *offset_p = offset;
+  *y_p = y;
+
+  return paragraph;
+}
+
+typedef struct _TextMeasureBatch        TextMeasureBatch;
+typedef struct _TextMeasureJob          TextMeasureJob;
+
+struct _TextMeasureBatch
+{
+  GMutex lock;
+  GCond cond;
+
+  guint n_pending;
+};
+
+struct _TextMeasureJob
+{
+  TextMeasureBatch *batch;
+
+  ClutterText *text;
+  PangoLayout *layout;
+};
+
+static GThreadPool *measure_thread_pool = NULL;
+
+/* Pango only guarantees that a font map can be shared by layouts
+ * living in different threads since 1.32.6; each #ClutterActor owns
+ * its own #PangoContext, so the layouts of two different #ClutterText
+ * instances do not share any other state
+ */
+static gboolean
+clutter_text_can_measure_in_threads (void)
+{
+  return g_get_num_processors () > 1 &&
+         pango_version () >= PANGO_VERSION_ENCODE (1, 32, 6);
+}
+
+static void
+clutter_text_measure_thread (gpointer data,
+                             gpointer user_data)
+{
+  TextMeasureJob *job = data;
+  TextMeasureBatch *batch = job->batch;
+  PangoRectangle logical_rect;
+
+  /* the layout is shaped lazily the first time we query its extents,
+   * and Pango keeps the lines around for later queries
+   */
+  pango_layout_get_extents (job->layout, NULL, &logical_rect);
+
+  g_mutex_lock (&batch->lock);
+
+  batch->n_pending -= 1;
+  if (batch->n_pending == 0)
+    g_cond_signal (&batch->cond);
+
+  g_mutex_unlock (&batch->lock);
+}
+
+static void
+clutter_text_collect_measure_jobs (ClutterActor     *actor,
+                                   TextMeasureBatch *batch,
+                                   GPtrArray        *jobs)
+{
+  ClutterActorIter iter;
+  ClutterActor *child;
+
+  if (!clutter_actor_is_visible (actor))
+    return;
+
+  /* the paragraphs are laid out separately */
+  if (CLUTTER_IS_TEXT (actor) &&
+      !clutter_text_use_paragraphs (CLUTTER_TEXT (actor)))
+    {
+      ClutterText *text = CLUTTER_TEXT (actor);
+      LayoutCache *oldest_cache;
+      PangoEllipsizeMode ellipsize;
+      gint width, height;
+
+      /* we only measure the unconstrained layout, which is the one
+       * used to compute the preferred width
+       */
+      clutter_text_get_layout_params (text, -1, -1,
+                                      &width, &height, &ellipsize);
+
+      if (clutter_text_lookup_layout (text, -1, -1,
+                                      width, height, ellipsize,
+                                      &oldest_cache) == NULL)
+        {
+          PangoLayout *layout = NULL;
+          SharedLayoutKey key;
+
+          if (clutter_text_get_shared_layout_key (text, width, height,
+                                                  ellipsize,
+                                                  &key))
+            {
+              layout = clutter_text_lookup_shared_layout (&key);
+              g_free (key.contents);
+            }
+
+          /* another actor already shaped the same text */
+          if (layout != NULL)
+            clutter_text_store_layout (text, oldest_cache, g_object_ref (layout));
+          else
+            {
+              TextMeasureJob *job = g_slice_new (TextMeasureJob);
+
+              job->batch = batch;
+              job->text = text;
+              job->layout = clutter_text_create_layout_no_cache (text,
+                                                                 width, height,
+                                                                 ellipsize);
+
+              g_ptr_array_add (jobs, job);
+            }
+        }
+    }
+
+  clutter_actor_iter_init (&iter, actor);
+  while (clutter_actor_iter_next (&iter, &child))
+    clutter_text_collect_measure_jobs (child, batch, jobs);
+}
+
+/*< private >
+ * _clutter_text_measure_subtrees:
+ * @container: a #ClutterActor
+ *
+ * Shapes the #ClutterText actors inside the sub-trees of the
+ * children of @container using a pool of worker threads, and
+ * stores the results inside the layout cache of each #ClutterText,
+ * so that the size negotiation of @container will not need to
+ * shape them again on the main thread.
+ *
+ * The caller must guarantee that the children of @container are
+ * independent, i.e. that measuring one child does not affect the
+ * others. This function blocks until all the layouts are ready.
+ */
+void
+_clutter_text_measure_subtrees (ClutterActor *container)
+{
+  TextMeasureBatch batch;
+  ClutterActorIter iter;
+  ClutterActor *child;
+  GPtrArray *jobs;
+  guint i;
+
+  if (!clutter_text_can_measure_in_threads ())
+    return;
+
+  jobs = g_ptr_array_new ();
+
+  clutter_actor_iter_init (&iter, container);
+  while (clutter_actor_iter_next (&iter, &child))
+    clutter_text_collect_measure_jobs (child, &batch, jobs);
+
+  /* not worth the synchronization */
+  if (jobs->len < 2)
+    goto out;
+
+  CLUTTER_NOTE (LAYOUT, "Measuring %u text actors inside '%s' in parallel",
+                jobs->len,
+                _clutter_actor_get_debug_name (container));
+
+  if (G_UNLIKELY (measure_thread_pool == NULL))
+    {
+      /* This apparently can't fail if exclusive == FALSE */
+      measure_thread_pool =
+        g_thread_pool_new (clutter_text_measure_thread, NULL,
+                           g_get_num_processors (),
+                           FALSE,
+                           NULL);
+    }
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+  batch.n_pending = jobs->len;
+
+  for (i = 0; i < jobs->len; i++)
+    g_thread_pool_push (measure_thread_pool, g_ptr_array_index (jobs, i), NULL);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.n_pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_mutex_clear (&batch.lock);
+  g_cond_clear (&batch.cond);
+
+out:
+  for (i = 0; i < jobs->len; i++)
+    {
+      TextMeasureJob *job = g_ptr_array_index (jobs, i);
+      LayoutCache *oldest_cache;
+      PangoEllipsizeMode ellipsize;
+      gint width, height;
+
+      /* the layout is stored even when it was not shaped in a
+       * thread, since we already paid for creating it
+       */
+      clutter_text_get_layout_params (job->text, -1, -1,
+                                      &width, &height, &ellipsize);
+      clutter_text_lookup_layout (job->text, -1, -1,
+                                  width, height, ellipsize,
+                                  &oldest_cache);
+      clutter_text_store_layout (job->text, oldest_cache, job->layout);
+
+      g_slice_free (TextMeasureJob, job);
+    }
+
+  g_ptr_array_unref (jobs);
+}
+
+struct _AsyncLayout
+{
+  /* the ClutterText that requested the layouts, or NULL if the
+   * request was cancelled; only accessed from the main thread
+   */
+  ClutterText *text;
+
+  /* the worker thread has exclusive access to the context and to
+   * the layouts until the request has been completed
+   */
+  PangoContext *context;
+  PangoLayout *layouts[3];
+  guint n_layouts;
+};
+
+static GThreadPool *async_layout_thread_pool = NULL;
+
+static void
+async_layout_free (AsyncLayout *async)
+{
+  guint i;
+
+  for (i = 0; i < async->n_layouts; i++)
+    g_object_unref (async->layouts[i]);
+
+  g_object_unref (async->context);
+
+  g_slice_free (AsyncLayout, async);
+}
+
+static gboolean
+clutter_text_async_layout_done (gpointer data)
+{
+  AsyncLayout *async = data;
+  ClutterText *text = async->text;
+  guint i;
+
+  if (text == NULL)
+    {
+      CLUTTER_NOTE (ACTOR, "ClutterText: async layout cancelled");
+      goto out;
+    }
+
+  text->priv->async_layout_data = NULL;
+
+  for (i = 0; i < async->n_layouts; i++)
+    {
+      PangoLayout *layout = async->layouts[i];
+      LayoutCache *oldest_cache;
+
+      /* passing a non-negative allocation size only matches layouts
+       * with the same parameters
+       */
+      if (clutter_text_lookup_layout (text, 0, 0,
+                                      pango_layout_get_width (layout),
+                                      pango_layout_get_height (layout),
+                                      pango_layout_get_ellipsize (layout),
+                                      &oldest_cache) != NULL)
+        continue;
+
+      clutter_text_store_layout (text, oldest_cache, g_object_ref (layout));
+    }
+
+  CLUTTER_NOTE (ACTOR, "ClutterText: %p: async layout done", text);
+
+  clutter_text_dirty_paint_volume (text);
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (text));
+
+out:
+  async_layout_free (async);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+clutter_text_async_layout_thread (gpointer data,
+                                  gpointer user_data)
+{
+  AsyncLayout *async = data;
+  guint i;
+
+  for (i = 0; i < async->n_layouts; i++)
+    {
+      PangoRectangle logical_rect;
+
+      pango_layout_get_extents (async->layouts[i], NULL, &logical_rect);
+    }
+
+  clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                 clutter_text_async_layout_done,
+                                 async,
+                                 NULL);
+}
+
+static void
+clutter_text_cancel_async_layout (ClutterText *self)
+{
+  ClutterTextPrivate *priv = self->priv;
+
+  if (priv->async_layout_data == NULL)
+    return;
+
+  /* the worker thread cannot be interrupted, so we just detach the
+   * request; the results will be discarded once it's done
+   */
+  priv->async_layout_data->text = NULL;
+  priv->async_layout_data = NULL;
+}
+
+static void
+clutter_text_add_async_layout (ClutterText *self,
+                               AsyncLayout *async,
+                               gfloat       allocation_width,
+                               gfloat       allocation_height)
+{
+  PangoEllipsizeMode ellipsize;
+  gint width, height;
+  guint i;
+
+  clutter_text_get_layout_params (self, allocation_width, allocation_height,
+                                  &width, &height, &ellipsize);
+
+  for (i = 0; i < async->n_layouts; i++)
+    {
+      PangoLayout *layout = async->layouts[i];
+
+      if (pango_layout_get_width (layout) == width &&
+          pango_layout_get_height (layout) == height &&
+          pango_layout_get_ellipsize (layout) == ellipsize)
+        return;
+    }
+
+  g_assert (async->n_layouts < G_N_ELEMENTS (async->layouts));
+
+  async->layouts[async->n_layouts] = pango_layout_new (async->context);
+  clutter_text_setup_layout (self, async->layouts[async->n_layouts],
+                             width, height,
+                             ellipsize);
+
+  async->n_layouts += 1;
+}
+
+/*
+ * clutter_text_defer_layout:
+ * @self: a #ClutterText
+ * @allocation_width: the allocation width
+ * @allocation_height: the allocation height
+ *
+ * Checks whether the layout of @self for the given size should be
+ * created asynchronously, and queues its creation if needed.
+ *
+ * Besides the requested layout, the request also includes the layout
+ * used by the width request and the one used by the height request
+ * for @allocation_width, as the next relayout is going to need them.
+ *
+ * Return value: %TRUE if the layout is not available yet, and the
+ *   caller should use an estimate of the size of @self instead
+ */
+static gboolean
+clutter_text_defer_layout (ClutterText *self,
+                           gfloat       allocation_width,
+                           gfloat       allocation_height)
+{
+  ClutterTextPrivate *priv = self->priv;
+  PangoEllipsizeMode ellipsize;
+  AsyncLayout *async;
+  gint width, height;
+
+  if (!priv->async_layout || priv->editable)
+    return FALSE;
+
+  if (clutter_text_buffer_get_bytes (get_buffer (self)) < ASYNC_LAYOUT_MIN_BYTES)
+    return FALSE;
+
+  if (!clutter_text_can_measure_in_threads ())
+    return FALSE;
+
+  clutter_text_get_layout_params (self, allocation_width, allocation_height,
+                                  &width, &height, &ellipsize);
+  if (clutter_text_lookup_layout (self, allocation_width, allocation_height,
+                                  width, height, ellipsize,
+                                  NULL) != NULL)
+    return FALSE;
+
+  /* a relayout will be queued once the pending request is done, and
+   * we will get here again if it did not include this layout
+   */
+  if (priv->async_layout_data != NULL)
+    return TRUE;
+
+  CLUTTER_NOTE (ACTOR, "ClutterText: %p: async layout for size %.2fx%.2f",
+                self,
+                allocation_width,
+                allocation_height);
+
+  async = g_slice_new0 (AsyncLayout);
+  async->text = self;
+  async->context = clutter_actor_create_pango_context (CLUTTER_ACTOR (self));
+
+  clutter_text_add_async_layout (self, async, -1, -1);
+  if (allocation_width >= 0)
+    clutter_text_add_async_layout (self, async, allocation_width, -1);
+  clutter_text_add_async_layout (self, async, allocation_width, allocation_height);
+
+  priv->async_layout_data = async;
+
+  if (G_UNLIKELY (async_layout_thread_pool == NULL))
+    {
+      /* This apparently can't fail if exclusive == FALSE */
+      async_layout_thread_pool =
+        g_thread_pool_new (clutter_text_async_layout_thread, NULL,
+                           1,
+                           FALSE,
+                           NULL);
+    }
+
+  g_thread_pool_push (async_layout_thread_pool, async, NULL);
+
+  return TRUE;
+}
+
+/*
+ * clutter_text_estimate_size:
+ * @self: a #ClutterText
+ * @for_width: the width used to wrap the text, or -1
+ * @width_p: (out): return location for the width of the longest line
+ * @height_p: (out): return location for the height of the text
+ *
+ * Estimates the size of the text of @self using the metrics of its
+ * font, while the layout is being created asynchronously.
+ */
+static void
+clutter_text_estimate_size (ClutterText *self,
+                            gfloat       for_width,
+                            gfloat      *width_p,
+                            gfloat      *height_p)
+{
+  ClutterTextPrivate *priv = self->priv;
+  PangoFontMetrics *metrics;
+  const gchar *text, *p;
+  gfloat char_width, line_height;
+  guint n_chars, max_chars, n_lines;
+
+  metrics = pango_context_get_metrics (clutter_actor_get_pango_context (CLUTTER_ACTOR (self)),
+                                       priv->font_desc,
+                                       NULL);
+
+  char_width = pango_font_metrics_get_approximate_char_width (metrics)
+             / (gfloat) PANGO_SCALE;
+  line_height = (pango_font_metrics_get_ascent (metrics)
+              +  pango_font_metrics_get_descent (metrics))
+              / (gfloat) PANGO_SCALE;
+
+  pango_font_metrics_unref (metrics);
+
+  if (!priv->wrap || char_width <= 0)
+    for_width = -1;
+
+  text = clutter_text_buffer_get_text (get_buffer (self));
+  n_chars = max_chars = n_lines = 0;
+
+  for (p = text; ; p++)
+    {
+      if (*p == '\0' || (*p == '\n' && !priv->single_line_mode))
+        {
+          if (for_width > 0)
+            n_lines += MAX (1, (guint) ceilf (n_chars * char_width / for_width));
+          else
+            n_lines += 1;
+
+          max_chars = MAX (max_chars, n_chars);
+          n_chars = 0;
+
+          if (*p == '\0')
+            break;
+        }
+      else if ((*p & 0xc0) != 0x80)
+        {
+          /* only count the first byte of each UTF-8 sequence */
+          n_chars += 1;
+        }
+    }
+
+  if (width_p != NULL)
+    {
+      *width_p = ceilf (max_chars * char_width);
+
+      if (for_width > 0)
+        *width_p = MIN (*width_p, for_width);
+    }
+
+  if (height_p != NULL)
+    *height_p = ceilf (n_lines * line_height);
+}
+
+/**
+ * clutter_text_coords_to_position:
+ * @self: a #ClutterText
+ * @x: the X coordinate, relative to the actor
+ * @y: the Y coordinate, relative to the actor
  *
  * Retrieves the position of the character at the given coordinates.
  *
@@ -901,6 +2377,37 @@ clutter_text_coords_to_position (ClutterText *self,
   px = (x - self->priv->text_x) * PANGO_SCALE;
   py = (y - self->priv->text_y) * PANGO_SCALE;
 
+  if (clutter_text_use_paragraphs (self))
+    {
+      ClutterTextPrivate *priv = self->priv;
+      gint slot = clutter_text_get_paragraphs_slot (self);
+      Paragraph *paragraph = NULL;
+      gsize offset;
+      guint i;
+
+      /* find the paragraph at @y, and pick inside its own layout */
+      for (i = 0, offset = 0; i < priv->paragraphs->len; i++)
+        {
+          gint height;
+
+          paragraph = &g_array_index (priv->paragraphs, Paragraph, i);
+          height = paragraph->logical_rects[slot].y
+                 + paragraph->logical_rects[slot].height;
+
+          if (py < height || i == priv->paragraphs->len - 1)
+            break;
+
+          py -= height;
+          offset += paragraph->n_bytes + paragraph->delimiter;
+        }
+
+      pango_layout_xy_to_index (paragraph->layouts[slot],
+                                px, py,
+                                &index_, &trailing);
+
+      return offset + index_ + trailing;
+    }
+
   pango_layout_xy_to_index (clutter_text_get_layout (self),
                             px, py,
                             &index_, &trailing);
@@ -947,49 +2454,67 @@ clutter_text_position_to_coords (ClutterText *self,
   if (position < -1 || position > n_chars)
     return FALSE;
 
-  if (priv->password_char != 0)
-    password_char_bytes = g_unichar_to_utf8 (priv->password_char, NULL);
-
-  if (position == -1)
+  if (clutter_text_use_paragraphs (self))
+    {
+      gint slot = clutter_text_get_paragraphs_slot (self);
+      Paragraph *paragraph;
+      gsize offset;
+      gint y_offset;
+
+      paragraph = clutter_text_find_paragraph (self, slot, position,
+                                               &index_,
+                                               &offset,
+                                               &y_offset);
+
+      pango_layout_get_cursor_pos (paragraph->layouts[slot], index_, &rect, NULL);
+      rect.y += y_offset;
+    }
+  else
     {
-      if (priv->password_char == 0)
+      if (priv->password_char != 0)
+        password_char_bytes = g_unichar_to_utf8 (priv->password_char, NULL);
+
+      if (position == -1)
         {
-          n_bytes = clutter_text_buffer_get_bytes (get_buffer (self));
-          if (priv->editable && priv->preedit_set)
-            index_ = n_bytes + strlen (priv->preedit_str);
+          if (priv->password_char == 0)
+            {
+              n_bytes = clutter_text_buffer_get_bytes (get_buffer (self));
+              if (priv->editable && priv->preedit_set)
+                index_ = n_bytes + strlen (priv->preedit_str);
+              else
+                index_ = n_bytes;
+            }
           else
-            index_ = n_bytes;
+            index_ = n_chars * password_char_bytes;
+        }
+      else if (position == 0)
+        {
+          index_ = 0;
         }
       else
-        index_ = n_chars * password_char_bytes;
-    }
-  else if (position == 0)
-    {
-      index_ = 0;
-    }
-  else
-    {
-      gchar *text = clutter_text_get_display_text (self);
-      GString *tmp = g_string_new (text);
-      gint cursor_index;
+        {
+          gchar *text = clutter_text_get_display_text (self);
+          GString *tmp = g_string_new (text);
+          gint cursor_index;
 
-      cursor_index = offset_to_bytes (text, priv->position);
+          cursor_index = clutter_text_offset_to_bytes (self, text, priv->position);
 
-      if (priv->preedit_str != NULL)
-        g_string_insert (tmp, cursor_index, priv->preedit_str);
+          if (priv->preedit_str != NULL)
+            g_string_insert (tmp, cursor_index, priv->preedit_str);
 
-      if (priv->password_char == 0)
-        index_ = offset_to_bytes (tmp->str, position);
-      else
-        index_ = position * password_char_bytes;
+          if (priv->password_char == 0)
+            index_ = offset_to_bytes (tmp->str, position);
+          else
+            index_ = position * password_char_bytes;
 
-      g_free (text);
-      g_string_free (tmp, TRUE);
-    }
+          g_free (text);
+          g_string_free (tmp, TRUE);
+        }
 
-  pango_layout_get_cursor_pos (clutter_text_get_layout (self),
-                               index_,
-                               &rect, NULL);
+      pango_layout_get_cursor_pos (clutter_text_get_layout (self),
+                                   index_,
+                                   &rect, NULL);
+    }
 
   if (x)
     {
@@ -1256,6 +2781,10 @@ clutter_text_set_property (GObject      *gobject,
       clutter_text_set_justify (self, g_value_get_boolean (value));
       break;
 
+    case PROP_ASYNC_LAYOUT:
+      clutter_text_set_async_layout (self, g_value_get_boolean (value));
+      break;
+
     case PROP_ELLIPSIZE:
       clutter_text_set_ellipsize (self, g_value_get_enum (value));
       break;
@@ -1442,6 +2971,10 @@ clutter_text_get_property (GObject    *gobject,
       g_value_set_boolean (value, priv->selected_text_color_set);
       break;
 
+    case PROP_ASYNC_LAYOUT:
+      g_value_set_boolean (value, priv->async_layout);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
     }
@@ -1453,7 +2986,9 @@ clutter_text_dispose (GObject *gobject)
   ClutterText *self = CLUTTER_TEXT (gobject);
   ClutterTextPrivate *priv = self->priv;
 
-  /* get rid of the entire cache */
+  /* get rid of the entire cache; this also cancels any pending
+   * asynchronous layout
+   */
   clutter_text_dirty_cache (self);
 
   if (priv->direction_changed_id)
@@ -1510,28 +3045,197 @@ typedef void (* ClutterTextSelectionFunc) (ClutterText           *text,
                                            const ClutterActorBox *box,
                                            gpointer               user_data);
 
+/* intersects the vertical range of a rectangle of @actor, transformed
+ * into the coordinate space of @self, with @y1 and @y2
+ */
+static gboolean
+clutter_text_clip_visible_range (ClutterText  *self,
+                                 ClutterActor *actor,
+                                 gfloat        x,
+                                 gfloat        y,
+                                 gfloat        width,
+                                 gfloat        height,
+                                 gfloat       *y1,
+                                 gfloat       *y2)
+{
+  gfloat min_y = G_MAXFLOAT, max_y = -G_MAXFLOAT;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      ClutterVertex point, stage_point;
+      gfloat point_x, point_y;
+
+      clutter_vertex_init (&point,
+                           (i & 1) ? x + width : x,
+                           (i & 2) ? y + height : y,
+                           0.f);
+
+      if (actor != NULL)
+        clutter_actor_apply_transform_to_point (actor, &point, &stage_point);
+      else
+        stage_point = point;
+
+      if (!clutter_actor_transform_stage_point (CLUTTER_ACTOR (self),
+                                                stage_point.x,
+                                                stage_point.y,
+                                                &point_x, &point_y))
+        return FALSE;
+
+      min_y = MIN (min_y, point_y);
+      max_y = MAX (max_y, point_y);
+    }
+
+  *y1 = MAX (*y1, floorf (min_y));
+  *y2 = MIN (*y2, ceilf (max_y));
+
+  return TRUE;
+}
+
+/* retrieves the vertical range of the actor that can end up on the
+ * stage, taking into account the size of the stage and the clip of
+ * every ancestor, like a ClutterScrollActor; returns FALSE if the
+ * whole text should be painted
+ */
+static gboolean
+clutter_text_get_visible_range (ClutterText *self,
+                                gfloat      *y1,
+                                gfloat      *y2)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (self);
+  ClutterActor *stage, *parent;
+  gfloat width, height;
+
+  if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_DISABLE_CULLING))
+    return FALSE;
+
+  /* clones and offscreen effects paint us with a different transformation
+   * than the one we would get by walking the scene graph
+   */
+  if (clutter_actor_is_in_clone_paint (actor))
+    return FALSE;
+
+  stage = _clutter_actor_get_stage_internal (actor);
+  if (stage == NULL)
+    return FALSE;
+
+  if (cogl_get_draw_framebuffer () !=
+      _clutter_stage_get_active_framebuffer (CLUTTER_STAGE (stage)))
+    return FALSE;
+
+  *y1 = -G_MAXFLOAT;
+  *y2 = G_MAXFLOAT;
+
+  clutter_actor_get_size (stage, &width, &height);
+  if (!clutter_text_clip_visible_range (self, NULL, 0, 0, width, height, y1, y2))
+    return FALSE;
+
+  for (parent = clutter_actor_get_parent (actor);
+       parent != NULL && parent != stage;
+       parent = clutter_actor_get_parent (parent))
+    {
+      gfloat x = 0.f, y = 0.f;
+
+      if (clutter_actor_has_clip (parent))
+        clutter_actor_get_clip (parent, &x, &y, &width, &height);
+      else if (clutter_actor_get_clip_to_allocation (parent))
+        clutter_actor_get_size (parent, &width, &height);
+      else
+        continue;
+
+      if (!clutter_text_clip_visible_range (self, parent,
+                                            x, y, width, height,
+                                            y1, y2))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* renders the lines of @layout that intersect the [@y1, @y2] range; the
+ * whole layout is rendered in one go if it is entirely visible, so that
+ * we can use the display list cached by CoglPango
+ */
+static void
+clutter_text_render_layout (PangoLayout     *layout,
+                            gint             x,
+                            gint             y,
+                            const CoglColor *color,
+                            gfloat           y1,
+                            gfloat           y2)
+{
+  PangoRectangle logical_rect = { 0, };
+  PangoLayoutIter *iter;
+
+  pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
+
+  if (y + logical_rect.y + logical_rect.height < y1 ||
+      y + logical_rect.y > y2)
+    return;
+
+  if (y + logical_rect.y >= y1 &&
+      y + logical_rect.y + logical_rect.height <= y2)
+    {
+      cogl_pango_render_layout (layout, x, y, color, 0);
+      return;
+    }
+
+  iter = pango_layout_get_iter (layout);
+
+  do
+    {
+      gint line_y1, line_y2;
+
+      pango_layout_iter_get_line_yrange (iter, &line_y1, &line_y2);
+
+      if (y + PANGO_PIXELS_CEIL (line_y2) < y1)
+        continue;
+
+      if (y + PANGO_PIXELS_FLOOR (line_y1) > y2)
+        break;
+
+      pango_layout_iter_get_line_extents (iter, NULL, &logical_rect);
+
+      /* unlike cogl_pango_render_layout(), the position of a single
+       * line is expressed in Pango units, and refers to the baseline
+       */
+      cogl_pango_render_layout_line (pango_layout_iter_get_line_readonly (iter),
+                                     x * PANGO_SCALE + logical_rect.x,
+                                     y * PANGO_SCALE + pango_layout_iter_get_baseline (iter),
+                                     color);
+    }
+  while (pango_layout_iter_next_line (iter));
+
+  pango_layout_iter_free (iter);
+}
+
+/* calls @func for every rectangle of the selection that intersects
+ * the [@visible_y1, @visible_y2] range; the rectangles are in actor
+ * coordinates, offset like the text they cover
+ */
 static void
 clutter_text_foreach_selection_rectangle (ClutterText              *self,
+                                          gfloat                    visible_y1,
+                                          gfloat                    visible_y2,
                                           ClutterTextSelectionFunc  func,
                                           gpointer                  user_data)
 {
   ClutterTextPrivate *priv = self->priv;
   PangoLayout *layout = clutter_text_get_layout (self);
   gchar *utf8 = clutter_text_get_display_text (self);
-  gint lines;
+  PangoLayoutIter *iter;
   gint start_index;
   gint end_index;
-  gint line_no;
 
   if (priv->position == 0)
     start_index = 0;
   else
-    start_index = offset_to_bytes (utf8, priv->position);
+    start_index = clutter_text_offset_to_bytes (self, utf8, priv->position);
 
   if (priv->selection_bound == 0)
     end_index = 0;
   else
-    end_index = offset_to_bytes (utf8, priv->selection_bound);
+    end_index = clutter_text_offset_to_bytes (self, utf8, priv->selection_bound);
 
   if (start_index > end_index)
     {
@@ -1540,9 +3244,9 @@ clutter_text_foreach_selection_rectangle (ClutterText              *self,
       end_index = temp;
     }
 
-  lines = pango_layout_get_line_count (layout);
+  iter = pango_layout_get_iter (layout);
 
-  for (line_no = 0; line_no < lines; line_no++)
+  do
     {
       PangoLayoutLine *line;
       gint n_ranges;
@@ -1550,10 +3254,25 @@ clutter_text_foreach_selection_rectangle (ClutterText              *self,
       gint i;
       gint index_;
       gint maxindex;
+      gint line_y1, line_y2;
       ClutterActorBox box;
       gfloat y, height;
 
-      line = pango_layout_get_line_readonly (layout, line_no);
+      line = pango_layout_iter_get_line_readonly (iter);
+      if (line->start_index + line->length < start_index)
+        continue;
+
+      if (line->start_index > end_index)
+        break;
+
+      /* skip the lines that are not going to be visible */
+      pango_layout_iter_get_line_yrange (iter, &line_y1, &line_y2);
+      if (priv->text_y + PANGO_PIXELS_CEIL (line_y2) < visible_y1)
+        continue;
+
+      if (priv->text_y + PANGO_PIXELS_FLOOR (line_y1) > visible_y2)
+        break;
+
       pango_layout_line_x_to_index (line, G_MAXINT, &maxindex, NULL);
       if (maxindex < start_index)
         continue;
@@ -1564,11 +3283,11 @@ clutter_text_foreach_selection_rectangle (ClutterText              *self,
       pango_layout_line_x_to_index (line, 0, &index_, NULL);
 
       clutter_text_position_to_coords (self,
-                                       bytes_to_offset (utf8, index_),
+                                       clutter_text_bytes_to_offset (self, utf8, index_),
                                        NULL, &y, &height);
 
-      box.y1 = y;
-      box.y2 = y + height;
+      box.y1 = priv->text_y + y;
+      box.y2 = priv->text_y + y + height;
 
       for (i = 0; i < n_ranges; i++)
         {
@@ -1593,7 +3312,9 @@ clutter_text_foreach_selection_rectangle (ClutterText              *self,
 
       g_free (ranges);
     }
+  while (pango_layout_iter_next_line (iter));
 
+  pango_layout_iter_free (iter);
   g_free (utf8);
 }
 
@@ -1607,7 +3328,9 @@ add_selection_rectangle_to_path (ClutterText           *text,
 
 /* Draws the selected text, its background, and the cursor */
 static void
-selection_paint (ClutterText *self)
+selection_paint (ClutterText *self,
+                 gfloat       visible_y1,
+                 gfloat       visible_y2)
 {
   ClutterTextPrivate *priv = self->priv;
   ClutterActor *actor = CLUTTER_ACTOR (self);
@@ -1631,9 +3354,9 @@ selection_paint (ClutterText *self)
                                 paint_opacity * color->alpha / 255);
 
       cogl_rectangle (priv->cursor_rect.origin.x,
-                      priv->cursor_rect.origin.y,
+                      priv->text_y + priv->cursor_rect.origin.y,
                       priv->cursor_rect.origin.x + priv->cursor_rect.size.width,
-                      priv->cursor_rect.origin.y + priv->cursor_rect.size.height);
+                      priv->text_y + priv->cursor_rect.origin.y + priv->cursor_rect.size.height);
     }
   else
     {
@@ -1661,6 +3384,7 @@ selection_paint (ClutterText *self)
                                 paint_opacity * color->alpha / 255);
 
       clutter_text_foreach_selection_rectangle (self,
+                                                visible_y1, visible_y2,
                                                 add_selection_rectangle_to_path,
                                                 selection_path);
 
@@ -1681,7 +3405,8 @@ selection_paint (ClutterText *self)
                                 color->blue,
                                 paint_opacity * color->alpha / 255);
 
-      cogl_pango_render_layout (layout, priv->text_x, 0, &cogl_color, 0);
+      clutter_text_render_layout (layout, priv->text_x, priv->text_y, &cogl_color,
+                                  visible_y1, visible_y2);
 
       cogl_framebuffer_pop_clip (fb);
     }
@@ -1754,7 +3479,7 @@ clutter_text_move_line_start (ClutterText *self,
   if (start == 0)
     index_ = 0;
   else
-    index_ = offset_to_bytes (text, start);
+    index_ = clutter_text_offset_to_bytes (self, text, start);
 
   pango_layout_index_to_line_x (layout, index_,
                                 0,
@@ -1766,7 +3491,7 @@ clutter_text_move_line_start (ClutterText *self,
 
   pango_layout_line_x_to_index (layout_line, 0, &index_, NULL);
 
-  position = bytes_to_offset (text, index_);
+  position = clutter_text_bytes_to_offset (self, text, index_);
 
   return position;
 }
@@ -1790,7 +3515,7 @@ clutter_text_move_line_end (ClutterText *self,
   if (start == 0)
     index_ = 0;
   else
-    index_ = offset_to_bytes (text, priv->position);
+    index_ = clutter_text_offset_to_bytes (self, text, priv->position);
 
   pango_layout_index_to_line_x (layout, index_,
                                 0,
@@ -1803,7 +3528,7 @@ clutter_text_move_line_end (ClutterText *self,
   pango_layout_line_x_to_index (layout_line, G_MAXINT, &index_, &trailing);
   index_ += trailing;
 
-  position = bytes_to_offset (text, index_);
+  position = clutter_text_bytes_to_offset (self, text, index_);
 
   return position;
 }
@@ -1881,7 +3606,7 @@ clutter_text_press (ClutterActor *actor,
 
       index_ = clutter_text_coords_to_position (self, x, y);
       text = clutter_text_buffer_get_text (get_buffer (self));
-      offset = bytes_to_offset (text, index_);
+      offset = clutter_text_bytes_to_offset (self, text, index_);
 
       /* what we select depends on the number of button clicks we
        * receive, and whether we are selectable:
@@ -1956,7 +3681,7 @@ clutter_text_move (ClutterActor *actor,
 
   index_ = clutter_text_coords_to_position (self, x, y);
   text = clutter_text_buffer_get_text (get_buffer (self));
-  offset = bytes_to_offset (text, index_);
+  offset = clutter_text_bytes_to_offset (self, text, index_);
 
   if (priv->selectable)
     clutter_text_set_cursor_position (self, offset);
@@ -2141,21 +3866,20 @@ clutter_text_key_press (ClutterActor    *actor,
   return CLUTTER_EVENT_PROPAGATE;
 }
 
+/* @logical_rect is in pixels */
 static void
-clutter_text_compute_layout_offsets (ClutterText           *self,
-                                     PangoLayout           *layout,
-                                     const ClutterActorBox *alloc,
-                                     int                   *text_x,
-                                     int                   *text_y)
+clutter_text_compute_offsets (ClutterText           *self,
+                              const PangoRectangle  *logical_rect,
+                              const ClutterActorBox *alloc,
+                              int                   *text_x,
+                              int                   *text_y)
 {
   ClutterActor *actor = CLUTTER_ACTOR (self);
   ClutterActorAlign x_align, y_align;
-  PangoRectangle logical_rect;
   float alloc_width, alloc_height;
   float x, y;
 
   clutter_actor_box_get_size (alloc, &alloc_width, &alloc_height);
-  pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
 
   if (clutter_actor_needs_expand (actor, CLUTTER_ORIENTATION_HORIZONTAL))
     x_align = _clutter_actor_get_effective_x_align (actor);
@@ -2175,13 +3899,13 @@ clutter_text_compute_layout_offsets (ClutterText           *self,
       break;
 
     case CLUTTER_ACTOR_ALIGN_END:
-      if (alloc_width > logical_rect.width)
-        x = alloc_width - logical_rect.width;
+      if (alloc_width > logical_rect->width)
+        x = alloc_width - logical_rect->width;
       break;
 
     case CLUTTER_ACTOR_ALIGN_CENTER:
-      if (alloc_width > logical_rect.width)
-        x = (alloc_width - logical_rect.width) / 2.f;
+      if (alloc_width > logical_rect->width)
+        x = (alloc_width - logical_rect->width) / 2.f;
       break;
     }
 
@@ -2193,13 +3917,13 @@ clutter_text_compute_layout_offsets (ClutterText           *self,
       break;
 
     case CLUTTER_ACTOR_ALIGN_END:
-      if (alloc_height > logical_rect.height)
-        y = alloc_height - logical_rect.height;
+      if (alloc_height > logical_rect->height)
+        y = alloc_height - logical_rect->height;
       break;
 
     case CLUTTER_ACTOR_ALIGN_CENTER:
-      if (alloc_height > logical_rect.height)
-        y = (alloc_height - logical_rect.height) / 2.f;
+      if (alloc_height > logical_rect->height)
+        y = (alloc_height - logical_rect->height) / 2.f;
       break;
     }
 
@@ -2210,8 +3934,107 @@ clutter_text_compute_layout_offsets (ClutterText           *self,
     *text_y = floorf (y);
 }
 
+static void
+clutter_text_compute_layout_offsets (ClutterText           *self,
+                                     PangoLayout           *layout,
+                                     const ClutterActorBox *alloc,
+                                     int                   *text_x,
+                                     int                   *text_y)
+{
+  PangoRectangle logical_rect;
+
+  pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
+
+  clutter_text_compute_offsets (self, &logical_rect, alloc, text_x, text_y);
+}
+
 #define TEXT_PADDING    2
 
+/* paints the text one paragraph at a time; see clutter_text_paint() */
+static void
+clutter_text_paint_paragraphs (ClutterText           *self,
+                               CoglFramebuffer       *fb,
+                               const ClutterActorBox *alloc)
+{
+  ClutterTextPrivate *priv = self->priv;
+  PangoRectangle logical_rect = { 0, };
+  CoglColor color = { 0, };
+  gboolean clip_set = FALSE;
+  gint text_x = priv->text_x;
+  gint text_y = priv->text_y;
+  float alloc_width, alloc_height;
+  float visible_y1, visible_y2;
+  guint8 real_opacity;
+  gint slot, i, y;
+
+  clutter_actor_box_get_size (alloc, &alloc_width, &alloc_height);
+
+  slot = clutter_text_ensure_paragraphs_for_size (self, alloc_width, -1);
+
+  if (clutter_text_should_draw_cursor (self))
+    clutter_text_ensure_cursor_position (self);
+
+  clutter_text_get_paragraphs_extents (self, slot, NULL, &logical_rect);
+  pango_extents_to_pixels (&logical_rect, NULL);
+
+  /* don't clip if the text managed to fit inside our allocation */
+  if (!priv->editable &&
+      (logical_rect.width > alloc_width ||
+       logical_rect.height > alloc_height))
+    {
+      cogl_framebuffer_push_rectangle_clip (fb, 0, 0, alloc_width, alloc_height);
+      clip_set = TRUE;
+    }
+
+  clutter_text_compute_offsets (self, &logical_rect, alloc, &text_x, &text_y);
+
+  if (priv->text_x != text_x ||
+      priv->text_y != text_y)
+    {
+      priv->text_x = text_x;
+      priv->text_y = text_y;
+
+      clutter_text_ensure_cursor_position (self);
+    }
+
+  real_opacity = clutter_actor_get_paint_opacity (CLUTTER_ACTOR (self))
+               * priv->text_color.alpha
+               / 255;
+
+  cogl_color_init_from_4ub (&color,
+                            priv->text_color.red,
+                            priv->text_color.green,
+                            priv->text_color.blue,
+                            real_opacity);
+
+  if (!clutter_text_get_visible_range (self, &visible_y1, &visible_y2))
+    {
+      visible_y1 = -G_MAXFLOAT;
+      visible_y2 = G_MAXFLOAT;
+    }
+
+  for (i = 0, y = 0; i < priv->paragraphs->len; i++)
+    {
+      Paragraph *paragraph = &g_array_index (priv->paragraphs, Paragraph, i);
+
+      if (priv->text_y + PANGO_PIXELS (y) > visible_y2)
+        break;
+
+      clutter_text_render_layout (paragraph->layouts[slot],
+                                  priv->text_x,
+                                  priv->text_y + PANGO_PIXELS (y),
+                                  &color,
+                                  visible_y1, visible_y2);
+
+      y += paragraph->logical_rects[slot].y + paragraph->logical_rects[slot].height;
+    }
+
+  selection_paint (self, visible_y1, visible_y2);
+
+  if (clip_set)
+    cogl_framebuffer_pop_clip (fb);
+}
+
 static void
 clutter_text_paint (ClutterActor *self)
 {
@@ -2229,6 +4052,7 @@ clutter_text_paint (ClutterActor *self)
   guint n_chars;
   float alloc_width;
   float alloc_height;
+  float visible_y1, visible_y2;
 
   /* FIXME: this should not be needed, but apparently the text-cache
    * test unit manages to get in a situation where the active frame
@@ -2272,6 +4096,17 @@ clutter_text_paint (ClutterActor *self)
       !clutter_text_should_draw_cursor (text))
     return;
 
+  /* the text will be painted once the layout is ready */
+  if (clutter_text_defer_layout (text, alloc_width,
+                                 priv->wrap && priv->ellipsize ? alloc_height : -1))
+    return;
+
+  if (clutter_text_use_paragraphs (text))
+    {
+      clutter_text_paint_paragraphs (text, fb, &alloc);
+      return;
+    }
+
   if (priv->editable && priv->single_line_mode)
     layout = clutter_text_create_layout (text, -1, -1);
   else
@@ -2391,9 +4226,21 @@ clutter_text_paint (ClutterActor *self)
                             priv->text_color.green,
                             priv->text_color.blue,
                             real_opacity);
-  cogl_pango_render_layout (layout, priv->text_x, priv->text_y, &color, 0);
 
-  selection_paint (text);
+  /* only emit the lines that can end up on the stage; a long text inside
+   * a scrolling container would otherwise draw all of its glyphs on every
+   * frame
+   */
+  if (!clutter_text_get_visible_range (text, &visible_y1, &visible_y2))
+    {
+      visible_y1 = -G_MAXFLOAT;
+      visible_y2 = G_MAXFLOAT;
+    }
+
+  clutter_text_render_layout (layout, priv->text_x, priv->text_y, &color,
+                              visible_y1, visible_y2);
+
+  selection_paint (text, visible_y1, visible_y2);
 
   if (clip_set)
     cogl_framebuffer_pop_clip (fb);
@@ -2434,7 +4281,7 @@ clutter_text_get_paint_volume_for_cursor (ClutterText        *text,
   if (priv->position == priv->selection_bound)
     {
       origin.x = priv->cursor_rect.origin.x;
-      origin.y = priv->cursor_rect.origin.y;
+      origin.y = priv->text_y + priv->cursor_rect.origin.y;
       origin.z = 0;
 
       clutter_paint_volume_set_origin (volume, &origin);
@@ -2444,6 +4291,7 @@ clutter_text_get_paint_volume_for_cursor (ClutterText        *text,
   else
     {
       clutter_text_foreach_selection_rectangle (text,
+                                                -G_MAXFLOAT, G_MAXFLOAT,
                                                 add_selection_to_paint_volume,
                                                 volume);
     }
@@ -2466,6 +4314,7 @@ clutter_text_get_paint_volume (ClutterActor       *self,
       PangoLayout *layout;
       PangoRectangle ink_rect;
       ClutterVertex origin;
+      gfloat width, height;
 
       /* If the text is single line editable then it gets clipped to
          the allocation anyway so we can just use that */
@@ -2480,10 +4329,27 @@ clutter_text_get_paint_volume (ClutterActor       *self,
       if (!clutter_actor_has_allocation (self))
         return FALSE;
 
+      /* the allocation is our best guess until the layout is ready */
+      clutter_actor_get_size (self, &width, &height);
+      if (clutter_text_defer_layout (text, width, height))
+        return _clutter_actor_set_default_paint_volume (self,
+                                                        CLUTTER_TYPE_TEXT,
+                                                        volume);
+
       _clutter_paint_volume_init_static (&priv->paint_volume, self);
 
-      layout = clutter_text_get_layout (text);
-      pango_layout_get_extents (layout, &ink_rect, NULL);
+      if (clutter_text_use_paragraphs (text))
+        {
+          clutter_text_get_paragraphs_extents (text,
+                                               clutter_text_get_paragraphs_slot (text),
+                                               &ink_rect,
+                                               NULL);
+        }
+      else
+        {
+          layout = clutter_text_get_layout (text);
+          pango_layout_get_extents (layout, &ink_rect, NULL);
+        }
 
       origin.x = ink_rect.x / (float) PANGO_SCALE;
       origin.y = ink_rect.y / (float) PANGO_SCALE;
@@ -2531,19 +4397,36 @@ clutter_text_get_preferred_width (ClutterActor *self,
   gint logical_width;
   gfloat layout_width;
 
-  layout = clutter_text_create_layout (text, -1, -1);
+  if (clutter_text_defer_layout (text, -1, -1))
+    {
+      clutter_text_estimate_size (text, -1, &layout_width, NULL);
+      layout_width = MAX (layout_width, 1);
+    }
+  else
+    {
+      if (clutter_text_use_paragraphs (text))
+        {
+          gint slot = clutter_text_ensure_paragraphs_for_size (text, -1, -1);
+
+          clutter_text_get_paragraphs_extents (text, slot, NULL, &logical_rect);
+        }
+      else
+        {
+          layout = clutter_text_create_layout (text, -1, -1);
 
-  pango_layout_get_extents (layout, NULL, &logical_rect);
+          pango_layout_get_extents (layout, NULL, &logical_rect);
+        }
 
-  /* the X coordinate of the logical rectangle might be non-zero
-   * according to the Pango documentation; hence, we need to offset
-   * the width accordingly
-   */
-  logical_width = logical_rect.x + logical_rect.width;
+      /* the X coordinate of the logical rectangle might be non-zero
+       * according to the Pango documentation; hence, we need to offset
+       * the width accordingly
+       */
+      logical_width = logical_rect.x + logical_rect.width;
 
-  layout_width = logical_width > 0
-    ? ceilf (logical_width / 1024.0f)
-    : 1;
+      layout_width = logical_width > 0
+        ? ceilf (logical_width / 1024.0f)
+        : 1;
+    }
 
   if (min_width_p)
     {
@@ -2588,6 +4471,46 @@ clutter_text_get_preferred_height (ClutterActor *self,
       if (priv->single_line_mode)
         for_width = -1;
 
+      if (clutter_text_defer_layout (CLUTTER_TEXT (self), for_width, -1))
+        {
+          clutter_text_estimate_size (CLUTTER_TEXT (self), for_width,
+                                      NULL,
+                                      &layout_height);
+
+          if (min_height_p)
+            *min_height_p = layout_height;
+
+          if (natural_height_p)
+            *natural_height_p = layout_height;
+
+          return;
+        }
+
+      /* there is no ellipsization when laying out paragraphs, so
+       * the minimum height is the height of the text
+       */
+      if (clutter_text_use_paragraphs (CLUTTER_TEXT (self)))
+        {
+          gint slot;
+
+          slot = clutter_text_ensure_paragraphs_for_size (CLUTTER_TEXT (self),
+                                                          for_width, -1);
+          clutter_text_get_paragraphs_extents (CLUTTER_TEXT (self), slot,
+                                               NULL,
+                                               &logical_rect);
+
+          logical_height = logical_rect.y + logical_rect.height;
+          layout_height = ceilf (logical_height / 1024.0f);
+
+          if (min_height_p)
+            *min_height_p = layout_height;
+
+          if (natural_height_p)
+            *natural_height_p = layout_height;
+
+          return;
+        }
+
       layout = clutter_text_create_layout (CLUTTER_TEXT (self),
                                            for_width, -1);
 
@@ -2644,7 +4567,13 @@ clutter_text_allocate (ClutterActor           *self,
    */
   if (text->priv->editable && text->priv->single_line_mode)
     clutter_text_create_layout (text, -1, -1);
-  else
+  else if (clutter_text_use_paragraphs (text))
+    clutter_text_ensure_paragraphs_for_size (text,
+                                             box->x2 - box->x1,
+                                             box->y2 - box->y1);
+  else if (!clutter_text_defer_layout (text,
+                                       box->x2 - box->x1,
+                                       box->y2 - box->y1))
     clutter_text_create_layout (text,
                                 box->x2 - box->x1,
                                 box->y2 - box->y1);
@@ -2780,7 +4709,7 @@ clutter_text_real_move_up (ClutterText         *self,
   if (priv->position == 0)
     index_ = 0;
   else
-    index_ = offset_to_bytes (text, priv->position);
+    index_ = clutter_text_offset_to_bytes (self, text, priv->position);
 
   pango_layout_index_to_line_x (layout, index_,
                                 0,
@@ -2801,7 +4730,7 @@ clutter_text_real_move_up (ClutterText         *self,
 
   g_object_freeze_notify (G_OBJECT (self));
 
-  pos = bytes_to_offset (text, index_);
+  pos = clutter_text_bytes_to_offset (self, text, index_);
   clutter_text_set_cursor_position (self, pos + trailing);
 
   /* Store the target x position to avoid drifting left and right when
@@ -2837,7 +4766,7 @@ clutter_text_real_move_down (ClutterText         *self,
   if (priv->position == 0)
     index_ = 0;
   else
-    index_ = offset_to_bytes (text, priv->position);
+    index_ = clutter_text_offset_to_bytes (self, text, priv->position);
 
   pango_layout_index_to_line_x (layout, index_,
                                 0,
@@ -2854,7 +4783,7 @@ clutter_text_real_move_down (ClutterText         *self,
 
   g_object_freeze_notify (G_OBJECT (self));
 
-  pos = bytes_to_offset (text, index_);
+  pos = clutter_text_bytes_to_offset (self, text, index_);
   clutter_text_set_cursor_position (self, pos + trailing);
 
   /* Store the target x position to avoid drifting left and right when
@@ -3869,6 +5798,26 @@ clutter_text_class_init (ClutterTextClass *klass)
   obj_props[PROP_SELECTED_TEXT_COLOR_SET] = pspec;
   g_object_class_install_property (gobject_class, PROP_SELECTED_TEXT_COLOR_SET, pspec);
 
+  /**
+   * ClutterText:async-layout:
+   *
+   * Whether large, non-editable contents of the #ClutterText should be
+   * laid out in a separate thread.
+   *
+   * While the layout is being created, the preferred size of the actor
+   * is estimated using the metrics of the font, and the text is not
+   * painted.
+   *
+   * Since: 1.28
+   */
+  pspec = g_param_spec_boolean ("async-layout",
+                                P_("Asynchronous Layout"),
+                                P_("Whether large text should be laid out in a separate thread"),
+                                FALSE,
+                                CLUTTER_PARAM_READWRITE);
+  obj_props[PROP_ASYNC_LAYOUT] = pspec;
+  g_object_class_install_property (gobject_class, PROP_ASYNC_LAYOUT, pspec);
+
   /**
    * ClutterText::text-changed:
    * @self: the #ClutterText that emitted the signal
@@ -4271,6 +6220,8 @@ buffer_inserted_text (ClutterTextBuffer *buffer,
   gint new_position;
   gint new_selection_bound;
 
+  clutter_text_update_paragraphs (self, position, 0, n_chars);
+
   priv = self->priv;
   if (priv->position >= 0 || priv->selection_bound >= 0)
     {
@@ -4299,6 +6250,8 @@ buffer_deleted_text (ClutterTextBuffer *buffer,
   gint new_position;
   gint new_selection_bound;
 
+  clutter_text_update_paragraphs (self, position, n_chars, 0);
+
   priv = self->priv;
   if (priv->position >= 0 || priv->selection_bound >= 0)
     {
@@ -4322,7 +6275,10 @@ buffer_notify_text (ClutterTextBuffer *buffer,
 {
   g_object_freeze_notify (G_OBJECT (self));
 
-  clutter_text_dirty_cache (self);
+  /* the paragraphs touched by the change are updated when the buffer
+   * emits ::inserted-text or ::deleted-text
+   */
+  clutter_text_dirty_layouts (self);
 
   clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
 
@@ -4434,6 +6390,8 @@ clutter_text_set_buffer (ClutterText       *self,
   if (priv->buffer)
      buffer_connect_signals (self);
 
+  clutter_text_dirty_cache (self);
+
   obj = G_OBJECT (self);
   g_object_freeze_notify (obj);
   g_object_notify (obj, "buffer");
@@ -4808,8 +6766,8 @@ clutter_text_get_selection (ClutterText *self)
     }
 
   text = clutter_text_buffer_get_text (get_buffer (self));
-  start_offset = offset_to_bytes (text, start_index);
-  end_offset = offset_to_bytes (text, end_index);
+  start_offset = clutter_text_offset_to_bytes (self, text, start_index);
+  end_offset = clutter_text_offset_to_bytes (self, text, end_index);
   len = end_offset - start_offset;
 
   str = g_malloc (len + 1);
@@ -6103,8 +8061,8 @@ clutter_text_get_chars (ClutterText *self,
   start_pos = MIN (n_chars, start_pos);
   end_pos = MIN (n_chars, end_pos);
 
-  start_index = g_utf8_offset_to_pointer (text, start_pos) - text;
-  end_index   = g_utf8_offset_to_pointer (text, end_pos) - text;
+  start_index = clutter_text_offset_to_bytes (self, text, start_pos);
+  end_index   = clutter_text_offset_to_bytes (self, text, end_pos);
 
   return g_strndup (text + start_index, end_index - start_index);
 }
@@ -6298,3 +8256,69 @@ clutter_text_get_cursor_rect (ClutterText *self,
 
   *rect = self->priv->cursor_rect;
 }
+
+/**
+ * clutter_text_set_async_layout:
+ * @self: a #ClutterText
+ * @async_layout: whether large contents should be laid out in a thread
+ *
+ * Sets whether the contents of a non-editable #ClutterText should be
+ * laid out in a separate thread when they are large, instead of blocking
+ * the frame in which they are set.
+ *
+ * While the layout is being created, the preferred size of @self is
+ * estimated using the metrics of its font, and the text is not painted;
+ * once the layout is ready, a relayout is queued.
+ *
+ * This setting is ignored on systems with a single processor, or if
+ * Clutter is running against a version of Pango whose font maps cannot
+ * be used from multiple threads.
+ *
+ * Since: 1.28
+ */
+void
+clutter_text_set_async_layout (ClutterText *self,
+                               gboolean     async_layout)
+{
+  ClutterTextPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_TEXT (self));
+
+  priv = self->priv;
+
+  async_layout = !!async_layout;
+
+  if (priv->async_layout != async_layout)
+    {
+      priv->async_layout = async_layout;
+
+      if (!priv->async_layout)
+        {
+          /* we are going to need the layouts right away */
+          if (priv->async_layout_data != NULL)
+            clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
+
+          clutter_text_cancel_async_layout (self);
+        }
+
+      g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_ASYNC_LAYOUT]);
+    }
+}
+
+/**
+ * clutter_text_get_async_layout:
+ * @self: a #ClutterText
+ *
+ * Retrieves the value set using clutter_text_set_async_layout().
+ *
+ * Return value: %TRUE if large contents are laid out in a thread
+ *
+ * Since: 1.28
+ */
+gboolean
+clutter_text_get_async_layout (ClutterText *self)
+{
+  g_return_val_if_fail (CLUTTER_IS_TEXT (self), FALSE);
+
+  return self->priv->async_layout;
+}
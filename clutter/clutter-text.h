@@ -302,6 +302,12 @@ void                  clutter_text_get_layout_offsets   (ClutterText           *
                                                          gint                  *x,
                                                          gint                  *y);
 
+CLUTTER_AVAILABLE_IN_1_28
+void                  clutter_text_set_async_layout     (ClutterText          *self,
+                                                         gboolean              async_layout);
+CLUTTER_AVAILABLE_IN_1_28
+gboolean              clutter_text_get_async_layout     (ClutterText          *self);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_TEXT_H__ */
@@ -0,0 +1,71 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_TEXTURE_BUDGET_PRIVATE_H__
+#define __CLUTTER_TEXTURE_BUDGET_PRIVATE_H__
+
+#include <cogl/cogl.h>
+#include <clutter/clutter-types.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ClutterTextureBudgetEntry       ClutterTextureBudgetEntry;
+
+/*
+ * ClutterTextureBudgetEvictFunc:
+ * @data: the data passed to _clutter_texture_budget_add()
+ *
+ * Releases the textures accounted by an entry, which must then be
+ * updated using _clutter_texture_budget_set_size(); the owner is
+ * responsible for re-creating them the next time they are painted.
+ */
+typedef void (* ClutterTextureBudgetEvictFunc) (gpointer data);
+
+G_GNUC_INTERNAL
+ClutterTextureBudgetEntry *     _clutter_texture_budget_add             (ClutterTextureBudgetEvictFunc  evict_func,
+                                                                         gpointer                       data);
+G_GNUC_INTERNAL
+ClutterTextureBudgetEntry *     _clutter_texture_budget_add_for_content (ClutterContent                *content,
+                                                                         ClutterTextureBudgetEvictFunc  evict_func);
+G_GNUC_INTERNAL
+void                            _clutter_texture_budget_remove          (ClutterTextureBudgetEntry     *entry);
+G_GNUC_INTERNAL
+void                            _clutter_texture_budget_set_size        (ClutterTextureBudgetEntry     *entry,
+                                                                         gsize                          size);
+G_GNUC_INTERNAL
+void                            _clutter_texture_budget_mark_used       (ClutterTextureBudgetEntry     *entry);
+
+G_GNUC_INTERNAL
+void                            _clutter_texture_budget_new_frame       (void);
+
+G_GNUC_INTERNAL
+void                            _clutter_texture_budget_set_limit       (gsize                          limit);
+G_GNUC_INTERNAL
+gsize                           _clutter_texture_budget_get_limit       (void);
+G_GNUC_INTERNAL
+gsize                           _clutter_texture_budget_get_usage       (void);
+
+G_GNUC_INTERNAL
+gsize                           _clutter_texture_budget_get_texture_size (CoglTexture                  *texture);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_TEXTURE_BUDGET_PRIVATE_H__ */
@@ -0,0 +1,291 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * ClutterTextureBudget: accounting of the texture memory used by
+ * contents, effects and actors.
+ *
+ * Every owner of textures registers an entry, and keeps its size up
+ * to date; painting an entry moves it to the front of a list, so that
+ * the least recently painted entries are at the end of it.
+ *
+ * When a limit is set and the total size goes over it, the entries at
+ * the end of the list are asked to release their textures, from an idle
+ * handler, until the total size fits again. Entries of a #ClutterContent
+ * attached to a mapped actor are never evicted, since they are most
+ * likely on screen; the owners re-create their textures the next time
+ * they are painted.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "clutter-texture-budget-private.h"
+
+#include "clutter-content-private.h"
+#include "clutter-debug.h"
+#include "clutter-main.h"
+#include "clutter-private.h"
+
+struct _ClutterTextureBudgetEntry
+{
+  /* the link inside the LRU list; link.data points to the entry */
+  GList link;
+
+  ClutterTextureBudgetEvictFunc evict_func;
+  gpointer data;
+
+  /* the content owning the entry, if any */
+  ClutterContent *content;
+
+  gsize size;
+};
+
+/* most recently painted first */
+static GQueue budget_entries = G_QUEUE_INIT;
+
+static gsize budget_usage = 0;
+static gsize budget_limit = 0;
+
+static guint budget_evict_id = 0;
+static gboolean budget_evicting = FALSE;
+
+static gboolean
+clutter_texture_budget_evict (gpointer unused)
+{
+  GList *candidates = NULL, *l;
+
+  budget_evict_id = 0;
+
+  if (budget_limit == 0 || budget_usage <= budget_limit)
+    return G_SOURCE_REMOVE;
+
+  /* collect the entries first, as evicting one might change the list */
+  for (l = budget_entries.tail; l != NULL; l = l->prev)
+    {
+      ClutterTextureBudgetEntry *entry = l->data;
+
+      if (entry->evict_func == NULL || entry->size == 0)
+        continue;
+
+      if (entry->content != NULL &&
+          _clutter_content_has_mapped_actors (entry->content))
+        continue;
+
+      candidates = g_list_prepend (candidates, entry);
+    }
+
+  candidates = g_list_reverse (candidates);
+
+  budget_evicting = TRUE;
+
+  for (l = candidates; l != NULL && budget_usage > budget_limit; l = l->next)
+    {
+      ClutterTextureBudgetEntry *entry = l->data;
+
+      CLUTTER_NOTE (MISC, "Evicting %" G_GSIZE_FORMAT " bytes of textures "
+                    "(usage: %" G_GSIZE_FORMAT ", limit: %" G_GSIZE_FORMAT ")",
+                    entry->size,
+                    budget_usage,
+                    budget_limit);
+
+      entry->evict_func (entry->data);
+    }
+
+  budget_evicting = FALSE;
+
+  g_list_free (candidates);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+clutter_texture_budget_check (void)
+{
+  if (budget_limit == 0 || budget_usage <= budget_limit)
+    return;
+
+  if (budget_evicting || budget_evict_id != 0)
+    return;
+
+  /* textures are often created while painting, so we never evict
+   * from the caller
+   */
+  budget_evict_id =
+    clutter_threads_add_idle_full (G_PRIORITY_DEFAULT_IDLE,
+                                   clutter_texture_budget_evict,
+                                   NULL,
+                                   NULL);
+}
+
+/*< private >
+ * _clutter_texture_budget_add:
+ * @evict_func: (allow-none): the function releasing the textures of
+ *   the entry, or %NULL if they cannot be re-created
+ * @data: data passed to @evict_func
+ *
+ * Registers a new owner of textures; entries without @evict_func are
+ * only accounted for.
+ *
+ * Return value: the new entry; use _clutter_texture_budget_remove()
+ *   to release it
+ */
+ClutterTextureBudgetEntry *
+_clutter_texture_budget_add (ClutterTextureBudgetEvictFunc evict_func,
+                             gpointer                      data)
+{
+  ClutterTextureBudgetEntry *entry;
+
+  entry = g_slice_new0 (ClutterTextureBudgetEntry);
+  entry->link.data = entry;
+  entry->evict_func = evict_func;
+  entry->data = data;
+
+  g_queue_push_head_link (&budget_entries, &entry->link);
+
+  return entry;
+}
+
+/*< private >
+ * _clutter_texture_budget_add_for_content:
+ * @content: the #ClutterContent owning the textures
+ * @evict_func: the function releasing the textures of @content
+ *
+ * Registers the textures of @content, which are only evicted while
+ * none of the actors using @content is mapped; @content is passed
+ * to @evict_func.
+ *
+ * Return value: the new entry; use _clutter_texture_budget_remove()
+ *   to release it
+ */
+ClutterTextureBudgetEntry *
+_clutter_texture_budget_add_for_content (ClutterContent                *content,
+                                         ClutterTextureBudgetEvictFunc  evict_func)
+{
+  ClutterTextureBudgetEntry *entry;
+
+  entry = _clutter_texture_budget_add (evict_func, content);
+  entry->content = content;
+
+  return entry;
+}
+
+void
+_clutter_texture_budget_remove (ClutterTextureBudgetEntry *entry)
+{
+  if (entry == NULL)
+    return;
+
+  budget_usage -= entry->size;
+
+  g_queue_unlink (&budget_entries, &entry->link);
+  g_slice_free (ClutterTextureBudgetEntry, entry);
+}
+
+/*< private >
+ * _clutter_texture_budget_set_size:
+ * @entry: a budget entry
+ * @size: the number of bytes of texture memory used by the entry
+ *
+ * Updates the size of @entry; if the total size goes over the limit,
+ * the least recently painted entries are evicted from an idle handler.
+ */
+void
+_clutter_texture_budget_set_size (ClutterTextureBudgetEntry *entry,
+                                  gsize                      size)
+{
+  if (entry->size == size)
+    return;
+
+  budget_usage = budget_usage - entry->size + size;
+  entry->size = size;
+
+  clutter_texture_budget_check ();
+}
+
+/*< private >
+ * _clutter_texture_budget_mark_used:
+ * @entry: a budget entry
+ *
+ * Marks @entry as the most recently painted one.
+ */
+void
+_clutter_texture_budget_mark_used (ClutterTextureBudgetEntry *entry)
+{
+  if (budget_entries.head == &entry->link)
+    return;
+
+  g_queue_unlink (&budget_entries, &entry->link);
+  g_queue_push_head_link (&budget_entries, &entry->link);
+}
+
+/*< private >
+ * _clutter_texture_budget_new_frame:
+ *
+ * Called by the stages before painting a new frame; actors might have
+ * been unmapped since the last one, and their contents can be evicted.
+ */
+void
+_clutter_texture_budget_new_frame (void)
+{
+  clutter_texture_budget_check ();
+}
+
+void
+_clutter_texture_budget_set_limit (gsize limit)
+{
+  budget_limit = limit;
+
+  clutter_texture_budget_check ();
+}
+
+gsize
+_clutter_texture_budget_get_limit (void)
+{
+  return budget_limit;
+}
+
+gsize
+_clutter_texture_budget_get_usage (void)
+{
+  return budget_usage;
+}
+
+/*< private >
+ * _clutter_texture_budget_get_texture_size:
+ * @texture: a #CoglTexture
+ *
+ * Estimates the amount of memory used by @texture; drivers store most
+ * formats with four bytes per pixel.
+ *
+ * Return value: the size of @texture, in bytes
+ */
+gsize
+_clutter_texture_budget_get_texture_size (CoglTexture *texture)
+{
+  if (texture == NULL)
+    return 0;
+
+  return (gsize) cogl_texture_get_width (texture)
+       * (gsize) cogl_texture_get_height (texture)
+       * 4;
+}
@@ -0,0 +1,997 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:clutter-tiled-image
+ * @Title: ClutterTiledImage
+ * @Short_Description: Content for very large images
+ *
+ * #ClutterTiledImage is a #ClutterContent implementation that displays
+ * images too large to be decoded and uploaded in one go, like maps or
+ * scanned documents.
+ *
+ * The image is split into tiles at several levels of detail, each level
+ * being half the size of the previous one. When painting, only the tiles
+ * of the level matching the on-screen scale of the actor, and inside the
+ * visible part of the stage, are requested; they are decoded on worker
+ * threads by the function set with clutter_tiled_image_set_load_func(),
+ * and uploaded as they become available. Until then, the corresponding
+ * area of a coarser level is painted instead. The coarsest levels are
+ * always kept in memory, while the tiles of the other levels are
+ * released once they have not been painted for a while.
+ *
+ * |[<!-- language="C" -->
+ *   ClutterContent *content = clutter_tiled_image_new (16384, 16384);
+ *
+ *   clutter_tiled_image_set_load_func (CLUTTER_TILED_IMAGE (content),
+ *                                      decode_floor_plan_area,
+ *                                      g_object_ref (floor_plan),
+ *                                      g_object_unref);
+ *   clutter_actor_set_content (actor, content);
+ * ]|
+ *
+ * #ClutterTiledImage is available since Clutter 1.28.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include "clutter-tiled-image.h"
+
+#include "clutter-actor.h"
+#include "clutter-cairo.h"
+#include "clutter-content-private.h"
+#include "clutter-debug.h"
+#include "clutter-main.h"
+#include "clutter-paint-node.h"
+#include "clutter-paint-nodes.h"
+#include "clutter-private.h"
+#include "clutter-texture-budget-private.h"
+
+/* the size of a tile, in pixels of its level */
+#define TILE_SIZE               256
+
+/* the number of coarsest levels that are never released */
+#define N_PINNED_LEVELS         3
+
+/* the number of tile textures kept around, pinned ones excluded */
+#define MAX_CACHED_TILES        192
+
+/* the number of tiles that can be queued for loading at the same time */
+#define MAX_PENDING_LOADS       8
+
+typedef struct _LoadClosure     LoadClosure;
+typedef struct _TileRequest     TileRequest;
+typedef struct _Tile            Tile;
+
+typedef enum {
+  TILE_EMPTY,
+  TILE_LOADING,
+  TILE_LOADED,
+  TILE_FAILED
+} TileState;
+
+struct _LoadClosure
+{
+  volatile gint ref_count;
+
+  ClutterTiledImageLoadFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+};
+
+struct _Tile
+{
+  /* the level and the position of the tile, packed; see tile_key() */
+  gint64 key;
+
+  guint level;
+
+  /* in pixels of the level */
+  cairo_rectangle_int_t area;
+
+  TileState state;
+
+  CoglTexture *texture;
+
+  /* set while loading */
+  TileRequest *request;
+
+  /* the paint serial of the last paint using the tile */
+  guint last_used;
+};
+
+struct _TileRequest
+{
+  ClutterTiledImage *image;
+  LoadClosure *closure;
+
+  /* only valid while the request has not been cancelled */
+  Tile *tile;
+
+  guint level;
+  cairo_rectangle_int_t area;
+
+  guint8 *data;
+  guint row_stride;
+  gboolean loaded;
+
+  volatile gint cancelled;
+};
+
+typedef struct {
+  ClutterActorBox box;
+  float x_scale;
+  float y_scale;
+
+  ClutterPaintNode *root;
+
+  ClutterColor color;
+  ClutterScalingFilter min_filter;
+  ClutterScalingFilter mag_filter;
+} TilePaint;
+
+struct _ClutterTiledImagePrivate
+{
+  guint width;
+  guint height;
+  guint n_levels;
+
+  LoadClosure *closure;
+
+  /* gint64 key -> Tile */
+  GHashTable *tiles;
+
+  guint n_textures;
+  guint n_pending;
+
+  guint paint_serial;
+
+  ClutterTextureBudgetEntry *budget_entry;
+  gsize texture_size;
+};
+
+static GThreadPool *tile_thread_pool = NULL;
+
+static void clutter_content_iface_init (ClutterContentIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (ClutterTiledImage, clutter_tiled_image, G_TYPE_OBJECT,
+                         G_ADD_PRIVATE (ClutterTiledImage)
+                         G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_CONTENT,
+                                                clutter_content_iface_init))
+
+static inline gint64
+tile_key (guint level,
+          int   x,
+          int   y)
+{
+  return ((gint64) level << 48) | ((gint64) y << 24) | (gint64) x;
+}
+
+static LoadClosure *
+load_closure_ref (LoadClosure *closure)
+{
+  g_atomic_int_inc (&closure->ref_count);
+
+  return closure;
+}
+
+static void
+load_closure_unref (LoadClosure *closure)
+{
+  /* the last reference can be held by a request that is still
+   * running after the function has been replaced
+   */
+  if (!g_atomic_int_dec_and_test (&closure->ref_count))
+    return;
+
+  if (closure->notify != NULL)
+    closure->notify (closure->user_data);
+
+  g_slice_free (LoadClosure, closure);
+}
+
+static void
+tile_request_free (TileRequest *request)
+{
+  g_free (request->data);
+  load_closure_unref (request->closure);
+  g_object_unref (request->image);
+
+  g_slice_free (TileRequest, request);
+}
+
+static void
+clutter_tiled_image_get_level_size (ClutterTiledImage *self,
+                                    guint              level,
+                                    int               *width,
+                                    int               *height)
+{
+  ClutterTiledImagePrivate *priv = self->priv;
+  guint scale = 1 << level;
+
+  *width = (priv->width + scale - 1) / scale;
+  *height = (priv->height + scale - 1) / scale;
+}
+
+static void
+clutter_tiled_image_remove_tile (ClutterTiledImage *self,
+                                 Tile              *tile)
+{
+  ClutterTiledImagePrivate *priv = self->priv;
+
+  if (tile->request != NULL)
+    {
+      /* the worker threads cannot be interrupted, so we just detach
+       * the request; it will be skipped, or its results discarded
+       */
+      g_atomic_int_set (&tile->request->cancelled, TRUE);
+      tile->request = NULL;
+      priv->n_pending -= 1;
+    }
+
+  if (tile->texture != NULL)
+    {
+      priv->texture_size -= _clutter_texture_budget_get_texture_size (tile->texture);
+      _clutter_texture_budget_set_size (priv->budget_entry, priv->texture_size);
+
+      cogl_object_unref (tile->texture);
+      priv->n_textures -= 1;
+    }
+
+  g_hash_table_remove (priv->tiles, &tile->key);
+  g_slice_free (Tile, tile);
+}
+
+static void
+clutter_tiled_image_clear_tiles (ClutterTiledImage *self)
+{
+  GList *tiles, *l;
+
+  tiles = g_hash_table_get_values (self->priv->tiles);
+  for (l = tiles; l != NULL; l = l->next)
+    clutter_tiled_image_remove_tile (self, l->data);
+
+  g_list_free (tiles);
+}
+
+static Tile *
+clutter_tiled_image_lookup_tile (ClutterTiledImage *self,
+                                 guint              level,
+                                 int                x,
+                                 int                y)
+{
+  gint64 key = tile_key (level, x, y);
+
+  return g_hash_table_lookup (self->priv->tiles, &key);
+}
+
+static Tile *
+clutter_tiled_image_get_tile (ClutterTiledImage *self,
+                              guint              level,
+                              int                x,
+                              int                y)
+{
+  Tile *tile;
+  int level_width, level_height;
+
+  tile = clutter_tiled_image_lookup_tile (self, level, x, y);
+  if (tile != NULL)
+    return tile;
+
+  clutter_tiled_image_get_level_size (self, level, &level_width, &level_height);
+
+  tile = g_slice_new0 (Tile);
+  tile->key = tile_key (level, x, y);
+  tile->level = level;
+  tile->area.x = x * TILE_SIZE;
+  tile->area.y = y * TILE_SIZE;
+  tile->area.width = MIN (TILE_SIZE, level_width - tile->area.x);
+  tile->area.height = MIN (TILE_SIZE, level_height - tile->area.y);
+  tile->state = TILE_EMPTY;
+
+  g_hash_table_insert (self->priv->tiles, &tile->key, tile);
+
+  return tile;
+}
+
+static gboolean clutter_tiled_image_load_done (gpointer data);
+
+static void
+clutter_tiled_image_load_thread (gpointer data,
+                                 gpointer unused)
+{
+  TileRequest *request = data;
+
+  if (!g_atomic_int_get (&request->cancelled))
+    {
+      request->row_stride = request->area.width * 4;
+      request->data = g_malloc0 (request->row_stride * request->area.height);
+      request->loaded = request->closure->func (request->image,
+                                                request->level,
+                                                &request->area,
+                                                request->data,
+                                                request->row_stride,
+                                                request->closure->user_data);
+    }
+
+  clutter_threads_add_idle_full (G_PRIORITY_HIGH_IDLE,
+                                 clutter_tiled_image_load_done,
+                                 request,
+                                 NULL);
+}
+
+static gint
+clutter_tiled_image_compare_requests (gconstpointer a,
+                                      gconstpointer b,
+                                      gpointer      unused)
+{
+  const TileRequest *request_a = a;
+  const TileRequest *request_b = b;
+
+  /* load the coarser levels first, so that there is always something
+   * to paint while the finer ones are loading
+   */
+  return (gint) request_b->level - (gint) request_a->level;
+}
+
+static void
+clutter_tiled_image_queue_load (ClutterTiledImage *self,
+                                Tile              *tile)
+{
+  ClutterTiledImagePrivate *priv = self->priv;
+  TileRequest *request;
+
+  request = g_slice_new0 (TileRequest);
+  request->image = g_object_ref (self);
+  request->closure = load_closure_ref (priv->closure);
+  request->tile = tile;
+  request->level = tile->level;
+  request->area = tile->area;
+
+  tile->request = request;
+  tile->state = TILE_LOADING;
+  priv->n_pending += 1;
+
+  if (G_UNLIKELY (tile_thread_pool == NULL))
+    {
+      /* This apparently can't fail if exclusive == FALSE */
+      tile_thread_pool =
+        g_thread_pool_new (clutter_tiled_image_load_thread, NULL,
+                           CLAMP (g_get_num_processors (), 1, 4),
+                           FALSE,
+                           NULL);
+      g_thread_pool_set_sort_function (tile_thread_pool,
+                                       clutter_tiled_image_compare_requests,
+                                       NULL);
+    }
+
+  CLUTTER_NOTE (MISC, "ClutterTiledImage: %p: loading tile %d,%d of level %u",
+                self,
+                tile->area.x / TILE_SIZE,
+                tile->area.y / TILE_SIZE,
+                tile->level);
+
+  g_thread_pool_push (tile_thread_pool, request, NULL);
+}
+
+static gboolean
+clutter_tiled_image_load_done (gpointer data)
+{
+  TileRequest *request = data;
+
+  if (!request->cancelled)
+    {
+      ClutterTiledImage *self = request->image;
+      Tile *tile = request->tile;
+
+      self->priv->n_pending -= 1;
+      tile->request = NULL;
+
+      if (request->loaded)
+        tile->texture = cogl_texture_new_from_data (request->area.width,
+                                                    request->area.height,
+                                                    COGL_TEXTURE_NO_ATLAS,
+                                                    CLUTTER_CAIRO_FORMAT_ARGB32,
+                                                    COGL_PIXEL_FORMAT_ANY,
+                                                    request->row_stride,
+                                                    request->data);
+
+      if (tile->texture != NULL)
+        {
+          tile->state = TILE_LOADED;
+          self->priv->n_textures += 1;
+
+          self->priv->texture_size += _clutter_texture_budget_get_texture_size (tile->texture);
+          _clutter_texture_budget_set_size (self->priv->budget_entry,
+                                            self->priv->texture_size);
+        }
+      else
+        tile->state = TILE_FAILED;
+
+      _clutter_content_queue_redraw (CLUTTER_CONTENT (self));
+    }
+
+  tile_request_free (request);
+
+  return G_SOURCE_REMOVE;
+}
+
+static guint
+clutter_tiled_image_get_paint_level (ClutterTiledImage     *self,
+                                     ClutterActor          *actor,
+                                     const ClutterActorBox *box)
+{
+  ClutterTiledImagePrivate *priv = self->priv;
+  ClutterVertex corners[3], transformed[3];
+  float screen_width, screen_height;
+  float scale;
+  guint level, i;
+
+  clutter_vertex_init (&corners[0], box->x1, box->y1, 0.f);
+  clutter_vertex_init (&corners[1], box->x2, box->y1, 0.f);
+  clutter_vertex_init (&corners[2], box->x1, box->y2, 0.f);
+
+  for (i = 0; i < G_N_ELEMENTS (corners); i++)
+    clutter_actor_apply_transform_to_point (actor, &corners[i], &transformed[i]);
+
+  screen_width = hypotf (transformed[1].x - transformed[0].x,
+                         transformed[1].y - transformed[0].y);
+  screen_height = hypotf (transformed[2].x - transformed[0].x,
+                          transformed[2].y - transformed[0].y);
+
+  /* the number of screen pixels for each pixel of the image */
+  scale = MAX (screen_width / priv->width, screen_height / priv->height);
+  if (scale <= 0.f)
+    return priv->n_levels - 1;
+
+  /* the coarsest level that still has at least a pixel for each
+   * screen pixel
+   */
+  level = 0;
+  while (level + 1 < priv->n_levels && scale * (1 << (level + 1)) <= 1.f)
+    level += 1;
+
+  return level;
+}
+
+static gboolean
+clutter_tiled_image_get_visible_area (ClutterTiledImage     *self,
+                                      ClutterActor          *actor,
+                                      const ClutterActorBox *box,
+                                      cairo_rectangle_int_t *area)
+{
+  ClutterTiledImagePrivate *priv = self->priv;
+  ClutterActor *stage;
+  float x1, y1, x2, y2;
+  float stage_width, stage_height;
+  float box_width, box_height;
+  int i;
+
+  x1 = box->x1;
+  y1 = box->y1;
+  x2 = box->x2;
+  y2 = box->y2;
+
+  stage = clutter_actor_get_stage (actor);
+  if (stage != NULL)
+    {
+      float bx1 = G_MAXFLOAT, by1 = G_MAXFLOAT;
+      float bx2 = -G_MAXFLOAT, by2 = -G_MAXFLOAT;
+
+      clutter_actor_get_size (stage, &stage_width, &stage_height);
+
+      /* map the corners of the stage back into the actor, to find out
+       * which part of the content box can be seen
+       */
+      for (i = 0; i < 4; i++)
+        {
+          float x = (i & 1) ? stage_width : 0.f;
+          float y = (i & 2) ? stage_height : 0.f;
+          float actor_x, actor_y;
+
+          if (!clutter_actor_transform_stage_point (actor, x, y,
+                                                    &actor_x,
+                                                    &actor_y))
+            break;
+
+          bx1 = MIN (bx1, actor_x);
+          by1 = MIN (by1, actor_y);
+          bx2 = MAX (bx2, actor_x);
+          by2 = MAX (by2, actor_y);
+        }
+
+      /* if the transformation cannot be inverted we just paint
+       * the whole content box
+       */
+      if (i == 4)
+        {
+          x1 = MAX (x1, bx1);
+          y1 = MAX (y1, by1);
+          x2 = MIN (x2, bx2);
+          y2 = MIN (y2, by2);
+        }
+    }
+
+  if (x2 <= x1 || y2 <= y1)
+    return FALSE;
+
+  box_width = box->x2 - box->x1;
+  box_height = box->y2 - box->y1;
+
+  /* convert to pixels of the image */
+  x1 = floorf ((x1 - box->x1) * priv->width / box_width);
+  y1 = floorf ((y1 - box->y1) * priv->height / box_height);
+  x2 = ceilf ((x2 - box->x1) * priv->width / box_width);
+  y2 = ceilf ((y2 - box->y1) * priv->height / box_height);
+
+  area->x = CLAMP (x1, 0, priv->width);
+  area->y = CLAMP (y1, 0, priv->height);
+  area->width = CLAMP (x2, 0, priv->width) - area->x;
+  area->height = CLAMP (y2, 0, priv->height) - area->y;
+
+  return area->width > 0 && area->height > 0;
+}
+
+static void
+clutter_tiled_image_paint_area (ClutterTiledImage *self,
+                                const TilePaint   *paint,
+                                Tile              *tile,
+                                int                x,
+                                int                y,
+                                int                width,
+                                int                height)
+{
+  ClutterPaintNode *node;
+  ClutterActorBox rect;
+  float scale = 1 << tile->level;
+  float s1, t1, s2, t2;
+
+  /* map the area, in pixels of the image, inside the tile */
+  s1 = (x / scale - tile->area.x) / tile->area.width;
+  t1 = (y / scale - tile->area.y) / tile->area.height;
+  s2 = ((x + width) / scale - tile->area.x) / tile->area.width;
+  t2 = ((y + height) / scale - tile->area.y) / tile->area.height;
+
+  rect.x1 = paint->box.x1 + x * paint->x_scale;
+  rect.y1 = paint->box.y1 + y * paint->y_scale;
+  rect.x2 = paint->box.x1 + (x + width) * paint->x_scale;
+  rect.y2 = paint->box.y1 + (y + height) * paint->y_scale;
+
+  node = clutter_texture_node_new (tile->texture,
+                                   &paint->color,
+                                   paint->min_filter,
+                                   paint->mag_filter);
+  clutter_paint_node_set_name (node, "Tile");
+  clutter_paint_node_add_texture_rectangle (node, &rect,
+                                            s1, t1,
+                                            MIN (s2, 1.f), MIN (t2, 1.f));
+  clutter_paint_node_add_child (paint->root, node);
+  clutter_paint_node_unref (node);
+}
+
+static void
+clutter_tiled_image_paint_tile (ClutterTiledImage *self,
+                                const TilePaint   *paint,
+                                guint              level,
+                                int                tile_x,
+                                int                tile_y,
+                                GPtrArray         *wanted)
+{
+  ClutterTiledImagePrivate *priv = self->priv;
+  Tile *tile;
+  int x, y, width, height;
+  guint i;
+
+  /* the area of the tile, in pixels of the image */
+  x = (tile_x * TILE_SIZE) << level;
+  y = (tile_y * TILE_SIZE) << level;
+  width = MIN (TILE_SIZE << level, (int) priv->width - x);
+  height = MIN (TILE_SIZE << level, (int) priv->height - y);
+
+  tile = clutter_tiled_image_get_tile (self, level, tile_x, tile_y);
+  tile->last_used = priv->paint_serial;
+
+  if (tile->state == TILE_LOADED)
+    {
+      clutter_tiled_image_paint_area (self, paint, tile, x, y, width, height);
+      return;
+    }
+
+  if (tile->state == TILE_EMPTY)
+    g_ptr_array_add (wanted, tile);
+
+  /* the tiles are aligned, so the tile is fully inside a single tile
+   * of each of the coarser levels
+   */
+  for (i = level + 1; i < priv->n_levels; i++)
+    {
+      Tile *coarse;
+
+      coarse = clutter_tiled_image_lookup_tile (self, i,
+                                                (x >> i) / TILE_SIZE,
+                                                (y >> i) / TILE_SIZE);
+      if (coarse == NULL || coarse->state != TILE_LOADED)
+        continue;
+
+      coarse->last_used = priv->paint_serial;
+      clutter_tiled_image_paint_area (self, paint, coarse, x, y, width, height);
+      return;
+    }
+}
+
+static gint
+compare_last_used (gconstpointer a,
+                   gconstpointer b)
+{
+  const Tile *tile_a = *((const Tile **) a);
+  const Tile *tile_b = *((const Tile **) b);
+
+  if (tile_a->last_used < tile_b->last_used)
+    return -1;
+
+  if (tile_a->last_used > tile_b->last_used)
+    return 1;
+
+  return 0;
+}
+
+static void
+clutter_tiled_image_trim (ClutterTiledImage *self)
+{
+  ClutterTiledImagePrivate *priv = self->priv;
+  GPtrArray *evictable;
+  GHashTableIter iter;
+  gpointer value;
+  guint i;
+
+  evictable = g_ptr_array_new ();
+
+  g_hash_table_iter_init (&iter, priv->tiles);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      Tile *tile = value;
+
+      /* drop the loads that are not needed any more, e.g. after
+       * scrolling or zooming; we allow them to skip a paint, in case
+       * the content is painted by more than one actor
+       */
+      if (tile->state == TILE_EMPTY || tile->state == TILE_LOADING)
+        {
+          if (tile->last_used + 1 < priv->paint_serial)
+            g_ptr_array_add (evictable, tile);
+
+          continue;
+        }
+
+      if (tile->state == TILE_LOADED &&
+          tile->level + N_PINNED_LEVELS < priv->n_levels &&
+          tile->last_used != priv->paint_serial)
+        g_ptr_array_add (evictable, tile);
+    }
+
+  g_ptr_array_sort (evictable, compare_last_used);
+
+  for (i = 0; i < evictable->len; i++)
+    {
+      Tile *tile = g_ptr_array_index (evictable, i);
+
+      if (tile->state == TILE_LOADED)
+        {
+          /* release the least recently used textures first */
+          if (priv->n_textures <= MAX_CACHED_TILES)
+            continue;
+
+          CLUTTER_NOTE (MISC, "ClutterTiledImage: %p: releasing tile %d,%d of level %u",
+                        self,
+                        tile->area.x / TILE_SIZE,
+                        tile->area.y / TILE_SIZE,
+                        tile->level);
+        }
+
+      clutter_tiled_image_remove_tile (self, tile);
+    }
+
+  g_ptr_array_unref (evictable);
+}
+
+static void
+clutter_tiled_image_paint_content (ClutterContent   *content,
+                                   ClutterActor     *actor,
+                                   ClutterPaintNode *root)
+{
+  ClutterTiledImage *self = CLUTTER_TILED_IMAGE (content);
+  ClutterTiledImagePrivate *priv = self->priv;
+  cairo_rectangle_int_t area;
+  TilePaint paint;
+  GPtrArray *wanted;
+  guint level, i;
+  int tile_size, x, y;
+  Tile *tile;
+
+  if (priv->closure == NULL || priv->width == 0 || priv->height == 0)
+    return;
+
+  clutter_actor_get_content_box (actor, &paint.box);
+  if (paint.box.x2 - paint.box.x1 <= 0 || paint.box.y2 - paint.box.y1 <= 0)
+    return;
+
+  priv->paint_serial += 1;
+
+  _clutter_texture_budget_mark_used (priv->budget_entry);
+
+  paint.x_scale = (paint.box.x2 - paint.box.x1) / priv->width;
+  paint.y_scale = (paint.box.y2 - paint.box.y1) / priv->height;
+  paint.root = root;
+
+  /* ClutterTextureNode will premultiply the blend color, so we
+   * want it to be white with the paint opacity
+   */
+  paint.color.red = 255;
+  paint.color.green = 255;
+  paint.color.blue = 255;
+  paint.color.alpha = clutter_actor_get_paint_opacity (actor);
+
+  clutter_actor_get_content_scaling_filters (actor,
+                                             &paint.min_filter,
+                                             &paint.mag_filter);
+
+  wanted = g_ptr_array_new ();
+
+  /* the coarsest level fits in a single tile, and it is always loaded
+   * first, to have something to paint in place of the other levels
+   */
+  tile = clutter_tiled_image_get_tile (self, priv->n_levels - 1, 0, 0);
+  tile->last_used = priv->paint_serial;
+  if (tile->state == TILE_EMPTY)
+    g_ptr_array_add (wanted, tile);
+
+  if (clutter_tiled_image_get_visible_area (self, actor, &paint.box, &area))
+    {
+      level = clutter_tiled_image_get_paint_level (self, actor, &paint.box);
+      tile_size = TILE_SIZE << level;
+
+      for (y = area.y / tile_size;
+           y <= (area.y + area.height - 1) / tile_size;
+           y++)
+        {
+          for (x = area.x / tile_size;
+               x <= (area.x + area.width - 1) / tile_size;
+               x++)
+            clutter_tiled_image_paint_tile (self, &paint, level, x, y, wanted);
+        }
+    }
+
+  clutter_tiled_image_trim (self);
+
+  for (i = 0; i < wanted->len && priv->n_pending < MAX_PENDING_LOADS; i++)
+    {
+      tile = g_ptr_array_index (wanted, i);
+
+      if (tile->state == TILE_EMPTY)
+        clutter_tiled_image_queue_load (self, tile);
+    }
+
+  g_ptr_array_unref (wanted);
+}
+
+static gboolean
+clutter_tiled_image_get_preferred_size (ClutterContent *content,
+                                        gfloat         *width,
+                                        gfloat         *height)
+{
+  ClutterTiledImagePrivate *priv = CLUTTER_TILED_IMAGE (content)->priv;
+
+  if (priv->width == 0 || priv->height == 0)
+    return FALSE;
+
+  if (width != NULL)
+    *width = priv->width;
+
+  if (height != NULL)
+    *height = priv->height;
+
+  return TRUE;
+}
+
+static void
+clutter_tiled_image_invalidate (ClutterContent *content)
+{
+  clutter_tiled_image_clear_tiles (CLUTTER_TILED_IMAGE (content));
+}
+
+static void
+clutter_content_iface_init (ClutterContentIface *iface)
+{
+  iface->get_preferred_size = clutter_tiled_image_get_preferred_size;
+  iface->paint_content = clutter_tiled_image_paint_content;
+  iface->invalidate = clutter_tiled_image_invalidate;
+}
+
+/* releases the tiles that were not painted last, keeping the coarsest
+ * levels to paint while the others are loaded again
+ */
+static void
+clutter_tiled_image_evict (gpointer data)
+{
+  ClutterTiledImage *self = data;
+  ClutterTiledImagePrivate *priv = self->priv;
+  GList *tiles, *l;
+
+  tiles = g_hash_table_get_values (priv->tiles);
+  for (l = tiles; l != NULL; l = l->next)
+    {
+      Tile *tile = l->data;
+
+      if (tile->state == TILE_LOADED &&
+          tile->level + N_PINNED_LEVELS < priv->n_levels &&
+          tile->last_used != priv->paint_serial)
+        clutter_tiled_image_remove_tile (self, tile);
+    }
+
+  g_list_free (tiles);
+}
+
+static void
+clutter_tiled_image_finalize (GObject *gobject)
+{
+  ClutterTiledImage *self = CLUTTER_TILED_IMAGE (gobject);
+  ClutterTiledImagePrivate *priv = self->priv;
+
+  clutter_tiled_image_clear_tiles (self);
+  g_hash_table_unref (priv->tiles);
+
+  _clutter_texture_budget_remove (priv->budget_entry);
+
+  g_clear_pointer (&priv->closure, load_closure_unref);
+
+  G_OBJECT_CLASS (clutter_tiled_image_parent_class)->finalize (gobject);
+}
+
+static void
+clutter_tiled_image_class_init (ClutterTiledImageClass *klass)
+{
+  G_OBJECT_CLASS (klass)->finalize = clutter_tiled_image_finalize;
+}
+
+static void
+clutter_tiled_image_init (ClutterTiledImage *self)
+{
+  self->priv = clutter_tiled_image_get_instance_private (self);
+
+  self->priv->tiles = g_hash_table_new (g_int64_hash, g_int64_equal);
+  self->priv->n_levels = 1;
+
+  self->priv->budget_entry =
+    _clutter_texture_budget_add_for_content (CLUTTER_CONTENT (self),
+                                             clutter_tiled_image_evict);
+}
+
+/**
+ * clutter_tiled_image_new:
+ * @width: the width of the image, in pixels
+ * @height: the height of the image, in pixels
+ *
+ * Creates a new #ClutterTiledImage instance for an image of the given
+ * size.
+ *
+ * Nothing is painted until a function decoding the image is set
+ * using clutter_tiled_image_set_load_func().
+ *
+ * Return value: (transfer full): the newly created #ClutterTiledImage.
+ *   Use g_object_unref() when done.
+ *
+ * Since: 1.28
+ */
+ClutterContent *
+clutter_tiled_image_new (guint width,
+                         guint height)
+{
+  ClutterTiledImage *self;
+  ClutterTiledImagePrivate *priv;
+
+  self = g_object_new (CLUTTER_TYPE_TILED_IMAGE, NULL);
+  priv = self->priv;
+
+  priv->width = width;
+  priv->height = height;
+
+  /* halve the image until it fits in a single tile */
+  while (TRUE)
+    {
+      int level_width, level_height;
+
+      clutter_tiled_image_get_level_size (self, priv->n_levels - 1,
+                                          &level_width,
+                                          &level_height);
+      if (level_width <= TILE_SIZE && level_height <= TILE_SIZE)
+        break;
+
+      priv->n_levels += 1;
+    }
+
+  return CLUTTER_CONTENT (self);
+}
+
+/**
+ * clutter_tiled_image_set_load_func:
+ * @image: a #ClutterTiledImage
+ * @func: (allow-none): the function decoding areas of the image
+ * @user_data: (closure): data to pass to @func
+ * @notify: (allow-none): function called to release @user_data
+ *
+ * Sets the function that @image uses to decode the areas of the image
+ * it needs for painting.
+ *
+ * @func is called from worker threads; @notify is called from the
+ * main loop, once @func has been replaced and is not running any more.
+ *
+ * Setting a new function discards all the tiles decoded so far.
+ *
+ * Since: 1.28
+ */
+void
+clutter_tiled_image_set_load_func (ClutterTiledImage         *image,
+                                   ClutterTiledImageLoadFunc  func,
+                                   gpointer                   user_data,
+                                   GDestroyNotify             notify)
+{
+  ClutterTiledImagePrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_TILED_IMAGE (image));
+
+  priv = image->priv;
+
+  g_clear_pointer (&priv->closure, load_closure_unref);
+
+  if (func != NULL)
+    {
+      priv->closure = g_slice_new0 (LoadClosure);
+      priv->closure->ref_count = 1;
+      priv->closure->func = func;
+      priv->closure->user_data = user_data;
+      priv->closure->notify = notify;
+    }
+
+  clutter_content_invalidate (CLUTTER_CONTENT (image));
+}
+
+/**
+ * clutter_tiled_image_get_n_levels:
+ * @image: a #ClutterTiledImage
+ *
+ * Retrieves the number of levels of detail of @image; the coarsest
+ * level, `n_levels - 1`, fits in a single tile of 256 by 256 pixels.
+ *
+ * Return value: the number of levels
+ *
+ * Since: 1.28
+ */
+guint
+clutter_tiled_image_get_n_levels (ClutterTiledImage *image)
+{
+  g_return_val_if_fail (CLUTTER_IS_TILED_IMAGE (image), 0);
+
+  return image->priv->n_levels;
+}
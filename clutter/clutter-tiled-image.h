@@ -0,0 +1,124 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Copyright (C) 2017  Clutter contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_TILED_IMAGE_H__
+#define __CLUTTER_TILED_IMAGE_H__
+
+#if !defined(__CLUTTER_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <clutter/clutter.h> can be included directly."
+#endif
+
+#include <cairo.h>
+#include <clutter/clutter-types.h>
+
+G_BEGIN_DECLS
+
+#define CLUTTER_TYPE_TILED_IMAGE                (clutter_tiled_image_get_type ())
+#define CLUTTER_TILED_IMAGE(obj)                (G_TYPE_CHECK_INSTANCE_CAST ((obj), CLUTTER_TYPE_TILED_IMAGE, ClutterTiledImage))
+#define CLUTTER_IS_TILED_IMAGE(obj)             (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CLUTTER_TYPE_TILED_IMAGE))
+#define CLUTTER_TILED_IMAGE_CLASS(klass)        (G_TYPE_CHECK_CLASS_CAST ((klass), CLUTTER_TYPE_TILED_IMAGE, ClutterTiledImageClass))
+#define CLUTTER_IS_TILED_IMAGE_CLASS(klass)     (G_TYPE_CHECK_CLASS_TYPE ((klass), CLUTTER_TYPE_TILED_IMAGE))
+#define CLUTTER_TILED_IMAGE_GET_CLASS(obj)      (G_TYPE_INSTANCE_GET_CLASS ((obj), CLUTTER_TYPE_TILED_IMAGE, ClutterTiledImageClass))
+
+typedef struct _ClutterTiledImage               ClutterTiledImage;
+typedef struct _ClutterTiledImagePrivate        ClutterTiledImagePrivate;
+typedef struct _ClutterTiledImageClass          ClutterTiledImageClass;
+
+/**
+ * ClutterTiledImageLoadFunc:
+ * @image: the #ClutterTiledImage
+ * @level: the level of detail of the requested area; the image at
+ *   level @level is the original image scaled down by 2 to the power
+ *   of @level, rounding its size up
+ * @area: the requested area, in pixels of the image at @level
+ * @data: the buffer to fill, @area.width by @area.height pixels in the
+ *   %CLUTTER_CAIRO_FORMAT_ARGB32 format, and initially transparent
+ * @row_stride: the length of a row of @data, in bytes
+ * @user_data: the data passed to clutter_tiled_image_set_load_func()
+ *
+ * The function used by #ClutterTiledImage to decode an area of the
+ * image.
+ *
+ * This function is called from a worker thread, and it can be called
+ * for different areas at the same time.
+ *
+ * Return value: %TRUE if @data has been filled, and %FALSE if the
+ *   area could not be decoded
+ *
+ * Since: 1.28
+ */
+typedef gboolean (* ClutterTiledImageLoadFunc) (ClutterTiledImage           *image,
+                                                 guint                        level,
+                                                 const cairo_rectangle_int_t *area,
+                                                 guint8                      *data,
+                                                 guint                        row_stride,
+                                                 gpointer                     user_data);
+
+/**
+ * ClutterTiledImage:
+ *
+ * The #ClutterTiledImage structure contains
+ * private data and should only be accessed using the provided
+ * API.
+ *
+ * Since: 1.28
+ */
+struct _ClutterTiledImage
+{
+  /*< private >*/
+  GObject parent_instance;
+
+  ClutterTiledImagePrivate *priv;
+};
+
+/**
+ * ClutterTiledImageClass:
+ *
+ * The #ClutterTiledImageClass structure contains
+ * private data.
+ *
+ * Since: 1.28
+ */
+struct _ClutterTiledImageClass
+{
+  /*< private >*/
+  GObjectClass parent_class;
+
+  gpointer _padding[16];
+};
+
+CLUTTER_AVAILABLE_IN_1_28
+GType clutter_tiled_image_get_type (void) G_GNUC_CONST;
+
+CLUTTER_AVAILABLE_IN_1_28
+ClutterContent *        clutter_tiled_image_new                 (guint                      width,
+                                                                 guint                      height);
+CLUTTER_AVAILABLE_IN_1_28
+void                    clutter_tiled_image_set_load_func       (ClutterTiledImage         *image,
+                                                                 ClutterTiledImageLoadFunc  func,
+                                                                 gpointer                   user_data,
+                                                                 GDestroyNotify             notify);
+CLUTTER_AVAILABLE_IN_1_28
+guint                   clutter_tiled_image_get_n_levels        (ClutterTiledImage         *image);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_TILED_IMAGE_H__ */
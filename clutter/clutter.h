@@ -86,6 +86,7 @@
 #include "clutter-path-constraint.h"
 #include "clutter-path.h"
 #include "clutter-property-transition.h"
+#include "clutter-rope-text-buffer.h"
 #include "clutter-rotate-action.h"
 #include "clutter-scriptable.h"
 #include "clutter-script.h"
@@ -95,12 +96,14 @@
 #include "clutter-shader-types.h"
 #include "clutter-swipe-action.h"
 #include "clutter-snap-constraint.h"
+#include "clutter-sprite-batch.h"
 #include "clutter-stage.h"
 #include "clutter-stage-manager.h"
 #include "clutter-tap-action.h"
 #include "clutter-test-utils.h"
 #include "clutter-texture.h"
 #include "clutter-text.h"
+#include "clutter-tiled-image.h"
 #include "clutter-timeline.h"
 #include "clutter-transition-group.h"
 #include "clutter-transition.h"
@@ -73,6 +73,7 @@
 #include "clutter-private.h"
 #include "clutter-scriptable.h"
 #include "clutter-stage-private.h"
+#include "clutter-texture-budget-private.h"
 
 #include "deprecated/clutter-shader.h"
 #include "deprecated/clutter-texture.h"
@@ -96,6 +97,9 @@ struct _ClutterTexturePrivate
 
   ClutterTextureAsyncData *async_data;
 
+  /* the textures cannot be re-created, so they are only accounted */
+  ClutterTextureBudgetEntry *budget_entry;
+
   guint no_slice : 1;
   guint sync_actor_size : 1;
   guint repeat_x : 1;
@@ -243,6 +247,8 @@ texture_free_gl_resources (ClutterTexture *texture)
          texture handle */
       cogl_pipeline_set_layer_texture (priv->pipeline, 0, NULL);
     }
+
+  _clutter_texture_budget_set_size (priv->budget_entry, 0);
 }
 
 static void
@@ -680,6 +686,7 @@ clutter_texture_paint (ClutterActor *self)
   ClutterTexture *texture = CLUTTER_TEXTURE (self);
   ClutterTexturePrivate *priv = texture->priv;
   guint8 paint_opacity = clutter_actor_get_paint_opacity (self);
+  CoglTexture *tex;
 
   CLUTTER_NOTE (PAINT,
                 "painting texture '%s'",
@@ -689,6 +696,11 @@ clutter_texture_paint (ClutterActor *self)
   if (priv->fbo_handle != NULL)
     update_fbo (self);
 
+  tex = cogl_pipeline_get_layer_texture (priv->pipeline, 0);
+  _clutter_texture_budget_set_size (priv->budget_entry,
+                                    _clutter_texture_budget_get_texture_size (tex));
+  _clutter_texture_budget_mark_used (priv->budget_entry);
+
   cogl_pipeline_set_color4ub (priv->pipeline,
 			      paint_opacity,
                               paint_opacity,
@@ -808,6 +820,8 @@ clutter_texture_finalize (GObject *object)
 
   g_free (priv->filename);
 
+  _clutter_texture_budget_remove (priv->budget_entry);
+
   G_OBJECT_CLASS (clutter_texture_parent_class)->finalize (object);
 }
 
@@ -1322,6 +1336,8 @@ clutter_texture_init (ClutterTexture *self)
 
   g_assert (texture_template_pipeline != NULL);
   priv->pipeline = cogl_pipeline_copy (texture_template_pipeline);
+
+  priv->budget_entry = _clutter_texture_budget_add (NULL, NULL);
 }
 
 /**
@@ -36,6 +36,11 @@
  * The class uses the GLX_EXT_texture_from_pixmap OpenGL extension
  * (http://people.freedesktop.org/~davidr/GLX_EXT_texture_from_pixmap.txt)
  * if available
+ *
+ * All the #ClutterX11TexturePixmap instances displaying the same pixmap,
+ * or the same window, share their textures and their damage tracking,
+ * so showing a window in several places does not multiply the cost of
+ * keeping it up to date.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -54,11 +59,14 @@
 #include "clutter-paint-volume-private.h"
 #include "clutter-private.h"
 
+#include <math.h>
+
 #include <cogl/cogl.h>
 
 #include <cogl/cogl-texture-pixmap-x11.h>
 
 #include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
 
 #if HAVE_XCOMPOSITE
 #include <X11/extensions/Xcomposite.h>
@@ -80,6 +88,9 @@ enum
   PROP_WINDOW_OVERRIDE_REDIRECT
 };
 
+/* past this number of damaged rectangles, we update their bounding box */
+#define MAX_DAMAGE_RECTS        16
+
 enum
 {
   UPDATE_AREA,
@@ -89,6 +100,8 @@ enum
   LAST_SIGNAL
 };
 
+typedef struct _PixmapCacheEntry        PixmapCacheEntry;
+
 static ClutterX11FilterReturn
 on_x_event_filter (XEvent *xev, ClutterEvent *cev, gpointer data);
 
@@ -112,6 +125,35 @@ clutter_x11_texture_pixmap_destroyed (ClutterX11TexturePixmap *texture);
 
 static guint signals[LAST_SIGNAL] = { 0, };
 
+/* the textures and the damage object of a pixmap, shared by all the
+ * actors displaying it
+ */
+struct _PixmapCacheEntry
+{
+  Pixmap pixmap;
+
+  /* the window the pixmap was named for, if any */
+  Window window;
+  guint width, height;
+
+  int ref_count;
+
+  CoglTexture *texture;
+
+  /* a copy of texture with mipmaps, for the actors painting the pixmap
+   * heavily scaled down; it is created on demand
+   */
+  CoglTexture *mipmap_texture;
+
+  Damage damage;
+  XserverRegion damage_region;
+
+  /* ClutterX11TexturePixmap instances with automatic updates */
+  GList *automatic_views;
+
+  guint owns_pixmap : 1;
+};
+
 struct _ClutterX11TexturePixmapPrivate
 {
   Window        window;
@@ -119,7 +161,7 @@ struct _ClutterX11TexturePixmapPrivate
   guint         pixmap_width, pixmap_height;
   guint         depth;
 
-  Damage        damage;
+  PixmapCacheEntry *cache_entry;
 
   gint          window_x, window_y;
   gint          window_width, window_height;
@@ -129,13 +171,20 @@ struct _ClutterX11TexturePixmapPrivate
    * it is viewable, and isn't updated correctly. */
   guint window_mapped             : 1;
   guint destroyed                 : 1;
-  guint owns_pixmap               : 1;
   guint override_redirect         : 1;
   guint automatic_updates         : 1;
 };
 
 static int _damage_event_base = 0;
 
+/* Pixmap -> PixmapCacheEntry */
+static GHashTable *pixmap_cache = NULL;
+
+/* Window -> PixmapCacheEntry of the last pixmap named for the window
+ * since it was mapped
+ */
+static GHashTable *window_pixmap_cache = NULL;
+
 G_DEFINE_TYPE_WITH_PRIVATE (ClutterX11TexturePixmap,
                             clutter_x11_texture_pixmap,
                             CLUTTER_TYPE_TEXTURE)
@@ -144,6 +193,8 @@ static gboolean
 check_extensions (ClutterX11TexturePixmap *texture)
 {
   int damage_error;
+  int fixes_event_base, fixes_error;
+  int fixes_major = 2, fixes_minor = 0;
   Display *dpy;
 
   if (_damage_event_base)
@@ -151,6 +202,15 @@ check_extensions (ClutterX11TexturePixmap *texture)
 
   dpy = clutter_x11_get_default_display();
 
+  /* the damaged regions are fetched through XFixes */
+  if (!XFixesQueryExtension (dpy, &fixes_event_base, &fixes_error))
+    {
+      g_warning ("No XFixes extension");
+      return FALSE;
+    }
+
+  XFixesQueryVersion (dpy, &fixes_major, &fixes_minor);
+
   if (!XDamageQueryExtension (dpy, &_damage_event_base, &damage_error))
     {
       g_warning ("No Damage extension");
@@ -161,45 +221,97 @@ check_extensions (ClutterX11TexturePixmap *texture)
 }
 
 static void
-process_damage_event (ClutterX11TexturePixmap *texture,
+process_damage_event (PixmapCacheEntry   *entry,
                       XDamageNotifyEvent *damage_event)
 {
-  /* Cogl will deal with updating the texture and subtracting from the
-     damage region so we only need to queue a redraw */
-  g_signal_emit (texture, signals[QUEUE_DAMAGE_REDRAW],
-                 0,
-                 damage_event->area.x,
-                 damage_event->area.y,
-                 damage_event->area.width,
-                 damage_event->area.height);
+  Display *dpy = clutter_x11_get_default_display ();
+  XRectangle *rects, bounds;
+  GList *views, *l;
+  int i, n_rects = 0;
+
+  /* the damage object only notifies us when its region stops being
+   * empty, so we have to take the whole region out of it; then we
+   * update and redraw each damaged rectangle on its own, so that
+   * small changes do not cause the whole window to be updated
+   */
+  clutter_x11_trap_x_errors ();
+
+  XDamageSubtract (dpy, entry->damage, None, entry->damage_region);
+  rects = XFixesFetchRegionAndBounds (dpy, entry->damage_region,
+                                      &n_rects,
+                                      &bounds);
+
+  if (clutter_x11_untrap_x_errors ())
+    {
+      /* the pixmap is gone; fall back to the area of the event */
+      if (rects != NULL)
+        XFree (rects);
+
+      rects = NULL;
+      n_rects = 0;
+      bounds = damage_event->area;
+    }
+
+  /* the handlers might release the views, and the entry with them */
+  views = g_list_copy_deep (entry->automatic_views, (GCopyFunc) g_object_ref, NULL);
+
+  for (l = views; l != NULL; l = l->next)
+    {
+      ClutterX11TexturePixmap *texture = l->data;
+
+      if (rects == NULL || n_rects > MAX_DAMAGE_RECTS)
+        clutter_x11_texture_pixmap_update_area (texture,
+                                                bounds.x,
+                                                bounds.y,
+                                                bounds.width,
+                                                bounds.height);
+      else
+        {
+          for (i = 0; i < n_rects; i++)
+            clutter_x11_texture_pixmap_update_area (texture,
+                                                    rects[i].x,
+                                                    rects[i].y,
+                                                    rects[i].width,
+                                                    rects[i].height);
+        }
+    }
+
+  g_list_free_full (views, g_object_unref);
+
+  if (rects != NULL)
+    XFree (rects);
 }
 
 static ClutterX11FilterReturn
 on_x_event_filter (XEvent *xev, ClutterEvent *cev, gpointer data)
 {
-  ClutterX11TexturePixmap        *texture;
-  ClutterX11TexturePixmapPrivate *priv;
-
-  texture = CLUTTER_X11_TEXTURE_PIXMAP (data);
-
-  g_return_val_if_fail (CLUTTER_X11_IS_TEXTURE_PIXMAP (texture), \
-                        CLUTTER_X11_FILTER_CONTINUE);
-
-  priv = texture->priv;
+  PixmapCacheEntry *entry = data;
 
   if (xev->type == _damage_event_base + XDamageNotify)
     {
       XDamageNotifyEvent *dev = (XDamageNotifyEvent*)xev;
 
-      if (dev->damage != priv->damage)
+      if (dev->damage != entry->damage)
         return CLUTTER_X11_FILTER_CONTINUE;
 
-      process_damage_event (texture, dev);
+      process_damage_event (entry, dev);
     }
 
   return  CLUTTER_X11_FILTER_CONTINUE;
 }
 
+/* the backing pixmap of a window is replaced when it is mapped again,
+ * and the XID can be reused once it is destroyed, so the pixmaps named
+ * until then must not be shared with new views of the window; the
+ * views already using them keep them
+ */
+static void
+window_pixmap_cache_forget (Window window)
+{
+  if (window_pixmap_cache != NULL)
+    g_hash_table_remove (window_pixmap_cache, GSIZE_TO_POINTER (window));
+}
+
 static ClutterX11FilterReturn
 on_x_event_filter_too (XEvent *xev, ClutterEvent *cev, gpointer data)
 {
@@ -234,9 +346,11 @@ on_x_event_filter_too (XEvent *xev, ClutterEvent *cev, gpointer data)
                                                      xev->xconfigure.override_redirect);
     break;
   case UnmapNotify:
+    window_pixmap_cache_forget (priv->window);
     clutter_x11_texture_pixmap_set_mapped (texture, FALSE);
     break;
   case DestroyNotify:
+    window_pixmap_cache_forget (priv->window);
     clutter_x11_texture_pixmap_destroyed (texture);
     break;
   default:
@@ -247,48 +361,15 @@ on_x_event_filter_too (XEvent *xev, ClutterEvent *cev, gpointer data)
 }
 
 static void
-update_pixmap_damage_object (ClutterX11TexturePixmap *texture)
-{
-  ClutterX11TexturePixmapPrivate *priv = texture->priv;
-  CoglHandle cogl_texture;
-
-  /* If we already have a CoglTexturePixmapX11 then update its
-     damage object */
-  cogl_texture =
-    clutter_texture_get_cogl_texture (CLUTTER_TEXTURE (texture));
-
-  if (cogl_texture && cogl_is_texture_pixmap_x11 (cogl_texture))
-    {
-      if (priv->damage)
-        {
-          const CoglTexturePixmapX11ReportLevel report_level =
-            COGL_TEXTURE_PIXMAP_X11_DAMAGE_BOUNDING_BOX;
-          cogl_texture_pixmap_x11_set_damage_object (cogl_texture,
-                                                     priv->damage,
-                                                     report_level);
-        }
-      else
-        cogl_texture_pixmap_x11_set_damage_object (cogl_texture, 0, 0);
-    }
-}
-
-static void
-create_damage_resources (ClutterX11TexturePixmap *texture)
+create_damage_resources (PixmapCacheEntry *entry)
 {
-  ClutterX11TexturePixmapPrivate *priv;
-  Display                        *dpy;
-
-  priv = texture->priv;
-  dpy = clutter_x11_get_default_display();
-
-  if (!priv->pixmap)
-    return;
+  Display *dpy = clutter_x11_get_default_display ();
 
   clutter_x11_trap_x_errors ();
 
-  priv->damage = XDamageCreate (dpy,
-                                priv->pixmap,
-                                XDamageReportBoundingBox);
+  entry->damage = XDamageCreate (dpy,
+                                 entry->pixmap,
+                                 XDamageReportNonEmpty);
 
   /* Errors here might occur if the window is already destroyed, we
    * simply skip processing damage and assume that the texture pixmap
@@ -297,35 +378,177 @@ create_damage_resources (ClutterX11TexturePixmap *texture)
   XSync (dpy, FALSE);
   clutter_x11_untrap_x_errors ();
 
-  if (priv->damage)
+  if (entry->damage)
     {
-      clutter_x11_add_filter (on_x_event_filter, (gpointer)texture);
+      entry->damage_region = XFixesCreateRegion (dpy, NULL, 0);
 
-      update_pixmap_damage_object (texture);
+      clutter_x11_add_filter (on_x_event_filter, entry);
     }
 }
 
 static void
-free_damage_resources (ClutterX11TexturePixmap *texture)
+free_damage_resources (PixmapCacheEntry *entry)
 {
-  ClutterX11TexturePixmapPrivate *priv;
-  Display                        *dpy;
-
-  priv = texture->priv;
-  dpy = clutter_x11_get_default_display();
+  Display *dpy = clutter_x11_get_default_display ();
 
-  if (priv->damage)
+  if (entry->damage)
     {
       clutter_x11_trap_x_errors ();
-      XDamageDestroy (dpy, priv->damage);
+      XDamageDestroy (dpy, entry->damage);
       XSync (dpy, FALSE);
       clutter_x11_untrap_x_errors ();
-      priv->damage = None;
+      entry->damage = None;
+
+      XFixesDestroyRegion (dpy, entry->damage_region);
+      entry->damage_region = None;
+
+      clutter_x11_remove_filter (on_x_event_filter, entry);
+    }
+}
+
+static CoglTexture *
+create_pixmap_texture (Pixmap pixmap)
+{
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglTexturePixmapX11 *texture_pixmap;
+  GError *error = NULL;
+
+  texture_pixmap = cogl_texture_pixmap_x11_new (ctx, pixmap, FALSE, &error);
+  if (texture_pixmap == NULL)
+    {
+      g_warning ("Failed to create CoglTexturePixmapX11: %s",
+                 error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  return COGL_TEXTURE (texture_pixmap);
+}
+
+/* retrieves the shared entry of @pixmap, creating it if needed */
+static PixmapCacheEntry *
+pixmap_cache_entry_ref (Pixmap pixmap,
+                        guint  width,
+                        guint  height)
+{
+  PixmapCacheEntry *entry;
 
-      clutter_x11_remove_filter (on_x_event_filter, (gpointer)texture);
+  if (G_UNLIKELY (pixmap_cache == NULL))
+    pixmap_cache = g_hash_table_new (NULL, NULL);
 
-      update_pixmap_damage_object (texture);
+  entry = g_hash_table_lookup (pixmap_cache, GSIZE_TO_POINTER (pixmap));
+  if (entry != NULL)
+    {
+      entry->ref_count += 1;
+      return entry;
     }
+
+  entry = g_slice_new0 (PixmapCacheEntry);
+  entry->pixmap = pixmap;
+  entry->width = width;
+  entry->height = height;
+  entry->ref_count = 1;
+  entry->texture = create_pixmap_texture (pixmap);
+
+  g_hash_table_insert (pixmap_cache, GSIZE_TO_POINTER (pixmap), entry);
+
+  return entry;
+}
+
+static void
+pixmap_cache_entry_unref (PixmapCacheEntry *entry)
+{
+  entry->ref_count -= 1;
+  if (entry->ref_count > 0)
+    return;
+
+  g_assert (entry->automatic_views == NULL);
+
+  g_hash_table_remove (pixmap_cache, GSIZE_TO_POINTER (entry->pixmap));
+
+  if (entry->window != None &&
+      g_hash_table_lookup (window_pixmap_cache,
+                           GSIZE_TO_POINTER (entry->window)) == entry)
+    g_hash_table_remove (window_pixmap_cache, GSIZE_TO_POINTER (entry->window));
+
+  /* the textures use the pixmap, so they go first */
+  if (entry->texture != NULL)
+    cogl_object_unref (entry->texture);
+
+  if (entry->mipmap_texture != NULL)
+    cogl_object_unref (entry->mipmap_texture);
+
+  if (entry->owns_pixmap)
+    XFreePixmap (clutter_x11_get_default_display (), entry->pixmap);
+
+  g_slice_free (PixmapCacheEntry, entry);
+}
+
+/* marks the pixmap of @entry as named for @window, so that other
+ * actors showing @window can share it
+ */
+static void
+pixmap_cache_entry_set_window (PixmapCacheEntry *entry,
+                               Window            window)
+{
+  if (G_UNLIKELY (window_pixmap_cache == NULL))
+    window_pixmap_cache = g_hash_table_new (NULL, NULL);
+
+  entry->window = window;
+  entry->owns_pixmap = TRUE;
+
+  g_hash_table_replace (window_pixmap_cache, GSIZE_TO_POINTER (window), entry);
+}
+
+static void
+pixmap_cache_entry_add_view (PixmapCacheEntry        *entry,
+                             ClutterX11TexturePixmap *texture)
+{
+  /* one damage object serves all the actors showing the pixmap */
+  if (entry->automatic_views == NULL)
+    create_damage_resources (entry);
+
+  entry->automatic_views = g_list_prepend (entry->automatic_views, texture);
+}
+
+static void
+pixmap_cache_entry_remove_view (PixmapCacheEntry        *entry,
+                                ClutterX11TexturePixmap *texture)
+{
+  entry->automatic_views = g_list_remove (entry->automatic_views, texture);
+
+  if (entry->automatic_views == NULL)
+    free_damage_resources (entry);
+}
+
+static CoglTexture *
+pixmap_cache_entry_get_mipmap_texture (PixmapCacheEntry *entry)
+{
+  /* the shared texture would switch to the slower, mipmapped update
+   * path for every actor if we painted it with mipmaps, so we use a
+   * second texture for the pixmap instead
+   */
+  if (entry->mipmap_texture == NULL && entry->texture != NULL)
+    entry->mipmap_texture = create_pixmap_texture (entry->pixmap);
+
+  return entry->mipmap_texture;
+}
+
+static void
+pixmap_cache_entry_update_area (PixmapCacheEntry *entry,
+                                int               x,
+                                int               y,
+                                int               width,
+                                int               height)
+{
+  if (entry->texture != NULL)
+    cogl_texture_pixmap_x11_update_area (entry->texture, x, y, width, height);
+
+  if (entry->mipmap_texture != NULL)
+    cogl_texture_pixmap_x11_update_area (entry->mipmap_texture,
+                                         x, y,
+                                         width, height);
 }
 
 static gboolean
@@ -335,6 +558,108 @@ clutter_x11_texture_pixmap_get_paint_volume (ClutterActor       *self,
   return clutter_paint_volume_set_from_allocation (volume, self);
 }
 
+/* whether the pixmap is painted at less than half its size, in which
+ * case we use a mipmapped texture to avoid aliasing
+ */
+static gboolean
+clutter_x11_texture_pixmap_use_mipmaps (ClutterX11TexturePixmap *texture)
+{
+  ClutterX11TexturePixmapPrivate *priv = texture->priv;
+  ClutterVertex corners[3], transformed[3];
+  gboolean repeat_x, repeat_y;
+  ClutterActorBox box;
+  float screen_width, screen_height;
+  guint i;
+
+  if (priv->cache_entry == NULL ||
+      priv->pixmap_width == 0 ||
+      priv->pixmap_height == 0)
+    return FALSE;
+
+  /* only the default quality; the others either do not filter, or
+   * already use mipmaps
+   */
+  if (clutter_texture_get_filter_quality (CLUTTER_TEXTURE (texture)) !=
+      CLUTTER_TEXTURE_QUALITY_MEDIUM)
+    return FALSE;
+
+  /* the mipmapped texture is painted over the whole allocation, so
+   * leave the repeated and aspect-preserving layouts to ClutterTexture
+   */
+  clutter_texture_get_repeat (CLUTTER_TEXTURE (texture), &repeat_x, &repeat_y);
+  if (repeat_x || repeat_y ||
+      clutter_texture_get_keep_aspect_ratio (CLUTTER_TEXTURE (texture)))
+    return FALSE;
+
+  clutter_actor_get_allocation_box (CLUTTER_ACTOR (texture), &box);
+
+  /* the size of the actor on the stage; the modelview matrix cannot
+   * be used here, as it also holds the view transformation of the
+   * stage
+   */
+  clutter_vertex_init (&corners[0], 0.f, 0.f, 0.f);
+  clutter_vertex_init (&corners[1], box.x2 - box.x1, 0.f, 0.f);
+  clutter_vertex_init (&corners[2], 0.f, box.y2 - box.y1, 0.f);
+
+  for (i = 0; i < G_N_ELEMENTS (corners); i++)
+    clutter_actor_apply_transform_to_point (CLUTTER_ACTOR (texture),
+                                            &corners[i],
+                                            &transformed[i]);
+
+  screen_width = hypotf (transformed[1].x - transformed[0].x,
+                         transformed[1].y - transformed[0].y);
+  screen_height = hypotf (transformed[2].x - transformed[0].x,
+                          transformed[2].y - transformed[0].y);
+
+  return screen_width < priv->pixmap_width / 2.f &&
+         screen_height < priv->pixmap_height / 2.f;
+}
+
+static void
+clutter_x11_texture_pixmap_paint (ClutterActor *self)
+{
+  ClutterX11TexturePixmap *texture = CLUTTER_X11_TEXTURE_PIXMAP (self);
+  ClutterX11TexturePixmapPrivate *priv = texture->priv;
+  CoglTexture *mipmap_texture = NULL;
+  CoglPipeline *pipeline;
+  ClutterActorBox box;
+  guint8 paint_opacity;
+
+  if (clutter_x11_texture_pixmap_use_mipmaps (texture))
+    mipmap_texture = pixmap_cache_entry_get_mipmap_texture (priv->cache_entry);
+
+  if (mipmap_texture == NULL)
+    {
+      CLUTTER_ACTOR_CLASS (clutter_x11_texture_pixmap_parent_class)->paint (self);
+      return;
+    }
+
+  /* a copy of the material, to keep its layer combine and shaders */
+  pipeline =
+    cogl_pipeline_copy (clutter_texture_get_cogl_material (CLUTTER_TEXTURE (self)));
+  cogl_pipeline_set_layer_texture (pipeline, 0, mipmap_texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_LINEAR_MIPMAP_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+
+  paint_opacity = clutter_actor_get_paint_opacity (self);
+  cogl_pipeline_set_color4ub (pipeline,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity);
+
+  clutter_actor_get_allocation_box (self, &box);
+
+  cogl_framebuffer_draw_rectangle (cogl_get_draw_framebuffer (),
+                                   pipeline,
+                                   0, 0,
+                                   box.x2 - box.x1,
+                                   box.y2 - box.y1);
+
+  cogl_object_unref (pipeline);
+}
+
 static void
 clutter_x11_texture_pixmap_real_queue_damage_redraw (
                                               ClutterX11TexturePixmap *texture,
@@ -374,10 +699,11 @@ clutter_x11_texture_pixmap_real_queue_damage_redraw (
   scale_x = (allocation.x2 - allocation.x1) / priv->pixmap_width;
   scale_y = (allocation.y2 - allocation.y1) / priv->pixmap_height;
 
-  clip.x = x * scale_x;
-  clip.y = y * scale_y;
-  clip.width = width * scale_x;
-  clip.height = height * scale_y;
+  /* round outwards, so that scaled damage covers every pixel it touches */
+  clip.x = floorf (x * scale_x);
+  clip.y = floorf (y * scale_y);
+  clip.width = ceilf ((x + width) * scale_x) - clip.x;
+  clip.height = ceilf ((y + height) * scale_y) - clip.y;
   clutter_actor_queue_redraw_with_clip (self, &clip);
 }
 
@@ -394,7 +720,7 @@ clutter_x11_texture_pixmap_init (ClutterX11TexturePixmap *self)
     }
 
   self->priv->automatic_updates = FALSE;
-  self->priv->damage = None;
+  self->priv->cache_entry = NULL;
   self->priv->window = None;
   self->priv->pixmap = None;
   self->priv->pixmap_height = 0;
@@ -412,8 +738,6 @@ clutter_x11_texture_pixmap_dispose (GObject *object)
 {
   ClutterX11TexturePixmap *texture = CLUTTER_X11_TEXTURE_PIXMAP (object);
 
-  free_damage_resources (texture);
-
   clutter_x11_remove_filter (on_x_event_filter_too, (gpointer)texture);
   clutter_x11_texture_pixmap_set_pixmap (texture, None);
 
@@ -523,6 +847,7 @@ clutter_x11_texture_pixmap_class_init (ClutterX11TexturePixmapClass *klass)
   GParamSpec        *pspec;
 
   actor_class->get_paint_volume = clutter_x11_texture_pixmap_get_paint_volume;
+  actor_class->paint = clutter_x11_texture_pixmap_paint;
 
   object_class->dispose      = clutter_x11_texture_pixmap_dispose;
   object_class->set_property = clutter_x11_texture_pixmap_set_property;
@@ -716,12 +1041,10 @@ clutter_x11_texture_pixmap_update_area_real (ClutterX11TexturePixmap *texture,
                                              gint                     width,
                                              gint                     height)
 {
-  CoglHandle cogl_texture;
-
-  cogl_texture = clutter_texture_get_cogl_texture (CLUTTER_TEXTURE (texture));
+  PixmapCacheEntry *entry = texture->priv->cache_entry;
 
-  if (cogl_texture)
-    cogl_texture_pixmap_x11_update_area (cogl_texture, x, y, width, height);
+  if (entry != NULL)
+    pixmap_cache_entry_update_area (entry, x, y, width, height);
 }
 
 /**
@@ -849,20 +1172,29 @@ clutter_x11_texture_pixmap_set_pixmap (ClutterX11TexturePixmap *texture,
 
   if (priv->pixmap != pixmap)
     {
-      if (priv->pixmap && priv->owns_pixmap)
-        XFreePixmap (clutter_x11_get_default_display (), priv->pixmap);
+      /* the textures and the damage object are shared with the other
+       * actors showing the same pixmap; the pixmap is released with
+       * the last of them
+       */
+      if (priv->cache_entry != NULL)
+        {
+          if (priv->automatic_updates)
+            pixmap_cache_entry_remove_view (priv->cache_entry, texture);
+
+          pixmap_cache_entry_unref (priv->cache_entry);
+          priv->cache_entry = NULL;
+        }
 
       priv->pixmap = pixmap;
       new_pixmap = TRUE;
 
-      /* The damage object is created on the pixmap, so it needs to be
-       * recreated with a change in pixmap.
-       */
-      if (priv->automatic_updates)
-	{
-	  free_damage_resources (texture);
-	  create_damage_resources (texture);
-	}
+      if (pixmap != None)
+        {
+          priv->cache_entry = pixmap_cache_entry_ref (pixmap, width, height);
+
+          if (priv->automatic_updates)
+            pixmap_cache_entry_add_view (priv->cache_entry, texture);
+        }
     }
 
   if (priv->pixmap_width != width)
@@ -897,27 +1229,9 @@ clutter_x11_texture_pixmap_set_pixmap (ClutterX11TexturePixmap *texture,
   if (new_pixmap_depth)
     g_object_notify (G_OBJECT (texture), "pixmap-depth");
 
-  if (pixmap)
-    {
-      CoglContext *ctx =
-        clutter_backend_get_cogl_context (clutter_get_default_backend ());
-      GError *error = NULL;
-      CoglTexturePixmapX11 *texture_pixmap =
-        cogl_texture_pixmap_x11_new (ctx, pixmap, FALSE, &error);
-      if (texture_pixmap)
-        {
-          clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (texture),
-                                            COGL_TEXTURE (texture_pixmap));
-          cogl_object_unref (texture_pixmap);
-          update_pixmap_damage_object (texture);
-        }
-      else
-        {
-          g_warning ("Failed to create CoglTexturePixmapX11: %s",
-                     error->message);
-          g_error_free (error);
-        }
-    }
+  if (pixmap && priv->cache_entry->texture != NULL)
+    clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (texture),
+                                      priv->cache_entry->texture);
 
   /*
    * Keep ref until here in case a notify causes removal from the scene; can't
@@ -1040,6 +1354,7 @@ clutter_x11_texture_pixmap_sync_window_internal (ClutterX11TexturePixmap *textur
 {
   ClutterX11TexturePixmapPrivate *priv;
   Pixmap pixmap = None;
+  gboolean named = FALSE;
   gboolean mapped = FALSE;
   gboolean notify_x = FALSE;
   gboolean notify_y = FALSE;
@@ -1084,25 +1399,42 @@ clutter_x11_texture_pixmap_sync_window_internal (ClutterX11TexturePixmap *textur
        */
 
       Display *dpy = clutter_x11_get_default_display ();
+      PixmapCacheEntry *shared = NULL;
 
-      /* NB: It's only valid to name a pixmap if the window is viewable.
-       *
-       * We don't explicitly check this though since there would be a race
-       * between checking and naming unless we use a server grab which is
-       * undesireable.
-       *
-       * Instead we gracefully handle any error with naming the pixmap.
-       */
-      clutter_x11_trap_x_errors ();
-
-      pixmap = XCompositeNameWindowPixmap (dpy, priv->window);
-
-      /* Possible improvement: combine with the XGetGeometry in
-       * clutter_x11_texture_pixmap_set_pixmap() */
-      XSync(dpy, False);
+      if (window_pixmap_cache != NULL)
+        shared = g_hash_table_lookup (window_pixmap_cache,
+                                      GSIZE_TO_POINTER (priv->window));
 
-      if (clutter_x11_untrap_x_errors ())
-	pixmap = None;
+      /* another actor showing the window already named a pixmap of
+       * the right size, so we share its textures
+       */
+      if (shared != NULL &&
+          shared->width == (guint) width &&
+          shared->height == (guint) height)
+        pixmap = shared->pixmap;
+      else
+        {
+          /* NB: It's only valid to name a pixmap if the window is viewable.
+           *
+           * We don't explicitly check this though since there would be a race
+           * between checking and naming unless we use a server grab which is
+           * undesireable.
+           *
+           * Instead we gracefully handle any error with naming the pixmap.
+           */
+          clutter_x11_trap_x_errors ();
+
+          pixmap = XCompositeNameWindowPixmap (dpy, priv->window);
+
+          /* Possible improvement: combine with the XGetGeometry in
+           * clutter_x11_texture_pixmap_set_pixmap() */
+          XSync(dpy, False);
+
+          if (clutter_x11_untrap_x_errors ())
+            pixmap = None;
+          else
+            named = TRUE;
+        }
     }
 
   g_object_ref (texture); /* guard against unparent */
@@ -1114,7 +1446,11 @@ clutter_x11_texture_pixmap_sync_window_internal (ClutterX11TexturePixmap *textur
   if (pixmap)
     {
       clutter_x11_texture_pixmap_set_pixmap (texture, pixmap);
-      priv->owns_pixmap = TRUE;
+
+      if (named &&
+          priv->cache_entry != NULL &&
+          priv->cache_entry->pixmap == pixmap)
+        pixmap_cache_entry_set_window (priv->cache_entry, priv->window);
     }
 
   if (notify_override_redirect)
@@ -1261,10 +1597,13 @@ clutter_x11_texture_pixmap_set_automatic (ClutterX11TexturePixmap *texture,
   if (setting == priv->automatic_updates)
     return;
 
-  if (setting)
-    create_damage_resources (texture);
-  else
-    free_damage_resources (texture);
+  if (priv->cache_entry != NULL)
+    {
+      if (setting)
+        pixmap_cache_entry_add_view (priv->cache_entry, texture);
+      else
+        pixmap_cache_entry_remove_view (priv->cache_entry, texture);
+    }
 
   priv->automatic_updates = setting;
 }
@@ -0,0 +1,122 @@
+#include <clutter/clutter.h>
+
+typedef struct {
+  guint8 center;
+  guint8 edge;
+  guint8 outside;
+  int n_paints;
+} BlurSample;
+
+static void
+on_paint (ClutterActor *actor,
+          int          *n_paints)
+{
+  *n_paints += 1;
+}
+
+/* samples the red channel along the middle row of the actor, which
+ * covers the stage from 100 to 150
+ */
+static void
+sample_blur (ClutterActor *stage,
+             int          *n_paints,
+             const char   *what,
+             BlurSample   *sample)
+{
+  guchar *pixels;
+
+  *n_paints = 0;
+
+  clutter_actor_queue_redraw (stage);
+  pixels = clutter_stage_read_pixels (CLUTTER_STAGE (stage), 90, 125, 36, 1);
+
+  sample->center = pixels[(125 - 90) * 4];
+  sample->edge = pixels[(100 - 90) * 4];
+  sample->outside = pixels[(99 - 90) * 4];
+  sample->n_paints = *n_paints;
+
+  if (g_test_verbose ())
+    g_print ("%s: center = %d, edge = %d, outside = %d, paints = %d\n",
+             what,
+             sample->center,
+             sample->edge,
+             sample->outside,
+             sample->n_paints);
+
+  /* the middle of a big red square is still red once blurred */
+  g_assert_cmpint (sample->center, >=, 200);
+  g_assert_cmpint (pixels[(125 - 90) * 4 + 1], <=, 55);
+  g_assert_cmpint (pixels[(125 - 90) * 4 + 2], <=, 55);
+
+  /* while its edge bleeds outside of it */
+  g_assert_cmpint (sample->edge, <, 255);
+  g_assert_cmpint (sample->outside, >, 0);
+
+  g_free (pixels);
+}
+
+static void
+actor_blur_effect_radius (void)
+{
+  ClutterActor *stage, *actor;
+  ClutterEffect *effect;
+  BlurSample small, big, bigger, small_again;
+  int n_paints = 0;
+
+  if (!clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL) ||
+      !cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    return;
+
+  stage = clutter_test_get_stage ();
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_background_color (actor, CLUTTER_COLOR_Red);
+  clutter_actor_set_position (actor, 100, 100);
+  clutter_actor_set_size (actor, 50, 50);
+  clutter_actor_add_child (stage, actor);
+
+  /* the actor is only painted when the effect redraws its offscreen
+   * buffer
+   */
+  g_signal_connect (actor, "paint", G_CALLBACK (on_paint), &n_paints);
+
+  /* a small radius is blurred at full size */
+  effect = clutter_blur_effect_new ();
+  clutter_blur_effect_set_radius (CLUTTER_BLUR_EFFECT (effect), 2.f);
+  clutter_actor_add_effect (actor, effect);
+
+  clutter_actor_show (stage);
+
+  sample_blur (stage, &n_paints, "radius 2", &small);
+
+  /* a bigger radius scales the image down first, and spreads the
+   * edge further
+   */
+  clutter_blur_effect_set_radius (CLUTTER_BLUR_EFFECT (effect), 10.2f);
+  sample_blur (stage, &n_paints, "radius 10.2", &big);
+
+  g_assert_cmpint (big.edge, <, small.edge);
+  g_assert_cmpint (big.outside, >, small.outside);
+
+  /* the padding does not change, so the blur is computed again from
+   * the cached image of the actor, without redrawing it
+   */
+  clutter_blur_effect_set_radius (CLUTTER_BLUR_EFFECT (effect), 10.6f);
+  sample_blur (stage, &n_paints, "radius 10.6", &bigger);
+
+  g_assert_cmpint (bigger.n_paints, ==, 0);
+  g_assert_cmpint (bigger.edge, <, small.edge);
+  g_assert_cmpint (bigger.outside, >, small.outside);
+
+  clutter_blur_effect_set_radius (CLUTTER_BLUR_EFFECT (effect), 2.5f);
+  sample_blur (stage, &n_paints, "radius 2.5", &small_again);
+
+  g_assert_cmpint (small_again.edge, >, big.edge);
+  g_assert_cmpint (small_again.outside, <, big.outside);
+
+  clutter_actor_destroy (actor);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/blur-effect/radius", actor_blur_effect_radius)
+)
@@ -0,0 +1,175 @@
+#include <clutter/clutter.h>
+
+typedef struct _FooActor      FooActor;
+typedef struct _FooActorClass FooActorClass;
+
+struct _FooActorClass
+{
+  ClutterActorClass parent_class;
+};
+
+struct _FooActor
+{
+  ClutterActor parent;
+
+  int paint_count;
+};
+
+GType foo_actor_get_type (void) G_GNUC_CONST;
+
+G_DEFINE_TYPE (FooActor, foo_actor, CLUTTER_TYPE_ACTOR);
+
+static void
+foo_actor_paint (ClutterActor *actor)
+{
+  FooActor *foo_actor = (FooActor *) actor;
+  ClutterActorBox allocation;
+  guint8 opacity;
+
+  foo_actor->paint_count++;
+
+  clutter_actor_get_allocation_box (actor, &allocation);
+
+  /* Paint a red rectangle with the right opacity */
+  opacity = clutter_actor_get_paint_opacity (actor);
+  cogl_set_source_color4ub (255, 0, 0, opacity);
+  cogl_rectangle (0, 0,
+                  allocation.x2 - allocation.x1,
+                  allocation.y2 - allocation.y1);
+}
+
+static gboolean
+foo_actor_get_paint_volume (ClutterActor       *actor,
+                            ClutterPaintVolume *volume)
+{
+  return clutter_paint_volume_set_from_allocation (volume, actor);
+}
+
+static void
+foo_actor_class_init (FooActorClass *klass)
+{
+  ClutterActorClass *actor_class = (ClutterActorClass *) klass;
+
+  actor_class->paint = foo_actor_paint;
+  actor_class->get_paint_volume = foo_actor_get_paint_volume;
+}
+
+static void
+foo_actor_init (FooActor *self)
+{
+}
+
+static int
+paint_and_count (ClutterActor *stage,
+                 FooActor     *foo_actor,
+                 int           x,
+                 int           y)
+{
+  guchar *pixel;
+
+  foo_actor->paint_count = 0;
+
+  clutter_actor_queue_redraw (stage);
+  pixel = clutter_stage_read_pixels (CLUTTER_STAGE (stage), x, y, 1, 1);
+
+  /* the clones paint the source in red */
+  g_assert_cmpint (pixel[0], >=, 253);
+  g_assert_cmpint (pixel[1], <=, 2);
+  g_assert_cmpint (pixel[2], <=, 2);
+
+  g_free (pixel);
+
+  return foo_actor->paint_count;
+}
+
+static void
+actor_clone_cached (void)
+{
+  ClutterActor *stage;
+  ClutterActor *clone_a, *clone_b;
+  FooActor *foo_actor;
+
+  if (!cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    return;
+
+  stage = clutter_test_get_stage ();
+
+  foo_actor = g_object_new (foo_actor_get_type (), NULL);
+  clutter_actor_set_size (CLUTTER_ACTOR (foo_actor), 50, 50);
+  clutter_actor_add_child (stage, CLUTTER_ACTOR (foo_actor));
+
+  clone_a = clutter_clone_new (CLUTTER_ACTOR (foo_actor));
+  clutter_actor_set_position (clone_a, 100, 0);
+  clutter_actor_add_child (stage, clone_a);
+
+  clone_b = clutter_clone_new (CLUTTER_ACTOR (foo_actor));
+  clutter_actor_set_position (clone_b, 200, 0);
+  clutter_actor_set_size (clone_b, 100, 100);
+  clutter_actor_add_child (stage, clone_b);
+
+  clutter_actor_show (stage);
+
+  /* the source is painted once for itself and once for each clone */
+  g_assert_cmpint (paint_and_count (stage, foo_actor, 125, 25), ==, 3);
+
+  clutter_clone_set_cached (CLUTTER_CLONE (clone_a), TRUE);
+  clutter_clone_set_cached (CLUTTER_CLONE (clone_b), TRUE);
+  g_assert (clutter_clone_get_cached (CLUTTER_CLONE (clone_a)));
+
+  /* the clones share a single snapshot of the source */
+  g_assert_cmpint (paint_and_count (stage, foo_actor, 125, 25), ==, 2);
+
+  /* the snapshot is reused while the source does not change */
+  g_assert_cmpint (paint_and_count (stage, foo_actor, 275, 75), ==, 1);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (foo_actor));
+  g_assert_cmpint (paint_and_count (stage, foo_actor, 125, 25), ==, 2);
+
+  clutter_clone_set_cached (CLUTTER_CLONE (clone_b), FALSE);
+  g_assert_cmpint (paint_and_count (stage, foo_actor, 275, 75), ==, 2);
+
+  clutter_actor_destroy (clone_a);
+  clutter_actor_destroy (clone_b);
+  clutter_actor_destroy (CLUTTER_ACTOR (foo_actor));
+}
+
+static void
+actor_clone_cached_destroy_source (void)
+{
+  ClutterActor *stage;
+  ClutterActor *clone;
+  FooActor *foo_actor;
+
+  if (!cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    return;
+
+  stage = clutter_test_get_stage ();
+
+  foo_actor = g_object_new (foo_actor_get_type (), NULL);
+  clutter_actor_set_size (CLUTTER_ACTOR (foo_actor), 50, 50);
+  clutter_actor_add_child (stage, CLUTTER_ACTOR (foo_actor));
+
+  clone = clutter_clone_new (CLUTTER_ACTOR (foo_actor));
+  clutter_clone_set_cached (CLUTTER_CLONE (clone), TRUE);
+  clutter_actor_set_position (clone, 100, 0);
+  clutter_actor_add_child (stage, clone);
+
+  clutter_actor_show (stage);
+
+  g_assert_cmpint (paint_and_count (stage, foo_actor, 125, 25), ==, 2);
+
+  /* the clone holds the last reference on the source, and the snapshot
+   * must be released before it
+   */
+  clutter_actor_destroy (CLUTTER_ACTOR (foo_actor));
+
+  clutter_actor_queue_redraw (stage);
+  g_free (clutter_stage_read_pixels (CLUTTER_STAGE (stage), 125, 25, 1, 1));
+
+  clutter_actor_destroy (clone);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/clone/cached", actor_clone_cached)
+  CLUTTER_TEST_UNIT ("/actor/clone/cached-destroy-source", actor_clone_cached_destroy_source)
+)
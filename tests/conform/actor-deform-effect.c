@@ -0,0 +1,114 @@
+#include <clutter/clutter.h>
+
+typedef struct _FooDeformEffect         FooDeformEffect;
+typedef struct _FooDeformEffectClass    FooDeformEffectClass;
+
+struct _FooDeformEffect
+{
+  ClutterDeformEffect parent_instance;
+};
+
+struct _FooDeformEffectClass
+{
+  ClutterDeformEffectClass parent_class;
+};
+
+GType foo_deform_effect_get_type (void) G_GNUC_CONST;
+
+G_DEFINE_TYPE (FooDeformEffect, foo_deform_effect, CLUTTER_TYPE_DEFORM_EFFECT)
+
+/* squeezes the actor into its left half */
+static void
+foo_deform_effect_deform_vertex (ClutterDeformEffect *effect,
+                                 gfloat               width,
+                                 gfloat               height,
+                                 CoglTextureVertex   *vertex)
+{
+  vertex->x *= 0.5f;
+}
+
+static void
+foo_deform_effect_class_init (FooDeformEffectClass *klass)
+{
+  ClutterDeformEffectClass *deform_class = CLUTTER_DEFORM_EFFECT_CLASS (klass);
+
+  deform_class->deform_vertex = foo_deform_effect_deform_vertex;
+}
+
+static void
+foo_deform_effect_init (FooDeformEffect *self)
+{
+}
+
+static void
+check_pixels (ClutterActor *stage,
+              const char   *what)
+{
+  guchar *pixels;
+
+  clutter_actor_queue_redraw (stage);
+  pixels = clutter_stage_read_pixels (CLUTTER_STAGE (stage), 110, 125, 30, 1);
+
+  if (g_test_verbose ())
+    g_print ("%s: left = %d, %d, %d; right = %d, %d, %d\n",
+             what,
+             pixels[0], pixels[1], pixels[2],
+             pixels[29 * 4], pixels[29 * 4 + 1], pixels[29 * 4 + 2]);
+
+  /* the left half of the actor is red... */
+  g_assert_cmpint (pixels[0], >=, 200);
+  g_assert_cmpint (pixels[1], <=, 55);
+  g_assert_cmpint (pixels[2], <=, 55);
+
+  /* ...and the right half is empty */
+  g_assert_cmpint (pixels[29 * 4], <=, 55);
+
+  g_free (pixels);
+}
+
+static void
+actor_deform_effect_vertex_shader (void)
+{
+  ClutterActor *stage, *actor;
+  ClutterDeformEffect *effect;
+  const float factor = 0.5f;
+  gboolean res;
+
+  if (!cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    return;
+
+  stage = clutter_test_get_stage ();
+  clutter_actor_set_background_color (stage, CLUTTER_COLOR_Black);
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_background_color (actor, CLUTTER_COLOR_Red);
+  clutter_actor_set_position (actor, 100, 100);
+  clutter_actor_set_size (actor, 50, 50);
+  clutter_actor_add_child (stage, actor);
+
+  effect = g_object_new (foo_deform_effect_get_type (), NULL);
+  clutter_actor_add_effect (actor, CLUTTER_EFFECT (effect));
+
+  clutter_actor_show (stage);
+
+  check_pixels (stage, "deform_vertex");
+
+  /* without GLSL, the deformation is still computed on the CPU */
+  res = clutter_deform_effect_set_vertex_shader (effect,
+                                                 "uniform float factor;\n",
+                                                 "position.x *= factor;");
+  g_assert (res == clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL));
+
+  clutter_deform_effect_set_uniform_float (effect, "factor", 1, 1, &factor);
+  check_pixels (stage, "vertex shader");
+
+  /* going back to the CPU uploads the deformed grid again */
+  g_assert (!clutter_deform_effect_set_vertex_shader (effect, NULL, NULL));
+  check_pixels (stage, "deform_vertex again");
+
+  clutter_actor_destroy (actor);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/deform-effect/vertex-shader", actor_deform_effect_vertex_shader)
+)
@@ -1,3 +1,5 @@
+#include <string.h>
+#include <glib/gstdio.h>
 #include <clutter/clutter.h>
 
 static void
@@ -86,7 +88,79 @@ actor_margin_layout (void)
   clutter_test_assert_actor_at_point (stage, &p, flower[2]);
 }
 
+static void
+actor_layout_profiler (void)
+{
+  GError *error = NULL;
+  gchar *filename, *contents, *second;
+  gint fd;
+
+  /* the profiler is enabled when Clutter is initialized, so the
+   * layout runs inside a child process
+   */
+  if (g_test_subprocess ())
+    {
+      ClutterActor *stage = clutter_test_get_stage ();
+      ClutterActor *vase, *flower;
+      ClutterPoint p;
+
+      vase = clutter_actor_new ();
+      clutter_actor_set_name (vase, "Vase");
+      clutter_actor_set_layout_manager (vase, clutter_box_layout_new ());
+      clutter_actor_add_child (stage, vase);
+
+      flower = clutter_actor_new ();
+      clutter_actor_set_size (flower, 100, 100);
+      clutter_actor_set_name (flower, "Red Flower");
+      clutter_actor_add_child (vase, flower);
+
+      clutter_point_init (&p, 50, 50);
+      clutter_test_assert_actor_at_point (stage, &p, flower);
+
+      /* the new actor might get the address of the destroyed one */
+      clutter_actor_destroy (flower);
+
+      flower = clutter_actor_new ();
+      clutter_actor_set_size (flower, 100, 100);
+      clutter_actor_set_name (flower, "Yellow Flower");
+      clutter_actor_add_child (vase, flower);
+
+      clutter_test_assert_actor_at_point (stage, &p, flower);
+      return;
+    }
+
+  fd = g_file_open_tmp ("clutter-layout-profile-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  g_close (fd, NULL);
+
+  g_setenv ("CLUTTER_LAYOUT_PROFILE", filename, TRUE);
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_unsetenv ("CLUTTER_LAYOUT_PROFILE");
+  g_test_trap_assert_passed ();
+
+  g_assert (g_file_get_contents (filename, &contents, NULL, &error));
+  g_assert_no_error (error);
+
+  if (g_test_verbose ())
+    g_print ("%s", contents);
+
+  g_assert (strstr (contents, "# relayout 1 of ") != NULL);
+  g_assert (strstr (contents, "# actor: ClutterActor 'Vase' [ClutterBoxLayout]") != NULL);
+  g_assert (strstr (contents, "'Red Flower':allocate ") != NULL);
+
+  /* every block only reports the actors laid out since the last one */
+  second = strstr (contents, "# relayout 2 of ");
+  g_assert (second != NULL);
+  g_assert (strstr (second, "# actor: ClutterActor 'Yellow Flower'") != NULL);
+  g_assert (strstr (second, "# actor: ClutterActor 'Red Flower'") == NULL);
+
+  g_free (contents);
+  g_unlink (filename);
+  g_free (filename);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/actor/layout/basic", actor_basic_layout)
   CLUTTER_TEST_UNIT ("/actor/layout/margin", actor_margin_layout)
+  CLUTTER_TEST_UNIT ("/actor/layout/profiler", actor_layout_profiler)
 )
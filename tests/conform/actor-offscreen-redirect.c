@@ -189,15 +189,32 @@ verify_redraws (gpointer user_data)
   clutter_actor_queue_redraw (data->child);
   verify_redraw (data, 1);
 
-  /* Modifying the transformation on the parent should cause a
-     redraw */
+  /* Translating the parent should only move the cached image */
   clutter_actor_set_anchor_point (data->parent_container, 0, 1);
+  verify_redraw (data, 0);
+
+  /* And so should moving the actor itself */
+  clutter_actor_set_position (data->container, 0, 1);
+  verify_redraw (data, 0);
+
+  /* Any other change of the transformation on the parent should
+     cause a redraw */
+  clutter_actor_set_scale (data->parent_container, 2.0, 2.0);
   verify_redraw (data, 1);
 
   /* Redrawing an unrelated actor shouldn't cause a redraw */
   clutter_actor_set_position (data->unrelated_actor, 0, 1);
   verify_redraw (data, 0);
 
+  /* A child out of the plane of the actor moves by a different
+     amount, so translating the parent should then cause a redraw */
+  clutter_actor_set_translation (data->child, 0, 0, 10);
+  verify_redraw (data, 1);
+  clutter_actor_set_anchor_point (data->parent_container, 0, 2);
+  verify_redraw (data, 1);
+  clutter_actor_set_translation (data->child, 0, 0, 0);
+  verify_redraw (data, 1);
+
   data->was_painted = TRUE;
 
   return G_SOURCE_REMOVE;
@@ -343,6 +360,75 @@ actor_offscreen_redirect (void)
     g_main_context_iteration (NULL, FALSE);
 }
 
+static void
+paint_stage (ClutterActor *stage)
+{
+  GMainLoop *main_loop = g_main_loop_new (NULL, TRUE);
+  guint paint_handler;
+
+  paint_handler = g_signal_connect_data (stage,
+                                         "paint",
+                                         G_CALLBACK (g_main_loop_quit),
+                                         main_loop,
+                                         NULL,
+                                         G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+
+  clutter_actor_queue_redraw (stage);
+  g_main_loop_run (main_loop);
+
+  g_signal_handler_disconnect (stage, paint_handler);
+  g_main_loop_unref (main_loop);
+}
+
+static void
+actor_offscreen_redirect_shared_pool (void)
+{
+  ClutterActor *stage;
+  ClutterActor *containers[2];
+  FooActor *foo_actors[2];
+  int i, frame;
+
+  if (!cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    return;
+
+  stage = clutter_test_get_stage ();
+
+  /* two cached actors of the same size borrow their render targets
+   * from the same bucket of the offscreen pool of the stage
+   */
+  for (i = 0; i < 2; i++)
+    {
+      containers[i] = clutter_actor_new ();
+      clutter_actor_set_position (containers[i], i * 100, 0);
+      clutter_actor_set_offscreen_redirect (containers[i],
+                                            CLUTTER_OFFSCREEN_REDIRECT_ALWAYS);
+
+      foo_actors[i] = g_object_new (foo_actor_get_type (), NULL);
+      clutter_actor_set_size (CLUTTER_ACTOR (foo_actors[i]), 50, 50);
+
+      clutter_actor_add_child (containers[i], CLUTTER_ACTOR (foo_actors[i]));
+      clutter_actor_add_child (stage, containers[i]);
+    }
+
+  clutter_actor_show (stage);
+
+  /* the first frame fills both caches */
+  paint_stage (stage);
+
+  for (frame = 0; frame < 3; frame++)
+    {
+      foo_actors[0]->paint_count = 0;
+      foo_actors[1]->paint_count = 0;
+
+      paint_stage (stage);
+
+      /* neither actor takes the target of the other one */
+      g_assert_cmpint (foo_actors[0]->paint_count, ==, 0);
+      g_assert_cmpint (foo_actors[1]->paint_count, ==, 0);
+    }
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/actor/offscreen/redirect", actor_offscreen_redirect)
+  CLUTTER_TEST_UNIT ("/actor/offscreen/shared-pool", actor_offscreen_redirect_shared_pool)
 )
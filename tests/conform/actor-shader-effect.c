@@ -279,6 +279,84 @@ actor_shader_effect (void)
     g_main_context_iteration (NULL, FALSE);
 }
 
+static ClutterActor *
+make_shared_actor (float red,
+                   float green,
+                   float blue)
+{
+  ClutterActor *rect;
+  ClutterEffect *effect;
+  const ClutterColor white = { 0xff, 0xff, 0xff, 0xff };
+
+  rect = clutter_rectangle_new ();
+  clutter_rectangle_set_color (CLUTTER_RECTANGLE (rect), &white);
+  clutter_actor_set_size (rect, 50, 50);
+
+  effect = clutter_shader_effect_new (CLUTTER_FRAGMENT_SHADER);
+  clutter_shader_effect_set_shader_source (CLUTTER_SHADER_EFFECT (effect),
+                                           old_shader_effect_source);
+  clutter_shader_effect_set_uniform (CLUTTER_SHADER_EFFECT (effect),
+                                     "override_color",
+                                     G_TYPE_FLOAT, 3,
+                                     red, green, blue);
+
+  clutter_actor_add_effect_with_name (rect, "shader", effect);
+
+  return rect;
+}
+
+static void
+shared_paint_cb (ClutterStage *stage,
+                 gpointer      data)
+{
+  gboolean *was_painted = data;
+
+  g_assert_cmpint (get_pixel (50, 50), ==, 0xff0000);
+  g_assert_cmpint (get_pixel (150, 50), ==, 0x0000ff);
+
+  *was_painted = TRUE;
+}
+
+static void
+actor_shader_effect_shared (void)
+{
+  ClutterActor *stage;
+  ClutterActor *rect_a, *rect_b;
+  ClutterShaderEffect *effect_a, *effect_b;
+  gboolean was_painted;
+
+  if (!clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
+    return;
+
+  stage = clutter_stage_new ();
+
+  rect_a = make_shared_actor (1.0f, 0.0f, 0.0f);
+  clutter_actor_add_child (stage, rect_a);
+
+  rect_b = make_shared_actor (0.0f, 0.0f, 1.0f);
+  clutter_actor_set_x (rect_b, 100);
+  clutter_actor_add_child (stage, rect_b);
+
+  /* effects with the same source share the program... */
+  effect_a = CLUTTER_SHADER_EFFECT (clutter_actor_get_effect (rect_a, "shader"));
+  effect_b = CLUTTER_SHADER_EFFECT (clutter_actor_get_effect (rect_b, "shader"));
+  g_assert (clutter_shader_effect_get_program (effect_a) != COGL_INVALID_HANDLE);
+  g_assert (clutter_shader_effect_get_program (effect_a) ==
+            clutter_shader_effect_get_program (effect_b));
+
+  clutter_actor_show (stage);
+
+  /* ...but not the uniforms */
+  was_painted = FALSE;
+  g_signal_connect (stage, "after-paint",
+                    G_CALLBACK (shared_paint_cb),
+                    &was_painted);
+
+  while (!was_painted)
+    g_main_context_iteration (NULL, FALSE);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/actor/shader-effect", actor_shader_effect)
+  CLUTTER_TEST_UNIT ("/actor/shader-effect/shared", actor_shader_effect_shared)
 )
@@ -0,0 +1,136 @@
+#include <clutter/clutter.h>
+
+typedef struct {
+  int n_draws;
+  double clip_x1, clip_y1, clip_x2, clip_y2;
+} DrawData;
+
+static gboolean
+on_draw (ClutterCanvas *canvas,
+         cairo_t       *cr,
+         int            width,
+         int            height,
+         DrawData      *data)
+{
+  data->n_draws += 1;
+
+  cairo_clip_extents (cr,
+                      &data->clip_x1, &data->clip_y1,
+                      &data->clip_x2, &data->clip_y2);
+
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_rgba (cr, 1.0, 0.0, 0.0, 1.0);
+  cairo_paint (cr);
+
+  return TRUE;
+}
+
+static void
+canvas_invalidate_rect (void)
+{
+  ClutterContent *canvas;
+  cairo_rectangle_int_t rect;
+  DrawData data = { 0, };
+
+  canvas = clutter_canvas_new ();
+  clutter_canvas_set_scale_factor (CLUTTER_CANVAS (canvas), 1);
+  g_signal_connect (canvas, "draw", G_CALLBACK (on_draw), &data);
+
+  /* a canvas that was never drawn is drawn in full */
+  clutter_canvas_set_size (CLUTTER_CANVAS (canvas), 100, 50);
+  g_assert_cmpint (data.n_draws, ==, 1);
+  g_assert_cmpfloat (data.clip_x1, ==, 0.0);
+  g_assert_cmpfloat (data.clip_y1, ==, 0.0);
+  g_assert_cmpfloat (data.clip_x2, ==, 100.0);
+  g_assert_cmpfloat (data.clip_y2, ==, 50.0);
+
+  /* a partial invalidation clips the drawing */
+  rect.x = 10;
+  rect.y = 20;
+  rect.width = 30;
+  rect.height = 5;
+  clutter_canvas_invalidate_rect (CLUTTER_CANVAS (canvas), &rect);
+  g_assert_cmpint (data.n_draws, ==, 2);
+  g_assert_cmpfloat (data.clip_x1, ==, 10.0);
+  g_assert_cmpfloat (data.clip_y1, ==, 20.0);
+  g_assert_cmpfloat (data.clip_x2, ==, 40.0);
+  g_assert_cmpfloat (data.clip_y2, ==, 25.0);
+
+  /* the area is clamped to the canvas */
+  rect.x = 90;
+  rect.y = -10;
+  rect.width = 30;
+  rect.height = 20;
+  clutter_canvas_invalidate_rect (CLUTTER_CANVAS (canvas), &rect);
+  g_assert_cmpint (data.n_draws, ==, 3);
+  g_assert_cmpfloat (data.clip_x1, ==, 90.0);
+  g_assert_cmpfloat (data.clip_y1, ==, 0.0);
+  g_assert_cmpfloat (data.clip_x2, ==, 100.0);
+  g_assert_cmpfloat (data.clip_y2, ==, 10.0);
+
+  /* areas outside of the canvas are ignored */
+  rect.x = 200;
+  rect.y = 0;
+  rect.width = 10;
+  rect.height = 10;
+  clutter_canvas_invalidate_rect (CLUTTER_CANVAS (canvas), &rect);
+  g_assert_cmpint (data.n_draws, ==, 3);
+
+  g_object_unref (canvas);
+}
+
+typedef struct {
+  GThread *main_thread;
+  GThread *draw_thread;
+  int width;
+  int height;
+  volatile gint n_draws;
+} AsyncDrawData;
+
+static gboolean
+on_async_draw (ClutterCanvas *canvas,
+               cairo_t       *cr,
+               int            width,
+               int            height,
+               AsyncDrawData *data)
+{
+  data->draw_thread = g_thread_self ();
+  data->width = width;
+  data->height = height;
+
+  g_atomic_int_inc (&data->n_draws);
+
+  return TRUE;
+}
+
+static void
+canvas_async_draw (void)
+{
+  ClutterContent *canvas;
+  AsyncDrawData data = { 0, };
+
+  data.main_thread = g_thread_self ();
+
+  canvas = clutter_canvas_new ();
+  clutter_canvas_set_scale_factor (CLUTTER_CANVAS (canvas), 1);
+  clutter_canvas_set_async_draw (CLUTTER_CANVAS (canvas), TRUE);
+  g_assert (clutter_canvas_get_async_draw (CLUTTER_CANVAS (canvas)));
+
+  g_signal_connect (canvas, "draw", G_CALLBACK (on_async_draw), &data);
+
+  clutter_canvas_set_size (CLUTTER_CANVAS (canvas), 64, 32);
+
+  while (g_atomic_int_get (&data.n_draws) == 0)
+    g_main_context_iteration (NULL, FALSE);
+
+  g_assert (data.draw_thread != data.main_thread);
+  g_assert_cmpint (data.width, ==, 64);
+  g_assert_cmpint (data.height, ==, 32);
+
+  g_object_unref (canvas);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/canvas/invalidate-rect", canvas_invalidate_rect)
+  CLUTTER_TEST_UNIT ("/canvas/async-draw", canvas_async_draw)
+)
@@ -0,0 +1,131 @@
+#include <clutter/clutter.h>
+
+static void
+grid_layout_child_at (void)
+{
+  ClutterLayoutManager *manager;
+  ClutterGridLayout *grid;
+  ClutterActor *box;
+  ClutterActor *a, *b, *c;
+
+  manager = clutter_grid_layout_new ();
+  grid = CLUTTER_GRID_LAYOUT (manager);
+
+  box = clutter_actor_new ();
+  clutter_actor_set_layout_manager (box, manager);
+  g_object_ref_sink (box);
+
+  a = clutter_actor_new ();
+  clutter_grid_layout_attach (grid, a, 0, 0, 2, 1);
+
+  b = clutter_actor_new ();
+  clutter_grid_layout_attach (grid, b, 0, 1, 1, 1);
+
+  c = clutter_actor_new ();
+  clutter_grid_layout_attach_next_to (grid, c, b, CLUTTER_GRID_POSITION_RIGHT, 1, 1);
+
+  g_assert (clutter_grid_layout_get_child_at (grid, 0, 0) == a);
+  g_assert (clutter_grid_layout_get_child_at (grid, 1, 0) == a);
+  g_assert (clutter_grid_layout_get_child_at (grid, 0, 1) == b);
+  g_assert (clutter_grid_layout_get_child_at (grid, 1, 1) == c);
+  g_assert_null (clutter_grid_layout_get_child_at (grid, 2, 0));
+
+  /* moving a child updates the cells it covers */
+  clutter_layout_manager_child_set (manager, CLUTTER_CONTAINER (box), c,
+                                    "left-attach", 3,
+                                    NULL);
+  g_assert_null (clutter_grid_layout_get_child_at (grid, 1, 1));
+  g_assert (clutter_grid_layout_get_child_at (grid, 3, 1) == c);
+
+  /* inserting a row shifts the children below it */
+  clutter_grid_layout_insert_row (grid, 1);
+  g_assert_null (clutter_grid_layout_get_child_at (grid, 0, 1));
+  g_assert (clutter_grid_layout_get_child_at (grid, 0, 2) == b);
+  g_assert (clutter_grid_layout_get_child_at (grid, 3, 2) == c);
+
+  /* removing a child removes it from the grid */
+  clutter_actor_remove_child (box, b);
+  g_assert_null (clutter_grid_layout_get_child_at (grid, 0, 2));
+  g_assert (clutter_grid_layout_get_child_at (grid, 3, 2) == c);
+
+  clutter_actor_destroy (box);
+  g_object_unref (box);
+}
+
+static void
+grid_layout_overlap (void)
+{
+  ClutterGridLayout *grid;
+  ClutterActor *box;
+  ClutterActor *a, *b;
+
+  grid = CLUTTER_GRID_LAYOUT (clutter_grid_layout_new ());
+
+  box = clutter_actor_new ();
+  clutter_actor_set_layout_manager (box, CLUTTER_LAYOUT_MANAGER (grid));
+  g_object_ref_sink (box);
+
+  a = clutter_actor_new ();
+  clutter_grid_layout_attach (grid, a, 0, 0, 2, 2);
+
+  b = clutter_actor_new ();
+  clutter_grid_layout_attach (grid, b, 1, 1, 1, 1);
+
+  /* the first child covering a cell wins */
+  g_assert (clutter_grid_layout_get_child_at (grid, 1, 1) == a);
+
+  clutter_actor_remove_child (box, a);
+  g_assert (clutter_grid_layout_get_child_at (grid, 1, 1) == b);
+  g_assert_null (clutter_grid_layout_get_child_at (grid, 0, 0));
+
+  clutter_actor_destroy (box);
+  g_object_unref (box);
+}
+
+static void
+grid_layout_size (void)
+{
+  ClutterGridLayout *grid;
+  ClutterActor *box;
+  ClutterActor *child;
+  gfloat min_width, nat_width, min_height, nat_height;
+  int i;
+
+  grid = CLUTTER_GRID_LAYOUT (clutter_grid_layout_new ());
+  clutter_grid_layout_set_column_spacing (grid, 10);
+
+  box = clutter_actor_new ();
+  clutter_actor_set_layout_manager (box, CLUTTER_LAYOUT_MANAGER (grid));
+  g_object_ref_sink (box);
+
+  for (i = 0; i < 3; i++)
+    {
+      child = clutter_actor_new ();
+      clutter_actor_set_size (child, 100, 50);
+      clutter_grid_layout_attach (grid, child, i, 0, 1, 1);
+    }
+
+  clutter_actor_get_preferred_width (box, -1, &min_width, &nat_width);
+  g_assert_cmpfloat (nat_width, ==, 320);
+
+  clutter_actor_get_preferred_height (box, nat_width, &min_height, &nat_height);
+  g_assert_cmpfloat (nat_height, ==, 50);
+
+  /* growing a child invalidates the cached requests */
+  clutter_actor_set_size (child, 200, 80);
+
+  clutter_actor_get_preferred_width (box, -1, &min_width, &nat_width);
+  g_assert_cmpfloat (nat_width, ==, 420);
+
+  clutter_actor_get_preferred_height (box, nat_width, &min_height, &nat_height);
+  g_assert_cmpfloat (nat_height, ==, 80);
+
+  clutter_actor_destroy (box);
+  g_object_unref (box);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/grid-layout/child-at", grid_layout_child_at)
+  CLUTTER_TEST_UNIT ("/grid-layout/overlap", grid_layout_overlap)
+  CLUTTER_TEST_UNIT ("/grid-layout/size", grid_layout_size)
+)
@@ -0,0 +1,351 @@
+#define CLUTTER_ENABLE_EXPERIMENTAL_API
+#include <clutter/clutter.h>
+
+static const guint8 red_pixels[] = {
+  0xff, 0x00, 0x00, 0xff,  0xff, 0x00, 0x00, 0xff,
+  0xff, 0x00, 0x00, 0xff,  0xff, 0x00, 0x00, 0xff,
+};
+
+static const guint8 blue_pixels[] = {
+  0x00, 0x00, 0xff, 0xff,  0x00, 0x00, 0xff, 0xff,
+  0x00, 0x00, 0xff, 0xff,  0x00, 0x00, 0xff, 0xff,
+};
+
+static void
+image_reuse_texture (void)
+{
+  ClutterContent *image;
+  CoglTexture *texture;
+  GError *error = NULL;
+
+  image = clutter_image_new ();
+
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          red_pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          2, 2, 8,
+                          &error);
+  g_assert_no_error (error);
+
+  texture = clutter_image_get_texture (CLUTTER_IMAGE (image));
+  g_assert (texture != NULL);
+
+  /* same size: the texture is updated in place */
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          blue_pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          2, 2, 8,
+                          &error);
+  g_assert_no_error (error);
+  g_assert (clutter_image_get_texture (CLUTTER_IMAGE (image)) == texture);
+
+  /* different size: a new texture is created */
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          blue_pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          4, 1, 16,
+                          &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (cogl_texture_get_width (clutter_image_get_texture (CLUTTER_IMAGE (image))), ==, 4);
+
+  g_object_unref (image);
+}
+
+typedef struct {
+  int n_done;
+  int n_cancelled;
+} AsyncData;
+
+static void
+on_set_bytes (GObject      *source,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  AsyncData *data = user_data;
+  GError *error = NULL;
+
+  if (clutter_image_set_bytes_finish (CLUTTER_IMAGE (source), result, &error))
+    data->n_done += 1;
+  else
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+      g_error_free (error);
+
+      data->n_cancelled += 1;
+    }
+}
+
+static void
+image_set_bytes_async (void)
+{
+  ClutterContent *image;
+  AsyncData data = { 0, };
+  GBytes *red, *blue;
+  gfloat width, height;
+
+  image = clutter_image_new ();
+
+  red = g_bytes_new_static (red_pixels, sizeof (red_pixels));
+  blue = g_bytes_new_static (blue_pixels, sizeof (blue_pixels));
+
+  clutter_image_set_bytes_async (CLUTTER_IMAGE (image), red,
+                                 COGL_PIXEL_FORMAT_RGBA_8888,
+                                 2, 2, 8,
+                                 NULL,
+                                 on_set_bytes, &data);
+
+  /* the size is known before the upload */
+  g_assert (clutter_content_get_preferred_size (image, &width, &height));
+  g_assert_cmpfloat (width, ==, 2);
+  g_assert_cmpfloat (height, ==, 2);
+
+  /* newer data replaces the pending one */
+  clutter_image_set_bytes_async (CLUTTER_IMAGE (image), blue,
+                                 COGL_PIXEL_FORMAT_RGBA_8888,
+                                 4, 1, 16,
+                                 NULL,
+                                 on_set_bytes, &data);
+
+  while (data.n_done + data.n_cancelled < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (data.n_done, ==, 1);
+  g_assert_cmpint (data.n_cancelled, ==, 1);
+  g_assert_cmpint (cogl_texture_get_width (clutter_image_get_texture (CLUTTER_IMAGE (image))), ==, 4);
+
+  g_bytes_unref (red);
+  g_bytes_unref (blue);
+  g_object_unref (image);
+}
+
+static void
+on_after_paint (ClutterActor *stage,
+                gboolean     *was_painted)
+{
+  *was_painted = TRUE;
+}
+
+static void
+image_texture_budget (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  ClutterActor *stage;
+  ClutterContent *image;
+  gboolean was_painted = FALSE;
+  gfloat width, height;
+  guint8 *pixels;
+  gsize usage;
+  gulong paint_id;
+
+  usage = clutter_backend_get_texture_memory (backend);
+
+  /* too wide for the atlas */
+  pixels = g_malloc0 (256 * 4);
+
+  image = clutter_image_new ();
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          256, 1, 256 * 4,
+                          NULL);
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), ==, usage + 256 * 4);
+
+  /* the image is not used by any mapped actor, so it is evicted
+   * once the stage is painted
+   */
+  clutter_backend_set_texture_budget (backend, 1);
+
+  stage = clutter_test_get_stage ();
+  paint_id = g_signal_connect (stage, "after-paint",
+                               G_CALLBACK (on_after_paint),
+                               &was_painted);
+  clutter_actor_show (stage);
+  clutter_actor_queue_redraw (stage);
+
+  while (!was_painted)
+    g_main_context_iteration (NULL, FALSE);
+
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), <=, usage);
+
+  /* the evicted image keeps its size, and is uploaded again on demand */
+  g_assert (clutter_content_get_preferred_size (image, &width, &height));
+  g_assert_cmpfloat (width, ==, 256);
+  g_assert_cmpfloat (height, ==, 1);
+
+  clutter_backend_set_texture_budget (backend, 0);
+
+  g_assert (clutter_image_get_texture (CLUTTER_IMAGE (image)) != NULL);
+  g_assert_cmpint (cogl_texture_get_width (clutter_image_get_texture (CLUTTER_IMAGE (image))), ==, 256);
+
+  g_signal_handler_disconnect (stage, paint_id);
+  g_object_unref (image);
+  g_free (pixels);
+}
+
+static void
+paint_stage (ClutterActor *stage)
+{
+  gboolean was_painted = FALSE;
+  gulong paint_id;
+
+  paint_id = g_signal_connect (stage, "after-paint",
+                               G_CALLBACK (on_after_paint),
+                               &was_painted);
+  clutter_actor_queue_redraw (stage);
+
+  while (!was_painted)
+    g_main_context_iteration (NULL, FALSE);
+
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+
+  g_signal_handler_disconnect (stage, paint_id);
+}
+
+static void
+image_texture_budget_mapped (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  ClutterActor *stage, *actor;
+  ClutterContent *image;
+  guint8 *pixels;
+  gsize usage;
+
+  usage = clutter_backend_get_texture_memory (backend);
+
+  pixels = g_malloc0 (256 * 4);
+
+  image = clutter_image_new ();
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          256, 1, 256 * 4,
+                          NULL);
+
+  stage = clutter_test_get_stage ();
+  actor = clutter_actor_new ();
+  clutter_actor_set_size (actor, 256, 1);
+  clutter_actor_set_content (actor, image);
+  clutter_actor_add_child (stage, actor);
+  clutter_actor_show (stage);
+
+  clutter_backend_set_texture_budget (backend, 1);
+
+  /* the image of a mapped actor is kept, even when it is culled */
+  clutter_actor_set_position (actor, 0, -100);
+  paint_stage (stage);
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), ==, usage + 256 * 4);
+
+  /* and released once the actor is hidden */
+  clutter_actor_hide (actor);
+  paint_stage (stage);
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), <=, usage);
+
+  clutter_backend_set_texture_budget (backend, 0);
+
+  clutter_actor_destroy (actor);
+  g_object_unref (image);
+  g_free (pixels);
+}
+
+static void
+image_atlas (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  ClutterContent *red, *blue;
+  gfloat width, height;
+  gsize usage;
+
+  red = clutter_image_new ();
+  clutter_image_set_data (CLUTTER_IMAGE (red),
+                          red_pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          2, 2, 8,
+                          NULL);
+
+  /* small images share the texture of the atlas */
+  usage = clutter_backend_get_texture_memory (backend);
+
+  blue = clutter_image_new ();
+  clutter_image_set_data (CLUTTER_IMAGE (blue),
+                          blue_pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          2, 2, 8,
+                          NULL);
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), ==, usage);
+
+  g_assert (clutter_content_get_preferred_size (blue, &width, &height));
+  g_assert_cmpfloat (width, ==, 2);
+  g_assert_cmpfloat (height, ==, 2);
+
+  /* retrieving the texture moves the image out of the atlas */
+  g_assert_cmpint (cogl_texture_get_width (clutter_image_get_texture (CLUTTER_IMAGE (blue))), ==, 2);
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), ==, usage + 16);
+
+  g_object_unref (blue);
+  g_object_unref (red);
+}
+
+static void
+image_atlas_mipmaps (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  ClutterActor *stage, *actor;
+  ClutterContent *image;
+  gboolean was_painted = FALSE;
+  gulong paint_id;
+  gsize usage;
+
+  image = clutter_image_new ();
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          red_pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          2, 2, 8,
+                          NULL);
+
+  usage = clutter_backend_get_texture_memory (backend);
+
+  stage = clutter_test_get_stage ();
+  actor = clutter_actor_new ();
+  clutter_actor_set_size (actor, 1, 1);
+  clutter_actor_set_content (actor, image);
+  clutter_actor_set_content_scaling_filters (actor,
+                                             CLUTTER_SCALING_FILTER_TRILINEAR,
+                                             CLUTTER_SCALING_FILTER_LINEAR);
+  clutter_actor_add_child (stage, actor);
+
+  paint_id = g_signal_connect (stage, "after-paint",
+                               G_CALLBACK (on_after_paint),
+                               &was_painted);
+  clutter_actor_show (stage);
+
+  while (!was_painted)
+    g_main_context_iteration (NULL, FALSE);
+
+  /* mipmapped images are painted from a texture of their own */
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), ==, usage + 16);
+
+  /* and they do not go back into the atlas when their data changes */
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          blue_pixels,
+                          COGL_PIXEL_FORMAT_RGBA_8888,
+                          2, 2, 8,
+                          NULL);
+  g_assert_cmpuint (clutter_backend_get_texture_memory (backend), ==, usage + 16);
+
+  g_signal_handler_disconnect (stage, paint_id);
+  clutter_actor_destroy (actor);
+  g_object_unref (image);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/image/reuse-texture", image_reuse_texture)
+  CLUTTER_TEST_UNIT ("/image/set-bytes-async", image_set_bytes_async)
+  CLUTTER_TEST_UNIT ("/image/texture-budget", image_texture_budget)
+  CLUTTER_TEST_UNIT ("/image/texture-budget-mapped", image_texture_budget_mapped)
+  CLUTTER_TEST_UNIT ("/image/atlas", image_atlas)
+  CLUTTER_TEST_UNIT ("/image/atlas-mipmaps", image_atlas_mipmaps)
+)
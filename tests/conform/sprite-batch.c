@@ -0,0 +1,85 @@
+#include <clutter/clutter.h>
+
+static void
+sprite_batch_hit_test (void)
+{
+  ClutterActor *actor = clutter_sprite_batch_new ();
+  ClutterSpriteBatch *batch = CLUTTER_SPRITE_BATCH (actor);
+  float positions[4] = { 100.f, 100.f, 5.f, 5.f };
+  float x, y;
+
+  g_object_ref_sink (actor);
+
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 5, 5), ==, -1);
+
+  g_assert_cmpuint (clutter_sprite_batch_add_sprite (batch, 0, 0, 10, 10, NULL), ==, 0);
+  g_assert_cmpuint (clutter_sprite_batch_add_sprite (batch, 5, 5, 10, 10, NULL), ==, 1);
+  g_assert_cmpuint (clutter_sprite_batch_add_sprite (batch, 50, 50, 10, 10, NULL), ==, 2);
+  g_assert_cmpuint (clutter_sprite_batch_get_n_sprites (batch), ==, 3);
+
+  /* sprites added later are on top */
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 2, 2), ==, 0);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 7, 7), ==, 1);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 55, 55), ==, 2);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 30, 30), ==, -1);
+
+  clutter_sprite_batch_set_positions (batch, 0, 2, positions);
+  clutter_sprite_batch_get_sprite_position (batch, 0, &x, &y);
+  g_assert_cmpfloat (x, ==, 100.f);
+  g_assert_cmpfloat (y, ==, 100.f);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 2, 2), ==, -1);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 105, 105), ==, 0);
+
+  /* the last sprite takes the place of the removed one */
+  clutter_sprite_batch_remove_sprite (batch, 0);
+  g_assert_cmpuint (clutter_sprite_batch_get_n_sprites (batch), ==, 2);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 105, 105), ==, -1);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 55, 55), ==, 0);
+
+  clutter_sprite_batch_remove_all (batch);
+  g_assert_cmpuint (clutter_sprite_batch_get_n_sprites (batch), ==, 0);
+  g_assert_cmpint (clutter_sprite_batch_get_sprite_at_position (batch, 55, 55), ==, -1);
+
+  g_object_unref (actor);
+}
+
+static void
+sprite_batch_paint (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterActor *actor = clutter_sprite_batch_new ();
+  ClutterSpriteBatch *batch = CLUTTER_SPRITE_BATCH (actor);
+  ClutterColor red = { 255, 0, 0, 255 };
+  ClutterColor blue = { 0, 0, 255, 255 };
+  guchar *pixels;
+  guint i;
+
+  clutter_actor_set_size (actor, 100, 100);
+  clutter_actor_add_child (stage, actor);
+
+  /* enough sprites to need more than one primitive */
+  for (i = 0; i < 20000; i++)
+    clutter_sprite_batch_add_sprite (batch, i % 100, 0, 1, 1, &red);
+
+  clutter_sprite_batch_add_sprite (batch, 10, 10, 20, 20, &blue);
+
+  clutter_actor_show (stage);
+
+  pixels = clutter_stage_read_pixels (CLUTTER_STAGE (stage), 0, 0, 100, 100);
+
+  /* the first row is covered by the red sprites */
+  g_assert_cmpint (pixels[(0 * 100 + 50) * 4 + 0], ==, 255);
+  g_assert_cmpint (pixels[(0 * 100 + 50) * 4 + 2], ==, 0);
+
+  g_assert_cmpint (pixels[(20 * 100 + 20) * 4 + 0], ==, 0);
+  g_assert_cmpint (pixels[(20 * 100 + 20) * 4 + 2], ==, 255);
+
+  g_free (pixels);
+
+  clutter_actor_destroy (actor);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/sprite-batch/hit-test", sprite_batch_hit_test)
+  CLUTTER_TEST_UNIT ("/sprite-batch/paint", sprite_batch_paint)
+)
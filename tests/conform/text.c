@@ -1,6 +1,8 @@
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <clutter/clutter.h>
 #include <string.h>
+#include <math.h>
 
 typedef struct {
   gunichar   unichar;
@@ -533,6 +535,561 @@ text_idempotent_use_markup (void)
   clutter_actor_destroy (CLUTTER_ACTOR (text));
 }
 
+static void
+text_async_layout (void)
+{
+  ClutterActor *sync_text, *async_text;
+  gfloat sync_width, sync_height;
+  gfloat async_width, async_height;
+  GString *contents;
+  gint64 end_time;
+
+  contents = g_string_new (NULL);
+  while (contents->len < 32 * 1024)
+    g_string_append (contents, "The quick brown fox jumps over the lazy dog\n");
+
+  sync_text = clutter_text_new ();
+  clutter_text_set_text (CLUTTER_TEXT (sync_text), contents->str);
+
+  async_text = clutter_text_new ();
+  clutter_text_set_async_layout (CLUTTER_TEXT (async_text), TRUE);
+  g_assert (clutter_text_get_async_layout (CLUTTER_TEXT (async_text)));
+  clutter_text_set_text (CLUTTER_TEXT (async_text), contents->str);
+
+  clutter_actor_get_preferred_size (sync_text, NULL, NULL,
+                                    &sync_width,
+                                    &sync_height);
+
+  /* the first request might return an estimate */
+  clutter_actor_get_preferred_size (async_text, NULL, NULL,
+                                    &async_width,
+                                    &async_height);
+  g_assert_cmpfloat (async_width, >, 0);
+  g_assert_cmpfloat (async_height, >, 0);
+
+  /* the real size is available once the layout has been created */
+  end_time = g_get_monotonic_time () + 5 * G_USEC_PER_SEC;
+  while (async_width != sync_width || async_height != sync_height)
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, end_time);
+
+      if (!g_main_context_iteration (NULL, FALSE))
+        g_usleep (1000);
+
+      clutter_actor_get_preferred_size (async_text, NULL, NULL,
+                                        &async_width,
+                                        &async_height);
+    }
+
+  if (g_test_verbose ())
+    g_print ("Size: %.2f x %.2f\n", async_width, async_height);
+
+  clutter_actor_destroy (async_text);
+  clutter_actor_destroy (sync_text);
+  g_string_free (contents, TRUE);
+}
+
+static void
+text_rope_buffer (void)
+{
+  ClutterTextBuffer *buffer;
+  ClutterText *text;
+  GString *expected;
+  gchar *chars;
+  gint i;
+
+  buffer = clutter_rope_text_buffer_new ();
+  text = CLUTTER_TEXT (clutter_text_new_with_buffer (buffer));
+  g_object_ref_sink (text);
+  g_object_unref (buffer);
+
+  /* mix ASCII and multi-byte characters, and go well past the size
+   * of a single chunk of the rope
+   */
+  expected = g_string_new (NULL);
+  for (i = 0; i < 2000; i++)
+    {
+      const TestData *t = &test_text_data[i % G_N_ELEMENTS (test_text_data)];
+
+      clutter_text_buffer_insert_text (buffer, 2 * i, "a", 1);
+      clutter_text_buffer_insert_text (buffer, 2 * i + 1, t->bytes, 1);
+
+      g_string_append_c (expected, 'a');
+      g_string_append_len (expected, t->bytes, t->nbytes);
+    }
+
+  g_assert_cmpint (clutter_text_buffer_get_length (buffer), ==, 4000);
+  g_assert_cmpint (clutter_text_buffer_get_bytes (buffer), ==, expected->len);
+  g_assert_cmpstr (clutter_text_buffer_get_text (buffer), ==, expected->str);
+
+  /* typing in the middle */
+  clutter_text_buffer_insert_text (buffer, 1001, "xyz", 3);
+  g_string_insert (expected,
+                   g_utf8_offset_to_pointer (expected->str, 1001) - expected->str,
+                   "xyz");
+  g_assert_cmpstr (clutter_text_buffer_get_text (buffer), ==, expected->str);
+
+  /* deleting across chunks */
+  clutter_text_buffer_delete_text (buffer, 500, 2500);
+  g_string_erase (expected,
+                  g_utf8_offset_to_pointer (expected->str, 500) - expected->str,
+                  g_utf8_offset_to_pointer (expected->str, 3000) -
+                  g_utf8_offset_to_pointer (expected->str, 500));
+  g_assert_cmpint (clutter_text_buffer_get_length (buffer), ==, 1503);
+  g_assert_cmpstr (clutter_text_buffer_get_text (buffer), ==, expected->str);
+
+  /* the text actor finds the offsets through the buffer */
+  chars = clutter_text_get_chars (text, 499, 503);
+  g_assert_cmpstr (chars, ==, "\xe2\x99\xa5" "\xc3\xa4" "a" "\xe2\x99\xa5");
+  g_free (chars);
+
+  clutter_text_set_cursor_position (text, 1);
+  clutter_text_set_selection_bound (text, 3);
+  chars = clutter_text_get_selection (text);
+  g_assert_cmpstr (chars, ==, "\xc3\xa4" "a");
+  g_free (chars);
+
+  clutter_text_buffer_delete_text (buffer, 0, -1);
+  g_assert_cmpint (clutter_text_buffer_get_length (buffer), ==, 0);
+  g_assert_cmpstr (clutter_text_buffer_get_text (buffer), ==, "");
+
+  clutter_actor_destroy (CLUTTER_ACTOR (text));
+  g_object_unref (text);
+  g_string_free (expected, TRUE);
+}
+
+static void
+text_paragraphs (void)
+{
+  ClutterText *text, *reference;
+  PangoAttrList *attrs;
+  gfloat height, reference_height;
+  gfloat y, reference_y;
+  GString *contents;
+  gint i, position;
+
+  contents = g_string_new (NULL);
+  for (i = 0; i < 200; i++)
+    g_string_append (contents, "The quick brown fox jumps over the lazy dog.\n");
+
+  text = CLUTTER_TEXT (clutter_text_new ());
+  g_object_ref_sink (text);
+  clutter_text_set_line_wrap (text, TRUE);
+  clutter_text_set_editable (text, TRUE);
+  clutter_text_set_text (text, contents->str);
+
+  /* attributes disable the per-paragraph layouts */
+  reference = CLUTTER_TEXT (clutter_text_new ());
+  g_object_ref_sink (reference);
+  attrs = pango_attr_list_new ();
+  clutter_text_set_attributes (reference, attrs);
+  pango_attr_list_unref (attrs);
+  clutter_text_set_line_wrap (reference, TRUE);
+  clutter_text_set_editable (reference, TRUE);
+  clutter_text_set_text (reference, contents->str);
+
+  for (i = 0; i < 3; i++)
+    {
+      clutter_actor_get_preferred_height (CLUTTER_ACTOR (text), 100, NULL, &height);
+      clutter_actor_get_preferred_height (CLUTTER_ACTOR (reference), 100, NULL, &reference_height);
+      g_assert_cmpfloat (fabsf (height - reference_height), <=, 1.f);
+
+      clutter_actor_set_size (CLUTTER_ACTOR (text), 100, height);
+      clutter_actor_set_size (CLUTTER_ACTOR (reference), 100, reference_height);
+
+      position = clutter_text_buffer_get_length (clutter_text_get_buffer (text)) / 2;
+      g_assert (clutter_text_position_to_coords (text, position, NULL, &y, NULL));
+      g_assert (clutter_text_position_to_coords (reference, position, NULL, &reference_y, NULL));
+      g_assert_cmpfloat (fabsf (y - reference_y), <=, 1.f);
+
+      /* split a paragraph in the middle, and then join two */
+      if (i == 0)
+        {
+          clutter_text_insert_text (text, "jumps\nover\n", position);
+          clutter_text_insert_text (reference, "jumps\nover\n", position);
+        }
+      else
+        {
+          clutter_text_delete_text (text, 40, 50);
+          clutter_text_delete_text (reference, 40, 50);
+        }
+    }
+
+  clutter_actor_destroy (CLUTTER_ACTOR (text));
+  g_object_unref (text);
+  clutter_actor_destroy (CLUTTER_ACTOR (reference));
+  g_object_unref (reference);
+  g_string_free (contents, TRUE);
+}
+
+static void
+text_glyph_cache (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  GError *error = NULL;
+  ClutterText *text, *other;
+  GKeyFile *key_file;
+  gchar *filename;
+  gchar *characters;
+  gint fd;
+
+  /* a missing file is an empty cache */
+  fd = g_file_open_tmp ("clutter-glyph-cache-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  g_close (fd, NULL);
+  g_unlink (filename);
+
+  g_assert (clutter_backend_set_glyph_cache_file (backend, filename, &error));
+  g_assert_no_error (error);
+
+  text = CLUTTER_TEXT (clutter_text_new_full ("Sans 12", "glyph", NULL));
+  g_object_ref_sink (text);
+  clutter_text_get_layout (text);
+
+  clutter_backend_warm_glyph_cache (backend, "Sans 20", "0123");
+
+  /* unsetting the file writes the recorded glyphs */
+  g_assert (clutter_backend_set_glyph_cache_file (backend, NULL, NULL));
+
+  key_file = g_key_file_new ();
+  g_assert (g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, &error));
+  g_assert_no_error (error);
+
+  characters = g_key_file_get_string (key_file, "Glyphs", "Sans 12", &error);
+  g_assert_no_error (error);
+  g_assert (strchr (characters, 'g') != NULL);
+  g_assert (strchr (characters, 'h') != NULL);
+  g_free (characters);
+
+  characters = g_key_file_get_string (key_file, "Glyphs", "Sans 20", &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (characters, ==, "0123");
+  g_free (characters);
+
+  g_key_file_free (key_file);
+  g_unlink (filename);
+
+  /* a new file only gets the glyphs recorded after it was set */
+  g_assert (clutter_backend_set_glyph_cache_file (backend, filename, &error));
+  g_assert_no_error (error);
+
+  other = CLUTTER_TEXT (clutter_text_new_full ("Sans 12", "xyz", NULL));
+  g_object_ref_sink (other);
+  clutter_text_get_layout (other);
+
+  g_assert (clutter_backend_set_glyph_cache_file (backend, NULL, NULL));
+
+  key_file = g_key_file_new ();
+  g_assert (g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, &error));
+  g_assert_no_error (error);
+
+  characters = g_key_file_get_string (key_file, "Glyphs", "Sans 12", &error);
+  g_assert_no_error (error);
+  g_assert (strchr (characters, 'x') != NULL);
+  g_assert (strchr (characters, 'g') == NULL);
+  g_free (characters);
+
+  g_assert (!g_key_file_has_key (key_file, "Glyphs", "Sans 20", NULL));
+
+  g_key_file_free (key_file);
+  g_unlink (filename);
+  g_free (filename);
+
+  clutter_actor_destroy (CLUTTER_ACTOR (other));
+  g_object_unref (other);
+  clutter_actor_destroy (CLUTTER_ACTOR (text));
+  g_object_unref (text);
+}
+
+static guint
+count_pixels (ClutterActor       *stage,
+              gint                x,
+              gint                y,
+              gint                width,
+              gint                height,
+              const ClutterColor *color)
+{
+  guchar *pixels, *p;
+  guint n_pixels = 0;
+  gint i;
+
+  clutter_actor_queue_redraw (stage);
+  pixels = clutter_stage_read_pixels (CLUTTER_STAGE (stage), x, y, width, height);
+
+  for (i = 0, p = pixels; i < width * height; i++, p += 4)
+    {
+      if (ABS (p[0] - color->red) < 64 &&
+          ABS (p[1] - color->green) < 64 &&
+          ABS (p[2] - color->blue) < 64)
+        n_pixels += 1;
+    }
+
+  g_free (pixels);
+
+  return n_pixels;
+}
+
+static void
+text_visible_range (void)
+{
+  ClutterActor *stage, *clip, *reference, *text;
+  GString *contents;
+  guchar *pixels;
+  gint i;
+
+  contents = g_string_new (NULL);
+  for (i = 0; i < 100; i++)
+    g_string_append (contents, "The quick brown fox\n");
+
+  stage = clutter_test_get_stage ();
+  clutter_actor_set_background_color (stage, CLUTTER_COLOR_Black);
+
+  /* only the lines inside the clip of the parent are painted... */
+  clip = clutter_actor_new ();
+  clutter_actor_set_size (clip, 200, 60);
+  clutter_actor_set_clip_to_allocation (clip, TRUE);
+  clutter_actor_add_child (stage, clip);
+
+  text = clutter_text_new_full ("Sans 12", contents->str, CLUTTER_COLOR_White);
+  clutter_actor_set_position (text, 0, -400);
+  clutter_actor_add_child (clip, text);
+
+  /* ...and they look like the ones of a text painted in full */
+  reference = clutter_actor_new ();
+  clutter_actor_set_position (reference, 200, 0);
+  clutter_actor_add_child (stage, reference);
+
+  text = clutter_text_new_full ("Sans 12", contents->str, CLUTTER_COLOR_White);
+  clutter_actor_set_position (text, 0, -400);
+  clutter_actor_add_child (reference, text);
+
+  clutter_actor_show (stage);
+
+  g_assert_cmpuint (count_pixels (stage, 0, 0, 200, 60, CLUTTER_COLOR_White), >, 0);
+
+  clutter_actor_queue_redraw (stage);
+  pixels = clutter_stage_read_pixels (CLUTTER_STAGE (stage), 0, 0, 400, 60);
+  for (i = 0; i < 60; i++)
+    g_assert (memcmp (pixels + i * 400 * 4,
+                      pixels + (i * 400 + 200) * 4,
+                      200 * 4) == 0);
+  g_free (pixels);
+
+  clutter_actor_destroy (reference);
+  clutter_actor_destroy (clip);
+  g_string_free (contents, TRUE);
+}
+
+static void
+text_visible_selection (void)
+{
+  ClutterActor *stage, *clip, *text;
+
+  stage = clutter_test_get_stage ();
+  clutter_actor_set_background_color (stage, CLUTTER_COLOR_Black);
+
+  clip = clutter_actor_new ();
+  clutter_actor_set_size (clip, 200, 100);
+  clutter_actor_set_clip_to_allocation (clip, TRUE);
+  clutter_actor_add_child (stage, clip);
+
+  /* the lines are at the end of the actor, the only part that is
+   * inside the clip
+   */
+  text = clutter_text_new_full ("Sans 12", "a\nb\nc", CLUTTER_COLOR_Blue);
+  clutter_actor_set_position (text, 0, -300);
+  clutter_actor_set_size (text, 200, 400);
+  clutter_actor_set_y_expand (text, TRUE);
+  clutter_actor_set_y_align (text, CLUTTER_ACTOR_ALIGN_END);
+  clutter_text_set_editable (CLUTTER_TEXT (text), TRUE);
+  clutter_text_set_selection_color (CLUTTER_TEXT (text), CLUTTER_COLOR_Red);
+  clutter_actor_add_child (clip, text);
+
+  clutter_actor_show (stage);
+  clutter_stage_set_key_focus (CLUTTER_STAGE (stage), text);
+  clutter_text_set_selection (CLUTTER_TEXT (text), 0, -1);
+
+  /* the selection is painted under the text it covers */
+  g_assert_cmpuint (count_pixels (stage, 0, 0, 200, 100, CLUTTER_COLOR_Red), >, 0);
+
+  clutter_stage_set_key_focus (CLUTTER_STAGE (stage), NULL);
+  clutter_actor_destroy (clip);
+}
+
+static ClutterActor *
+create_measure_container (gboolean independent)
+{
+  ClutterLayoutManager *layout;
+  ClutterActor *container;
+  gint i, j;
+
+  layout = clutter_box_layout_new ();
+  clutter_box_layout_set_orientation (CLUTTER_BOX_LAYOUT (layout),
+                                      CLUTTER_ORIENTATION_VERTICAL);
+  clutter_layout_manager_set_independent_children (layout, independent);
+  g_assert (clutter_layout_manager_get_independent_children (layout) == independent);
+
+  container = clutter_actor_new ();
+  clutter_actor_set_layout_manager (container, layout);
+  g_object_ref_sink (container);
+
+  for (i = 0; i < 8; i++)
+    {
+      ClutterActor *row, *text;
+      GString *contents = g_string_new (NULL);
+
+      for (j = 0; j <= i * 4; j++)
+        g_string_append (contents, "The quick brown fox jumps over the lazy dog. ");
+
+      text = clutter_text_new_full ("Sans 12", contents->str, NULL);
+      clutter_text_set_line_wrap (CLUTTER_TEXT (text), TRUE);
+
+      /* the texts inside the sub-trees of the children are measured too */
+      if (i % 2 == 0)
+        {
+          row = clutter_actor_new ();
+          clutter_actor_set_layout_manager (row, clutter_bin_layout_new (CLUTTER_BIN_ALIGNMENT_FILL,
+                                                                         CLUTTER_BIN_ALIGNMENT_FILL));
+          clutter_actor_add_child (row, text);
+        }
+      else
+        row = text;
+
+      clutter_actor_add_child (container, row);
+      g_string_free (contents, TRUE);
+    }
+
+  return container;
+}
+
+static void
+text_parallel_measure (void)
+{
+  ClutterActor *serial, *parallel;
+  ClutterActor *serial_child, *parallel_child;
+  gfloat serial_min, serial_nat;
+  gfloat parallel_min, parallel_nat;
+  gint i;
+
+  serial = create_measure_container (FALSE);
+  parallel = create_measure_container (TRUE);
+
+  for (i = 0; i < 3; i++)
+    {
+      gfloat for_width = 100.f * (i + 1);
+
+      clutter_actor_get_preferred_width (serial, -1, &serial_min, &serial_nat);
+      clutter_actor_get_preferred_width (parallel, -1, &parallel_min, &parallel_nat);
+      g_assert_cmpfloat (serial_min, ==, parallel_min);
+      g_assert_cmpfloat (serial_nat, ==, parallel_nat);
+
+      clutter_actor_get_preferred_height (serial, for_width, &serial_min, &serial_nat);
+      clutter_actor_get_preferred_height (parallel, for_width, &parallel_min, &parallel_nat);
+      g_assert_cmpfloat (serial_min, ==, parallel_min);
+      g_assert_cmpfloat (serial_nat, ==, parallel_nat);
+    }
+
+  /* the layouts shaped in the threads are the ones used by the children */
+  serial_child = clutter_actor_get_first_child (serial);
+  parallel_child = clutter_actor_get_first_child (parallel);
+  while (serial_child != NULL)
+    {
+      g_assert (parallel_child != NULL);
+
+      clutter_actor_get_preferred_height (serial_child, 300, &serial_min, &serial_nat);
+      clutter_actor_get_preferred_height (parallel_child, 300, &parallel_min, &parallel_nat);
+      g_assert_cmpfloat (serial_min, ==, parallel_min);
+      g_assert_cmpfloat (serial_nat, ==, parallel_nat);
+
+      serial_child = clutter_actor_get_next_sibling (serial_child);
+      parallel_child = clutter_actor_get_next_sibling (parallel_child);
+    }
+
+  clutter_actor_destroy (serial);
+  g_object_unref (serial);
+  clutter_actor_destroy (parallel);
+  g_object_unref (parallel);
+}
+
+static ClutterActor *
+create_label (const gchar *label)
+{
+  ClutterActor *text;
+
+  text = clutter_text_new_full ("Sans 12", label, NULL);
+  g_object_ref_sink (text);
+
+  return text;
+}
+
+static void
+destroy_label (ClutterActor *text)
+{
+  clutter_actor_destroy (text);
+  g_object_unref (text);
+}
+
+static void
+text_shared_layouts (void)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  ClutterActor *text, *other;
+  PangoLayout *layout;
+  cairo_font_options_t *font_options;
+  gchar *label;
+  gint i;
+
+  /* identical labels share their layout */
+  text = create_label ("Shared label");
+  layout = g_object_ref (clutter_text_get_layout (CLUTTER_TEXT (text)));
+
+  other = create_label ("Shared label");
+  g_assert (clutter_text_get_layout (CLUTTER_TEXT (other)) == layout);
+  destroy_label (other);
+
+  other = create_label ("Another label");
+  g_assert (clutter_text_get_layout (CLUTTER_TEXT (other)) != layout);
+  destroy_label (other);
+
+  /* editable texts keep their own layouts */
+  other = create_label ("Shared label");
+  clutter_text_set_editable (CLUTTER_TEXT (other), TRUE);
+  g_assert (clutter_text_get_layout (CLUTTER_TEXT (other)) != layout);
+  destroy_label (other);
+
+  /* the least recently used layouts are evicted */
+  for (i = 0; i < 300; i++)
+    {
+      label = g_strdup_printf ("Label %d", i);
+      other = create_label (label);
+      clutter_text_get_layout (CLUTTER_TEXT (other));
+      destroy_label (other);
+      g_free (label);
+    }
+
+  other = create_label ("Shared label");
+  g_assert (clutter_text_get_layout (CLUTTER_TEXT (other)) != layout);
+  destroy_label (other);
+
+  destroy_label (text);
+  g_object_unref (layout);
+
+  /* the layouts are dropped when the font settings change */
+  text = create_label ("Shared label");
+  layout = g_object_ref (clutter_text_get_layout (CLUTTER_TEXT (text)));
+
+  font_options = cairo_font_options_copy (clutter_backend_get_font_options (backend));
+  clutter_backend_set_font_options (backend, font_options);
+  cairo_font_options_destroy (font_options);
+
+  other = create_label ("Shared label");
+  g_assert (clutter_text_get_layout (CLUTTER_TEXT (other)) != layout);
+  destroy_label (other);
+
+  destroy_label (text);
+  g_object_unref (layout);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/text/utf8-validation", text_utf8_validation)
   CLUTTER_TEST_UNIT ("/text/set-empty", text_set_empty)
@@ -547,4 +1104,12 @@ CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/text/cursor", text_cursor)
   CLUTTER_TEST_UNIT ("/text/event", text_event)
   CLUTTER_TEST_UNIT ("/text/idempotent-use-markup", text_idempotent_use_markup)
+  CLUTTER_TEST_UNIT ("/text/async-layout", text_async_layout)
+  CLUTTER_TEST_UNIT ("/text/parallel-measure", text_parallel_measure)
+  CLUTTER_TEST_UNIT ("/text/shared-layouts", text_shared_layouts)
+  CLUTTER_TEST_UNIT ("/text/rope-buffer", text_rope_buffer)
+  CLUTTER_TEST_UNIT ("/text/paragraphs", text_paragraphs)
+  CLUTTER_TEST_UNIT ("/text/glyph-cache", text_glyph_cache)
+  CLUTTER_TEST_UNIT ("/text/visible-range", text_visible_range)
+  CLUTTER_TEST_UNIT ("/text/visible-selection", text_visible_selection)
 )
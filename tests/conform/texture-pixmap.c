@@ -0,0 +1,108 @@
+#define CLUTTER_DISABLE_DEPRECATION_WARNINGS
+#include <clutter/clutter.h>
+
+#ifdef CLUTTER_WINDOWING_X11
+
+#include <clutter/x11/clutter-x11.h>
+
+#define PIXMAP_SIZE 100
+
+/* a pixmap made of one pixel wide black and white columns, which
+ * alias when painted at a smaller size without mipmaps
+ */
+static Pixmap
+create_striped_pixmap (void)
+{
+  Display *dpy = clutter_x11_get_default_display ();
+  int screen = clutter_x11_get_default_screen ();
+  Pixmap pixmap;
+  GC gc;
+  int x;
+
+  pixmap = XCreatePixmap (dpy, RootWindow (dpy, screen),
+                          PIXMAP_SIZE, PIXMAP_SIZE,
+                          DefaultDepth (dpy, screen));
+
+  gc = XCreateGC (dpy, pixmap, 0, NULL);
+
+  XSetForeground (dpy, gc, WhitePixel (dpy, screen));
+  XFillRectangle (dpy, pixmap, gc, 0, 0, PIXMAP_SIZE, PIXMAP_SIZE);
+
+  XSetForeground (dpy, gc, BlackPixel (dpy, screen));
+  for (x = 0; x < PIXMAP_SIZE; x += 2)
+    XDrawLine (dpy, pixmap, gc, x, 0, x, PIXMAP_SIZE - 1);
+
+  XFreeGC (dpy, gc);
+  XSync (dpy, False);
+
+  return pixmap;
+}
+
+/* paints @actor at @size and tells whether any pixel of its first
+ * row is pure black or white, as happens when the columns are only
+ * filtered linearly
+ */
+static gboolean
+paint_has_pure_columns (ClutterActor *stage,
+                        ClutterActor *actor,
+                        int           size)
+{
+  gboolean retval = FALSE;
+  guchar *pixels;
+  int x;
+
+  clutter_actor_set_size (actor, size, size);
+
+  pixels = clutter_stage_read_pixels (CLUTTER_STAGE (stage), 0, 0, size, 1);
+  g_assert (pixels != NULL);
+
+  for (x = 0; x < size; x++)
+    {
+      if (pixels[x * 4] < 16 || pixels[x * 4] > 239)
+        retval = TRUE;
+    }
+
+  g_free (pixels);
+
+  return retval;
+}
+
+#endif /* CLUTTER_WINDOWING_X11 */
+
+static void
+texture_pixmap_mipmaps (void)
+{
+#ifdef CLUTTER_WINDOWING_X11
+  ClutterActor *stage, *actor;
+  Pixmap pixmap;
+
+  stage = clutter_test_get_stage ();
+
+  pixmap = create_striped_pixmap ();
+  actor = clutter_x11_texture_pixmap_new_with_pixmap (pixmap);
+  clutter_actor_add_child (stage, actor);
+  clutter_actor_show (stage);
+
+  /* at 3/5 of its size the pixmap is not mipmapped, whatever the
+   * view transformation of the stage; the second column of the actor
+   * samples the center of the third column of the pixmap
+   */
+  g_assert (paint_has_pure_columns (stage, actor, 60));
+
+  /* at 1/5 of its size, the columns are averaged */
+  g_assert (!paint_has_pure_columns (stage, actor, 20));
+
+  /* a repeated pixmap is painted at its own size, so it is never
+   * scaled down, and ClutterTexture paints it
+   */
+  clutter_texture_set_repeat (CLUTTER_TEXTURE (actor), TRUE, TRUE);
+  g_assert (paint_has_pure_columns (stage, actor, 20));
+
+  clutter_actor_destroy (actor);
+  XFreePixmap (clutter_x11_get_default_display (), pixmap);
+#endif /* CLUTTER_WINDOWING_X11 */
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/texture-pixmap/mipmaps", texture_pixmap_mipmaps)
+)
@@ -0,0 +1,95 @@
+#include <string.h>
+#include <clutter/clutter.h>
+
+typedef struct {
+  GMutex lock;
+  int n_loads[3];
+  gboolean bad_area;
+} LoadData;
+
+static gboolean
+load_area (ClutterTiledImage           *image,
+           guint                        level,
+           const cairo_rectangle_int_t *area,
+           guint8                      *data,
+           guint                        row_stride,
+           gpointer                     user_data)
+{
+  LoadData *load = user_data;
+  int level_width = (1000 + (1 << level) - 1) >> level;
+  int level_height = (600 + (1 << level) - 1) >> level;
+
+  memset (data, 0xff, row_stride * area->height);
+
+  g_mutex_lock (&load->lock);
+
+  if (level < G_N_ELEMENTS (load->n_loads))
+    load->n_loads[level] += 1;
+
+  if (area->x + area->width > level_width ||
+      area->y + area->height > level_height ||
+      area->width > 256 || area->height > 256)
+    load->bad_area = TRUE;
+
+  g_mutex_unlock (&load->lock);
+
+  return TRUE;
+}
+
+static void
+tiled_image_load_visible (void)
+{
+  ClutterActor *stage, *actor;
+  ClutterContent *image;
+  LoadData load = { 0, };
+  gfloat width, height;
+  int n_fine, n_coarse;
+
+  g_mutex_init (&load.lock);
+
+  image = clutter_tiled_image_new (1000, 600);
+
+  /* 1000x600, 500x300, 250x150 */
+  g_assert_cmpint (clutter_tiled_image_get_n_levels (CLUTTER_TILED_IMAGE (image)), ==, 3);
+
+  g_assert (clutter_content_get_preferred_size (image, &width, &height));
+  g_assert_cmpfloat (width, ==, 1000);
+  g_assert_cmpfloat (height, ==, 600);
+
+  clutter_tiled_image_set_load_func (CLUTTER_TILED_IMAGE (image),
+                                     load_area, &load,
+                                     NULL);
+
+  /* painted at half size, the second level is used */
+  stage = clutter_test_get_stage ();
+  actor = clutter_actor_new ();
+  clutter_actor_set_size (actor, 500, 300);
+  clutter_actor_set_content (actor, image);
+  clutter_actor_add_child (stage, actor);
+  clutter_actor_show (stage);
+
+  do
+    {
+      g_main_context_iteration (NULL, TRUE);
+
+      g_mutex_lock (&load.lock);
+      n_fine = load.n_loads[1];
+      n_coarse = load.n_loads[2];
+      g_mutex_unlock (&load.lock);
+    }
+  while (n_fine < 4 || n_coarse < 1);
+
+  g_mutex_lock (&load.lock);
+  g_assert_cmpint (load.n_loads[0], ==, 0);
+  g_assert_cmpint (load.n_loads[1], ==, 4);
+  g_assert_cmpint (load.n_loads[2], ==, 1);
+  g_assert (!load.bad_area);
+  g_mutex_unlock (&load.lock);
+
+  clutter_actor_destroy (actor);
+  g_object_unref (image);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/tiled-image/load-visible", tiled_image_load_visible)
+)
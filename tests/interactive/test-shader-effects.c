@@ -50,6 +50,7 @@ test_shader_effects_main (int argc, char *argv[])
   clutter_actor_set_position (rect, 415, 215);
   clutter_actor_set_size (rect, 150, 150);
   clutter_actor_animate_with_timeline (rect, CLUTTER_LINEAR, timeline,
+                                       "@effects.blur.radius", 24.0,
                                        "rotation-angle-z", 360.0,
                                        "fixed::anchor-x", 75.0,
                                        "fixed::anchor-y", 75.0,